@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+
+// How an API route is charged
+enum RouteClass {
+  ROUTE_CHEAP,      // Status, toggles, single-signal edits
+  ROUTE_EXPENSIVE,  // Listings, queries, export/import - big buffers and CPU
+  ROUTE_TRANSMIT    // Separate budget so polling can never starve transmits
+};
+
+struct AdmissionLimits {
+  float ratePerSecond;          // General bucket refill per client
+  float burst;                  // General bucket size
+  float transmitRatePerSecond;  // Transmit bucket refill per client
+  float transmitBurst;
+  float expensiveCost;          // Tokens taken by an expensive request
+  int maxExpensive;             // Expensive requests in flight, all clients
+};
+
+struct AdmissionStats {
+  unsigned long accepted;
+  unsigned long rejectedRate;  // Client over its token budget
+  unsigned long rejectedBusy;  // Expensive concurrency cap reached
+};
+
+// Per-client token buckets plus a global cap on expensive work.
+//
+// The device has a single web server task, but the native harnesses call
+// the API from many threads, so the buckets sit behind a mutex; the
+// in-flight count and counters are atomic because streamed responses
+// release their slot from wherever the response is destroyed.
+class AdmissionControl {
+public:
+  explicit AdmissionControl(const AdmissionLimits& limits);
+
+  // Charge a request; on rejection returns false and the seconds the
+  // client should wait, and whether it was the concurrency cap
+  bool admit(uint32_t client, RouteClass route, unsigned long now,
+             uint32_t& retryAfter, bool& busy);
+  void releaseExpensive();
+
+  AdmissionStats stats() const;
+
+private:
+  static const size_t MAX_CLIENTS = 16;
+
+  struct Bucket {
+    uint32_t client;
+    float tokens;
+    float transmitTokens;
+    unsigned long lastRefill;
+  };
+
+  Bucket& bucketFor(uint32_t client, unsigned long now);
+
+  AdmissionLimits limits;
+  std::mutex bucketMutex;
+  Bucket buckets[MAX_CLIENTS];
+  size_t bucketCount;
+  std::atomic<int> expensiveInFlight;
+  std::atomic<unsigned long> accepted;
+  std::atomic<unsigned long> rejectedRate;
+  std::atomic<unsigned long> rejectedBusy;
+};
+
+// Holds one expensive slot until destroyed; share it with a streamed
+// response so the slot lives as long as the response does
+class AdmissionSlot {
+public:
+  explicit AdmissionSlot(AdmissionControl& control) : control(control) {}
+  ~AdmissionSlot() { control.releaseExpensive(); }
+
+private:
+  AdmissionSlot(const AdmissionSlot&);
+  AdmissionSlot& operator=(const AdmissionSlot&);
+
+  AdmissionControl& control;
+};
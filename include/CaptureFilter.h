@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Hal.h"
+
+// Allow/deny lists checked right after decode, so frames nobody cares
+// about (a neighbour's weather station) never reach dedup, storage or
+// feedback. A denied frame is dropped; when there is any allow rule, a
+// frame no allow rule matches is dropped too.
+
+enum FilterList : uint8_t { FILTER_ALLOW, FILTER_DENY };
+
+// Every rule is a protocol set, a bit-length set and a value range. An
+// exact code is one of each with low == high; a format rule covers every
+// value.
+struct FilterRule {
+  uint64_t bitLengths;  // Bit N set = N-bit frames (1-32)
+  uint32_t protocols;   // Bit N set = protocol N (1-31)
+  uint32_t low;         // Inclusive value range
+  uint32_t high;
+  uint32_t id;
+  FilterList list;
+};
+
+const char* filterListName(FilterList list);
+
+// Parses the API's spelling; each absent part matches anything:
+//   protocol  1  or  1,2,5-7
+//   bits      24  or  12-24,32
+//   value     VALUE  or  LOW..HIGH, decimal or 0x hex
+// Returns false and fills error when malformed; id is left at 0.
+bool parseFilterRule(const String& list, const String* protocol, const String* bits, const String* value,
+                     FilterRule& rule, String& error);
+
+// A protocol or bit-length set in the spelling parseFilterRule takes, e.g. "1,3-5"
+String filterSetText(uint64_t set);
+
+// An immutable filter set, compiled by rule shape: exact codes into a hash
+// map, format rules into a protocol x bit-length table, and value ranges
+// into sorted segments, each listing the range rules that cover it. A
+// frame costs a hash probe, an array index and a binary search.
+class FilterTable {
+public:
+  static const size_t MAX_FILTERS = 64;
+
+  explicit FilterTable(const std::vector<FilterRule>& rules);
+
+  // Whether a frame goes on to capture; rule is the index of the rule that
+  // decided, -1 for the default. Counts the match; owner task only.
+  bool admit(const RadioFrame& frame, int& rule) const;
+
+  const std::vector<FilterRule>& rules() const { return source; }  // In id order
+  bool empty() const { return source.empty(); }
+  // Frames a rule decided, since boot or since it was added
+  uint32_t matches(size_t index) const { return matchCounts[index].load(std::memory_order_relaxed); }
+  // Keeps the counts of rules the previous set had; call before publishing
+  void carryMatches(const FilterTable& previous);
+
+private:
+  // Lowest matching rule index per list, -1 = none
+  struct Verdict {
+    int8_t allow;
+    int8_t deny;
+  };
+
+  static const int FORMAT_PROTOCOLS = 32;
+  static const int FORMAT_BITS = 33;
+
+  static void merge(Verdict& verdict, FilterList list, int index);
+  static void merge(Verdict& verdict, const Verdict& other);
+
+  std::vector<FilterRule> source;
+  std::unordered_map<uint64_t, Verdict> codes;  // signalKey() -> verdict
+  std::vector<Verdict> formats;    // [protocol * FORMAT_BITS + bits], empty without format rules
+  std::vector<uint32_t> bounds;    // Range segment starts, ascending
+  std::vector<uint16_t> segments;  // Segment i's rules: covering[segments[i]] up to segments[i + 1]
+  std::vector<uint8_t> covering;   // Range rule indexes, ascending per segment
+  bool anyAllow;
+  std::unique_ptr<std::atomic<uint32_t>[]> matchCounts;
+};
+
+typedef std::shared_ptr<const FilterTable> FilterSet;
+
+// Rules in the key/value store: one "filters" blob, a count byte followed
+// by packed records
+void saveFilters(KeyValueStore& storage, const FilterTable& table);
+// Records that fail validation are skipped
+void loadFilters(KeyValueStore& storage, std::vector<FilterRule>& rules);
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <Arduino.h>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Every state change (HTTP, capture, scheduler) is a command
+enum CommandType {
+  CMD_CAPTURE,
+  CMD_SET_SNIFFING,
+  CMD_SET_BUZZER,
+  CMD_SET_LED,
+  CMD_TRANSMIT,
+  CMD_REPEAT_TRANSMIT,
+  CMD_DELETE_SIGNAL,
+  CMD_RENAME_SIGNAL,
+  CMD_SET_FAVORITE,
+  CMD_CLEAR_SIGNALS,
+  CMD_CLEANUP,
+  CMD_CLEANUP_OLD,
+  CMD_TAG_SIGNAL,
+  CMD_UNTAG_SIGNAL,
+  CMD_DELETE_TAG,
+  CMD_IMPORT,
+  CMD_SET_REPEATER,
+  CMD_REPEATER_CODE,
+  CMD_ADD_RULE,
+  CMD_DELETE_RULE,
+  CMD_ADD_TRANSLATION,
+  CMD_DELETE_TRANSLATION,
+  CMD_ADD_FILTER,
+  CMD_DELETE_FILTER,
+  CMD_SET_ANALYTICS_WINDOW,
+  CMD_RESET_ANALYTICS
+};
+
+struct CommandResult {
+  int status;
+  String message;
+};
+
+struct Command {
+  CommandType type;
+  int id;  // Signal uid, or the rule, translation or filter ID
+  int target;  // Second signal uid, for commands relating two; -1 = none
+  int count;
+  bool flag;
+  unsigned long value;
+  unsigned int bitLength;
+  unsigned int protocol;
+  String text;
+  std::shared_ptr<void> payload;  // Bulk data, type depends on the command
+  unsigned long queuedAt;  // micros() when posted
+  uint32_t trace;  // Capture trace frame, 0 = untraced
+  uint32_t ticket;  // Handed to the caller of call(), 0 = none
+  std::shared_ptr<std::promise<CommandResult>> reply;  // null = fire and forget
+
+  explicit Command(CommandType type)
+    : type(type), id(-1), target(-1), count(0), flag(false), value(0), bitLength(0),
+      protocol(0), queuedAt(0), trace(0), ticket(0) {}
+};
+
+struct CommandStats {
+  unsigned long processed;
+  unsigned long batches;
+  unsigned long rejected;
+  unsigned long commandsPerSecond;
+  unsigned long avgLatencyUs;  // posted -> reply, averaged since last window
+  unsigned long maxLatencyUs;
+};
+
+// Multi-producer queue drained in batches by the single owner task.
+//
+// Producers only touch the queue under its mutex; the owner swaps the whole
+// pending batch out and runs it without holding any lock, so command
+// handlers (and the signal store) need no locking of their own.
+class CommandQueue {
+public:
+  // The last reserved slots only take priority posts
+  CommandQueue(size_t capacity, size_t reserved);
+
+  // Any task: enqueue without waiting for the result
+  bool post(Command command, bool priority = false);
+  // Any task: enqueue and wait up to waitMs for the owner's reply. A command
+  // still queued after that answers 202; result(ticket) has its outcome later.
+  CommandResult call(Command command, unsigned long waitMs, uint32_t& ticket);
+  // Any task: 202 while the command is queued, then its result. Only commands
+  // whose call() gave up are kept, the last MAX_RESULTS of them; 410 otherwise.
+  CommandResult result(uint32_t ticket);
+
+  // Owner task: sleep until work arrives or timeoutMs elapses
+  void waitForWork(unsigned long timeoutMs);
+  // Owner task: take everything queued so far
+  std::deque<Command> takeBatch();
+  // Owner task: fulfil a processed command's reply and account for it
+  void complete(Command& command, const CommandResult& result);
+  void batchFinished(size_t batchSize);
+
+  CommandStats stats();
+
+  static const size_t MAX_RESULTS = 16;
+
+private:
+  struct FinishedCommand {
+    uint32_t ticket;
+    CommandResult result;
+  };
+
+  bool enqueue(Command& command, bool priority, uint32_t* ticket);
+
+  std::mutex queueMutex;
+  std::condition_variable workAvailable;
+  std::deque<Command> pending;
+  size_t capacity;
+  size_t reserved;
+  uint32_t lastTicket;
+
+  // Tickets complete in queue order, so one counter tells queued from done
+  std::mutex resultsMutex;
+  uint32_t completedThrough;
+  std::vector<uint32_t> abandoned;  // Tickets whose caller stopped waiting
+  FinishedCommand finished[MAX_RESULTS];
+  size_t nextFinished;
+
+  std::mutex statsMutex;
+  CommandStats totals;
+  unsigned long windowStart;
+  unsigned long windowCount;
+  unsigned long windowLatencyUs;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+
+// A value the writer shares with the snapshots it publishes. Copies share
+// one instance; after markShared() the next write() gives the writer a
+// private copy first, so a publish only ever copies what its batch changed.
+//
+// Sharing is tracked with a flag the owner sets at publish rather than with
+// use_count(): a reader dropping the last old snapshot would otherwise race
+// with the writer's in-place change.
+template <typename T>
+class CopyOnWrite {
+public:
+  CopyOnWrite() : value(std::make_shared<T>()), shared(false) {}
+
+  const T& operator*() const { return *value; }
+  const T* operator->() const { return value.get(); }
+
+  // Owner task only
+  T& write() {
+    if (shared) {
+      value = std::make_shared<T>(*value);
+      shared = false;
+    }
+    return *value;
+  }
+  // Start over from an empty value without copying the shared one
+  void reset() {
+    value = std::make_shared<T>();
+    shared = false;
+  }
+  // A published snapshot now holds a copy of this one
+  void markShared() { shared = true; }
+
+private:
+  std::shared_ptr<T> value;
+  bool shared;
+};
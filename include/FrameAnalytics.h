@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Arduino.h>
+#include <mutex>
+
+// Streaming statistics over every decoded frame, deduplicated and filtered
+// ones included: which codes are busiest, how many distinct codes are
+// around, and frames per protocol. Each frame is O(1) and memory is fixed.
+
+// Heavy hitters with the Space-Saving algorithm: CAPACITY counters kept in
+// a "stream summary", buckets of equal count in ascending order, so adding
+// a frame or evicting the least counted code never scans. A code's true
+// count lies in [count - error, count], and every code with more than
+// 1/CAPACITY of the frames is present.
+class SpaceSaving {
+public:
+  static const int CAPACITY = 64;
+
+  struct Entry {
+    uint64_t key;
+    uint32_t count;
+    uint32_t error;  // Count inherited from the code it evicted
+  };
+
+  SpaceSaving() { clear(); }
+
+  void add(uint64_t key, uint64_t hash);
+  void clear();
+  // Up to max entries, highest count first
+  size_t top(Entry* out, size_t max) const;
+  size_t size() const { return used; }
+
+private:
+  static const int SLOTS = CAPACITY * 2;  // Open addressing, a power of two
+  static const int16_t NONE = -1;
+
+  struct Counter {
+    Entry entry;
+    uint64_t hash;
+    int16_t bucket;
+    int16_t prev;  // Within the bucket
+    int16_t next;
+  };
+
+  struct Bucket {
+    uint32_t count;
+    int16_t first;  // Counter
+    int16_t prev;   // Bucket with the next lower count
+    int16_t next;
+  };
+
+  int find(uint64_t key, uint64_t hash) const;
+  void unindex(int slot);
+  void increment(int counter);
+  void attach(int counter, int bucket);
+  void detach(int counter);
+  int newBucket(uint32_t count, int after);
+  void freeBucket(int bucket);
+
+  Counter counters[CAPACITY];
+  Bucket buckets[CAPACITY + 1];
+  int16_t index[SLOTS];  // Counter per slot, NONE = empty
+  int16_t used;
+  int16_t freeBuckets;
+  int16_t lowest;   // Bucket with the smallest count
+  int16_t highest;
+};
+
+// Distinct count with HyperLogLog: 2^PRECISION one-byte registers, a
+// standard error of 1.04 / sqrt(2^PRECISION), about 3%
+class HyperLogLog {
+public:
+  static const int PRECISION = 10;
+  static const int REGISTERS = 1 << PRECISION;
+
+  HyperLogLog() { clear(); }
+
+  void add(uint64_t hash);
+  double estimate() const;
+  void clear();
+
+private:
+  uint8_t registers[REGISTERS];
+};
+
+struct AnalyticsReport {
+  static const int TOP = 10;
+  static const int PROTOCOLS = 32;  // Slot 0 holds protocols above 31
+
+  unsigned long start;   // millis() the window began
+  unsigned long length;  // How long it ran, ms
+  uint32_t frames;
+  uint32_t distinct;     // Estimate
+  uint32_t protocolFrames[PROTOCOLS];
+  SpaceSaving::Entry top[TOP];
+  size_t topCount;
+};
+
+// The sketches for the current window, and the summary of the last
+// complete one. record() runs on the owner task; report() on any task.
+class FrameAnalytics {
+public:
+  // windowMs 0 = a single window that only reset() ends
+  explicit FrameAnalytics(unsigned long windowMs);
+
+  void record(uint64_t key, unsigned int protocol, unsigned long now);
+  // Both start a new window
+  void setWindow(unsigned long windowMs, unsigned long now);
+  void reset(unsigned long now);
+
+  unsigned long window() const { return windowMs; }
+  // previousValid is false until a window has completed
+  void report(unsigned long now, AnalyticsReport& current, AnalyticsReport& previous, bool& previousValid);
+
+  static uint64_t hashKey(uint64_t key);
+
+private:
+  void rollOver(unsigned long now);
+  void summarize(unsigned long now, AnalyticsReport& report) const;
+  void restart(unsigned long now);
+
+  std::mutex lock;  // Held for a frame or a copy, never across I/O
+  unsigned long windowMs;
+  unsigned long start;
+  uint32_t frames;
+  uint32_t protocolFrames[AnalyticsReport::PROTOCOLS];
+  SpaceSaving hitters;
+  HyperLogLog distinct;
+  AnalyticsReport last;
+  bool lastValid;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Hardware the firmware core depends on. The ESP32 build implements these
+// over RCSwitch, Preferences, ledc and the Arduino clock (src/main.cpp);
+// the native build uses in-memory and file-backed stand-ins (src/native/).
+
+struct RadioFrame {
+  unsigned long value;
+  unsigned int bitLength;
+  unsigned int protocol;
+};
+
+class Radio {
+public:
+  virtual ~Radio() {}
+
+  // Next decoded frame, if one is waiting
+  virtual bool receive(RadioFrame& frame) = 0;
+  virtual void transmit(const RadioFrame& frame) = 0;
+};
+
+// Preferences-style key/value namespace
+class KeyValueStore {
+public:
+  virtual ~KeyValueStore() {}
+
+  virtual int getInt(const char* key, int fallback) = 0;
+  virtual void putInt(const char* key, int value) = 0;
+  virtual unsigned int getUInt(const char* key, unsigned int fallback) = 0;
+  virtual void putUInt(const char* key, unsigned int value) = 0;
+  virtual unsigned long getULong(const char* key, unsigned long fallback) = 0;
+  virtual void putULong(const char* key, unsigned long value) = 0;
+  virtual bool getBool(const char* key, bool fallback) = 0;
+  virtual void putBool(const char* key, bool value) = 0;
+  virtual String getString(const char* key, const String& fallback) = 0;
+  virtual void putString(const char* key, const String& value) = 0;
+  virtual size_t getBytesLength(const char* key) = 0;
+  virtual size_t getBytes(const char* key, void* buffer, size_t maxLength) = 0;
+  virtual void putBytes(const char* key, const void* data, size_t length) = 0;
+};
+
+class Clock {
+public:
+  virtual ~Clock() {}
+
+  virtual unsigned long millis() = 0;
+  virtual unsigned long micros() = 0;
+  // Cheap high-resolution counter for overhead accounting (CPU cycles on ESP32)
+  virtual uint32_t cycles() = 0;
+};
+
+// Buzzer and LED; the core decides when, and whether they are enabled
+class Feedback {
+public:
+  virtual ~Feedback() {}
+
+  virtual void playReceiveSound() = 0;
+  virtual void playTransmitSound() = 0;
+  virtual void playStartupSound() = 0;
+  virtual void flashLED(int duration, int times) = 0;
+};
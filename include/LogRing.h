@@ -0,0 +1,142 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// Deferred logging: call sites store a message ID and up to four numeric
+// arguments in a RAM ring, and a low-priority task formats and prints them
+// later. Calls below RF_LOG_LEVEL compile to nothing.
+#define RF_LOG_LEVEL_DEBUG 0
+#define RF_LOG_LEVEL_INFO 1
+#define RF_LOG_LEVEL_WARN 2
+#define RF_LOG_LEVEL_ERROR 3
+#define RF_LOG_LEVEL_NONE 4
+
+#ifndef RF_LOG_LEVEL
+#define RF_LOG_LEVEL RF_LOG_LEVEL_INFO
+#endif
+
+// Every loggable message; formats take only %u arguments
+#define RF_LOG_MESSAGES(X) \
+  X(LOG_RECEIVED, "Received: %u / %ubit Protocol: %u") \
+  X(LOG_QUEUE_FULL, "Command queue full! Signal dropped.") \
+  X(LOG_STORED, "Signal stored (%u/%u)") \
+  X(LOG_STORAGE_FULL, "Storage full! Signal not saved.") \
+  X(LOG_DUPLICATE_UPDATED, "Duplicate signal detected - timestamp updated") \
+  X(LOG_DUPLICATE_IGNORED, "Duplicate signal ignored.") \
+  X(LOG_CLEANUP_STARTED, "Storage nearly full, performing automatic cleanup...") \
+  X(LOG_CLEANUP_DONE, "Cleanup complete: Removed %u old signals, storage now %u/%u") \
+  X(LOG_TRANSMITTING, "Transmitting: %u / %ubit Protocol: %u") \
+  X(LOG_REPEAT_STARTED, "Starting repeat transmission: %u times") \
+  X(LOG_REPEAT_PROGRESS, "Transmitted %u/%u") \
+  X(LOG_REPEAT_DONE, "Repeat transmission completed: %u times") \
+  X(LOG_REPEATED, "Repeated: %u / %ubit Protocol: %u") \
+  X(LOG_ECHO_SUPPRESSED, "Own transmission received - ignored") \
+  X(LOG_FILTERED, "Signal filtered out") \
+  X(LOG_RULE_FIRED, "Rule %u fired (action %u)") \
+  X(LOG_TRANSLATED, "Translation %u sent: %u / %ubit Protocol: %u") \
+  X(LOG_IMPORTED, "Imported %u signals (%u duplicates, %u over capacity)")
+
+enum LogMessage : uint8_t {
+#define RF_LOG_ENUM(id, format) id,
+  RF_LOG_MESSAGES(RF_LOG_ENUM)
+#undef RF_LOG_ENUM
+  LOG_MESSAGE_COUNT
+};
+
+enum LogLevel : uint8_t {
+  LOG_DEBUG = RF_LOG_LEVEL_DEBUG,
+  LOG_INFO = RF_LOG_LEVEL_INFO,
+  LOG_WARN = RF_LOG_LEVEL_WARN,
+  LOG_ERROR = RF_LOG_LEVEL_ERROR
+};
+
+struct LogEntry {
+  uint32_t sequence;  // Position in the ring since boot
+  uint32_t timestampUs;
+  LogLevel level;
+  LogMessage message;
+  uint8_t argCount;
+  uint32_t args[4];
+};
+
+// Fixed-size ring of log entries, written the same way as TraceRing: any
+// task or ISR claims a slot with one atomic increment and never waits.
+// One consumer drains it in order; readers of recent entries skip slots
+// overwritten while being copied.
+class LogRing {
+public:
+  static const size_t CAPACITY = 128;
+  static const size_t MAX_ARGS = 4;
+
+  LogRing();
+
+  void record(LogLevel level, LogMessage message, uint32_t timestampUs,
+              const uint32_t* args, uint8_t argCount);
+  // Single consumer: hands over up to max entries not drained yet, oldest
+  // first, and returns how many were overwritten before it got to them
+  uint32_t drain(const std::function<void(const LogEntry&)>& write, size_t max);
+  // Retained entries with sequence >= since, oldest first
+  void recent(std::vector<LogEntry>& entries, uint32_t since) const;
+
+  uint32_t recorded() const { return head.load(std::memory_order_relaxed); }
+  uint32_t lost() const { return lostTotal.load(std::memory_order_relaxed); }
+
+  // Renders the entry's message; returns the length snprintf would write
+  static int format(const LogEntry& entry, char* buffer, size_t size);
+  static const char* levelName(LogLevel level);
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;  // Position + 1 once written, 0 while writing
+    std::atomic<uint32_t> timestampUs;
+    std::atomic<uint32_t> header;    // level | message << 8 | argCount << 16
+    std::atomic<uint32_t> args[MAX_ARGS];
+  };
+
+  bool read(uint32_t position, LogEntry& entry) const;
+
+  Slot slots[CAPACITY];
+  std::atomic<uint32_t> head;
+  uint32_t drained;  // Consumer only
+  std::atomic<uint32_t> lostTotal;
+};
+
+extern LogRing logRing;
+
+inline void logRecord(LogLevel level, LogMessage message) {
+  logRing.record(level, message, micros(), nullptr, 0);
+}
+
+template <typename... Args>
+inline void logRecord(LogLevel level, LogMessage message, Args... args) {
+  static_assert(sizeof...(Args) <= LogRing::MAX_ARGS, "Log messages take at most four arguments");
+  const uint32_t values[] = {(uint32_t)args...};
+  logRing.record(level, message, micros(), values, sizeof...(Args));
+}
+
+#if RF_LOG_LEVEL <= RF_LOG_LEVEL_DEBUG
+#define RF_LOGD(...) logRecord(LOG_DEBUG, __VA_ARGS__)
+#else
+#define RF_LOGD(...) ((void)0)
+#endif
+
+#if RF_LOG_LEVEL <= RF_LOG_LEVEL_INFO
+#define RF_LOGI(...) logRecord(LOG_INFO, __VA_ARGS__)
+#else
+#define RF_LOGI(...) ((void)0)
+#endif
+
+#if RF_LOG_LEVEL <= RF_LOG_LEVEL_WARN
+#define RF_LOGW(...) logRecord(LOG_WARN, __VA_ARGS__)
+#else
+#define RF_LOGW(...) ((void)0)
+#endif
+
+#if RF_LOG_LEVEL <= RF_LOG_LEVEL_ERROR
+#define RF_LOGE(...) logRecord(LOG_ERROR, __VA_ARGS__)
+#else
+#define RF_LOGE(...) ((void)0)
+#endif
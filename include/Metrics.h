@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+// Allocation-free metrics in Prometheus text format.
+//
+// Every metric links itself into a static list for its lifetime; define
+// them as globals or members of long-lived objects. Recording only touches
+// atomics; text is built when /metrics is scraped. Metrics sharing a name (different labels)
+// must be defined next to each other so HELP/TYPE is written once.
+class Metric {
+public:
+  enum Type { COUNTER, GAUGE, HISTOGRAM };
+
+  Metric(const char* name, const char* help, Type type, const char* labels = nullptr);
+  virtual ~Metric();
+
+  static Metric* first() { return head; }
+  Metric* nextMetric() const { return next; }
+
+  // Append HELP/TYPE (unless the previous metric had the same name) and samples
+  void render(String& out, const Metric* previous) const;
+
+  const char* name;
+  const char* help;
+  Type type;
+  const char* labels;  // e.g. reason="queue_full", may be null
+
+  // Append one sample line: name+suffix{labels,extraLabels} value
+  static void sample(String& out, const char* name, const char* suffix,
+                     const char* labels, const char* extraLabels, double value);
+
+protected:
+  virtual void renderSamples(String& out) const = 0;
+
+private:
+  Metric(const Metric&);
+  Metric& operator=(const Metric&);
+
+  static Metric* head;
+  static Metric* tail;
+  Metric* next;
+};
+
+class Counter : public Metric {
+public:
+  Counter(const char* name, const char* help, const char* labels = nullptr)
+    : Metric(name, help, COUNTER, labels), value(0) {}
+
+  void increment(uint32_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+  uint32_t get() const { return value.load(std::memory_order_relaxed); }
+
+protected:
+  void renderSamples(String& out) const override;
+
+private:
+  std::atomic<uint32_t> value;
+};
+
+class Gauge : public Metric {
+public:
+  Gauge(const char* name, const char* help, const char* labels = nullptr)
+    : Metric(name, help, GAUGE, labels), value(0) {}
+
+  void set(int32_t v) { value.store(v, std::memory_order_relaxed); }
+
+protected:
+  void renderSamples(String& out) const override;
+
+private:
+  std::atomic<int32_t> value;
+};
+
+// Counter or gauge read from elsewhere at scrape time (heap, stacks, stats)
+class SampledMetric : public Metric {
+public:
+  typedef std::function<double()> Sampler;
+
+  SampledMetric(const char* name, const char* help, Type type, Sampler sampler,
+                const char* labels = nullptr)
+    : Metric(name, help, type, labels), sampler(sampler) {}
+
+protected:
+  void renderSamples(String& out) const override;
+
+private:
+  Sampler sampler;
+};
+
+// Fixed-bucket histogram of microsecond durations, exported in seconds
+struct HistogramData {
+  static const size_t MAX_BUCKETS = 12;
+
+  std::atomic<uint32_t> buckets[MAX_BUCKETS + 1];  // Last one is +Inf
+  std::atomic<uint64_t> sumUs;
+  std::atomic<uint32_t> count;
+
+  HistogramData();
+  void observe(const uint32_t* bounds, size_t boundCount, uint32_t valueUs);
+  void render(String& out, const char* name, const char* labels,
+              const uint32_t* bounds, size_t boundCount) const;
+};
+
+// Default latency buckets: 100 us .. 5 s
+extern const uint32_t LATENCY_BUCKETS_US[];
+extern const size_t LATENCY_BUCKET_COUNT;
+
+class Histogram : public Metric {
+public:
+  Histogram(const char* name, const char* help, const char* labels = nullptr,
+            const uint32_t* bounds = LATENCY_BUCKETS_US, size_t boundCount = LATENCY_BUCKET_COUNT);
+
+  void observe(uint32_t valueUs) { data.observe(bounds, boundCount, valueUs); }
+
+protected:
+  void renderSamples(String& out) const override;
+
+private:
+  const uint32_t* bounds;
+  size_t boundCount;
+  HistogramData data;
+};
+
+// One histogram per HTTP route, children claimed while routes are set up.
+// The table grows with each route registered, so add() must be done before
+// the server starts; observing never allocates.
+class RouteHistogram : public Metric {
+public:
+  RouteHistogram(const char* name, const char* help);
+
+  // route and method must be string literals; the child lives as long as this
+  HistogramData* add(const char* route, const char* method);
+  void observe(HistogramData* child, uint32_t valueUs) {
+    child->observe(LATENCY_BUCKETS_US, LATENCY_BUCKET_COUNT, valueUs);
+  }
+  size_t size() const { return children.size(); }
+
+protected:
+  void renderSamples(String& out) const override;
+
+private:
+  struct Child {
+    const char* route;
+    const char* method;
+    HistogramData data;
+  };
+
+  std::deque<Child> children;  // Never moves a child once added
+};
+
+// Streams the registry a metric at a time for a chunked response
+class MetricsExporter {
+public:
+  MetricsExporter() : current(Metric::first()), previous(nullptr), offset(0) {}
+
+  size_t read(uint8_t* buffer, size_t maxLength);
+
+private:
+  const Metric* current;
+  const Metric* previous;
+  String pending;
+  size_t offset;
+};
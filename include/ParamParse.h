@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Strict, allocation-free parsing of untrusted request parameters.
+//
+// Unlike String::toInt(), empty input, anything but an optional sign and
+// digits, and values outside [min, max] are errors instead of silently
+// becoming 0 or wrapping. parseUInt32 takes digits only.
+bool parseLong(const char* text, size_t length, long min, long max, long& value);
+bool parseInt(const String& text, int min, int max, int& value);
+bool parseUInt32(const String& text, uint32_t& value);
+// Digits, or 0x and hex digits, at most 32 bits: RF codes
+bool parseCode(const char* text, size_t length, uint32_t& value);
+
+// "true"/"1" or "false"/"0"
+bool parseBool(const char* text, size_t length, bool& value);
+bool parseBool(const String& text, bool& value);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+// CPU share needs FreeRTOS run-time stats (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+#if defined(configGENERATE_RUN_TIME_STATS) && configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+#define RF_PROFILE_RUN_TIME 1
+#else
+#define RF_PROFILE_RUN_TIME 0
+#endif
+
+struct TaskProfile {
+  String name;
+  int core;               // -1 = not pinned
+  unsigned int priority;
+  uint32_t stackFreeMin;  // Bytes, lowest seen
+  float cpuPercent;       // Share of its core over the last second, -1 = unknown
+};
+
+// Sliding windows over the last 1, 10 and 60 seconds
+enum ProfileWindow { WINDOW_1S, WINDOW_10S, WINDOW_60S, WINDOW_COUNT };
+
+struct ProfileSnapshot {
+  uint32_t uptimeMs;
+  bool runTimeStats;
+  float coreBusyPercent[portNUM_PROCESSORS];  // 100 - idle task share, -1 = unknown
+  float loopRate[WINDOW_COUNT];               // loop() iterations per second
+  float loopBusyPercent[WINDOW_COUNT];        // Time loop() spends outside its wait
+  uint32_t loopMaxUs;                         // Longest iteration in the last second
+  std::vector<TaskProfile> tasks;
+};
+
+// Samples task state once a second on the owner task and publishes an
+// immutable snapshot for /api/profile, like SignalStore does for signals.
+class Profiler {
+public:
+  typedef std::shared_ptr<const ProfileSnapshot> Snapshot;
+
+  Profiler();
+
+  // Owner task: account one loop() pass that did busyUs of work
+  void loopIteration(uint32_t busyUs);
+  // Owner task: closes the current second and republishes when it's over
+  void tick(uint32_t nowMs);
+
+  // Any task
+  Snapshot snapshot() const;
+
+private:
+  static const size_t SECONDS = 60;
+
+  struct RunTime {
+    TaskHandle_t task;
+    uint32_t counter;
+  };
+
+  void sampleTasks(ProfileSnapshot& profile);
+
+  uint32_t iterations[SECONDS];
+  uint32_t busyUs[SECONDS];
+  size_t filled;
+  size_t current;
+  uint32_t currentMaxUs;
+  uint32_t lastTickMs;
+  std::vector<RunTime> lastRunTimes;
+  uint32_t lastTotalRunTime;
+  Snapshot published;
+};
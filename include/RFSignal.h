@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Signal storage structure
+struct RFSignal {
+  uint32_t uid;  // Stable across deletes and cleanup (API "id" is the list position)
+  String name;
+  unsigned long value;
+  unsigned int bitLength;
+  unsigned int protocol;
+  unsigned long timestamp;
+  bool isFavorite;
+};
+
+// Longest signal name in bytes. Rename rejects longer names and import cuts
+// them short; the binary export format itself could carry 255.
+static const unsigned int MAX_NAME_LENGTH = 64;
+
+// Dedup key: two captures are the same signal when value, bit length and
+// protocol all match
+inline uint64_t signalKey(unsigned long value, unsigned int bitLength, unsigned int protocol) {
+  return ((uint64_t)(uint32_t)value << 32) | ((bitLength & 0xFF) << 8) | (protocol & 0xFF);
+}
+
+inline uint64_t signalKey(const RFSignal& signal) {
+  return signalKey(signal.value, signal.bitLength, signal.protocol);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Compressed set of 32-bit ids in the style of Roaring bitmaps.
+//
+// Ids are split into 65536-wide chunks keyed by their high 16 bits. Sparse
+// chunks are sorted uint16 arrays, dense chunks (more than 4096 members)
+// are 8 KB bitsets, so set operations between dense chunks run a 64-bit
+// word at a time.
+class RoaringBitmap {
+public:
+  void add(uint32_t id);
+  void remove(uint32_t id);
+  bool contains(uint32_t id) const;
+  size_t cardinality() const;
+  bool empty() const { return containers.empty(); }
+  void clear() { containers.clear(); }
+
+  // Ascending ids
+  void toVector(std::vector<uint32_t>& ids) const;
+
+  static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b);
+  static RoaringBitmap unite(const RoaringBitmap& a, const RoaringBitmap& b);
+  static RoaringBitmap subtract(const RoaringBitmap& a, const RoaringBitmap& b);
+
+  // Portable little-endian encoding for persistence
+  void serialize(std::vector<uint8_t>& out) const;
+  bool deserialize(const uint8_t* data, size_t length);
+
+  size_t memoryUsage() const;
+
+private:
+  static const size_t ARRAY_LIMIT = 4096;
+  static const size_t BITSET_WORDS = 1024;
+
+  struct Container {
+    uint16_t key;
+    uint32_t count;
+    std::vector<uint16_t> array;  // Used while sparse
+    std::vector<uint64_t> bits;   // Used once dense
+
+    bool isBitset() const { return !bits.empty(); }
+    bool contains(uint16_t low) const;
+    bool add(uint16_t low);
+    bool remove(uint16_t low);
+    void toBitset();
+    void toArray();
+    void normalize();
+  };
+
+  enum Operation { AND, OR, ANDNOT };
+
+  Container* find(uint16_t key);
+  const Container* find(uint16_t key) const;
+  static Container combine(const Container& a, const Container& b, Operation operation);
+  static RoaringBitmap combine(const RoaringBitmap& a, const RoaringBitmap& b, Operation operation);
+
+  std::vector<Container> containers;  // Sorted by key
+};
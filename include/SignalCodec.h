@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "SignalStore.h"
+
+// Library backup formats.
+//
+// NDJSON: one JSON object per line
+//   {"uid":3,"name":"Gate","value":5393,"bitLength":24,"protocol":1,
+//    "timestamp":81234,"isFavorite":true,"tags":["garage"]}
+//
+// Binary: "RF43" + version byte, then per record (little endian)
+//   u32 uid, u32 value, u8 bitLength, u8 protocol, u8 flags (bit 0 favorite),
+//   u32 timestamp, u8 name length + name, u8 tag count + (u8 length + tag)*
+enum ExportFormat {
+  EXPORT_NDJSON,
+  EXPORT_BINARY
+};
+
+// Produces an export a chunk at a time from a fixed snapshot, so the
+// whole library is never held in memory as text
+class SignalExporter {
+public:
+  SignalExporter(SignalStore::Snapshot snapshot, ExportFormat format);
+
+  // Fill up to maxLength bytes; returns 0 once everything was written
+  size_t read(uint8_t* buffer, size_t maxLength);
+
+private:
+  bool encodeNext();
+
+  SignalStore::Snapshot snapshot;
+  ExportFormat format;
+  size_t position;
+  bool headerWritten;
+  std::vector<uint8_t> record;
+  size_t recordOffset;
+};
+
+struct ImportedSignal {
+  RFSignal signal;
+  std::vector<String> tags;
+};
+
+// Incremental parser for uploads in either format (detected from the
+// first bytes). Records are staged until the upload completes.
+class SignalImporter {
+public:
+  static const size_t MAX_RECORD_LENGTH = 1024;
+
+  explicit SignalImporter(size_t maxRecords);
+
+  // Returns false once the stream is malformed; see error()
+  bool feed(const uint8_t* data, size_t length);
+  bool finish();
+
+  const String& error() const { return failure; }
+  std::vector<ImportedSignal>& records() { return staged; }
+
+private:
+  enum Mode { DETECT, NDJSON, BINARY };
+
+  bool parseLine(const char* line, size_t length);
+  // Decodes one binary record at pending[start]; returns its length,
+  // 0 when more data is needed or -1 when malformed
+  int parseBinaryRecord(size_t start);
+  bool stage(const ImportedSignal& imported);
+  bool fail(const String& message);
+
+  size_t maxRecords;
+  Mode mode;
+  std::vector<uint8_t> pending;
+  std::vector<ImportedSignal> staged;
+  String failure;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "CopyOnWrite.h"
+#include "RFSignal.h"
+
+// Secondary indexes, each can be compiled out with -DRF_INDEX_<NAME>=0
+#ifndef RF_INDEX_PROTOCOL
+#define RF_INDEX_PROTOCOL 1
+#endif
+#ifndef RF_INDEX_TIME
+#define RF_INDEX_TIME 1
+#endif
+#ifndef RF_INDEX_NAME
+#define RF_INDEX_NAME 1
+#endif
+
+// Per-protocol posting lists of uids, kept sorted
+class ProtocolIndex {
+public:
+  static const unsigned int MAX_PROTOCOL = 31;
+
+  void insert(unsigned int protocol, uint32_t uid);
+  void erase(unsigned int protocol, uint32_t uid);
+  void clear();
+  const std::vector<uint32_t>& postings(unsigned int protocol) const { return lists[protocol]; }
+  size_t memoryUsage() const;
+
+private:
+  std::vector<uint32_t> lists[MAX_PROTOCOL + 1];
+};
+
+// Sorted array of (last seen, uid)
+class TimeIndex {
+public:
+  struct Entry {
+    unsigned long timestamp;
+    uint32_t uid;
+    bool operator<(const Entry& other) const {
+      return timestamp < other.timestamp || (timestamp == other.timestamp && uid < other.uid);
+    }
+  };
+
+  void insert(unsigned long timestamp, uint32_t uid);
+  void erase(unsigned long timestamp, uint32_t uid);
+  void clear() { entries.clear(); }
+  // Entries with timestamp >= since, oldest first
+  const Entry* begin(unsigned long since) const;
+  const Entry* end() const { return entries.data() + entries.size(); }
+  size_t memoryUsage() const { return entries.capacity() * sizeof(Entry); }
+
+private:
+  std::vector<Entry> entries;
+};
+
+// Character trie over signal names with uid lists at terminal nodes.
+// Nodes and list cells are pooled in flat arrays; erased cells, and nodes
+// no remaining name passes through, are recycled.
+class NameTrie {
+public:
+  NameTrie();
+
+  void insert(const String& name, uint32_t uid);
+  void erase(const String& name, uint32_t uid);
+  void clear();
+  // Append the uids of every name starting with prefix
+  void findPrefix(const String& prefix, std::vector<uint32_t>& uids) const;
+  size_t memoryUsage() const;
+
+private:
+  struct Node {
+    int32_t child;
+    int32_t sibling;
+    int32_t firstCell;
+    char key;
+  };
+  struct Cell {
+    uint32_t uid;
+    int32_t next;
+  };
+
+  int32_t findChild(int32_t node, char key) const;
+  int32_t findNode(const String& text) const { return walk(text, text.length()); }
+  // Node for the first length characters of text, or -1
+  int32_t walk(const String& text, unsigned int length) const;
+  void collect(int32_t node, std::vector<uint32_t>& uids) const;
+
+  std::vector<Node> nodes;
+  std::vector<Cell> cells;
+  int32_t freeCells;
+  int32_t freeNodes;  // Chained through sibling
+};
+
+// The set of enabled indexes, maintained by SignalStore on every change.
+// Snapshots share each index until a change touches it.
+struct SignalIndexes {
+#if RF_INDEX_PROTOCOL
+  CopyOnWrite<ProtocolIndex> protocol;
+#endif
+#if RF_INDEX_TIME
+  CopyOnWrite<TimeIndex> time;
+#endif
+#if RF_INDEX_NAME
+  CopyOnWrite<NameTrie> name;
+#endif
+
+  void onInsert(const RFSignal& signal);
+  void onErase(const RFSignal& signal);
+  void onUpdate(const RFSignal& before, const RFSignal& after);
+  void clear();
+  void markShared();
+};
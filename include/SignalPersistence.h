@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Hal.h"
+#include "SignalStore.h"
+
+// Library layout in the key/value store: signalCount, nextId, then
+// sigN_name/val/bits/proto/time/fav/uid per signal and tagN_name/bits per tag
+
+// Writes the whole library; nextId is the next uid to hand out
+void saveSignals(KeyValueStore& storage, const SignalStore& store, int nextId);
+
+// Loads at most capacity signals into an empty store and publishes it,
+// skipping records that fail validation. Returns true when records were
+// migrated or repaired and should be saved again.
+bool loadSignals(KeyValueStore& storage, SignalStore& store, int& nextId, int capacity);
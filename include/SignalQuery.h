@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "SignalStore.h"
+
+// Compiled form of a /api/signals/query filter expression.
+//
+// Clauses are joined with "and":
+//   protocol in {1,2}    protocol = 1
+//   bits in 24..32       bits = 24    bits >= 12    bits <= 32
+//   seen < 3600          (last seen within the past N seconds)
+//   name ^= "Garage"     (name prefix, quotes optional)
+//   favorite             !favorite
+struct SignalQuery {
+  uint32_t protocolMask;  // bit N set = protocol N allowed
+  uint8_t minBits;
+  uint8_t maxBits;
+  unsigned long maxAgeMs;  // 0 = any age
+  String namePrefix;
+  int8_t favorite;  // -1 any, 0 not favorite, 1 favorite
+
+  SignalQuery();
+};
+
+// Returns false and fills error on a malformed expression
+bool compileSignalQuery(const String& text, SignalQuery& query, String& error);
+
+// Where a query's candidates came from; QUERY_SCAN = every row
+enum QueryIndex { QUERY_SCAN, QUERY_PROTOCOL, QUERY_TIME, QUERY_NAME };
+
+const char* queryIndexName(QueryIndex index);
+
+// Scan the snapshot columns and append matching indexes in store order.
+// Returns the index that narrowed the scan.
+QueryIndex runSignalQuery(const SignalQuery& query, const SignalSnapshot& snapshot,
+                          unsigned long now, std::vector<uint32_t>& matches);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Hal.h"
+
+// On-capture automation: "when code X is seen, transmit Y / push an event /
+// mark it favorite", evaluated on the owner task for every capture.
+
+enum RuleAction : uint8_t {
+  RULE_TRANSMIT,  // Send the target code
+  RULE_PUSH,      // "rule" event to open dashboards
+  RULE_FAVORITE,  // Mark the captured signal favorite
+  RULE_ACTION_COUNT
+};
+
+// Widest fields first, so a rule packs into 24 bytes
+struct Rule {
+  uint64_t trigger;  // signalKey() of the code that fires it
+  uint64_t target;   // RULE_TRANSMIT: signalKey() of the code to send
+  uint32_t id;
+  RuleAction action;
+};
+
+const char* ruleActionName(RuleAction action);
+bool parseRuleAction(const String& name, RuleAction& action);
+
+// An immutable rule set, compiled into a decision table keyed by trigger:
+// the actions sit in one array grouped by trigger, and a hash map points at
+// each group. A frame costs one probe plus its own actions, however many
+// rules there are for other codes.
+class RuleTable {
+public:
+  static const size_t MAX_RULES = 1000;
+
+  struct Step {
+    uint64_t target;
+    uint32_t rule;
+    RuleAction action;
+  };
+
+  explicit RuleTable(const std::vector<Rule>& rules);
+
+  // The steps for a frame's key, nullptr and 0 when no rule matches
+  const Step* match(uint64_t key, size_t& count) const;
+
+  const std::vector<Rule>& rules() const { return source; }  // In id order
+  size_t memoryUsage() const;
+
+private:
+  struct Group {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  std::vector<Rule> source;
+  std::vector<Step> steps;
+  std::unordered_map<uint64_t, Group> groups;
+};
+
+typedef std::shared_ptr<const RuleTable> RuleSet;
+
+// Rules in the key/value store: ruleCount, then rules0, rules1, ... blobs of
+// 48 packed records. Only chunks whose bytes changed are written.
+void saveRules(KeyValueStore& storage, const RuleTable& table);
+// Records that fail validation are skipped
+void loadRules(KeyValueStore& storage, std::vector<Rule>& rules);
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "RFSignal.h"
+#include "SignalIndex.h"
+#include "SignalTags.h"
+
+typedef std::shared_ptr<const RFSignal> SignalRef;
+typedef std::vector<SignalRef> SignalList;
+
+// Column-oriented copy of the scalar fields, for filter scans
+struct SignalColumns {
+  std::vector<uint32_t> uid;
+  std::vector<unsigned long> value;
+  std::vector<unsigned long> timestamp;
+  std::vector<uint8_t> bitLength;
+  std::vector<uint8_t> protocol;
+  std::vector<uint8_t> favorite;
+  std::vector<uint32_t> revision;  // Revision that last changed the record or its tags
+
+  void append(const RFSignal& signal, uint32_t changed);
+  void assign(size_t index, const RFSignal& signal, uint32_t changed);
+  void erase(size_t index);
+  void clear();
+};
+
+struct RemovedSignal {
+  uint32_t uid;
+  uint32_t revision;
+};
+
+// Immutable view of the store at one point in time
+struct SignalSnapshot {
+  SignalList signals;
+  SignalColumns columns;
+  SignalIndexes indexes;
+  SignalTags tags;
+  std::vector<uint32_t> uidOrder;  // Positions sorted by uid
+  // Every publish that changed something gets the next revision. Changes
+  // since a revision are the records stamped after it plus the removals;
+  // from before resetRevision (cleared, bulk tag change or too many
+  // removals forgotten) only the full list is accurate.
+  uint32_t revision;
+  uint32_t resetRevision;
+  std::vector<RemovedSignal> removed;  // Recent, oldest first
+
+  SignalSnapshot() : revision(0), resetRevision(0) {}
+  SignalSnapshot(const SignalIndexes& indexes, const SignalTags& tags)
+    : indexes(indexes), tags(tags), revision(0), resetRevision(0) {}
+
+  size_t size() const { return signals.size(); }
+  const RFSignal& operator[](size_t index) const { return *signals[index]; }
+  // List position of a uid, or -1 if it is not in this snapshot
+  int positionOf(uint32_t uid) const;
+};
+
+// Signal store with a single writer and immutable snapshots for readers.
+//
+// The owner task (see CommandQueue) is the only writer. It keeps a working
+// list of shared, immutable signal records and publishes it as a new
+// snapshot after each batch of commands. Readers (the web server callbacks)
+// grab the current snapshot and iterate it freely: they never block the
+// writer and never see a half-applied change.
+// Unchanged records are shared between snapshots, and so are the secondary
+// indexes and tag bitmaps a batch left alone. Publishing copies a vector of
+// pointers, the scalar columns and the uid order, all kept up to date as
+// the writer goes, plus whichever index the batch changed.
+class SignalStore {
+public:
+  typedef std::shared_ptr<const SignalSnapshot> Snapshot;
+
+  SignalStore();
+
+  // Reader side - safe from any task
+  Snapshot snapshot() const;
+
+  // Writer side - owner task only
+  size_t size() const { return working.size(); }
+  const RFSignal& at(size_t index) const { return *working[index]; }
+  void add(const RFSignal& signal);
+  void replace(size_t index, const RFSignal& signal);
+  void erase(size_t index);
+  void clear();
+
+  // Position of the signal with this dedup key, or -1
+  int find(uint64_t key) const;
+  // Position of the signal with this uid, or -1
+  int positionOf(uint32_t uid) const;
+  // Drop up to count of the oldest non-favorite signals; returns how many
+  size_t evictOldest(size_t count);
+
+  // Tags - false when the tag limit is reached
+  bool tagSignal(size_t index, const String& tag);
+  void untagSignal(size_t index, const String& tag);
+  bool deleteTag(const String& tag);
+  bool restoreTag(const String& tag, const RoaringBitmap& members);
+
+  template <typename Predicate>
+  size_t removeIf(Predicate predicate) {
+    std::vector<uint8_t> doomed(working.size());
+    size_t count = 0;
+    for (size_t i = 0; i < working.size(); i++) {
+      doomed[i] = predicate(*working[i]);
+      count += doomed[i];
+    }
+    if (count > 0) {
+      removeMarked(doomed);
+    }
+    return count;
+  }
+
+  // Make pending changes visible to readers
+  void publish();
+
+  // Removals remembered for change listings; room for a whole auto-cleanup
+  // (a fifth of SnifferCore::MAX_SIGNALS) so it does not force full reloads
+  static const size_t MAX_REMOVED = 256;
+
+  const SignalIndexes& currentIndexes() const { return indexes; }
+  const SignalTags& currentTags() const { return tags; }
+
+private:
+  // Revision bookkeeping for the pending publish
+  void stamp(size_t index) { columns.revision[index] = revision + 1; }
+  void forget(uint32_t uid);
+  void reset();
+  void removeMarked(const std::vector<uint8_t>& doomed);
+  void insertUid(size_t index);
+  void eraseUid(uint32_t uid);
+
+  SignalList working;
+  SignalColumns columns;          // Of working, row for row
+  std::vector<uint32_t> uidOrder;
+  SignalIndexes indexes;
+  SignalTags tags;
+  Snapshot published;
+  bool dirty;
+
+  uint32_t revision;  // Of the published snapshot
+  uint32_t resetRevision;
+  std::deque<RemovedSignal> removed;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "CopyOnWrite.h"
+#include "RFSignal.h"
+#include "RoaringBitmap.h"
+
+// User tags, each stored as a bitmap of signal uids.
+//
+// Selections such as "tag:garage AND NOT favorite" are answered with bitmap
+// AND/OR/ANDNOT instead of per-record checks. "favorite" and "all" are
+// built-in sets kept up to date from the store. Copies share each bitmap
+// until a change touches it, so a snapshot costs little more than the names.
+class SignalTags {
+public:
+  static const size_t MAX_TAGS = 32;
+  static const size_t MAX_TAG_LENGTH = 15;
+
+  struct Tag {
+    String name;
+    CopyOnWrite<RoaringBitmap> members;
+  };
+
+  static bool validName(const String& tag);
+
+  // Returns false when the tag would exceed MAX_TAGS
+  bool tag(const String& tag, uint32_t uid);
+  void untag(const String& tag, uint32_t uid);
+  // Forget a tag entirely; false if it did not exist
+  bool remove(const String& tag);
+  // Replace a tag's members (used when loading)
+  bool restore(const String& tag, const RoaringBitmap& members);
+
+  void onInsert(const RFSignal& signal);
+  void onErase(const RFSignal& signal);
+  void onUpdate(const RFSignal& before, const RFSignal& after);
+  void clear();
+  void markShared();
+
+  const std::vector<Tag>& list() const { return tags; }
+  void tagsOf(uint32_t uid, std::vector<const String*>& names) const;
+
+  // Evaluate a selection expression:
+  //   expr := term ("OR" term)*      term := factor ("AND" factor)*
+  //   factor := "NOT" factor | "(" expr ")" | "tag:<name>" | "favorite" | "all"
+  bool select(const String& expression, RoaringBitmap& result, String& error) const;
+
+  size_t memoryUsage() const;
+
+private:
+  Tag* find(const String& tag);
+  const Tag* find(const String& tag) const;
+
+  std::vector<Tag> tags;  // Sorted by name
+  CopyOnWrite<RoaringBitmap> all;
+  CopyOnWrite<RoaringBitmap> favorites;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Hal.h"
+
+// Protocol translation for retrofits: a frame from an old remote that
+// matches a source pattern is re-encoded for a new receiver (another
+// protocol, bit length and value layout) and sent straight away by the
+// owner task.
+
+// Copies source bits [from, from + width) to target bits [to, to + width)
+struct BitField {
+  uint8_t from;
+  uint8_t to;
+  uint8_t width;
+};
+
+struct Translation {
+  static const int MAX_FIELDS = 4;
+
+  uint32_t id;
+  uint32_t match;  // Source value bits under mask
+  uint32_t mask;   // Source value bits that must equal match
+  uint32_t base;   // Target value before the fields are copied in
+  uint8_t sourceProtocol;
+  uint8_t sourceBits;
+  uint8_t targetProtocol;
+  uint8_t targetBits;
+  uint8_t fieldCount;
+  BitField fields[MAX_FIELDS];
+};
+
+// The target frame for a value that matched
+RadioFrame translateFrame(const Translation& translation, uint32_t value);
+
+// Parses the API's spelling; values are decimal or 0x hex, bit 0 is the LSB:
+//   source  PROTOCOL/BITS/VALUE[/MASK]   mask defaults to all BITS
+//   target  PROTOCOL/BITS/VALUE
+//   fields  FROM:TO:WIDTH[,...]          optional
+// Returns false and fills error when malformed; id is left at 0.
+bool parseTranslation(const String& source, const String& target, const String* fields,
+                      Translation& translation, String& error);
+
+// An immutable translation set, compiled for the capture path. Each source
+// format (protocol and bit length) has at most MAX_MASKS distinct masks;
+// a frame costs one hash probe per mask of its format, most specific mask
+// first, however many translations there are.
+class TranslationTable {
+public:
+  static const size_t MAX_TRANSLATIONS = 64;
+  static const int MAX_MASKS = 4;
+
+  explicit TranslationTable(const std::vector<Translation>& translations);
+
+  // The translation for a received frame, nullptr when none matches
+  const Translation* match(const RadioFrame& frame) const;
+  // Why translation can't join this set (same pattern, too many masks), or false
+  bool conflicts(const Translation& translation, String& error) const;
+
+  const std::vector<Translation>& translations() const { return source; }  // In id order
+
+private:
+  struct Masks {
+    uint32_t mask[MAX_MASKS];  // Most bits set first
+    int count;
+  };
+
+  static uint16_t formatOf(unsigned int bitLength, unsigned int protocol) { return bitLength << 8 | protocol; }
+  static uint64_t patternKey(uint32_t match, int slot, uint16_t format) {
+    return (uint64_t)match << 32 | (uint32_t)slot << 16 | format;
+  }
+
+  std::vector<Translation> source;
+  std::unordered_map<uint16_t, Masks> masks;
+  std::unordered_map<uint64_t, uint32_t> entries;  // Pattern -> index in source
+};
+
+typedef std::shared_ptr<const TranslationTable> TranslationSet;
+
+// Translations in the key/value store: one "translations" blob, a count
+// byte followed by packed records
+void saveTranslations(KeyValueStore& storage, const TranslationTable& table);
+// Records that fail validation are skipped
+void loadTranslations(KeyValueStore& storage, std::vector<Translation>& translations);
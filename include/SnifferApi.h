@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "AdmissionControl.h"
+#include "Metrics.h"
+#include "SignalCodec.h"
+#include "SnifferCore.h"
+
+enum HttpMethod {
+  METHOD_GET,
+  METHOD_POST,
+  METHOD_DELETE
+};
+
+struct ApiParam {
+  String name;
+  String value;
+  bool body;  // Form body rather than query string
+};
+
+// Transport-neutral request: AsyncWebServer on the device, direct calls natively
+struct ApiRequest {
+  HttpMethod method;
+  String path;
+  uint32_t client;  // IPv4 address of the caller
+  std::vector<ApiParam> params;
+
+  ApiRequest() : method(METHOD_GET), client(0) {}
+
+  // Like AsyncWebServerRequest::getParam(name, body)
+  const String* param(const char* name, bool body = false) const;
+  // Form body parameter, falling back to the query string
+  const String* find(const char* name) const;
+};
+
+// Fills buffer with the next chunk, 0 when done
+typedef std::function<size_t(uint8_t* buffer, size_t maxLength)> ApiStream;
+
+struct ApiResponse {
+  int status;
+  String contentType;
+  String body;
+  ApiStream stream;  // Chunked body instead of body when set
+  std::vector<std::pair<String, String>> headers;
+
+  ApiResponse(int status, const char* contentType, const String& body)
+    : status(status), contentType(contentType), body(body) {}
+};
+
+// The REST API over a SnifferCore. Handlers run on the web server task and
+// read snapshots or post commands; they never touch the store directly.
+class SnifferApi {
+public:
+  typedef std::function<ApiResponse(const ApiRequest&)> Handler;
+
+  struct Route {
+    const char* path;
+    HttpMethod method;
+    RouteClass routeClass;
+    Handler handler;
+    HistogramData* latency;
+  };
+
+  // How long a request waits for its command before answering 202
+  static const unsigned long COMMAND_WAIT_MS = 100;
+
+  SnifferApi(SnifferCore& core, const AdmissionLimits& limits);
+
+  // Platform-specific routes; path must be a string literal
+  void addRoute(const char* path, HttpMethod method, RouteClass routeClass, Handler handler);
+  // In registration order; sub-paths come before their parents
+  const std::vector<Route>& routes() const { return routeTable; }
+
+  // Admission, latency accounting and dispatch
+  ApiResponse handle(const Route& route, const ApiRequest& request);
+  ApiResponse handle(const ApiRequest& request);  // Looks the route up, 404 if none
+
+  // /api/import arrives as body chunks; key identifies the upload
+  void importData(const void* key, uint32_t client, const uint8_t* data, size_t length, bool first);
+  void importAborted(const void* key);
+  ApiResponse finishImport(const void* key);
+
+  AdmissionControl& admissionControl() { return admission; }
+
+  // Payload of the "capture" event pushed to the UI
+  static String captureEventJson(const CaptureEvent& event);
+  // Payload of the "rule" event sent by push rules
+  static String ruleEventJson(const RuleEvent& event);
+
+private:
+  void registerRoutes();
+  ApiResponse commandResponse(const Command& command);
+  ApiResponse signalPage(const SignalSnapshot& snapshot, const std::vector<uint32_t>& matches,
+                         int offset, int limit);
+  bool readPaging(const ApiRequest& request, int& offset, int& limit, ApiResponse& error);
+  bool admit(uint32_t client, RouteClass routeClass, std::shared_ptr<AdmissionSlot>& slot,
+             ApiResponse& rejection);
+  static ApiResponse rejection(bool busy, uint32_t retryAfter);
+  static const char* methodName(HttpMethod method);
+
+  SnifferCore& core;
+  AdmissionControl admission;
+  std::vector<Route> routeTable;
+  HistogramData* importLatency;
+
+  // Upload in progress for /api/import (web server task only)
+  const void* importKey;
+  std::shared_ptr<SignalImporter> importer;
+  std::shared_ptr<AdmissionSlot> importSlot;
+  const void* importRejected;
+  bool importRejectedBusy;
+  uint32_t importRetryAfter;
+
+  RouteHistogram httpLatency;
+  SampledMetric admissionAccepted;
+  SampledMetric admissionRejectedRate;
+  SampledMetric admissionRejectedBusy;
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "CaptureFilter.h"
+#include "CommandQueue.h"
+#include "FrameAnalytics.h"
+#include "Hal.h"
+#include "Metrics.h"
+#include "SignalCodec.h"
+#include "SignalRules.h"
+#include "SignalStore.h"
+#include "SignalTranslation.h"
+#include "TraceRing.h"
+
+// Capture pipeline totals since boot
+struct CaptureStats {
+  uint32_t received;        // Frames read from the radio
+  uint32_t stored;          // New signals
+  uint32_t duplicates;      // Refreshed an existing signal
+  uint32_t droppedQueue;    // Command queue full
+  uint32_t droppedStorage;  // Library full after cleanup
+  uint32_t transmissions;
+};
+
+// A received frame as the UI sees it: the stored signal once the batch
+// holding it has been published
+struct CaptureEvent {
+  RFSignal signal;
+  bool isNew;  // Added to the library rather than refreshed
+};
+
+typedef std::function<void(const CaptureEvent&)> CaptureListener;
+
+// A RULE_PUSH rule fired for a capture
+struct RuleEvent {
+  uint32_t rule;
+  RFSignal signal;
+};
+
+typedef std::function<void(const RuleEvent&)> RuleListener;
+
+// signalKey() of every code the repeater sends on, ascending
+typedef std::shared_ptr<const std::vector<uint64_t>> RepeaterCodes;
+
+struct RepeaterStats {
+  uint32_t repeated;          // Frames sent on by the repeater
+  uint32_t echoesSuppressed;  // Own transmissions heard back and ignored
+};
+
+// Frames dropped by the capture filters since boot
+struct FilterStats {
+  uint32_t denied;      // Matched a deny rule
+  uint32_t notAllowed;  // Matched no allow rule while there are some
+};
+
+// Capture, dedup, cleanup, persistence and transmit logic, independent of
+// the hardware behind it. poll() is the owner task: it is the only place
+// the store and settings change; other tasks go through commands().
+class SnifferCore {
+public:
+  static const int MAX_SIGNALS = 1000;
+  static const int AUTO_CLEANUP_THRESHOLD = 950;  // Start cleanup at 95% capacity
+  static const int MAX_REPEATER_CODES = 32;
+  // Captures may use the whole queue, API commands all but the reserve; poll()
+  // queues at most one capture before draining it
+  static const size_t COMMAND_QUEUE_SIZE = 32;
+  static const size_t CAPTURE_RESERVE = 4;
+  // Frames matching a recent transmission are our own echo for this long
+  // after it ends; covers the receiver latching the final copy late
+  static const unsigned long ECHO_HOLDOFF_MS = 200;
+  static const int ECHO_SLOTS = 4;  // Transmissions remembered; a rule may send several
+  static const unsigned long DEFAULT_ANALYTICS_WINDOW_S = 3600;
+  static const unsigned long MAX_ANALYTICS_WINDOW_S = 7 * 24 * 3600;
+  // loop()'s idle wait while the repeater is on, instead of 10 ms
+  static const unsigned long REPEATER_WAIT_MS = 1;
+
+  // capacity is MAX_SIGNALS on the device; native hosts may raise it
+  SnifferCore(Radio& radio, KeyValueStore& storage, Clock& clock, Feedback& feedback, int capacity = MAX_SIGNALS);
+
+  // Owner task
+  void begin();  // Load settings and the library
+  void poll();   // Received frames, queued commands, repeat transmissions
+  void waitForWork(unsigned long timeoutMs) { commandQueue.waitForWork(timeoutMs); }
+  // Called on the owner task for every stored or refreshed capture, after
+  // replies are out and before feedback; set it before begin()
+  void onCapture(CaptureListener listener) { captureListener = listener; }
+  // Same, for push rules
+  void onRule(RuleListener listener) { ruleListener = listener; }
+
+  // Any task
+  CommandQueue& commands() { return commandQueue; }
+  SignalStore::Snapshot snapshot() const { return signalStore.snapshot(); }
+  Clock& clock() { return time; }
+  int signalCapacity() const { return maxSignals; }
+  bool sniffingEnabled() const { return sniffing; }
+  bool buzzerEnabled() const { return buzzer; }
+  bool ledEnabled() const { return led; }
+  unsigned long lastSignalTime() const { return lastSignal; }
+  bool repeaterEnabled() const { return repeater; }
+  RepeaterCodes repeaterCodes() const { return std::atomic_load(&publishedRepeaterCodes); }
+  RepeaterStats repeaterStats() const;
+  RuleSet rules() const { return std::atomic_load(&ruleSet); }
+  uint32_t rulesFired() const { return rulesFiredTotal.get(); }
+  TranslationSet translations() const { return std::atomic_load(&translationSet); }
+  uint32_t translated() const { return translationsSent.get(); }
+  FilterSet filters() const { return std::atomic_load(&filterSet); }
+  FilterStats filterStats() const;
+  FrameAnalytics& analytics() { return frameAnalytics; }  // Locks internally
+  // Counts boots; library revisions restart at 1 on each one
+  uint32_t libraryEpoch() const { return epoch; }
+  int lastImportAdded() const { return importAdded; }  // -1 = no import yet
+  int lastImportDuplicates() const { return importDuplicates; }
+  CaptureStats captureStats() const;
+#if RF_TRACE_ENABLED
+  const TraceRing& trace() const { return traceRing; }
+  uint32_t traceOverhead() const { return traceCycles.get(); }
+#endif
+
+private:
+  void handleReceivedFrame(const RadioFrame& frame);
+  void processCommands();
+  CommandResult executeCommand(const Command& command);
+  void storeCapturedSignal(const Command& command);
+  CommandResult importSignals(SignalImporter& importer);
+  bool isDuplicate(const RFSignal& newSignal);
+  void performAutoCleanup();
+  void transmitSignal(const RFSignal& signal, bool withFeedback);
+  void transmitFrame(const RadioFrame& frame);
+  CommandResult setRepeaterCode(int index, bool enabled);
+  void publishRepeaterCodes(bool persist);
+  bool isEcho(uint64_t key);
+  void runRules(const RFSignal& captured);
+  CommandResult addRule(const Command& command, int trigger, int target);
+  CommandResult deleteRule(uint32_t id);
+  void publishRules(const std::vector<Rule>& rules, bool persist);
+  CommandResult addTranslation(const Translation& translation);
+  CommandResult deleteTranslation(uint32_t id);
+  void publishTranslations(const std::vector<Translation>& translations, bool persist);
+  CommandResult addFilter(const FilterRule& rule);
+  CommandResult deleteFilter(uint32_t id);
+  void publishFilters(const std::vector<FilterRule>& rules, bool persist);
+  void startRepeatTransmission(const RFSignal& signal, int count);
+  void handleRepeatTransmission();
+  void saveStoredSignals();
+#if RF_TRACE_ENABLED
+  void traceStage(uint32_t frame, TraceStage stage, uint8_t arg);
+#endif
+
+  Radio& radio;
+  KeyValueStore& storage;
+  Clock& time;
+  Feedback& feedback;
+
+  const int maxSignals;
+  const int cleanupThreshold;   // AUTO_CLEANUP_THRESHOLD at the default capacity
+  SignalStore signalStore;
+  CommandQueue commandQueue;
+  bool signalsDirty;            // Persist once per command batch
+  bool receiveFeedbackPending;
+  CaptureListener captureListener;
+  std::vector<CaptureEvent> pendingCaptures;  // This batch's, only with a listener
+  RuleListener ruleListener;
+  std::vector<RuleEvent> pendingRuleEvents;
+  int signalCount;              // Next uid / default name number
+  uint32_t epoch;
+
+  std::atomic<bool> sniffing;
+  std::atomic<bool> buzzer;
+  std::atomic<bool> led;
+  std::atomic<unsigned long> lastSignal;
+  std::atomic<int> importAdded;
+  std::atomic<int> importDuplicates;
+  std::atomic<bool> repeater;
+
+  // Repeater allowlist, looked up for every frame; the API reads the copy
+  std::unordered_set<uint64_t> repeaterSet;
+  RepeaterCodes publishedRepeaterCodes;
+  struct RecentTransmit {
+    uint64_t key;
+    unsigned long end;  // millis()
+  };
+  RecentTransmit recentTransmits[ECHO_SLOTS];
+  int nextTransmitSlot;
+
+  // Compiled on every change; the owner evaluates it, the API lists it
+  RuleSet ruleSet;
+  uint32_t nextRuleId;
+
+  // Same, for protocol translations
+  TranslationSet translationSet;
+  uint32_t nextTranslationId;
+
+  // Checked first for every frame; match counts carry over recompiles
+  FilterSet filterSet;
+  uint32_t nextFilterId;
+
+  // Every frame but our own echoes, before filtering and dedup
+  FrameAnalytics frameAnalytics;
+
+  // Non-blocking repeat transmission
+  bool repeatTransmissionActive;
+  int repeatCount;
+  int currentRepeatIndex;
+  RFSignal repeatSignal;
+
+#if RF_TRACE_ENABLED
+  TraceRing traceRing;
+  uint32_t nextTraceFrame;
+#endif
+
+  Counter framesReceived;
+  Counter framesStored;
+  Counter dedupHits;
+  Counter framesDroppedQueue;
+  Counter framesDroppedStorage;
+  Counter txJobs;
+  Counter transmissions;
+  Counter repeats;
+  Counter echoesSuppressed;
+  Counter rulesFiredTotal;
+  Counter translationsSent;
+  Counter framesDenied;
+  Counter framesNotAllowed;
+  Histogram saveDuration;
+  SampledMetric commandsProcessed;
+  SampledMetric commandsRejected;
+#if RF_TRACE_ENABLED
+  Counter traceCycles;
+#endif
+};
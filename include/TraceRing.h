@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+
+// Per-capture pipeline tracing, compiled out with -DRF_TRACE_ENABLED=0
+#ifndef RF_TRACE_ENABLED
+#define RF_TRACE_ENABLED 1
+#endif
+
+enum TraceStage : uint8_t {
+  TRACE_DECODE,   // Frame picked up from the receiver
+  TRACE_DEQUEUE,  // Capture command reached the owner task
+  TRACE_DEDUP,    // Duplicate decision made (arg = TraceDedup)
+  TRACE_COMMIT,   // Batch persisted
+  TRACE_NOTIFY    // Snapshot published and replies sent
+};
+
+enum TraceDedup : uint8_t {
+  TRACE_NEW,
+  TRACE_DUPLICATE,
+  TRACE_DROPPED
+};
+
+struct TraceEvent {
+  uint32_t frame;
+  uint32_t timestampUs;
+  TraceStage stage;
+  uint8_t arg;
+};
+
+// Fixed-size ring of trace events. Writers claim a slot with one atomic
+// increment and never wait; readers copy slots and discard any that were
+// overwritten while being read.
+class TraceRing {
+public:
+  static const size_t CAPACITY = 256;
+
+  TraceRing();
+
+  void record(uint32_t frame, TraceStage stage, uint8_t arg, uint32_t timestampUs);
+  // Consistent copy of the retained events, oldest first
+  void snapshot(std::vector<TraceEvent>& events) const;
+  uint32_t recorded() const { return head.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;  // Position + 1 once written, 0 while writing
+    std::atomic<uint32_t> frame;
+    std::atomic<uint32_t> timestampUs;
+    std::atomic<uint32_t> stageArg;
+  };
+
+  Slot slots[CAPACITY];
+  std::atomic<uint32_t> head;
+};
+
+// Chrome trace-event JSON (chrome://tracing, Perfetto): one row per frame,
+// one span per pipeline stage
+String renderChromeTrace(std::vector<TraceEvent>& events, uint32_t overheadCycles);
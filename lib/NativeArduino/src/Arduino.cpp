@@ -0,0 +1,104 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <thread>
+
+HardwareSerial Serial;
+
+static const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+String::String(float value, unsigned char decimals) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  text = buffer;
+}
+
+String::String(double value, unsigned char decimals) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  text = buffer;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return text.size() >= suffix.text.size() &&
+         text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t found = text.find(c, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String& needle, unsigned int from) const {
+  size_t found = text.find(needle.text, from);
+  return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    std::swap(from, to);
+  }
+  if (from >= text.size()) {
+    return String();
+  }
+  to = std::min<unsigned int>(to, text.size());
+  return String(text.c_str() + from, to - from);
+}
+
+void String::trim() {
+  size_t begin = 0;
+  while (begin < text.size() && isspace((unsigned char)text[begin])) {
+    begin++;
+  }
+  size_t end = text.size();
+  while (end > begin && isspace((unsigned char)text[end - 1])) {
+    end--;
+  }
+  text = text.substr(begin, end - begin);
+}
+
+void String::toLowerCase() {
+  for (char& c : text) {
+    c = tolower((unsigned char)c);
+  }
+}
+
+void String::toUpperCase() {
+  for (char& c : text) {
+    c = toupper((unsigned char)c);
+  }
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+  if (!output) {
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  int written = vfprintf(output, format, args);
+  va_end(args);
+  return written > 0 ? written : 0;
+}
+
+size_t HardwareSerial::write(const char* text) {
+  return output ? fputs(text, output), strlen(text) : 0;
+}
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - started).count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - started).count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino core the firmware core uses.
+// Only built for env:native; the ESP32 build uses the real framework.
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+
+class String {
+public:
+  String() {}
+  String(const char* text) : text(text ? text : "") {}
+  String(const char* text, unsigned int length) : text(text, length) {}
+  String(char c) : text(1, c) {}
+  String(int value) : text(std::to_string(value)) {}
+  String(unsigned int value) : text(std::to_string(value)) {}
+  String(long value) : text(std::to_string(value)) {}
+  String(unsigned long value) : text(std::to_string(value)) {}
+  String(long long value) : text(std::to_string(value)) {}
+  String(unsigned long long value) : text(std::to_string(value)) {}
+  String(float value, unsigned char decimals = 2);
+  String(double value, unsigned char decimals = 2);
+
+  const char* c_str() const { return text.c_str(); }
+  unsigned int length() const { return text.size(); }
+  bool isEmpty() const { return text.empty(); }
+  bool reserve(unsigned int size) { text.reserve(size); return true; }
+
+  long toInt() const { return strtol(text.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(text.c_str(), nullptr); }
+
+  char charAt(unsigned int index) const { return index < text.size() ? text[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+  bool endsWith(const String& suffix) const;
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String& needle, unsigned int from = 0) const;
+  String substring(unsigned int from) const { return substring(from, text.size()); }
+  String substring(unsigned int from, unsigned int to) const;
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+
+  bool concat(const String& other) { text += other.text; return true; }
+  bool concat(const char* other) { if (other) text += other; return other != nullptr; }
+  bool concat(const char* other, unsigned int length) { text.append(other, length); return true; }
+  bool concat(char c) { text += c; return true; }
+  String& operator+=(const String& other) { text += other.text; return *this; }
+  String& operator+=(const char* other) { concat(other); return *this; }
+  String& operator+=(char c) { text += c; return *this; }
+
+  bool equals(const String& other) const { return text == other.text; }
+  bool operator==(const String& other) const { return text == other.text; }
+  bool operator==(const char* other) const { return text == (other ? other : ""); }
+  bool operator!=(const String& other) const { return text != other.text; }
+  bool operator!=(const char* other) const { return !(*this == other); }
+  bool operator<(const String& other) const { return text < other.text; }
+  int compareTo(const String& other) const { return text.compare(other.text); }
+
+private:
+  std::string text;
+};
+
+class StringSumHelper : public String {
+public:
+  StringSumHelper(const String& value) : String(value) {}
+};
+
+inline String operator+(const String& a, const String& b) { String sum(a); sum += b; return sum; }
+inline String operator+(const String& a, const char* b) { String sum(a); sum += b; return sum; }
+inline String operator+(const char* a, const String& b) { String sum(a); sum += b; return sum; }
+
+// Serial output goes to stdout, or nowhere once disabled
+class HardwareSerial {
+public:
+  HardwareSerial() : output(stdout) {}
+
+  void begin(unsigned long) {}
+  void setOutput(FILE* stream) { output = stream; }
+
+  size_t print(const String& value) { return write(value.c_str()); }
+  size_t print(const char* value) { return write(value); }
+  size_t print(char value) { return write(String(value).c_str()); }
+  size_t print(int value) { return write(String(value).c_str()); }
+  size_t print(unsigned int value) { return write(String(value).c_str()); }
+  size_t print(long value) { return write(String(value).c_str()); }
+  size_t print(unsigned long value) { return write(String(value).c_str()); }
+  size_t print(double value, int decimals = 2) { return write(String(value, decimals).c_str()); }
+  template <typename T>
+  size_t println(const T& value) { return print(value) + write("\n"); }
+  size_t println() { return write("\n"); }
+  size_t printf(const char* format, ...);
+
+private:
+  size_t write(const char* text);
+
+  FILE* output;
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
@@ -0,0 +1,5 @@
+# env:fuzz needs clang for libFuzzer, and the sanitizers at link time too
+Import("env")
+
+env.Replace(CC="clang", CXX="clang++")
+env.Append(LINKFLAGS=["-fsanitize=fuzzer,address,undefined"])
@@ -0,0 +1,4 @@
+# env:tsan links the ThreadSanitizer runtime as well as compiling with it
+Import("env")
+
+env.Append(LINKFLAGS=["-fsanitize=thread"])
@@ -0,0 +1,77 @@
+#include "AdmissionControl.h"
+
+#include <math.h>
+
+AdmissionControl::AdmissionControl(const AdmissionLimits& limits)
+  : limits(limits), bucketCount(0), expensiveInFlight(0), accepted(0),
+    rejectedRate(0), rejectedBusy(0) {
+}
+
+AdmissionControl::Bucket& AdmissionControl::bucketFor(uint32_t client, unsigned long now) {
+  size_t oldest = 0;
+  for (size_t i = 0; i < bucketCount; i++) {
+    if (buckets[i].client == client) {
+      return buckets[i];
+    }
+    if (buckets[i].lastRefill < buckets[oldest].lastRefill) {
+      oldest = i;
+    }
+  }
+  
+  // New client: take a free entry or recycle the least recently seen one
+  Bucket& bucket = bucketCount < MAX_CLIENTS ? buckets[bucketCount++] : buckets[oldest];
+  bucket.client = client;
+  bucket.tokens = limits.burst;
+  bucket.transmitTokens = limits.transmitBurst;
+  bucket.lastRefill = now;
+  return bucket;
+}
+
+bool AdmissionControl::admit(uint32_t client, RouteClass route, unsigned long now,
+                             uint32_t& retryAfter, bool& busy) {
+  std::lock_guard<std::mutex> lock(bucketMutex);
+  Bucket& bucket = bucketFor(client, now);
+  float elapsed = (now - bucket.lastRefill) / 1000.0f;
+  bucket.lastRefill = now;
+  bucket.tokens = fminf(limits.burst, bucket.tokens + elapsed * limits.ratePerSecond);
+  bucket.transmitTokens = fminf(limits.transmitBurst, bucket.transmitTokens + elapsed * limits.transmitRatePerSecond);
+  
+  busy = false;
+  float* tokens = route == ROUTE_TRANSMIT ? &bucket.transmitTokens : &bucket.tokens;
+  float rate = route == ROUTE_TRANSMIT ? limits.transmitRatePerSecond : limits.ratePerSecond;
+  float cost = route == ROUTE_EXPENSIVE ? limits.expensiveCost : 1.0f;
+  
+  if (*tokens < cost) {
+    retryAfter = (uint32_t)ceilf((cost - *tokens) / rate);
+    if (retryAfter < 1) retryAfter = 1;
+    rejectedRate++;
+    return false;
+  }
+  
+  if (route == ROUTE_EXPENSIVE) {
+    // Reserve a slot before charging, so a busy reply costs the client nothing
+    if (++expensiveInFlight > limits.maxExpensive) {
+      expensiveInFlight--;
+      retryAfter = 1;
+      busy = true;
+      rejectedBusy++;
+      return false;
+    }
+  }
+  
+  *tokens -= cost;
+  accepted++;
+  return true;
+}
+
+void AdmissionControl::releaseExpensive() {
+  expensiveInFlight--;
+}
+
+AdmissionStats AdmissionControl::stats() const {
+  AdmissionStats stats;
+  stats.accepted = accepted;
+  stats.rejectedRate = rejectedRate;
+  stats.rejectedBusy = rejectedBusy;
+  return stats;
+}
@@ -0,0 +1,303 @@
+#include "CaptureFilter.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "ParamParse.h"
+#include "RFSignal.h"
+
+// Packed record, little-endian: id u32, protocols u32, bit lengths u64,
+// low u32, high u32, list u8
+static const size_t FILTER_RECORD_BYTES = 25;
+
+static const uint32_t ALL_PROTOCOLS = 0xFFFFFFFE;       // 1-31
+static const uint64_t ALL_BIT_LENGTHS = 0x1FFFFFFFEULL;  // 1-32
+
+const size_t FilterTable::MAX_FILTERS;
+const int FilterTable::FORMAT_PROTOCOLS;
+const int FilterTable::FORMAT_BITS;
+
+static const char* LIST_NAMES[] = {"allow", "deny"};
+
+const char* filterListName(FilterList list) {
+  return list <= FILTER_DENY ? LIST_NAMES[list] : "unknown";
+}
+
+// Shared by the API and loading from flash
+static bool validFilterRule(const FilterRule& rule) {
+  return rule.protocols != 0 && (rule.protocols & ~ALL_PROTOCOLS) == 0 && rule.bitLengths != 0 &&
+         (rule.bitLengths & ~ALL_BIT_LENGTHS) == 0 && rule.low <= rule.high && rule.list <= FILTER_DENY;
+}
+
+// "1,2,5-7" into a bit set of numbers within [min, max]
+static bool parseSet(const String& text, long min, long max, uint64_t& set) {
+  const char* begin = text.c_str();
+  const char* end = begin + text.length();
+  set = 0;
+  while (true) {
+    const char* next = std::find(begin, end, ',');
+    const char* dash = std::find(begin, next, '-');
+    long first, last;
+    if (!parseLong(begin, dash - begin, min, max, first)) {
+      return false;
+    }
+    last = first;
+    if (dash != next && (!parseLong(dash + 1, next - dash - 1, min, max, last) || last < first)) {
+      return false;
+    }
+    for (long n = first; n <= last; n++) {
+      set |= 1ULL << n;
+    }
+    if (next == end) {
+      return true;
+    }
+    begin = next + 1;
+  }
+}
+
+bool parseFilterRule(const String& list, const String* protocol, const String* bits, const String* value,
+                     FilterRule& rule, String& error) {
+  memset(&rule, 0, sizeof(rule));
+  if (list == LIST_NAMES[FILTER_ALLOW] || list == LIST_NAMES[FILTER_DENY]) {
+    rule.list = list == LIST_NAMES[FILTER_ALLOW] ? FILTER_ALLOW : FILTER_DENY;
+  } else {
+    error = "Invalid list (allow or deny)";
+    return false;
+  }
+  if (!protocol && !bits && !value) {
+    error = "Give a protocol, bits or value to match";
+    return false;
+  }
+  
+  uint64_t set = ALL_PROTOCOLS;
+  if (protocol && !parseSet(*protocol, 1, 31, set)) {
+    error = "Invalid protocol (1-31, lists and ranges like 1,3-5)";
+    return false;
+  }
+  rule.protocols = set;
+  rule.bitLengths = ALL_BIT_LENGTHS;
+  if (bits && !parseSet(*bits, 1, 32, rule.bitLengths)) {
+    error = "Invalid bits (1-32, lists and ranges like 12-24,32)";
+    return false;
+  }
+  
+  rule.low = 0;
+  rule.high = UINT32_MAX;
+  if (value) {
+    const char* text = value->c_str();
+    const char* dots = strstr(text, "..");
+    size_t length = dots ? dots - text : value->length();
+    // A single value is a range of one
+    if (!parseCode(text, length, rule.low) ||
+        !parseCode(dots ? dots + 2 : text, dots ? value->length() - length - 2 : length, rule.high) ||
+        rule.low > rule.high) {
+      error = "Invalid value (N or LOW..HIGH)";
+      return false;
+    }
+  }
+  return true;
+}
+
+String filterSetText(uint64_t set) {
+  String text;
+  for (int first = 0; first < 64; first++) {
+    if (!(set >> first & 1)) {
+      continue;
+    }
+    int last = first;
+    while (last < 63 && (set >> (last + 1) & 1)) {
+      last++;
+    }
+    text += text.length() > 0 ? "," : "";
+    text += String(first);
+    if (last > first) {
+      text += "-" + String(last);
+    }
+    first = last;
+  }
+  return text;
+}
+
+static bool single(uint64_t set) {
+  return set != 0 && (set & (set - 1)) == 0;
+}
+
+static int lowestBit(uint64_t set) {
+  int bit = 0;
+  while (!(set & 1)) {
+    set >>= 1;
+    bit++;
+  }
+  return bit;
+}
+
+void FilterTable::merge(Verdict& verdict, FilterList list, int index) {
+  int8_t& slot = list == FILTER_ALLOW ? verdict.allow : verdict.deny;
+  if (slot < 0 || index < slot) {
+    slot = index;
+  }
+}
+
+void FilterTable::merge(Verdict& verdict, const Verdict& other) {
+  if (other.allow >= 0) {
+    merge(verdict, FILTER_ALLOW, other.allow);
+  }
+  if (other.deny >= 0) {
+    merge(verdict, FILTER_DENY, other.deny);
+  }
+}
+
+FilterTable::FilterTable(const std::vector<FilterRule>& rules)
+  : source(rules.begin(), rules.begin() + std::min(rules.size(), MAX_FILTERS)), anyAllow(false),
+    matchCounts(new std::atomic<uint32_t>[std::max<size_t>(source.size(), 1)]) {
+  std::vector<uint8_t> ranges;
+  for (size_t i = 0; i < source.size(); i++) {
+    const FilterRule& rule = source[i];
+    matchCounts[i].store(0, std::memory_order_relaxed);
+    anyAllow |= rule.list == FILTER_ALLOW;
+  
+    if (rule.low == rule.high && single(rule.protocols) && single(rule.bitLengths)) {
+      Verdict none = {-1, -1};
+      uint64_t key = signalKey(rule.low, lowestBit(rule.bitLengths), lowestBit(rule.protocols));
+      merge(codes.emplace(key, none).first->second, rule.list, i);
+    } else if (rule.low == 0 && rule.high == UINT32_MAX) {
+      if (formats.empty()) {
+        formats.assign(FORMAT_PROTOCOLS * FORMAT_BITS, Verdict{-1, -1});
+      }
+      for (int protocol = 1; protocol < FORMAT_PROTOCOLS; protocol++) {
+        for (int bits = 1; bits < FORMAT_BITS; bits++) {
+          if ((rule.protocols >> protocol & 1) && (rule.bitLengths >> bits & 1)) {
+            merge(formats[protocol * FORMAT_BITS + bits], rule.list, i);
+          }
+        }
+      }
+    } else {
+      ranges.push_back(i);
+    }
+  }
+  
+  // Cut the value space at every range edge; within a segment the same rules apply
+  for (uint8_t index : ranges) {
+    bounds.push_back(source[index].low);
+    if (source[index].high < UINT32_MAX) {
+      bounds.push_back(source[index].high + 1);
+    }
+  }
+  std::sort(bounds.begin(), bounds.end());
+  bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+  for (uint32_t start : bounds) {
+    segments.push_back(covering.size());
+    for (uint8_t index : ranges) {
+      if (source[index].low <= start && start <= source[index].high) {
+        covering.push_back(index);
+      }
+    }
+  }
+  segments.push_back(covering.size());
+}
+
+bool FilterTable::admit(const RadioFrame& frame, int& rule) const {
+  Verdict verdict = {-1, -1};
+  // Frames no rule can describe only get the default
+  if (frame.protocol >= 1 && frame.protocol < (unsigned int)FORMAT_PROTOCOLS && frame.bitLength >= 1 &&
+      frame.bitLength < (unsigned int)FORMAT_BITS && (uint64_t)frame.value <= UINT32_MAX) {
+    if (!codes.empty()) {
+      auto code = codes.find(signalKey(frame.value, frame.bitLength, frame.protocol));
+      if (code != codes.end()) {
+        merge(verdict, code->second);
+      }
+    }
+    if (!formats.empty()) {
+      merge(verdict, formats[frame.protocol * FORMAT_BITS + frame.bitLength]);
+    }
+    auto bound = std::upper_bound(bounds.begin(), bounds.end(), (uint32_t)frame.value);
+    if (bound != bounds.begin()) {
+      size_t segment = bound - bounds.begin() - 1;
+      for (size_t i = segments[segment]; i < segments[segment + 1]; i++) {
+        const FilterRule& range = source[covering[i]];
+        if ((range.protocols >> frame.protocol & 1) && (range.bitLengths >> frame.bitLength & 1)) {
+          merge(verdict, range.list, covering[i]);
+        }
+      }
+    }
+  }
+  
+  // Deny wins; with an allow list, anything it doesn't name is out
+  rule = verdict.deny >= 0 ? verdict.deny : verdict.allow;
+  if (rule >= 0) {
+    matchCounts[rule].fetch_add(1, std::memory_order_relaxed);
+    return verdict.deny < 0;
+  }
+  return !anyAllow;
+}
+
+void FilterTable::carryMatches(const FilterTable& previous) {
+  for (size_t i = 0; i < source.size(); i++) {
+    for (size_t j = 0; j < previous.source.size(); j++) {
+      if (previous.source[j].id == source[i].id) {
+        matchCounts[i].store(previous.matches(j), std::memory_order_relaxed);
+        break;
+      }
+    }
+  }
+}
+
+static void putLittleEndian(uint8_t* out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    out[i] = value >> (8 * i);
+  }
+}
+
+static uint64_t getLittleEndian(const uint8_t* in, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value |= (uint64_t)in[i] << (8 * i);
+  }
+  return value;
+}
+
+void saveFilters(KeyValueStore& storage, const FilterTable& table) {
+  const std::vector<FilterRule>& rules = table.rules();
+  uint8_t blob[1 + FilterTable::MAX_FILTERS * FILTER_RECORD_BYTES];
+  // The count byte also keeps an empty set from being a zero-length blob
+  blob[0] = rules.size();
+  for (size_t i = 0; i < rules.size(); i++) {
+    uint8_t* record = blob + 1 + i * FILTER_RECORD_BYTES;
+    putLittleEndian(record, rules[i].id, 4);
+    putLittleEndian(record + 4, rules[i].protocols, 4);
+    putLittleEndian(record + 8, rules[i].bitLengths, 8);
+    putLittleEndian(record + 16, rules[i].low, 4);
+    putLittleEndian(record + 20, rules[i].high, 4);
+    record[24] = rules[i].list;
+  }
+  storage.putBytes("filters", blob, 1 + rules.size() * FILTER_RECORD_BYTES);
+}
+
+void loadFilters(KeyValueStore& storage, std::vector<FilterRule>& rules) {
+  uint8_t blob[1 + FilterTable::MAX_FILTERS * FILTER_RECORD_BYTES];
+  rules.clear();
+  size_t length = storage.getBytesLength("filters");
+  if (length < 1 || length > sizeof(blob) || (length - 1) % FILTER_RECORD_BYTES != 0 ||
+      storage.getBytes("filters", blob, length) != length) {
+    return;
+  }
+  
+  // The count byte comes from flash; the blob length bounds the loop
+  size_t count = std::min((size_t)blob[0], (length - 1) / FILTER_RECORD_BYTES);
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* record = blob + 1 + i * FILTER_RECORD_BYTES;
+    FilterRule rule;
+    rule.id = getLittleEndian(record, 4);
+    rule.protocols = getLittleEndian(record + 4, 4);
+    rule.bitLengths = getLittleEndian(record + 8, 8);
+    rule.low = getLittleEndian(record + 16, 4);
+    rule.high = getLittleEndian(record + 20, 4);
+    rule.list = (FilterList)record[24];
+    if (rule.id == 0 || !validFilterRule(rule)) {
+      continue;
+    }
+    rules.push_back(rule);
+  }
+  
+  std::sort(rules.begin(), rules.end(), [](const FilterRule& a, const FilterRule& b) { return a.id < b.id; });
+}
@@ -0,0 +1,132 @@
+#include "CommandQueue.h"
+
+#include <algorithm>
+
+const size_t CommandQueue::MAX_RESULTS;
+
+CommandQueue::CommandQueue(size_t capacity, size_t reserved)
+  : capacity(capacity), reserved(reserved), lastTicket(0), completedThrough(0), finished(), nextFinished(0), totals(),
+    windowStart(0), windowCount(0), windowLatencyUs(0) {
+}
+
+bool CommandQueue::post(Command command, bool priority) {
+  return enqueue(command, priority, nullptr);
+}
+
+// Tickets are handed out under the queue lock, so they follow queue order
+bool CommandQueue::enqueue(Command& command, bool priority, uint32_t* ticket) {
+  command.queuedAt = micros();
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (pending.size() >= (priority ? capacity : capacity - reserved)) {
+      std::lock_guard<std::mutex> statsLock(statsMutex);
+      totals.rejected++;
+      return false;
+    }
+    if (ticket) {
+      command.ticket = *ticket = ++lastTicket;
+    }
+    pending.push_back(std::move(command));
+  }
+  workAvailable.notify_one();
+  return true;
+}
+
+CommandResult CommandQueue::call(Command command, unsigned long waitMs, uint32_t& ticket) {
+  command.reply = std::make_shared<std::promise<CommandResult>>();
+  std::future<CommandResult> result = command.reply->get_future();
+  
+  if (!enqueue(command, false, &ticket)) {
+    return CommandResult{503, "Command queue full"};
+  }
+  if (result.wait_for(std::chrono::milliseconds(waitMs)) != std::future_status::ready) {
+    // Checked under the lock complete() takes, so the result goes one way or the other
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    if (completedThrough < ticket) {
+      abandoned.push_back(ticket);
+      return CommandResult{202, "Command queued"};
+    }
+  }
+  return result.get();
+}
+
+CommandResult CommandQueue::result(uint32_t ticket) {
+  uint32_t issued;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    issued = lastTicket;
+  }
+  std::lock_guard<std::mutex> lock(resultsMutex);
+  if (ticket == 0 || ticket > issued) {
+    return CommandResult{410, "Unknown or expired command"};
+  }
+  if (ticket > completedThrough) {
+    return CommandResult{202, "Command queued"};
+  }
+  for (const FinishedCommand& done : finished) {
+    if (done.ticket == ticket) {
+      return done.result;
+    }
+  }
+  return CommandResult{410, "Unknown or expired command"};
+}
+
+void CommandQueue::waitForWork(unsigned long timeoutMs) {
+  std::unique_lock<std::mutex> lock(queueMutex);
+  workAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                         [this] { return !pending.empty(); });
+}
+
+std::deque<Command> CommandQueue::takeBatch() {
+  std::deque<Command> batch;
+  std::lock_guard<std::mutex> lock(queueMutex);
+  batch.swap(pending);
+  return batch;
+}
+
+void CommandQueue::complete(Command& command, const CommandResult& result) {
+  if (command.ticket) {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    completedThrough = command.ticket;
+    auto waiting = std::find(abandoned.begin(), abandoned.end(), command.ticket);
+    if (waiting != abandoned.end()) {
+      abandoned.erase(waiting);
+      finished[nextFinished++ % MAX_RESULTS] = FinishedCommand{command.ticket, result};
+    }
+  }
+  if (command.reply) {
+    command.reply->set_value(result);
+  }
+  
+  unsigned long latency = micros() - command.queuedAt;
+  std::lock_guard<std::mutex> lock(statsMutex);
+  totals.processed++;
+  windowCount++;
+  windowLatencyUs += latency;
+  if (latency > totals.maxLatencyUs) {
+    totals.maxLatencyUs = latency;
+  }
+}
+
+void CommandQueue::batchFinished(size_t batchSize) {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  if (batchSize > 0) {
+    totals.batches++;
+  }
+  
+  // Roll the rate/latency window once per second
+  unsigned long now = millis();
+  unsigned long elapsed = now - windowStart;
+  if (elapsed >= 1000) {
+    totals.commandsPerSecond = windowCount * 1000 / elapsed;
+    totals.avgLatencyUs = windowCount > 0 ? windowLatencyUs / windowCount : 0;
+    windowStart = now;
+    windowCount = 0;
+    windowLatencyUs = 0;
+  }
+}
+
+CommandStats CommandQueue::stats() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return totals;
+}
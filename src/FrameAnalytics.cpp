@@ -0,0 +1,278 @@
+#include "FrameAnalytics.h"
+
+#include <math.h>
+#include <string.h>
+
+const int SpaceSaving::CAPACITY;
+const int SpaceSaving::SLOTS;
+const int16_t SpaceSaving::NONE;
+const int HyperLogLog::PRECISION;
+const int HyperLogLog::REGISTERS;
+const int AnalyticsReport::TOP;
+const int AnalyticsReport::PROTOCOLS;
+
+void SpaceSaving::clear() {
+  used = 0;
+  lowest = NONE;
+  highest = NONE;
+  for (int slot = 0; slot < SLOTS; slot++) {
+    index[slot] = NONE;
+  }
+  // Every bucket on the free list, chained through next
+  for (int bucket = 0; bucket <= CAPACITY; bucket++) {
+    buckets[bucket].next = bucket < CAPACITY ? bucket + 1 : NONE;
+  }
+  freeBuckets = 0;
+}
+
+// The slot holding key, or the empty slot it would go in
+int SpaceSaving::find(uint64_t key, uint64_t hash) const {
+  int slot = hash & (SLOTS - 1);
+  while (index[slot] != NONE && counters[index[slot]].entry.key != key) {
+    slot = (slot + 1) & (SLOTS - 1);
+  }
+  return slot;
+}
+
+// Backward-shift deletion: later entries of the probe run move up, so
+// lookups never need tombstones
+void SpaceSaving::unindex(int slot) {
+  int hole = slot;
+  for (int i = (hole + 1) & (SLOTS - 1); index[i] != NONE; i = (i + 1) & (SLOTS - 1)) {
+    int home = counters[index[i]].hash & (SLOTS - 1);
+    if (((i - home) & (SLOTS - 1)) >= ((i - hole) & (SLOTS - 1))) {
+      index[hole] = index[i];
+      hole = i;
+    }
+  }
+  index[hole] = NONE;
+}
+
+void SpaceSaving::add(uint64_t key, uint64_t hash) {
+  int slot = find(key, hash);
+  if (index[slot] != NONE) {
+    increment(index[slot]);
+    return;
+  }
+  
+  if (used == CAPACITY) {
+    // Take over a least counted code, inheriting its count as error
+    int counter = buckets[lowest].first;
+    uint32_t inherited = buckets[lowest].count;
+    unindex(find(counters[counter].entry.key, counters[counter].hash));
+    counters[counter].entry = Entry{key, inherited, inherited};
+    counters[counter].hash = hash;
+    index[find(key, hash)] = counter;
+    increment(counter);
+    return;
+  }
+  
+  int counter = used++;
+  counters[counter].entry = Entry{key, 1, 0};
+  counters[counter].hash = hash;
+  index[slot] = counter;
+  attach(counter, lowest != NONE && buckets[lowest].count == 1 ? lowest : newBucket(1, NONE));
+}
+
+void SpaceSaving::increment(int counter) {
+  int bucket = counters[counter].bucket;
+  uint32_t count = buckets[bucket].count + 1;
+  counters[counter].entry.count = count;
+  
+  int next = buckets[bucket].next;
+  if (next != NONE && buckets[next].count == count) {
+    detach(counter);
+    attach(counter, next);
+  } else if (buckets[bucket].first == counter && counters[counter].next == NONE) {
+    // Alone in its bucket, and the next one up is higher still
+    buckets[bucket].count = count;
+  } else {
+    int created = newBucket(count, bucket);
+    detach(counter);
+    attach(counter, created);
+  }
+}
+
+void SpaceSaving::attach(int counter, int bucket) {
+  Counter& c = counters[counter];
+  c.bucket = bucket;
+  c.prev = NONE;
+  c.next = buckets[bucket].first;
+  if (c.next != NONE) {
+    counters[c.next].prev = counter;
+  }
+  buckets[bucket].first = counter;
+}
+
+void SpaceSaving::detach(int counter) {
+  Counter& c = counters[counter];
+  if (c.prev != NONE) {
+    counters[c.prev].next = c.next;
+  } else {
+    buckets[c.bucket].first = c.next;
+  }
+  if (c.next != NONE) {
+    counters[c.next].prev = c.prev;
+  }
+  if (buckets[c.bucket].first == NONE) {
+    freeBucket(c.bucket);
+  }
+}
+
+// An empty bucket linked in after the given one, or first when after is NONE
+int SpaceSaving::newBucket(uint32_t count, int after) {
+  int bucket = freeBuckets;
+  freeBuckets = buckets[bucket].next;
+  Bucket& b = buckets[bucket];
+  b.count = count;
+  b.first = NONE;
+  b.prev = after;
+  b.next = after != NONE ? buckets[after].next : lowest;
+  if (b.prev != NONE) {
+    buckets[b.prev].next = bucket;
+  } else {
+    lowest = bucket;
+  }
+  if (b.next != NONE) {
+    buckets[b.next].prev = bucket;
+  } else {
+    highest = bucket;
+  }
+  return bucket;
+}
+
+void SpaceSaving::freeBucket(int bucket) {
+  Bucket& b = buckets[bucket];
+  if (b.prev != NONE) {
+    buckets[b.prev].next = b.next;
+  } else {
+    lowest = b.next;
+  }
+  if (b.next != NONE) {
+    buckets[b.next].prev = b.prev;
+  } else {
+    highest = b.prev;
+  }
+  b.next = freeBuckets;
+  freeBuckets = bucket;
+}
+
+size_t SpaceSaving::top(Entry* out, size_t max) const {
+  size_t count = 0;
+  for (int bucket = highest; bucket != NONE && count < max; bucket = buckets[bucket].prev) {
+    for (int counter = buckets[bucket].first; counter != NONE && count < max; counter = counters[counter].next) {
+      out[count++] = counters[counter].entry;
+    }
+  }
+  return count;
+}
+
+void HyperLogLog::clear() {
+  memset(registers, 0, sizeof(registers));
+}
+
+void HyperLogLog::add(uint64_t hash) {
+  // The top bits pick a register, the rest give the rank of the first 1 bit
+  int slot = hash >> (64 - PRECISION);
+  uint64_t rest = hash << PRECISION;
+  uint8_t rank = rest ? __builtin_clzll(rest) + 1 : 64 - PRECISION + 1;
+  if (rank > registers[slot]) {
+    registers[slot] = rank;
+  }
+}
+
+double HyperLogLog::estimate() const {
+  double sum = 0;
+  int zeros = 0;
+  for (int i = 0; i < REGISTERS; i++) {
+    sum += ldexp(1.0, -registers[i]);
+    zeros += registers[i] == 0;
+  }
+  double alpha = 0.7213 / (1 + 1.079 / REGISTERS);
+  double estimate = alpha * REGISTERS * REGISTERS / sum;
+  // Linear counting is closer while many registers are still empty
+  if (estimate <= 2.5 * REGISTERS && zeros > 0) {
+    estimate = REGISTERS * log((double)REGISTERS / zeros);
+  }
+  return estimate;
+}
+
+// splitmix64's finalizer: signal keys differ in a few low bits of each field
+uint64_t FrameAnalytics::hashKey(uint64_t key) {
+  key ^= key >> 30;
+  key *= 0xBF58476D1CE4E5B9ULL;
+  key ^= key >> 27;
+  key *= 0x94D049BB133111EBULL;
+  return key ^ (key >> 31);
+}
+
+FrameAnalytics::FrameAnalytics(unsigned long windowMs) : windowMs(windowMs), last(), lastValid(false) {
+  restart(0);
+}
+
+void FrameAnalytics::record(uint64_t key, unsigned int protocol, unsigned long now) {
+  std::lock_guard<std::mutex> guard(lock);
+  rollOver(now);
+  frames++;
+  protocolFrames[protocol < (unsigned int)AnalyticsReport::PROTOCOLS ? protocol : 0]++;
+  uint64_t hash = hashKey(key);
+  hitters.add(key, hash);
+  distinct.add(hash);
+}
+
+void FrameAnalytics::setWindow(unsigned long window, unsigned long now) {
+  std::lock_guard<std::mutex> guard(lock);
+  windowMs = window;
+  lastValid = false;
+  restart(now);
+}
+
+void FrameAnalytics::reset(unsigned long now) {
+  std::lock_guard<std::mutex> guard(lock);
+  lastValid = false;
+  restart(now);
+}
+
+void FrameAnalytics::report(unsigned long now, AnalyticsReport& current, AnalyticsReport& previous,
+                            bool& previousValid) {
+  std::lock_guard<std::mutex> guard(lock);
+  rollOver(now);
+  summarize(now, current);
+  previous = last;
+  previousValid = lastValid;
+}
+
+// Ends the window once it has run its length; windows that passed with no
+// frame at all leave an empty one as the last
+void FrameAnalytics::rollOver(unsigned long now) {
+  unsigned long elapsed = now - start;
+  if (windowMs == 0 || elapsed < windowMs) {
+    return;
+  }
+  unsigned long windows = elapsed / windowMs;
+  if (windows == 1) {
+    summarize(start + windowMs, last);
+  } else {
+    restart(start + (windows - 1) * windowMs);
+    summarize(start + windowMs, last);
+  }
+  lastValid = true;
+  restart(start + windowMs);
+}
+
+void FrameAnalytics::summarize(unsigned long now, AnalyticsReport& report) const {
+  report.start = start;
+  report.length = now - start;
+  report.frames = frames;
+  report.distinct = lround(distinct.estimate());
+  memcpy(report.protocolFrames, protocolFrames, sizeof(protocolFrames));
+  report.topCount = hitters.top(report.top, AnalyticsReport::TOP);
+}
+
+void FrameAnalytics::restart(unsigned long now) {
+  start = now;
+  frames = 0;
+  memset(protocolFrames, 0, sizeof(protocolFrames));
+  hitters.clear();
+  distinct.clear();
+}
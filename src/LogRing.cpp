@@ -0,0 +1,121 @@
+#include "LogRing.h"
+
+#include "Metrics.h"
+
+static const char* FORMATS[] = {
+#define RF_LOG_FORMAT(id, format) format,
+  RF_LOG_MESSAGES(RF_LOG_FORMAT)
+#undef RF_LOG_FORMAT
+};
+
+static const char* LEVEL_NAMES[] = {"debug", "info", "warn", "error"};
+
+LogRing logRing;
+
+static SampledMetric logEntries("log_entries_total", "Log entries recorded",
+  Metric::COUNTER, []() { return (double)logRing.recorded(); });
+static SampledMetric logLost("log_entries_lost_total", "Log entries overwritten before they were printed",
+  Metric::COUNTER, []() { return (double)logRing.lost(); });
+
+LogRing::LogRing() : head(0), drained(0), lostTotal(0) {
+  for (auto& slot : slots) {
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.timestampUs.store(0, std::memory_order_relaxed);
+    slot.header.store(0, std::memory_order_relaxed);
+    for (auto& arg : slot.args) {
+      arg.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void LogRing::record(LogLevel level, LogMessage message, uint32_t timestampUs,
+                     const uint32_t* args, uint8_t argCount) {
+  uint32_t position = head.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots[position % CAPACITY];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestampUs.store(timestampUs, std::memory_order_relaxed);
+  slot.header.store((uint32_t)level | ((uint32_t)message << 8) | ((uint32_t)argCount << 16),
+                    std::memory_order_relaxed);
+  for (uint8_t i = 0; i < argCount; i++) {
+    slot.args[i].store(args[i], std::memory_order_relaxed);
+  }
+  slot.sequence.store(position + 1, std::memory_order_release);
+}
+
+bool LogRing::read(uint32_t position, LogEntry& entry) const {
+  const Slot& slot = slots[position % CAPACITY];
+  if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+    return false;  // Still being written or already reused
+  }
+  entry.sequence = position;
+  entry.timestampUs = slot.timestampUs.load(std::memory_order_relaxed);
+  uint32_t header = slot.header.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < MAX_ARGS; i++) {
+    entry.args[i] = slot.args[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.sequence.load(std::memory_order_relaxed) != position + 1) {
+    return false;
+  }
+  entry.level = (LogLevel)(header & 0xFF);
+  entry.message = (LogMessage)((header >> 8) & 0xFF);
+  entry.argCount = (header >> 16) & 0xFF;
+  return entry.message < LOG_MESSAGE_COUNT && entry.argCount <= MAX_ARGS;
+}
+
+uint32_t LogRing::drain(const std::function<void(const LogEntry&)>& write, size_t max) {
+  uint32_t end = head.load(std::memory_order_acquire);
+  uint32_t lostNow = 0;
+  if (end - drained > CAPACITY) {
+    lostNow = end - CAPACITY - drained;
+    drained = end - CAPACITY;
+  }
+  
+  LogEntry entry;
+  for (size_t handled = 0; drained != end && handled < max; handled++) {
+    if (read(drained, entry)) {
+      write(entry);
+    } else if (head.load(std::memory_order_acquire) - drained <= CAPACITY) {
+      break;  // Writer still filling this slot; pick it up next time
+    } else {
+      lostNow++;
+    }
+    drained++;
+  }
+  
+  if (lostNow) {
+    lostTotal.fetch_add(lostNow, std::memory_order_relaxed);
+  }
+  return lostNow;
+}
+
+void LogRing::recent(std::vector<LogEntry>& entries, uint32_t since) const {
+  uint32_t end = head.load(std::memory_order_acquire);
+  uint32_t begin = end > CAPACITY ? end - CAPACITY : 0;
+  if (since > begin && since <= end) {
+    begin = since;
+  }
+  entries.clear();
+  entries.reserve(end - begin);
+  LogEntry entry;
+  for (uint32_t position = begin; position < end; position++) {
+    if (read(position, entry)) {
+      entries.push_back(entry);
+    }
+  }
+}
+
+int LogRing::format(const LogEntry& entry, char* buffer, size_t size) {
+  if (entry.message >= LOG_MESSAGE_COUNT) {
+    return snprintf(buffer, size, "Unknown log message %u", (unsigned)entry.message);
+  }
+  // Unused trailing arguments are ignored by the format
+  return snprintf(buffer, size, FORMATS[entry.message],
+                  (unsigned)entry.args[0], (unsigned)entry.args[1],
+                  (unsigned)entry.args[2], (unsigned)entry.args[3]);
+}
+
+const char* LogRing::levelName(LogLevel level) {
+  return level < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]) ? LEVEL_NAMES[level] : "unknown";
+}
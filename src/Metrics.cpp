@@ -0,0 +1,183 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+Metric* Metric::head = nullptr;
+Metric* Metric::tail = nullptr;
+
+const uint32_t LATENCY_BUCKETS_US[] = {
+  100, 500, 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000
+};
+const size_t LATENCY_BUCKET_COUNT = sizeof(LATENCY_BUCKETS_US) / sizeof(LATENCY_BUCKETS_US[0]);
+
+Metric::Metric(const char* name, const char* help, Type type, const char* labels)
+  : name(name), help(help), type(type), labels(labels), next(nullptr) {
+  // Keep definition order so same-name metrics stay adjacent
+  if (tail) {
+    tail->next = this;
+  } else {
+    head = this;
+  }
+  tail = this;
+}
+
+Metric::~Metric() {
+  // Registration is not synchronised with scrapes; only metrics of
+  // short-lived objects (native benchmarks) are ever destroyed
+  Metric* previous = nullptr;
+  for (Metric* metric = head; metric; previous = metric, metric = metric->next) {
+    if (metric == this) {
+      (previous ? previous->next : head) = next;
+      if (tail == this) {
+        tail = previous;
+      }
+      break;
+    }
+  }
+}
+
+void Metric::render(String& out, const Metric* previous) const {
+  if (!previous || strcmp(previous->name, name) != 0) {
+    static const char* TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += TYPE_NAMES[type];
+    out += "\n";
+  }
+  renderSamples(out);
+}
+
+void Metric::sample(String& out, const char* name, const char* suffix,
+                    const char* labels, const char* extraLabels, double value) {
+  out += name;
+  out += suffix;
+  bool hasLabels = labels && *labels;
+  bool hasExtra = extraLabels && *extraLabels;
+  if (hasLabels || hasExtra) {
+    out += "{";
+    if (hasLabels) out += labels;
+    if (hasLabels && hasExtra) out += ",";
+    if (hasExtra) out += extraLabels;
+    out += "}";
+  }
+  char number[32];
+  snprintf(number, sizeof(number), " %.9g\n", value);
+  out += number;
+}
+
+void Counter::renderSamples(String& out) const {
+  sample(out, name, "", labels, nullptr, value.load(std::memory_order_relaxed));
+}
+
+void Gauge::renderSamples(String& out) const {
+  sample(out, name, "", labels, nullptr, value.load(std::memory_order_relaxed));
+}
+
+void SampledMetric::renderSamples(String& out) const {
+  sample(out, name, "", labels, nullptr, sampler());
+}
+
+// HistogramData
+
+HistogramData::HistogramData() : sumUs(0), count(0) {
+  for (auto& bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void HistogramData::observe(const uint32_t* bounds, size_t boundCount, uint32_t valueUs) {
+  size_t bucket = 0;
+  while (bucket < boundCount && valueUs > bounds[bucket]) {
+    bucket++;
+  }
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  sumUs.fetch_add(valueUs, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HistogramData::render(String& out, const char* name, const char* labels,
+                           const uint32_t* bounds, size_t boundCount) const {
+  // Buckets are stored per range; Prometheus wants cumulative counts
+  uint32_t cumulative = 0;
+  char le[32];
+  for (size_t i = 0; i <= boundCount; i++) {
+    cumulative += buckets[i].load(std::memory_order_relaxed);
+    if (i < boundCount) {
+      snprintf(le, sizeof(le), "le=\"%g\"", bounds[i] / 1e6);
+    } else {
+      snprintf(le, sizeof(le), "le=\"+Inf\"");
+    }
+    Metric::sample(out, name, "_bucket", labels, le, cumulative);
+  }
+  Metric::sample(out, name, "_sum", labels, nullptr, sumUs.load(std::memory_order_relaxed) / 1e6);
+  Metric::sample(out, name, "_count", labels, nullptr, count.load(std::memory_order_relaxed));
+}
+
+// Histogram
+
+Histogram::Histogram(const char* name, const char* help, const char* labels,
+                     const uint32_t* bounds, size_t boundCount)
+  : Metric(name, help, HISTOGRAM, labels), bounds(bounds),
+    boundCount(boundCount < HistogramData::MAX_BUCKETS ? boundCount : HistogramData::MAX_BUCKETS) {
+}
+
+void Histogram::renderSamples(String& out) const {
+  data.render(out, name, labels, bounds, boundCount);
+}
+
+// RouteHistogram
+
+RouteHistogram::RouteHistogram(const char* name, const char* help)
+  : Metric(name, help, HISTOGRAM) {
+}
+
+HistogramData* RouteHistogram::add(const char* route, const char* method) {
+  children.emplace_back();
+  Child& child = children.back();
+  child.route = route;
+  child.method = method;
+  return &child.data;
+}
+
+void RouteHistogram::renderSamples(String& out) const {
+  String labels;
+  for (const Child& child : children) {
+    labels = "route=\"";
+    labels += child.route;
+    labels += "\",method=\"";
+    labels += child.method;
+    labels += "\"";
+    child.data.render(out, name, labels.c_str(), LATENCY_BUCKETS_US, LATENCY_BUCKET_COUNT);
+  }
+}
+
+// MetricsExporter
+
+size_t MetricsExporter::read(uint8_t* buffer, size_t maxLength) {
+  size_t written = 0;
+  while (written < maxLength) {
+    if (offset >= pending.length()) {
+      if (!current) {
+        break;
+      }
+      pending = "";
+      offset = 0;
+      current->render(pending, previous);
+      previous = current;
+      current = current->nextMetric();
+      continue;
+    }
+    size_t count = std::min<size_t>(maxLength - written, pending.length() - offset);
+    memcpy(buffer + written, pending.c_str() + offset, count);
+    offset += count;
+    written += count;
+  }
+  return written;
+}
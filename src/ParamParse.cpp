@@ -0,0 +1,122 @@
+#include "ParamParse.h"
+
+#include <string.h>
+
+bool parseLong(const char* text, size_t length, long min, long max, long& value) {
+  size_t i = 0;
+  bool negative = false;
+  if (length > 0 && (text[0] == '-' || text[0] == '+')) {
+    negative = text[0] == '-';
+    i = 1;
+  }
+  if (i == length) {
+    return false;
+  }
+  
+  // Accumulate as a negative number so LONG_MIN fits
+  long limit = negative ? min : -max;
+  long result = 0;
+  for (; i < length; i++) {
+    char c = text[i];
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    int digit = c - '0';
+    if (result < (limit + digit) / 10) {
+      return false;
+    }
+    result = result * 10 - digit;
+    if (result < limit) {
+      return false;
+    }
+  }
+  
+  if (negative) {
+    if (result > max) {
+      return false;
+    }
+    value = result;
+    return true;
+  }
+  if (-result < min) {
+    return false;
+  }
+  value = -result;
+  return true;
+}
+
+bool parseInt(const String& text, int min, int max, int& value) {
+  long parsed;
+  if (!parseLong(text.c_str(), text.length(), min, max, parsed)) {
+    return false;
+  }
+  value = (int)parsed;
+  return true;
+}
+
+bool parseUInt32(const String& text, uint32_t& value) {
+  // Digits only, checked against 2^32 without relying on a 64-bit long
+  const char* digits = text.c_str();
+  size_t length = text.length();
+  if (length == 0) {
+    return false;
+  }
+  uint32_t result = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (digits[i] < '0' || digits[i] > '9') {
+      return false;
+    }
+    uint32_t digit = digits[i] - '0';
+    if (result > (UINT32_MAX - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  value = result;
+  return true;
+}
+
+bool parseCode(const char* text, size_t length, uint32_t& value) {
+  bool hex = length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+  size_t i = hex ? 2 : 0;
+  if (i == length) {
+    return false;
+  }
+  uint32_t base = hex ? 16 : 10;
+  uint32_t result = 0;
+  for (; i < length; i++) {
+    char c = text[i];
+    uint32_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (hex && c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (hex && c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    if (result > (UINT32_MAX - digit) / base) {
+      return false;
+    }
+    result = result * base + digit;
+  }
+  value = result;
+  return true;
+}
+
+bool parseBool(const char* text, size_t length, bool& value) {
+  if ((length == 4 && memcmp(text, "true", 4) == 0) || (length == 1 && text[0] == '1')) {
+    value = true;
+    return true;
+  }
+  if ((length == 5 && memcmp(text, "false", 5) == 0) || (length == 1 && text[0] == '0')) {
+    value = false;
+    return true;
+  }
+  return false;
+}
+
+bool parseBool(const String& text, bool& value) {
+  return parseBool(text.c_str(), text.length(), value);
+}
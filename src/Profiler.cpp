@@ -0,0 +1,119 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+
+static const size_t WINDOW_SECONDS[WINDOW_COUNT] = {1, 10, 60};
+
+Profiler::Profiler()
+  : filled(0), current(0), currentMaxUs(0), lastTickMs(0), lastTotalRunTime(0),
+    published(std::make_shared<ProfileSnapshot>()) {
+  for (size_t i = 0; i < SECONDS; i++) {
+    iterations[i] = 0;
+    busyUs[i] = 0;
+  }
+}
+
+void Profiler::loopIteration(uint32_t busy) {
+  iterations[current]++;
+  busyUs[current] += busy;
+  if (busy > currentMaxUs) {
+    currentMaxUs = busy;
+  }
+}
+
+void Profiler::tick(uint32_t nowMs) {
+  uint32_t elapsedMs = nowMs - lastTickMs;
+  if (elapsedMs < 1000) {
+    return;
+  }
+  lastTickMs = nowMs;
+  if (filled < SECONDS) {
+    filled++;
+  }
+  
+  std::shared_ptr<ProfileSnapshot> profile = std::make_shared<ProfileSnapshot>();
+  profile->uptimeMs = nowMs;
+  profile->loopMaxUs = currentMaxUs;
+  
+  // Walk back from the second that just closed
+  for (int window = 0; window < WINDOW_COUNT; window++) {
+    size_t seconds = std::min(WINDOW_SECONDS[window], filled);
+    uint64_t count = 0;
+    uint64_t busy = 0;
+    for (size_t i = 0; i < seconds; i++) {
+      size_t slot = (current + SECONDS - i) % SECONDS;
+      count += iterations[slot];
+      busy += busyUs[slot];
+    }
+    profile->loopRate[window] = (float)count / seconds;
+    profile->loopBusyPercent[window] = busy / (seconds * 10000.0f);
+  }
+  
+  sampleTasks(*profile);
+  std::atomic_store(&published, Snapshot(profile));
+  
+  current = (current + 1) % SECONDS;
+  iterations[current] = 0;
+  busyUs[current] = 0;
+  currentMaxUs = 0;
+}
+
+Profiler::Snapshot Profiler::snapshot() const {
+  return std::atomic_load(&published);
+}
+
+void Profiler::sampleTasks(ProfileSnapshot& profile) {
+  profile.runTimeStats = RF_PROFILE_RUN_TIME;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    profile.coreBusyPercent[core] = -1;
+  }
+  
+#if configUSE_TRACE_FACILITY
+  UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;  // Room for tasks created meanwhile
+  std::vector<TaskStatus_t> states(capacity);
+  uint32_t totalRunTime = 0;
+  UBaseType_t count = uxTaskGetSystemState(states.data(), capacity, &totalRunTime);
+  states.resize(count);
+  
+  // Run-time counters are cumulative; shares come from the change since last sample
+  std::vector<RunTime> runTimes;
+  runTimes.reserve(count);
+  uint32_t elapsed = totalRunTime - lastTotalRunTime;
+  
+  profile.tasks.reserve(count);
+  for (const TaskStatus_t& state : states) {
+    TaskProfile task;
+    task.name = state.pcTaskName;
+    task.priority = state.uxCurrentPriority;
+    task.stackFreeMin = state.usStackHighWaterMark;
+    task.cpuPercent = -1;
+#if configTASKLIST_INCLUDE_COREID
+    task.core = (state.xCoreID >= 0 && state.xCoreID < portNUM_PROCESSORS) ? state.xCoreID : -1;
+#else
+    task.core = -1;
+#endif
+    
+#if RF_PROFILE_RUN_TIME
+    runTimes.push_back(RunTime{state.xHandle, state.ulRunTimeCounter});
+    if (lastTotalRunTime != 0 && elapsed > 0) {
+      for (const RunTime& last : lastRunTimes) {
+        if (last.task == state.xHandle) {
+          task.cpuPercent = (state.ulRunTimeCounter - last.counter) * 100.0f / elapsed;
+          break;
+        }
+      }
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+      if (state.xHandle == xTaskGetIdleTaskHandleForCPU(core) && task.cpuPercent >= 0) {
+        profile.coreBusyPercent[core] = std::max(0.0f, 100.0f - task.cpuPercent);
+      }
+    }
+#endif
+    profile.tasks.push_back(task);
+  }
+  
+  lastRunTimes.swap(runTimes);
+  lastTotalRunTime = totalRunTime;
+#endif
+}
@@ -0,0 +1,363 @@
+#include "RoaringBitmap.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+int popcount64(uint64_t word) {
+  return __builtin_popcountll(word);
+}
+
+}  // namespace
+
+// Container
+
+bool RoaringBitmap::Container::contains(uint16_t low) const {
+  if (isBitset()) {
+    return (bits[low >> 6] >> (low & 63)) & 1;
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool RoaringBitmap::Container::add(uint16_t low) {
+  if (isBitset()) {
+    uint64_t mask = 1ULL << (low & 63);
+    if (bits[low >> 6] & mask) return false;
+    bits[low >> 6] |= mask;
+  } else {
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it != array.end() && *it == low) return false;
+    array.insert(it, low);
+  }
+  count++;
+  normalize();
+  return true;
+}
+
+bool RoaringBitmap::Container::remove(uint16_t low) {
+  if (isBitset()) {
+    uint64_t mask = 1ULL << (low & 63);
+    if (!(bits[low >> 6] & mask)) return false;
+    bits[low >> 6] &= ~mask;
+  } else {
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it == array.end() || *it != low) return false;
+    array.erase(it);
+  }
+  count--;
+  normalize();
+  return true;
+}
+
+void RoaringBitmap::Container::toBitset() {
+  bits.assign(BITSET_WORDS, 0);
+  for (uint16_t low : array) {
+    bits[low >> 6] |= 1ULL << (low & 63);
+  }
+  std::vector<uint16_t>().swap(array);
+}
+
+void RoaringBitmap::Container::toArray() {
+  array.clear();
+  array.reserve(count);
+  for (size_t word = 0; word < BITSET_WORDS; word++) {
+    uint64_t w = bits[word];
+    while (w) {
+      int bit = __builtin_ctzll(w);
+      array.push_back(word * 64 + bit);
+      w &= w - 1;
+    }
+  }
+  std::vector<uint64_t>().swap(bits);
+}
+
+void RoaringBitmap::Container::normalize() {
+  if (isBitset() && count <= ARRAY_LIMIT) {
+    toArray();
+  } else if (!isBitset() && count > ARRAY_LIMIT) {
+    toBitset();
+  }
+}
+
+// Lookup
+
+RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) {
+  auto it = std::lower_bound(containers.begin(), containers.end(), key,
+    [](const Container& c, uint16_t k) { return c.key < k; });
+  return it != containers.end() && it->key == key ? &*it : nullptr;
+}
+
+const RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) const {
+  return const_cast<RoaringBitmap*>(this)->find(key);
+}
+
+void RoaringBitmap::add(uint32_t id) {
+  uint16_t key = id >> 16;
+  auto it = std::lower_bound(containers.begin(), containers.end(), key,
+    [](const Container& c, uint16_t k) { return c.key < k; });
+  if (it == containers.end() || it->key != key) {
+    Container container;
+    container.key = key;
+    container.count = 0;
+    it = containers.insert(it, container);
+  }
+  it->add(id & 0xFFFF);
+}
+
+void RoaringBitmap::remove(uint32_t id) {
+  Container* container = find(id >> 16);
+  if (container && container->remove(id & 0xFFFF) && container->count == 0) {
+    containers.erase(containers.begin() + (container - containers.data()));
+  }
+}
+
+bool RoaringBitmap::contains(uint32_t id) const {
+  const Container* container = find(id >> 16);
+  return container && container->contains(id & 0xFFFF);
+}
+
+size_t RoaringBitmap::cardinality() const {
+  size_t total = 0;
+  for (const auto& container : containers) {
+    total += container.count;
+  }
+  return total;
+}
+
+void RoaringBitmap::toVector(std::vector<uint32_t>& ids) const {
+  ids.reserve(ids.size() + cardinality());
+  for (const auto& container : containers) {
+    uint32_t high = (uint32_t)container.key << 16;
+    if (container.isBitset()) {
+      for (size_t word = 0; word < BITSET_WORDS; word++) {
+        uint64_t w = container.bits[word];
+        while (w) {
+          ids.push_back(high | (word * 64 + __builtin_ctzll(w)));
+          w &= w - 1;
+        }
+      }
+    } else {
+      for (uint16_t low : container.array) {
+        ids.push_back(high | low);
+      }
+    }
+  }
+}
+
+// Set operations
+
+RoaringBitmap::Container RoaringBitmap::combine(const Container& a, const Container& b, Operation operation) {
+  Container result;
+  result.key = a.key;
+  result.count = 0;
+  
+  if (a.isBitset() && b.isBitset()) {
+    // Word-parallel
+    result.bits.resize(BITSET_WORDS);
+    for (size_t word = 0; word < BITSET_WORDS; word++) {
+      uint64_t w;
+      switch (operation) {
+        case AND: w = a.bits[word] & b.bits[word]; break;
+        case OR: w = a.bits[word] | b.bits[word]; break;
+        default: w = a.bits[word] & ~b.bits[word]; break;
+      }
+      result.bits[word] = w;
+      result.count += popcount64(w);
+    }
+  } else if (a.isBitset() || b.isBitset()) {
+    // One side is an array: probe or update the bitset with its values,
+    // never widen it
+    const Container& bitset = a.isBitset() ? a : b;
+    const Container& sparse = a.isBitset() ? b : a;
+    if (operation == AND || (operation == ANDNOT && !a.isBitset())) {
+      bool keep = operation == AND;
+      for (uint16_t low : sparse.array) {
+        if (bitset.contains(low) == keep) {
+          result.array.push_back(low);
+        }
+      }
+      result.count = result.array.size();
+    } else {
+      // a | array, or a bitset minus an array: a copy of the bitset, updated in place
+      result.bits = bitset.bits;
+      result.count = bitset.count;
+      for (uint16_t low : sparse.array) {
+        uint64_t mask = 1ULL << (low & 63);
+        uint64_t& word = result.bits[low >> 6];
+        if (operation == OR && !(word & mask)) {
+          word |= mask;
+          result.count++;
+        } else if (operation == ANDNOT && (word & mask)) {
+          word &= ~mask;
+          result.count--;
+        }
+      }
+    }
+  } else {
+    // Sorted merge of two arrays
+    std::vector<uint16_t>& out = result.array;
+    switch (operation) {
+      case AND:
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out));
+        break;
+      case OR:
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out));
+        break;
+      default:
+        std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out));
+        break;
+    }
+    result.count = out.size();
+  }
+  
+  result.normalize();
+  return result;
+}
+
+RoaringBitmap RoaringBitmap::combine(const RoaringBitmap& a, const RoaringBitmap& b, Operation operation) {
+  RoaringBitmap result;
+  size_t i = 0, j = 0;
+  while (i < a.containers.size() || j < b.containers.size()) {
+    bool hasA = i < a.containers.size();
+    bool hasB = j < b.containers.size();
+    if (hasA && (!hasB || a.containers[i].key < b.containers[j].key)) {
+      // Only in a
+      if (operation != AND) result.containers.push_back(a.containers[i]);
+      i++;
+    } else if (hasB && (!hasA || b.containers[j].key < a.containers[i].key)) {
+      // Only in b
+      if (operation == OR) result.containers.push_back(b.containers[j]);
+      j++;
+    } else {
+      Container merged = combine(a.containers[i], b.containers[j], operation);
+      if (merged.count > 0) result.containers.push_back(merged);
+      i++;
+      j++;
+    }
+  }
+  return result;
+}
+
+RoaringBitmap RoaringBitmap::intersect(const RoaringBitmap& a, const RoaringBitmap& b) {
+  return combine(a, b, AND);
+}
+
+RoaringBitmap RoaringBitmap::unite(const RoaringBitmap& a, const RoaringBitmap& b) {
+  return combine(a, b, OR);
+}
+
+RoaringBitmap RoaringBitmap::subtract(const RoaringBitmap& a, const RoaringBitmap& b) {
+  return combine(a, b, ANDNOT);
+}
+
+// Encoding: u16 container count, then per container
+// u16 key, u8 kind (0 array, 1 bitset), u16 count - 1, payload
+
+namespace {
+
+void put16(std::vector<uint8_t>& out, uint16_t v) {
+  out.push_back(v & 0xFF);
+  out.push_back(v >> 8);
+}
+
+uint16_t get16(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+}  // namespace
+
+void RoaringBitmap::serialize(std::vector<uint8_t>& out) const {
+  put16(out, containers.size());
+  for (const auto& container : containers) {
+    put16(out, container.key);
+    out.push_back(container.isBitset() ? 1 : 0);
+    put16(out, container.count - 1);
+    if (container.isBitset()) {
+      for (uint64_t word : container.bits) {
+        for (int shift = 0; shift < 64; shift += 8) {
+          out.push_back((word >> shift) & 0xFF);
+        }
+      }
+    } else {
+      for (uint16_t low : container.array) {
+        put16(out, low);
+      }
+    }
+  }
+}
+
+bool RoaringBitmap::deserialize(const uint8_t* data, size_t length) {
+  containers.clear();
+  if (length < 2) {
+    return false;
+  }
+  size_t containerCount = get16(data);
+  size_t offset = 2;
+  
+  for (size_t c = 0; c < containerCount; c++) {
+    if (length - offset < 5) {
+      containers.clear();
+      return false;
+    }
+    Container container;
+    container.key = get16(data + offset);
+    bool bitset = data[offset + 2] == 1;
+    container.count = get16(data + offset + 3) + 1;
+    offset += 5;
+  
+    // Keys must be strictly ascending
+    if (!containers.empty() && containers.back().key >= container.key) {
+      containers.clear();
+      return false;
+    }
+  
+    if (bitset) {
+      if (length - offset < BITSET_WORDS * 8) {
+        containers.clear();
+        return false;
+      }
+      container.bits.resize(BITSET_WORDS);
+      uint32_t actual = 0;
+      for (size_t word = 0; word < BITSET_WORDS; word++) {
+        uint64_t w = 0;
+        for (int b = 0; b < 8; b++) {
+          w |= (uint64_t)data[offset + word * 8 + b] << (b * 8);
+        }
+        container.bits[word] = w;
+        actual += popcount64(w);
+      }
+      offset += BITSET_WORDS * 8;
+      if (actual != container.count) {
+        containers.clear();
+        return false;
+      }
+    } else {
+      if (container.count > ARRAY_LIMIT || length - offset < container.count * 2) {
+        containers.clear();
+        return false;
+      }
+      container.array.resize(container.count);
+      for (size_t i = 0; i < container.count; i++) {
+        container.array[i] = get16(data + offset + i * 2);
+        if (i > 0 && container.array[i] <= container.array[i - 1]) {
+          containers.clear();
+          return false;
+        }
+      }
+      offset += container.count * 2;
+    }
+    container.normalize();
+    containers.push_back(container);
+  }
+  return offset == length;
+}
+
+size_t RoaringBitmap::memoryUsage() const {
+  size_t bytes = containers.capacity() * sizeof(Container);
+  for (const auto& container : containers) {
+    bytes += container.array.capacity() * sizeof(uint16_t);
+    bytes += container.bits.capacity() * sizeof(uint64_t);
+  }
+  return bytes;
+}
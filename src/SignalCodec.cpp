@@ -0,0 +1,315 @@
+#include "SignalCodec.h"
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const uint8_t BINARY_MAGIC[4] = {'R', 'F', '4', '3'};
+const uint8_t BINARY_VERSION = 1;
+const size_t BINARY_HEADER_LENGTH = 5;
+const size_t BINARY_FIXED_LENGTH = 15;  // uid..timestamp
+
+void put32(std::vector<uint8_t>& out, uint32_t v) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out.push_back((v >> shift) & 0xFF);
+  }
+}
+
+uint32_t get32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void putShortString(std::vector<uint8_t>& out, const String& text) {
+  size_t length = std::min<size_t>(text.length(), 255);
+  out.push_back(length);
+  out.insert(out.end(), text.c_str(), text.c_str() + length);
+}
+
+void appendText(std::vector<uint8_t>& out, const char* text) {
+  out.insert(out.end(), text, text + strlen(text));
+}
+
+void appendJsonString(std::vector<uint8_t>& out, const String& text) {
+  out.push_back('"');
+  for (unsigned int i = 0; i < text.length(); i++) {
+    char c = text[i];
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if ((unsigned char)c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      appendText(out, escaped);
+    } else {
+      out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+}  // namespace
+
+// SignalExporter
+
+SignalExporter::SignalExporter(SignalStore::Snapshot snapshot, ExportFormat format)
+  : snapshot(snapshot), format(format), position(0), headerWritten(false), recordOffset(0) {
+}
+
+bool SignalExporter::encodeNext() {
+  record.clear();
+  recordOffset = 0;
+  
+  if (format == EXPORT_BINARY && !headerWritten) {
+    record.insert(record.end(), BINARY_MAGIC, BINARY_MAGIC + 4);
+    record.push_back(BINARY_VERSION);
+    headerWritten = true;
+    return true;
+  }
+  if (position >= snapshot->size()) {
+    return false;
+  }
+  
+  const RFSignal& signal = (*snapshot)[position++];
+  std::vector<const String*> tags;
+  snapshot->tags.tagsOf(signal.uid, tags);
+  
+  if (format == EXPORT_BINARY) {
+    put32(record, signal.uid);
+    put32(record, signal.value);
+    record.push_back(signal.bitLength);
+    record.push_back(signal.protocol);
+    record.push_back(signal.isFavorite ? 1 : 0);
+    put32(record, signal.timestamp);
+    putShortString(record, signal.name);
+    record.push_back(tags.size());
+    for (const String* tag : tags) {
+      putShortString(record, *tag);
+    }
+  } else {
+    char numbers[128];
+    snprintf(numbers, sizeof(numbers), "{\"uid\":%lu,\"name\":", (unsigned long)signal.uid);
+    appendText(record, numbers);
+    appendJsonString(record, signal.name);
+    snprintf(numbers, sizeof(numbers),
+             ",\"value\":%lu,\"bitLength\":%u,\"protocol\":%u,\"timestamp\":%lu,\"isFavorite\":%s,\"tags\":[",
+             (unsigned long)signal.value, signal.bitLength, signal.protocol,
+             (unsigned long)signal.timestamp, signal.isFavorite ? "true" : "false");
+    appendText(record, numbers);
+    for (size_t i = 0; i < tags.size(); i++) {
+      if (i > 0) record.push_back(',');
+      appendJsonString(record, *tags[i]);
+    }
+    appendText(record, "]}\n");
+  }
+  return true;
+}
+
+size_t SignalExporter::read(uint8_t* buffer, size_t maxLength) {
+  size_t written = 0;
+  while (written < maxLength) {
+    if (recordOffset >= record.size() && !encodeNext()) {
+      break;
+    }
+    size_t count = std::min(maxLength - written, record.size() - recordOffset);
+    memcpy(buffer + written, record.data() + recordOffset, count);
+    recordOffset += count;
+    written += count;
+  }
+  return written;
+}
+
+// SignalImporter
+
+SignalImporter::SignalImporter(size_t maxRecords)
+  : maxRecords(maxRecords), mode(DETECT) {
+}
+
+bool SignalImporter::fail(const String& message) {
+  if (failure.length() == 0) {
+    failure = message;
+  }
+  pending.clear();
+  return false;
+}
+
+// Names longer than rename allows are cut at a UTF-8 character boundary
+static size_t clampNameLength(const char* name, size_t length) {
+  if (length <= MAX_NAME_LENGTH) {
+    return length;
+  }
+  size_t cut = MAX_NAME_LENGTH;
+  while (cut > 0 && ((uint8_t)name[cut] & 0xC0) == 0x80) {
+    cut--;
+  }
+  return cut;
+}
+
+bool SignalImporter::stage(const ImportedSignal& imported) {
+  if (imported.signal.value == 0) {
+    return true;  // Same rule as loading from preferences
+  }
+  if (staged.size() >= maxRecords) {
+    return fail("Too many records (max " + String(maxRecords) + ")");
+  }
+  staged.push_back(imported);
+  return true;
+}
+
+bool SignalImporter::feed(const uint8_t* data, size_t length) {
+  if (failure.length() > 0) {
+    return false;
+  }
+  pending.insert(pending.end(), data, data + length);
+  
+  if (mode == DETECT) {
+    if (pending.size() < BINARY_HEADER_LENGTH) {
+      return true;
+    }
+    if (memcmp(pending.data(), BINARY_MAGIC, 4) == 0) {
+      if (pending[4] != BINARY_VERSION) {
+        return fail("Unsupported binary version");
+      }
+      pending.erase(pending.begin(), pending.begin() + BINARY_HEADER_LENGTH);
+      mode = BINARY;
+    } else {
+      mode = NDJSON;
+    }
+  }
+  
+  if (mode == BINARY) {
+    size_t offset = 0;
+    while (true) {
+      int consumed = parseBinaryRecord(offset);
+      if (consumed < 0) return false;
+      if (consumed == 0) break;
+      offset += consumed;
+    }
+    pending.erase(pending.begin(), pending.begin() + offset);
+    if (pending.size() > MAX_RECORD_LENGTH) {
+      return fail("Record too long");
+    }
+    return true;
+  }
+  
+  // NDJSON: parse every complete line
+  size_t start = 0;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[i] == '\n') {
+      if (!parseLine((const char*)pending.data() + start, i - start)) {
+        return false;
+      }
+      start = i + 1;
+    }
+  }
+  pending.erase(pending.begin(), pending.begin() + start);
+  if (pending.size() > MAX_RECORD_LENGTH) {
+    return fail("Line too long");
+  }
+  return true;
+}
+
+bool SignalImporter::finish() {
+  if (failure.length() > 0) {
+    return false;
+  }
+  if (mode == BINARY) {
+    if (!pending.empty()) {
+      return fail("Truncated record");
+    }
+  } else if (!pending.empty()) {
+    // Short uploads never left DETECT; a last line may lack its newline
+    if (mode == DETECT && pending.size() >= 4 && memcmp(pending.data(), BINARY_MAGIC, 4) == 0) {
+      return fail("Truncated header");
+    }
+    if (!parseLine((const char*)pending.data(), pending.size())) {
+      return false;
+    }
+    pending.clear();
+  }
+  return true;
+}
+
+bool SignalImporter::parseLine(const char* line, size_t length) {
+  // Tolerate blank lines and CRLF endings
+  while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ')) length--;
+  if (length == 0) {
+    return true;
+  }
+  
+  StaticJsonDocument<1024> doc;
+  DeserializationError error = deserializeJson(doc, line, length);
+  if (error) {
+    return fail(String("Invalid JSON line: ") + error.c_str());
+  }
+  
+  ImportedSignal imported;
+  RFSignal& signal = imported.signal;
+  JsonVariant value = doc["value"];
+  // Accept the string form used by /api/signals as well as numbers
+  signal.value = value.is<const char*>() ? strtoul(value.as<const char*>(), nullptr, 10)
+                                         : value.as<unsigned long>();
+  signal.uid = doc["uid"] | 0UL;
+  const char* name = doc["name"] | "";
+  signal.name.concat(name, clampNameLength(name, strlen(name)));
+  signal.bitLength = doc["bitLength"] | 0U;
+  signal.protocol = doc["protocol"] | 0U;
+  signal.timestamp = doc["timestamp"] | 0UL;
+  signal.isFavorite = doc["isFavorite"] | false;
+  if (signal.bitLength == 0 || signal.bitLength > 64 || signal.protocol == 0 || signal.protocol > 255) {
+    return fail("Invalid bitLength or protocol");
+  }
+  
+  JsonArray tags = doc["tags"];
+  for (JsonVariant tag : tags) {
+    imported.tags.push_back(tag.as<const char*>());
+  }
+  return stage(imported);
+}
+
+int SignalImporter::parseBinaryRecord(size_t start) {
+  const uint8_t* p = pending.data() + start;
+  size_t available = pending.size() - start;
+  if (available < BINARY_FIXED_LENGTH + 1) {
+    return 0;
+  }
+  
+  ImportedSignal imported;
+  RFSignal& signal = imported.signal;
+  signal.uid = get32(p);
+  signal.value = get32(p + 4);
+  signal.bitLength = p[8];
+  signal.protocol = p[9];
+  signal.isFavorite = p[10] & 1;
+  signal.timestamp = get32(p + 11);
+  if (signal.bitLength == 0 || signal.bitLength > 64 || signal.protocol == 0) {
+    fail("Invalid bitLength or protocol");
+    return -1;
+  }
+  
+  size_t offset = BINARY_FIXED_LENGTH;
+  size_t nameLength = p[offset++];
+  if (available < offset + nameLength + 1) {
+    return 0;
+  }
+  signal.name.concat((const char*)p + offset, clampNameLength((const char*)p + offset, nameLength));
+  offset += nameLength;
+  
+  size_t tagCount = p[offset++];
+  for (size_t i = 0; i < tagCount; i++) {
+    if (available < offset + 1 || available < offset + 1 + p[offset]) {
+      return 0;
+    }
+    size_t tagLength = p[offset++];
+    String tag;
+    tag.concat((const char*)p + offset, tagLength);
+    imported.tags.push_back(tag);
+    offset += tagLength;
+  }
+  
+  if (!stage(imported)) {
+    return -1;
+  }
+  return offset;
+}
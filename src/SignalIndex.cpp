@@ -0,0 +1,263 @@
+#include "SignalIndex.h"
+
+#include <algorithm>
+
+// ProtocolIndex
+
+void ProtocolIndex::insert(unsigned int protocol, uint32_t uid) {
+  if (protocol > MAX_PROTOCOL) {
+    return;
+  }
+  std::vector<uint32_t>& list = lists[protocol];
+  // New captures carry the highest uid, so this is usually an append
+  if (list.empty() || list.back() < uid) {
+    list.push_back(uid);
+  } else {
+    list.insert(std::lower_bound(list.begin(), list.end(), uid), uid);
+  }
+}
+
+void ProtocolIndex::erase(unsigned int protocol, uint32_t uid) {
+  if (protocol > MAX_PROTOCOL) {
+    return;
+  }
+  std::vector<uint32_t>& list = lists[protocol];
+  auto it = std::lower_bound(list.begin(), list.end(), uid);
+  if (it != list.end() && *it == uid) {
+    list.erase(it);
+  }
+}
+
+void ProtocolIndex::clear() {
+  for (auto& list : lists) {
+    list.clear();
+  }
+}
+
+size_t ProtocolIndex::memoryUsage() const {
+  size_t bytes = sizeof(lists);
+  for (const auto& list : lists) {
+    bytes += list.capacity() * sizeof(uint32_t);
+  }
+  return bytes;
+}
+
+// TimeIndex
+
+void TimeIndex::insert(unsigned long timestamp, uint32_t uid) {
+  Entry entry{timestamp, uid};
+  if (entries.empty() || entries.back() < entry) {
+    entries.push_back(entry);
+  } else {
+    entries.insert(std::lower_bound(entries.begin(), entries.end(), entry), entry);
+  }
+}
+
+void TimeIndex::erase(unsigned long timestamp, uint32_t uid) {
+  Entry entry{timestamp, uid};
+  auto it = std::lower_bound(entries.begin(), entries.end(), entry);
+  if (it != entries.end() && it->timestamp == timestamp && it->uid == uid) {
+    entries.erase(it);
+  }
+}
+
+const TimeIndex::Entry* TimeIndex::begin(unsigned long since) const {
+  Entry first{since, 0};
+  return entries.data() + (std::lower_bound(entries.begin(), entries.end(), first) - entries.begin());
+}
+
+// NameTrie
+
+NameTrie::NameTrie() {
+  clear();
+}
+
+void NameTrie::clear() {
+  nodes.clear();
+  cells.clear();
+  nodes.push_back(Node{-1, -1, -1, '\0'});  // Root
+  freeCells = -1;
+  freeNodes = -1;
+}
+
+int32_t NameTrie::findChild(int32_t node, char key) const {
+  for (int32_t child = nodes[node].child; child >= 0; child = nodes[child].sibling) {
+    if (nodes[child].key == key) {
+      return child;
+    }
+  }
+  return -1;
+}
+
+int32_t NameTrie::walk(const String& text, unsigned int length) const {
+  int32_t node = 0;
+  for (unsigned int i = 0; i < length && node >= 0; i++) {
+    node = findChild(node, text[i]);
+  }
+  return node;
+}
+
+void NameTrie::insert(const String& name, uint32_t uid) {
+  int32_t node = 0;
+  for (unsigned int i = 0; i < name.length(); i++) {
+    int32_t child = findChild(node, name[i]);
+    if (child < 0) {
+      Node added = {-1, nodes[node].child, -1, name[i]};
+      if (freeNodes >= 0) {
+        child = freeNodes;
+        freeNodes = nodes[child].sibling;
+        nodes[child] = added;
+      } else {
+        child = nodes.size();
+        nodes.push_back(added);
+      }
+      nodes[node].child = child;
+    }
+    node = child;
+  }
+  
+  int32_t cell;
+  if (freeCells >= 0) {
+    cell = freeCells;
+    freeCells = cells[cell].next;
+  } else {
+    cell = cells.size();
+    cells.push_back(Cell());
+  }
+  cells[cell].uid = uid;
+  cells[cell].next = nodes[node].firstCell;
+  nodes[node].firstCell = cell;
+}
+
+void NameTrie::erase(const String& name, uint32_t uid) {
+  int32_t node = findNode(name);
+  if (node < 0) {
+    return;
+  }
+  int32_t* link = &nodes[node].firstCell;
+  while (*link >= 0 && cells[*link].uid != uid) {
+    link = &cells[*link].next;
+  }
+  if (*link < 0) {
+    return;
+  }
+  int32_t cell = *link;
+  *link = cells[cell].next;
+  cells[cell].next = freeCells;
+  freeCells = cell;
+  
+  // Unlink the nodes only this name used, deepest first; names are mostly
+  // unique ("Signal 1234"), so keeping them would grow the trie forever
+  for (unsigned int depth = name.length(); depth > 0; depth--) {
+    int32_t parent = walk(name, depth - 1);
+    int32_t child = findChild(parent, name[depth - 1]);
+    if (nodes[child].firstCell >= 0 || nodes[child].child >= 0) {
+      break;
+    }
+    int32_t* sibling = &nodes[parent].child;
+    while (*sibling != child) {
+      sibling = &nodes[*sibling].sibling;
+    }
+    *sibling = nodes[child].sibling;
+    nodes[child].sibling = freeNodes;
+    freeNodes = child;
+  }
+}
+
+void NameTrie::collect(int32_t node, std::vector<uint32_t>& uids) const {
+  // Iterative walk - names are user supplied and may be long
+  std::vector<int32_t> pending(1, node);
+  while (!pending.empty()) {
+    int32_t current = pending.back();
+    pending.pop_back();
+    for (int32_t cell = nodes[current].firstCell; cell >= 0; cell = cells[cell].next) {
+      uids.push_back(cells[cell].uid);
+    }
+    for (int32_t child = nodes[current].child; child >= 0; child = nodes[child].sibling) {
+      pending.push_back(child);
+    }
+  }
+}
+
+void NameTrie::findPrefix(const String& prefix, std::vector<uint32_t>& uids) const {
+  int32_t node = findNode(prefix);
+  if (node >= 0) {
+    collect(node, uids);
+  }
+}
+
+size_t NameTrie::memoryUsage() const {
+  return nodes.capacity() * sizeof(Node) + cells.capacity() * sizeof(Cell);
+}
+
+// SignalIndexes
+
+void SignalIndexes::onInsert(const RFSignal& signal) {
+#if RF_INDEX_PROTOCOL
+  protocol.write().insert(signal.protocol, signal.uid);
+#endif
+#if RF_INDEX_TIME
+  time.write().insert(signal.timestamp, signal.uid);
+#endif
+#if RF_INDEX_NAME
+  name.write().insert(signal.name, signal.uid);
+#endif
+}
+
+void SignalIndexes::onErase(const RFSignal& signal) {
+#if RF_INDEX_PROTOCOL
+  protocol.write().erase(signal.protocol, signal.uid);
+#endif
+#if RF_INDEX_TIME
+  time.write().erase(signal.timestamp, signal.uid);
+#endif
+#if RF_INDEX_NAME
+  name.write().erase(signal.name, signal.uid);
+#endif
+}
+
+void SignalIndexes::onUpdate(const RFSignal& before, const RFSignal& after) {
+  // Only touch the indexes whose key actually changed
+#if RF_INDEX_PROTOCOL
+  if (before.protocol != after.protocol || before.uid != after.uid) {
+    protocol.write().erase(before.protocol, before.uid);
+    protocol.write().insert(after.protocol, after.uid);
+  }
+#endif
+#if RF_INDEX_TIME
+  if (before.timestamp != after.timestamp || before.uid != after.uid) {
+    time.write().erase(before.timestamp, before.uid);
+    time.write().insert(after.timestamp, after.uid);
+  }
+#endif
+#if RF_INDEX_NAME
+  if (before.name != after.name || before.uid != after.uid) {
+    name.write().erase(before.name, before.uid);
+    name.write().insert(after.name, after.uid);
+  }
+#endif
+}
+
+void SignalIndexes::clear() {
+#if RF_INDEX_PROTOCOL
+  protocol.reset();
+#endif
+#if RF_INDEX_TIME
+  time.reset();
+#endif
+#if RF_INDEX_NAME
+  name.reset();
+#endif
+}
+
+void SignalIndexes::markShared() {
+#if RF_INDEX_PROTOCOL
+  protocol.markShared();
+#endif
+#if RF_INDEX_TIME
+  time.markShared();
+#endif
+#if RF_INDEX_NAME
+  name.markShared();
+#endif
+}
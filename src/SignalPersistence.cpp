@@ -0,0 +1,99 @@
+#include "SignalPersistence.h"
+
+#include <limits.h>
+#include <algorithm>
+#include <unordered_set>
+
+// Larger tag bitmaps than a full library could need are treated as corrupt
+static const size_t MAX_TAG_BYTES = 8192;
+
+void saveSignals(KeyValueStore& storage, const SignalStore& store, int nextId) {
+  storage.putInt("signalCount", store.size());
+  storage.putInt("nextId", nextId);
+  
+  for (size_t i = 0; i < store.size(); i++) {
+    String prefix = "sig" + String(i) + "_";
+    const RFSignal& signal = store.at(i);
+  
+    storage.putString((prefix + "name").c_str(), signal.name);
+    storage.putULong((prefix + "val").c_str(), signal.value);
+    storage.putUInt((prefix + "bits").c_str(), signal.bitLength);
+    storage.putUInt((prefix + "proto").c_str(), signal.protocol);
+    storage.putULong((prefix + "time").c_str(), signal.timestamp);
+    storage.putBool((prefix + "fav").c_str(), signal.isFavorite);
+    storage.putUInt((prefix + "uid").c_str(), signal.uid);
+  }
+  
+  // Tags are stored as serialized uid bitmaps
+  const std::vector<SignalTags::Tag>& tags = store.currentTags().list();
+  storage.putInt("tagCount", tags.size());
+  std::vector<uint8_t> encoded;
+  for (size_t i = 0; i < tags.size(); i++) {
+    String prefix = "tag" + String(i) + "_";
+    encoded.clear();
+    tags[i].members->serialize(encoded);
+    storage.putString((prefix + "name").c_str(), tags[i].name);
+    storage.putBytes((prefix + "bits").c_str(), encoded.data(), encoded.size());
+  }
+}
+
+bool loadSignals(KeyValueStore& storage, SignalStore& store, int& nextId, int capacity) {
+  // Counts come from flash and may be corrupt; never trust them for loop bounds
+  int count = std::min(std::max(storage.getInt("signalCount", 0), 0), capacity);
+  // Leave room to hand out uids to every record, skipping taken ones, without overflowing
+  int maxId = INT_MAX - 2 * capacity;
+  nextId = std::min(std::max(storage.getInt("nextId", 0), 0), maxId);
+  bool migrated = false;
+  std::unordered_set<uint32_t> uids;
+  uint32_t highestUid = 0;
+  
+  for (int i = 0; i < count; i++) {
+    RFSignal signal;
+    String prefix = "sig" + String(i) + "_";
+  
+    signal.name = storage.getString((prefix + "name").c_str(), "");
+    signal.value = storage.getULong((prefix + "val").c_str(), 0);
+    signal.bitLength = storage.getUInt((prefix + "bits").c_str(), 0);
+    signal.protocol = storage.getUInt((prefix + "proto").c_str(), 0);
+    signal.timestamp = storage.getULong((prefix + "time").c_str(), 0);
+    signal.isFavorite = storage.getBool((prefix + "fav").c_str(), false);
+    signal.uid = storage.getUInt((prefix + "uid").c_str(), UINT32_MAX);
+    if (signal.value == 0 || signal.bitLength == 0 || signal.bitLength > 64 ||
+        signal.protocol == 0 || signal.protocol > 255) {
+      continue;
+    }
+    // Saved before uids existed, or a uid already taken
+    if (signal.uid >= (uint32_t)maxId || !uids.insert(signal.uid).second) {
+      do {
+        signal.uid = nextId++;
+      } while (!uids.insert(signal.uid).second);
+      migrated = true;
+    }
+    highestUid = std::max(highestUid, signal.uid);
+    store.add(signal);
+  }
+  if (!uids.empty() && (uint32_t)nextId <= highestUid) {
+    nextId = highestUid + 1;  // New captures must not reuse a stored uid
+    migrated = true;
+  }
+  
+  // Tags refer to uids, so load them after the signals
+  int tagCount = std::min(std::max(storage.getInt("tagCount", 0), 0), (int)SignalTags::MAX_TAGS);
+  for (int i = 0; i < tagCount; i++) {
+    String prefix = "tag" + String(i) + "_";
+    String name = storage.getString((prefix + "name").c_str(), "");
+    size_t length = storage.getBytesLength((prefix + "bits").c_str());
+    if (length > MAX_TAG_BYTES) {
+      continue;
+    }
+    std::vector<uint8_t> encoded(length);
+    RoaringBitmap members;
+    if (SignalTags::validName(name) && length > 0 &&
+        storage.getBytes((prefix + "bits").c_str(), encoded.data(), length) == length &&
+        members.deserialize(encoded.data(), length)) {
+      store.restoreTag(name, members);
+    }
+  }
+  store.publish();
+  return migrated;
+}
@@ -0,0 +1,336 @@
+#include "SignalQuery.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+
+SignalQuery::SignalQuery()
+  : protocolMask(0xFFFFFFFF), minBits(0), maxBits(255), maxAgeMs(0), favorite(-1) {
+}
+
+namespace {
+
+// Minimal cursor over the expression text
+struct QueryParser {
+  const char* p;
+  String& error;
+
+  QueryParser(const char* text, String& error) : p(text), error(error) {}
+
+  void skipSpace() {
+    while (*p && isspace((unsigned char)*p)) p++;
+  }
+
+  bool atEnd() {
+    skipSpace();
+    return *p == '\0';
+  }
+
+  bool accept(const char* token) {
+    skipSpace();
+    size_t length = strlen(token);
+    if (strncmp(p, token, length) != 0) {
+      return false;
+    }
+    // Keywords must not run into an identifier character
+    if (isalpha((unsigned char)token[length - 1]) && isalnum((unsigned char)p[length])) {
+      return false;
+    }
+    p += length;
+    return true;
+  }
+
+  bool expect(const char* token) {
+    if (accept(token)) {
+      return true;
+    }
+    error = String("Expected '") + token + "'";
+    return false;
+  }
+
+  bool number(unsigned long& out) {
+    skipSpace();
+    if (!isdigit((unsigned char)*p)) {
+      error = "Expected a number";
+      return false;
+    }
+    out = 0;
+    while (isdigit((unsigned char)*p)) {
+      unsigned long next = out * 10 + (*p - '0');
+      if (next < out) {
+        error = "Number out of range";
+        return false;
+      }
+      out = next;
+      p++;
+    }
+    return true;
+  }
+
+  bool word(String& out) {
+    skipSpace();
+    out = "";
+    if (*p == '"') {
+      const char* start = ++p;
+      while (*p && *p != '"') p++;
+      if (*p != '"') {
+        error = "Unterminated string";
+        return false;
+      }
+      out.concat(start, p - start);
+      p++;
+      return true;
+    }
+    const char* start = p;
+    while (*p && !isspace((unsigned char)*p)) p++;
+    if (p == start) {
+      error = "Expected a name";
+      return false;
+    }
+    out.concat(start, p - start);
+    return true;
+  }
+
+  bool protocolClause(SignalQuery& query) {
+    unsigned long protocol;
+    uint32_t mask = 0;
+    if (accept("in")) {
+      if (!expect("{")) return false;
+      do {
+        if (!number(protocol)) return false;
+        if (protocol > 31) {
+          error = "Protocol out of range";
+          return false;
+        }
+        mask |= 1UL << protocol;
+      } while (accept(","));
+      if (!expect("}")) return false;
+    } else if (accept("=")) {
+      if (!number(protocol)) return false;
+      if (protocol > 31) {
+        error = "Protocol out of range";
+        return false;
+      }
+      mask = 1UL << protocol;
+    } else {
+      error = "Expected 'in' or '=' after protocol";
+      return false;
+    }
+    query.protocolMask &= mask;
+    return true;
+  }
+
+  bool bitsClause(SignalQuery& query) {
+    unsigned long low, high;
+    if (accept("in")) {
+      if (!number(low) || !expect("..") || !number(high)) return false;
+    } else if (accept(">=")) {
+      if (!number(low)) return false;
+      high = 255;
+    } else if (accept("<=")) {
+      if (!number(high)) return false;
+      low = 0;
+    } else if (accept("=")) {
+      if (!number(low)) return false;
+      high = low;
+    } else {
+      error = "Expected 'in', '=', '>=' or '<=' after bits";
+      return false;
+    }
+    if (low > 255 || high > 255 || low > high) {
+      error = "Invalid bit length range";
+      return false;
+    }
+    query.minBits = std::max<uint8_t>(query.minBits, low);
+    query.maxBits = std::min<uint8_t>(query.maxBits, high);
+    return true;
+  }
+
+  bool seenClause(SignalQuery& query) {
+    unsigned long seconds;
+    if (!expect("<") || !number(seconds)) return false;
+    if (seconds == 0 || seconds > 0xFFFFFFFFUL / 1000) {
+      error = "Invalid seen window";
+      return false;
+    }
+    query.maxAgeMs = seconds * 1000;
+    return true;
+  }
+
+  bool nameClause(SignalQuery& query) {
+    return expect("^=") && word(query.namePrefix);
+  }
+
+  bool clause(SignalQuery& query) {
+    if (accept("protocol")) return protocolClause(query);
+    if (accept("bits")) return bitsClause(query);
+    if (accept("seen")) return seenClause(query);
+    if (accept("name")) return nameClause(query);
+    if (accept("favorite")) {
+      query.favorite = 1;
+      return true;
+    }
+    if (accept("!favorite")) {
+      query.favorite = 0;
+      return true;
+    }
+    error = "Unknown filter";
+    return false;
+  }
+};
+
+}  // namespace
+
+bool compileSignalQuery(const String& text, SignalQuery& query, String& error) {
+  query = SignalQuery();
+  QueryParser parser(text.c_str(), error);
+  if (parser.atEnd()) {
+    return true;  // Empty filter matches everything
+  }
+  
+  do {
+    if (!parser.clause(query)) {
+      return false;
+    }
+  } while (parser.accept("and"));
+  
+  if (!parser.atEnd()) {
+    error = "Unexpected input after filter";
+    return false;
+  }
+  return true;
+}
+
+namespace {
+
+const uint32_t ALL_PROTOCOLS = 0xFFFFFFFF;
+
+bool rowMatches(const SignalQuery& query, const SignalSnapshot& snapshot,
+                unsigned long now, size_t i) {
+  // Cheap column checks first, the name only for survivors
+  const SignalColumns& columns = snapshot.columns;
+  uint8_t protocol = columns.protocol[i];
+  if (protocol > ProtocolIndex::MAX_PROTOCOL) {
+    if (query.protocolMask != ALL_PROTOCOLS) return false;
+  } else if (!(query.protocolMask & (1UL << protocol))) {
+    return false;
+  }
+  uint8_t bits = columns.bitLength[i];
+  if (bits < query.minBits || bits > query.maxBits) return false;
+  if (query.favorite >= 0 && columns.favorite[i] != (uint8_t)query.favorite) return false;
+  if (query.maxAgeMs > 0 && now - columns.timestamp[i] > query.maxAgeMs) return false;
+  if (query.namePrefix.length() > 0 &&
+      strncmp(snapshot[i].name.c_str(), query.namePrefix.c_str(), query.namePrefix.length()) != 0) {
+    return false;
+  }
+  return true;
+}
+
+// Narrow the scan to the smallest candidate set an enabled index can give.
+// Returns QUERY_SCAN when no index applies or none beats a full scan.
+QueryIndex indexCandidates(const SignalQuery& query, const SignalSnapshot& snapshot,
+                           unsigned long now, std::vector<uint32_t>& positions) {
+  QueryIndex source = QUERY_SCAN;
+  size_t best = snapshot.size() / 2;
+  std::vector<uint32_t> nameUids;
+  
+#if RF_INDEX_PROTOCOL
+  if (query.protocolMask != ALL_PROTOCOLS) {
+    size_t count = 0;
+    for (unsigned int p = 0; p <= ProtocolIndex::MAX_PROTOCOL; p++) {
+      if (query.protocolMask & (1UL << p)) {
+        count += snapshot.indexes.protocol->postings(p).size();
+      }
+    }
+    if (count < best) {
+      best = count;
+      source = QUERY_PROTOCOL;
+    }
+  }
+#endif
+#if RF_INDEX_TIME
+  unsigned long since = now >= query.maxAgeMs ? now - query.maxAgeMs : 0;
+  if (query.maxAgeMs > 0) {
+    size_t count = snapshot.indexes.time->end() - snapshot.indexes.time->begin(since);
+    if (count < best) {
+      best = count;
+      source = QUERY_TIME;
+    }
+  }
+#endif
+#if RF_INDEX_NAME
+  if (query.namePrefix.length() > 0) {
+    snapshot.indexes.name->findPrefix(query.namePrefix, nameUids);
+    if (nameUids.size() < best) {
+      best = nameUids.size();
+      source = QUERY_NAME;
+    }
+  }
+#endif
+  
+  std::vector<uint32_t> uids;
+  switch (source) {
+    case QUERY_SCAN:
+      return QUERY_SCAN;
+    case QUERY_PROTOCOL:
+#if RF_INDEX_PROTOCOL
+      for (unsigned int p = 0; p <= ProtocolIndex::MAX_PROTOCOL; p++) {
+        if (query.protocolMask & (1UL << p)) {
+          const std::vector<uint32_t>& list = snapshot.indexes.protocol->postings(p);
+          uids.insert(uids.end(), list.begin(), list.end());
+        }
+      }
+#endif
+      break;
+    case QUERY_TIME:
+#if RF_INDEX_TIME
+      for (const TimeIndex::Entry* entry = snapshot.indexes.time->begin(since);
+           entry != snapshot.indexes.time->end(); ++entry) {
+        uids.push_back(entry->uid);
+      }
+#endif
+      break;
+    case QUERY_NAME:
+      uids.swap(nameUids);
+      break;
+  }
+  
+  positions.reserve(uids.size());
+  for (uint32_t uid : uids) {
+    int position = snapshot.positionOf(uid);
+    if (position >= 0) {
+      positions.push_back(position);
+    }
+  }
+  // Keep results in store order, same as a full scan
+  std::sort(positions.begin(), positions.end());
+  return source;
+}
+
+}  // namespace
+
+const char* queryIndexName(QueryIndex index) {
+  static const char* NAMES[] = {"scan", "protocol", "time", "name"};
+  return NAMES[index];
+}
+
+QueryIndex runSignalQuery(const SignalQuery& query, const SignalSnapshot& snapshot,
+                          unsigned long now, std::vector<uint32_t>& matches) {
+  std::vector<uint32_t> candidates;
+  QueryIndex source = indexCandidates(query, snapshot, now, candidates);
+  if (source != QUERY_SCAN) {
+    for (uint32_t position : candidates) {
+      if (rowMatches(query, snapshot, now, position)) {
+        matches.push_back(position);
+      }
+    }
+    return source;
+  }
+  
+  for (size_t i = 0; i < snapshot.size(); i++) {
+    if (rowMatches(query, snapshot, now, i)) {
+      matches.push_back(i);
+    }
+  }
+  return QUERY_SCAN;
+}
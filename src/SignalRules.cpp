@@ -0,0 +1,139 @@
+#include "SignalRules.h"
+
+#include <algorithm>
+#include <string.h>
+
+// Packed record: id u32, trigger u64, target u64, action u8, little-endian
+static const size_t RULE_RECORD_BYTES = 21;
+static const size_t RULES_PER_CHUNK = 48;  // Just under 1 KB per blob
+
+const size_t RuleTable::MAX_RULES;
+
+static const char* ACTION_NAMES[RULE_ACTION_COUNT] = {"transmit", "push", "favorite"};
+
+const char* ruleActionName(RuleAction action) {
+  return action < RULE_ACTION_COUNT ? ACTION_NAMES[action] : "unknown";
+}
+
+bool parseRuleAction(const String& name, RuleAction& action) {
+  for (int i = 0; i < RULE_ACTION_COUNT; i++) {
+    if (name == ACTION_NAMES[i]) {
+      action = (RuleAction)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+RuleTable::RuleTable(const std::vector<Rule>& rules) : source(rules) {
+  // Group by trigger, keeping id order within a group
+  std::vector<const Rule*> ordered;
+  ordered.reserve(source.size());
+  for (const Rule& rule : source) {
+    ordered.push_back(&rule);
+  }
+  std::stable_sort(ordered.begin(), ordered.end(), [](const Rule* a, const Rule* b) {
+    return a->trigger < b->trigger;
+  });
+  
+  steps.reserve(ordered.size());
+  groups.reserve(ordered.size());
+  for (const Rule* rule : ordered) {
+    Group& group = groups[rule->trigger];
+    if (group.count == 0) {
+      group.first = steps.size();
+    }
+    group.count++;
+    steps.push_back(Step{rule->target, rule->id, rule->action});
+  }
+}
+
+const RuleTable::Step* RuleTable::match(uint64_t key, size_t& count) const {
+  auto group = groups.find(key);
+  if (group == groups.end()) {
+    count = 0;
+    return nullptr;
+  }
+  count = group->second.count;
+  return &steps[group->second.first];
+}
+
+size_t RuleTable::memoryUsage() const {
+  return source.capacity() * sizeof(Rule) + steps.capacity() * sizeof(Step) +
+         groups.bucket_count() * sizeof(void*) +
+         groups.size() * (sizeof(std::pair<const uint64_t, Group>) + sizeof(void*));
+}
+
+static void putLittleEndian(uint8_t* out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    out[i] = value >> (8 * i);
+  }
+}
+
+static uint64_t getLittleEndian(const uint8_t* in, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value |= (uint64_t)in[i] << (8 * i);
+  }
+  return value;
+}
+
+void saveRules(KeyValueStore& storage, const RuleTable& table) {
+  const std::vector<Rule>& rules = table.rules();
+  uint8_t chunk[RULES_PER_CHUNK * RULE_RECORD_BYTES];
+  uint8_t stored[sizeof(chunk)];
+  
+  for (size_t first = 0; first < rules.size(); first += RULES_PER_CHUNK) {
+    size_t count = std::min(rules.size() - first, RULES_PER_CHUNK);
+    for (size_t i = 0; i < count; i++) {
+      const Rule& rule = rules[first + i];
+      uint8_t* record = chunk + i * RULE_RECORD_BYTES;
+      putLittleEndian(record, rule.id, 4);
+      putLittleEndian(record + 4, rule.trigger, 8);
+      putLittleEndian(record + 12, rule.target, 8);
+      record[20] = rule.action;
+    }
+  
+    // Flash wears per write; a rule edit should cost one chunk, not all of them
+    String key = "rules" + String((unsigned long)(first / RULES_PER_CHUNK));
+    size_t length = count * RULE_RECORD_BYTES;
+    if (storage.getBytesLength(key.c_str()) != length ||
+        storage.getBytes(key.c_str(), stored, length) != length || memcmp(stored, chunk, length) != 0) {
+      storage.putBytes(key.c_str(), chunk, length);
+    }
+  }
+  // Chunks past the count are left behind and ignored
+  storage.putInt("ruleCount", rules.size());
+}
+
+void loadRules(KeyValueStore& storage, std::vector<Rule>& rules) {
+  // The count comes from flash and may be corrupt; never trust it for loop bounds
+  size_t count = std::min((size_t)std::max(storage.getInt("ruleCount", 0), 0), RuleTable::MAX_RULES);
+  uint8_t chunk[RULES_PER_CHUNK * RULE_RECORD_BYTES];
+  rules.clear();
+  
+  for (size_t first = 0; first < count; first += RULES_PER_CHUNK) {
+    String key = "rules" + String((unsigned long)(first / RULES_PER_CHUNK));
+    size_t length = storage.getBytesLength(key.c_str());
+    if (length > sizeof(chunk) || length % RULE_RECORD_BYTES != 0 ||
+        storage.getBytes(key.c_str(), chunk, length) != length) {
+      continue;
+    }
+    size_t records = std::min(length / RULE_RECORD_BYTES, count - first);
+    for (size_t i = 0; i < records; i++) {
+      const uint8_t* record = chunk + i * RULE_RECORD_BYTES;
+      Rule rule;
+      rule.id = getLittleEndian(record, 4);
+      rule.trigger = getLittleEndian(record + 4, 8);
+      rule.target = getLittleEndian(record + 12, 8);
+      rule.action = (RuleAction)record[20];
+      if (rule.trigger == 0 || rule.action >= RULE_ACTION_COUNT || (rule.action == RULE_TRANSMIT && rule.target == 0)) {
+        continue;
+      }
+      rules.push_back(rule);
+    }
+  }
+  
+  // Saved in id order; keep it that way even if a chunk was lost
+  std::sort(rules.begin(), rules.end(), [](const Rule& a, const Rule& b) { return a.id < b.id; });
+}
@@ -0,0 +1,286 @@
+#include "SignalStore.h"
+
+// Position of uid in a uid-ordered list of positions, or -1
+static int findUid(const std::vector<uint32_t>& uidOrder, const std::vector<uint32_t>& uids, uint32_t uid) {
+  auto it = std::lower_bound(uidOrder.begin(), uidOrder.end(), uid,
+    [&uids](uint32_t position, uint32_t key) { return uids[position] < key; });
+  if (it == uidOrder.end() || uids[*it] != uid) {
+    return -1;
+  }
+  return *it;
+}
+
+int SignalSnapshot::positionOf(uint32_t uid) const {
+  return findUid(uidOrder, columns.uid, uid);
+}
+
+// SignalColumns
+
+void SignalColumns::append(const RFSignal& signal, uint32_t changed) {
+  uid.push_back(signal.uid);
+  value.push_back(signal.value);
+  timestamp.push_back(signal.timestamp);
+  bitLength.push_back(signal.bitLength);
+  protocol.push_back(signal.protocol);
+  favorite.push_back(signal.isFavorite);
+  revision.push_back(changed);
+}
+
+void SignalColumns::assign(size_t index, const RFSignal& signal, uint32_t changed) {
+  uid[index] = signal.uid;
+  value[index] = signal.value;
+  timestamp[index] = signal.timestamp;
+  bitLength[index] = signal.bitLength;
+  protocol[index] = signal.protocol;
+  favorite[index] = signal.isFavorite;
+  revision[index] = changed;
+}
+
+void SignalColumns::erase(size_t index) {
+  uid.erase(uid.begin() + index);
+  value.erase(value.begin() + index);
+  timestamp.erase(timestamp.begin() + index);
+  bitLength.erase(bitLength.begin() + index);
+  protocol.erase(protocol.begin() + index);
+  favorite.erase(favorite.begin() + index);
+  revision.erase(revision.begin() + index);
+}
+
+void SignalColumns::clear() {
+  uid.clear();
+  value.clear();
+  timestamp.clear();
+  bitLength.clear();
+  protocol.clear();
+  favorite.clear();
+  revision.clear();
+}
+
+// SignalStore
+
+const size_t SignalStore::MAX_REMOVED;
+
+SignalStore::SignalStore()
+  : published(std::make_shared<SignalSnapshot>()), dirty(false), revision(0), resetRevision(0) {
+}
+
+SignalStore::Snapshot SignalStore::snapshot() const {
+  return std::atomic_load(&published);
+}
+
+void SignalStore::add(const RFSignal& signal) {
+  working.push_back(std::make_shared<const RFSignal>(signal));
+  columns.append(signal, revision + 1);
+  insertUid(working.size() - 1);
+  indexes.onInsert(signal);
+  tags.onInsert(signal);
+  dirty = true;
+}
+
+void SignalStore::replace(size_t index, const RFSignal& signal) {
+  // Never modify a record in place - readers may still hold it
+  indexes.onUpdate(*working[index], signal);
+  tags.onUpdate(*working[index], signal);
+  uint32_t before = working[index]->uid;
+  if (before != signal.uid) {
+    forget(before);
+    eraseUid(before);
+  }
+  working[index] = std::make_shared<const RFSignal>(signal);
+  columns.assign(index, signal, revision + 1);
+  if (before != signal.uid) {
+    insertUid(index);
+  }
+  dirty = true;
+}
+
+void SignalStore::erase(size_t index) {
+  indexes.onErase(*working[index]);
+  tags.onErase(*working[index]);
+  forget(working[index]->uid);
+  eraseUid(working[index]->uid);
+  working.erase(working.begin() + index);
+  columns.erase(index);
+  // Later rows moved up one
+  for (uint32_t& position : uidOrder) {
+    position -= position > index;
+  }
+  dirty = true;
+}
+
+void SignalStore::clear() {
+  working.clear();
+  columns.clear();
+  uidOrder.clear();
+  indexes.clear();
+  tags.clear();
+  reset();
+  dirty = true;
+}
+
+int SignalStore::find(uint64_t key) const {
+  for (size_t i = 0; i < working.size(); i++) {
+    if (signalKey(*working[i]) == key) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int SignalStore::positionOf(uint32_t uid) const {
+  return findUid(uidOrder, columns.uid, uid);
+}
+
+size_t SignalStore::evictOldest(size_t count) {
+  // Oldest non-favorites by (timestamp, position); the rest keep their order
+  std::vector<uint32_t> candidates;
+  for (size_t i = 0; i < working.size(); i++) {
+    if (!columns.favorite[i]) {
+      candidates.push_back(i);
+    }
+  }
+  if (count < candidates.size()) {
+    std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end(),
+      [this](uint32_t a, uint32_t b) {
+        return columns.timestamp[a] < columns.timestamp[b] || (columns.timestamp[a] == columns.timestamp[b] && a < b);
+      });
+    candidates.resize(count);
+  }
+  if (candidates.empty()) {
+    return 0;
+  }
+  
+  // Erased like any other removal, so change listings report them
+  std::vector<uint8_t> doomed(working.size());
+  for (uint32_t position : candidates) {
+    doomed[position] = 1;
+  }
+  removeMarked(doomed);
+  return candidates.size();
+}
+
+bool SignalStore::tagSignal(size_t index, const String& tag) {
+  if (!tags.tag(tag, working[index]->uid)) {
+    return false;
+  }
+  stamp(index);
+  dirty = true;
+  return true;
+}
+
+void SignalStore::untagSignal(size_t index, const String& tag) {
+  tags.untag(tag, working[index]->uid);
+  stamp(index);
+  dirty = true;
+}
+
+bool SignalStore::deleteTag(const String& tag) {
+  bool deleted = tags.remove(tag);
+  if (deleted) {
+    reset();  // Changes every member
+    dirty = true;
+  }
+  return deleted;
+}
+
+bool SignalStore::restoreTag(const String& tag, const RoaringBitmap& members) {
+  bool restored = tags.restore(tag, members);
+  if (restored) {
+    reset();
+    dirty = true;
+  }
+  return restored;
+}
+
+void SignalStore::forget(uint32_t uid) {
+  removed.push_back(RemovedSignal{uid, revision + 1});
+  if (removed.size() > MAX_REMOVED) {
+    // Whoever is behind this removal can no longer be told about it
+    resetRevision = std::max(resetRevision, removed.front().revision);
+    removed.pop_front();
+  }
+}
+
+void SignalStore::reset() {
+  removed.clear();
+  resetRevision = revision + 1;
+  std::fill(columns.revision.begin(), columns.revision.end(), resetRevision);
+}
+
+// One pass over the rows for any number of removals
+void SignalStore::removeMarked(const std::vector<uint8_t>& doomed) {
+  std::vector<uint32_t> moved(working.size());
+  size_t kept = 0;
+  for (size_t i = 0; i < working.size(); i++) {
+    if (doomed[i]) {
+      indexes.onErase(*working[i]);
+      tags.onErase(*working[i]);
+      forget(working[i]->uid);
+      continue;
+    }
+    moved[i] = kept;
+    if (kept != i) {
+      working[kept] = working[i];
+      columns.assign(kept, *working[i], columns.revision[i]);
+    }
+    kept++;
+  }
+  working.resize(kept);
+  columns.uid.resize(kept);
+  columns.value.resize(kept);
+  columns.timestamp.resize(kept);
+  columns.bitLength.resize(kept);
+  columns.protocol.resize(kept);
+  columns.favorite.resize(kept);
+  columns.revision.resize(kept);
+  
+  // Still in uid order once the removed rows are gone
+  size_t next = 0;
+  for (uint32_t position : uidOrder) {
+    if (!doomed[position]) {
+      uidOrder[next++] = moved[position];
+    }
+  }
+  uidOrder.resize(next);
+  dirty = true;
+}
+
+void SignalStore::insertUid(size_t index) {
+  uint32_t uid = columns.uid[index];
+  // New captures carry the highest uid, so this is usually an append
+  if (uidOrder.empty() || columns.uid[uidOrder.back()] < uid) {
+    uidOrder.push_back(index);
+    return;
+  }
+  uidOrder.insert(std::lower_bound(uidOrder.begin(), uidOrder.end(), uid,
+    [this](uint32_t position, uint32_t key) { return columns.uid[position] < key; }), index);
+}
+
+void SignalStore::eraseUid(uint32_t uid) {
+  auto it = std::lower_bound(uidOrder.begin(), uidOrder.end(), uid,
+    [this](uint32_t position, uint32_t key) { return columns.uid[position] < key; });
+  if (it != uidOrder.end() && columns.uid[*it] == uid) {
+    uidOrder.erase(it);
+  }
+}
+
+void SignalStore::publish() {
+  if (!dirty) {
+    return;
+  }
+  
+  // Indexes and tags are shared; the next change to each copies it first
+  std::shared_ptr<SignalSnapshot> next = std::make_shared<SignalSnapshot>(indexes, tags);
+  indexes.markShared();
+  tags.markShared();
+  next->signals = working;
+  next->columns = columns;
+  next->uidOrder = uidOrder;
+  
+  next->revision = ++revision;
+  next->resetRevision = resetRevision;
+  next->removed.assign(removed.begin(), removed.end());
+  
+  std::atomic_store(&published, Snapshot(next));
+  dirty = false;
+}
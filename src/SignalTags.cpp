@@ -0,0 +1,267 @@
+#include "SignalTags.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <functional>
+#include <string.h>
+
+bool SignalTags::validName(const String& tag) {
+  if (tag.length() == 0 || tag.length() > MAX_TAG_LENGTH) {
+    return false;
+  }
+  for (unsigned int i = 0; i < tag.length(); i++) {
+    char c = tag[i];
+    if (!isalnum((unsigned char)c) && c != '_' && c != '-') {
+      return false;
+    }
+  }
+  return true;
+}
+
+SignalTags::Tag* SignalTags::find(const String& tag) {
+  auto it = std::lower_bound(tags.begin(), tags.end(), tag,
+    [](const Tag& t, const String& name) { return t.name < name; });
+  return it != tags.end() && it->name == tag ? &*it : nullptr;
+}
+
+const SignalTags::Tag* SignalTags::find(const String& tag) const {
+  return const_cast<SignalTags*>(this)->find(tag);
+}
+
+bool SignalTags::tag(const String& tag, uint32_t uid) {
+  Tag* existing = find(tag);
+  if (!existing) {
+    if (tags.size() >= MAX_TAGS) {
+      return false;
+    }
+    auto it = std::lower_bound(tags.begin(), tags.end(), tag,
+      [](const Tag& t, const String& name) { return t.name < name; });
+    Tag created;
+    created.name = tag;
+    existing = &*tags.insert(it, created);
+  }
+  existing->members.write().add(uid);
+  return true;
+}
+
+void SignalTags::untag(const String& tag, uint32_t uid) {
+  Tag* existing = find(tag);
+  if (existing && existing->members->contains(uid)) {
+    existing->members.write().remove(uid);
+  }
+}
+
+bool SignalTags::remove(const String& tag) {
+  Tag* existing = find(tag);
+  if (!existing) {
+    return false;
+  }
+  tags.erase(tags.begin() + (existing - tags.data()));
+  return true;
+}
+
+bool SignalTags::restore(const String& tag, const RoaringBitmap& members) {
+  if (!find(tag) && tags.size() >= MAX_TAGS) {
+    return false;
+  }
+  remove(tag);
+  Tag restored;
+  restored.name = tag;
+  // Drop uids that are no longer stored
+  restored.members.write() = RoaringBitmap::intersect(members, *all);
+  auto it = std::lower_bound(tags.begin(), tags.end(), tag,
+    [](const Tag& t, const String& name) { return t.name < name; });
+  tags.insert(it, restored);
+  return true;
+}
+
+void SignalTags::onInsert(const RFSignal& signal) {
+  all.write().add(signal.uid);
+  if (signal.isFavorite) {
+    favorites.write().add(signal.uid);
+  }
+}
+
+void SignalTags::onErase(const RFSignal& signal) {
+  all.write().remove(signal.uid);
+  // Only the bitmaps holding the uid get copied
+  if (favorites->contains(signal.uid)) {
+    favorites.write().remove(signal.uid);
+  }
+  for (auto& tag : tags) {
+    if (tag.members->contains(signal.uid)) {
+      tag.members.write().remove(signal.uid);
+    }
+  }
+}
+
+void SignalTags::onUpdate(const RFSignal& before, const RFSignal& after) {
+  if (before.uid != after.uid) {
+    onErase(before);
+    onInsert(after);
+  } else if (before.isFavorite != after.isFavorite) {
+    if (after.isFavorite) {
+      favorites.write().add(after.uid);
+    } else {
+      favorites.write().remove(after.uid);
+    }
+  }
+}
+
+void SignalTags::clear() {
+  // Tag names survive; they just lose their members
+  for (auto& tag : tags) {
+    tag.members.reset();
+  }
+  all.reset();
+  favorites.reset();
+}
+
+void SignalTags::markShared() {
+  for (auto& tag : tags) {
+    tag.members.markShared();
+  }
+  all.markShared();
+  favorites.markShared();
+}
+
+void SignalTags::tagsOf(uint32_t uid, std::vector<const String*>& names) const {
+  for (const auto& tag : tags) {
+    if (tag.members->contains(uid)) {
+      names.push_back(&tag.name);
+    }
+  }
+}
+
+size_t SignalTags::memoryUsage() const {
+  size_t bytes = all->memoryUsage() + favorites->memoryUsage() + tags.capacity() * sizeof(Tag);
+  for (const auto& tag : tags) {
+    bytes += tag.members->memoryUsage() + tag.name.length();
+  }
+  return bytes;
+}
+
+// Selection expressions
+
+namespace {
+
+const size_t MAX_EXPRESSION_DEPTH = 16;
+
+struct SelectParser {
+  const char* p;
+  String& error;
+  size_t depth;
+
+  SelectParser(const char* text, String& error) : p(text), error(error), depth(0) {}
+
+  void skipSpace() {
+    while (*p && isspace((unsigned char)*p)) p++;
+  }
+
+  bool keyword(const char* word) {
+    skipSpace();
+    size_t length = strlen(word);
+    if (strncasecmp(p, word, length) != 0 || isalnum((unsigned char)p[length])) {
+      return false;
+    }
+    p += length;
+    return true;
+  }
+
+  bool symbol(char c) {
+    skipSpace();
+    if (*p != c) return false;
+    p++;
+    return true;
+  }
+};
+
+}  // namespace
+
+bool SignalTags::select(const String& expression, RoaringBitmap& result, String& error) const {
+  SelectParser parser(expression.c_str(), error);
+  
+  // Recursive descent with the parser state shared through the lambdas
+  std::function<bool(RoaringBitmap&)> parseExpr, parseTerm, parseFactor;
+  
+  parseFactor = [&](RoaringBitmap& out) -> bool {
+    if (++parser.depth > MAX_EXPRESSION_DEPTH) {
+      error = "Expression too deeply nested";
+      return false;
+    }
+    bool ok = false;
+    parser.skipSpace();
+    if (parser.keyword("NOT")) {
+      RoaringBitmap inner;
+      ok = parseFactor(inner);
+      if (ok) out = RoaringBitmap::subtract(*all, inner);
+    } else if (parser.symbol('(')) {
+      ok = parseExpr(out);
+      if (ok && !parser.symbol(')')) {
+        error = "Expected ')'";
+        ok = false;
+      }
+    } else if (parser.keyword("favorite")) {
+      out = *favorites;
+      ok = true;
+    } else if (parser.keyword("all")) {
+      out = *all;
+      ok = true;
+    } else if (strncasecmp(parser.p, "tag:", 4) == 0) {
+      parser.p += 4;
+      const char* start = parser.p;
+      while (*parser.p && (isalnum((unsigned char)*parser.p) || *parser.p == '_' || *parser.p == '-')) {
+        parser.p++;
+      }
+      String name;
+      name.concat(start, parser.p - start);
+      if (!validName(name)) {
+        error = "Invalid tag name";
+      } else {
+        const Tag* tag = find(name);
+        out = tag ? *tag->members : RoaringBitmap();  // Unknown tags select nothing
+        ok = true;
+      }
+    } else {
+      error = "Expected tag:<name>, favorite, all, NOT or '('";
+    }
+    parser.depth--;
+    return ok;
+  };
+  
+  parseTerm = [&](RoaringBitmap& out) -> bool {
+    if (!parseFactor(out)) return false;
+    while (parser.keyword("AND")) {
+      RoaringBitmap right;
+      // "AND NOT x" maps straight onto ANDNOT
+      if (parser.keyword("NOT")) {
+        if (!parseFactor(right)) return false;
+        out = RoaringBitmap::subtract(out, right);
+      } else {
+        if (!parseFactor(right)) return false;
+        out = RoaringBitmap::intersect(out, right);
+      }
+    }
+    return true;
+  };
+  
+  parseExpr = [&](RoaringBitmap& out) -> bool {
+    if (!parseTerm(out)) return false;
+    while (parser.keyword("OR")) {
+      RoaringBitmap right;
+      if (!parseTerm(right)) return false;
+      out = RoaringBitmap::unite(out, right);
+    }
+    return true;
+  };
+  
+  if (!parseExpr(result)) {
+    return false;
+  }
+  parser.skipSpace();
+  if (*parser.p != '\0') {
+    error = "Unexpected input after expression";
+    return false;
+  }
+  return true;
+}
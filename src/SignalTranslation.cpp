@@ -0,0 +1,284 @@
+#include "SignalTranslation.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "ParamParse.h"
+
+// Packed record, little-endian: id u32, match u32, mask u32, base u32,
+// source protocol/bits, target protocol/bits, field count, then
+// MAX_FIELDS x (from, to, width)
+static const size_t TRANSLATION_RECORD_BYTES = 21 + Translation::MAX_FIELDS * 3;
+
+const int Translation::MAX_FIELDS;
+const size_t TranslationTable::MAX_TRANSLATIONS;
+const int TranslationTable::MAX_MASKS;
+
+static uint32_t lowBits(unsigned int width) {
+  return width >= 32 ? 0xFFFFFFFF : ((uint32_t)1 << width) - 1;
+}
+
+RadioFrame translateFrame(const Translation& translation, uint32_t value) {
+  uint32_t translated = translation.base;
+  for (int i = 0; i < translation.fieldCount; i++) {
+    const BitField& field = translation.fields[i];
+    uint32_t bits = (value >> field.from) & lowBits(field.width);
+    translated = (translated & ~(lowBits(field.width) << field.to)) | bits << field.to;
+  }
+  return RadioFrame{translated, translation.targetBits, translation.targetProtocol};
+}
+
+// Shared by the API and loading from flash
+static bool validTranslation(const Translation& t, String& error) {
+  if (t.sourceProtocol < 1 || t.targetProtocol < 1) {
+    error = "Invalid protocol";
+    return false;
+  }
+  if (t.sourceBits < 1 || t.sourceBits > 32 || t.targetBits < 1 || t.targetBits > 32) {
+    error = "Invalid bit length (1-32)";
+    return false;
+  }
+  if ((t.mask & ~lowBits(t.sourceBits)) != 0 || (t.match & ~t.mask) != 0) {
+    error = "Source value or mask wider than the pattern";
+    return false;
+  }
+  if ((t.base & ~lowBits(t.targetBits)) != 0) {
+    error = "Target value wider than its bit length";
+    return false;
+  }
+  if (t.fieldCount > Translation::MAX_FIELDS) {
+    error = "Too many fields (max " + String(Translation::MAX_FIELDS) + ")";
+    return false;
+  }
+  for (int i = 0; i < t.fieldCount; i++) {
+    const BitField& field = t.fields[i];
+    if (field.width < 1 || field.from + field.width > t.sourceBits || field.to + field.width > t.targetBits) {
+      error = "Field outside the source or target bits";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Splits text on separator into at most max numbers; count is how many
+static bool parseNumbers(const char* begin, const char* end, char separator, uint32_t* values, int max, int& count) {
+  count = 0;
+  while (count < max) {
+    const char* next = std::find(begin, end, separator);
+    if (!parseCode(begin, next - begin, values[count++])) {
+      return false;
+    }
+    if (next == end) {
+      return true;
+    }
+    begin = next + 1;
+  }
+  return false;
+}
+
+bool parseTranslation(const String& source, const String& target, const String* fields,
+                      Translation& translation, String& error) {
+  memset(&translation, 0, sizeof(translation));
+  uint32_t numbers[4];
+  int count;
+  const char* text = source.c_str();
+  if (!parseNumbers(text, text + source.length(), '/', numbers, 4, count) || count < 3 ||
+      numbers[0] > 0xFF || numbers[1] > 0xFF) {
+    error = "Invalid source (protocol/bits/value[/mask])";
+    return false;
+  }
+  translation.sourceProtocol = numbers[0];
+  translation.sourceBits = numbers[1];
+  translation.match = numbers[2];
+  translation.mask = count == 4 ? numbers[3] : lowBits(translation.sourceBits);
+  
+  text = target.c_str();
+  if (!parseNumbers(text, text + target.length(), '/', numbers, 3, count) || count != 3 ||
+      numbers[0] > 0xFF || numbers[1] > 0xFF) {
+    error = "Invalid target (protocol/bits/value)";
+    return false;
+  }
+  translation.targetProtocol = numbers[0];
+  translation.targetBits = numbers[1];
+  translation.base = numbers[2];
+  
+  if (fields && fields->length() > 0) {
+    const char* begin = fields->c_str();
+    const char* end = begin + fields->length();
+    while (true) {
+      const char* next = std::find(begin, end, ',');
+      if (translation.fieldCount == Translation::MAX_FIELDS) {
+        error = "Too many fields (max " + String(Translation::MAX_FIELDS) + ")";
+        return false;
+      }
+      if (!parseNumbers(begin, next, ':', numbers, 3, count) || count != 3 ||
+          numbers[0] > 31 || numbers[1] > 31 || numbers[2] > 32) {
+        error = "Invalid field (from:to:width)";
+        return false;
+      }
+      translation.fields[translation.fieldCount++] = BitField{(uint8_t)numbers[0], (uint8_t)numbers[1], (uint8_t)numbers[2]};
+      if (next == end) {
+        break;
+      }
+      begin = next + 1;
+    }
+  }
+  return validTranslation(translation, error);
+}
+
+static int bitCount(uint32_t value) {
+  int count = 0;
+  for (; value; value &= value - 1) {
+    count++;
+  }
+  return count;
+}
+
+TranslationTable::TranslationTable(const std::vector<Translation>& translations) {
+  // Each format's masks, most specific first; one over the limit drops its translation
+  for (const Translation& translation : translations) {
+    Masks& format = masks[formatOf(translation.sourceBits, translation.sourceProtocol)];
+    uint32_t* last = format.mask + format.count;
+    if (std::find(format.mask, last, translation.mask) == last && format.count < MAX_MASKS) {
+      *last = translation.mask;
+      format.count++;
+      std::stable_sort(format.mask, format.mask + format.count, [](uint32_t a, uint32_t b) {
+        return bitCount(a) > bitCount(b);
+      });
+    }
+  }
+  
+  source.reserve(translations.size());
+  entries.reserve(translations.size());
+  for (const Translation& translation : translations) {
+    uint16_t format = formatOf(translation.sourceBits, translation.sourceProtocol);
+    const Masks& formatMasks = masks[format];
+    int slot = std::find(formatMasks.mask, formatMasks.mask + formatMasks.count, translation.mask) - formatMasks.mask;
+    // The earlier translation keeps a pattern
+    if (slot == formatMasks.count || !entries.emplace(patternKey(translation.match, slot, format), source.size()).second) {
+      continue;
+    }
+    source.push_back(translation);
+  }
+}
+
+const Translation* TranslationTable::match(const RadioFrame& frame) const {
+  if (frame.bitLength > 32 || frame.protocol > 0xFF) {
+    return nullptr;
+  }
+  uint16_t format = formatOf(frame.bitLength, frame.protocol);
+  auto formatMasks = masks.find(format);
+  if (formatMasks == masks.end()) {
+    return nullptr;
+  }
+  
+  const Masks& candidates = formatMasks->second;
+  for (int slot = 0; slot < candidates.count; slot++) {
+    auto entry = entries.find(patternKey((uint32_t)frame.value & candidates.mask[slot], slot, format));
+    if (entry != entries.end()) {
+      return &source[entry->second];
+    }
+  }
+  return nullptr;
+}
+
+bool TranslationTable::conflicts(const Translation& translation, String& error) const {
+  auto formatMasks = masks.find(formatOf(translation.sourceBits, translation.sourceProtocol));
+  if (formatMasks == masks.end()) {
+    return false;
+  }
+  const Masks& format = formatMasks->second;
+  const uint32_t* last = format.mask + format.count;
+  const uint32_t* mask = std::find(format.mask, last, translation.mask);
+  if (mask == last) {
+    if (format.count < MAX_MASKS) {
+      return false;
+    }
+    error = "Too many masks for this protocol and bit length (max " + String(MAX_MASKS) + ")";
+    return true;
+  }
+  if (entries.count(patternKey(translation.match, mask - format.mask, formatMasks->first)) > 0) {
+    error = "A translation for this pattern already exists";
+    return true;
+  }
+  return false;
+}
+
+static void putLittleEndian(uint8_t* out, uint32_t value) {
+  for (size_t i = 0; i < 4; i++) {
+    out[i] = value >> (8 * i);
+  }
+}
+
+static uint32_t getLittleEndian(const uint8_t* in) {
+  return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+void saveTranslations(KeyValueStore& storage, const TranslationTable& table) {
+  const std::vector<Translation>& translations = table.translations();
+  uint8_t blob[1 + TranslationTable::MAX_TRANSLATIONS * TRANSLATION_RECORD_BYTES];
+  size_t count = std::min(translations.size(), TranslationTable::MAX_TRANSLATIONS);
+  // The count byte also keeps an empty set from being a zero-length blob
+  blob[0] = count;
+  for (size_t i = 0; i < count; i++) {
+    const Translation& t = translations[i];
+    uint8_t* record = blob + 1 + i * TRANSLATION_RECORD_BYTES;
+    putLittleEndian(record, t.id);
+    putLittleEndian(record + 4, t.match);
+    putLittleEndian(record + 8, t.mask);
+    putLittleEndian(record + 12, t.base);
+    record[16] = t.sourceProtocol;
+    record[17] = t.sourceBits;
+    record[18] = t.targetProtocol;
+    record[19] = t.targetBits;
+    record[20] = t.fieldCount;
+    for (int f = 0; f < Translation::MAX_FIELDS; f++) {
+      const BitField& field = t.fields[f];
+      uint8_t* packed = record + 21 + f * 3;
+      packed[0] = f < t.fieldCount ? field.from : 0;
+      packed[1] = f < t.fieldCount ? field.to : 0;
+      packed[2] = f < t.fieldCount ? field.width : 0;
+    }
+  }
+  storage.putBytes("translations", blob, 1 + count * TRANSLATION_RECORD_BYTES);
+}
+
+void loadTranslations(KeyValueStore& storage, std::vector<Translation>& translations) {
+  uint8_t blob[1 + TranslationTable::MAX_TRANSLATIONS * TRANSLATION_RECORD_BYTES];
+  translations.clear();
+  size_t length = storage.getBytesLength("translations");
+  if (length < 1 || length > sizeof(blob) || (length - 1) % TRANSLATION_RECORD_BYTES != 0 ||
+      storage.getBytes("translations", blob, length) != length) {
+    return;
+  }
+  
+  // The count byte comes from flash; the blob length bounds the loop
+  size_t count = std::min((size_t)blob[0], (length - 1) / TRANSLATION_RECORD_BYTES);
+  String error;
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* record = blob + 1 + i * TRANSLATION_RECORD_BYTES;
+    Translation t;
+    memset(&t, 0, sizeof(t));
+    t.id = getLittleEndian(record);
+    t.match = getLittleEndian(record + 4);
+    t.mask = getLittleEndian(record + 8);
+    t.base = getLittleEndian(record + 12);
+    t.sourceProtocol = record[16];
+    t.sourceBits = record[17];
+    t.targetProtocol = record[18];
+    t.targetBits = record[19];
+    t.fieldCount = record[20];
+    for (int f = 0; f < Translation::MAX_FIELDS && f < t.fieldCount; f++) {
+      const uint8_t* packed = record + 21 + f * 3;
+      t.fields[f] = BitField{packed[0], packed[1], packed[2]};
+    }
+    if (t.id == 0 || !validTranslation(t, error)) {
+      continue;
+    }
+    translations.push_back(t);
+  }
+  
+  std::sort(translations.begin(), translations.end(), [](const Translation& a, const Translation& b) {
+    return a.id < b.id;
+  });
+}
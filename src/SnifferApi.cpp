@@ -0,0 +1,1027 @@
+#include "SnifferApi.h"
+
+#include <ArduinoJson.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+
+#include "LogRing.h"
+#include "ParamParse.h"
+#include "SignalQuery.h"
+
+const String* ApiRequest::param(const char* name, bool body) const {
+  for (const ApiParam& candidate : params) {
+    if (candidate.body == body && candidate.name == name) {
+      return &candidate.value;
+    }
+  }
+  return nullptr;
+}
+
+const String* ApiRequest::find(const char* name) const {
+  const String* value = param(name, true);
+  return value ? value : param(name);
+}
+
+// IDs are checked against the owner's state when the command runs
+static bool readId(const String* text, int& id) {
+  return text && parseInt(*text, 0, INT_MAX, id);
+}
+
+// Commands name a signal by uid, which the owner looks up when the command
+// runs; a list position could point at another signal by then. The older
+// "id" position is still accepted and read against the current list.
+static bool readSignal(const String* uid, const String* position, const SignalSnapshot& snapshot, int& id) {
+  if (uid) {
+    return readId(uid, id);
+  }
+  int index;
+  if (!readId(position, index) || index >= (int)snapshot.size()) {
+    return false;
+  }
+  id = snapshot[index].uid;
+  return true;
+}
+
+static ApiResponse jsonResponse(const JsonDocument& doc) {
+  ApiResponse response(200, "application/json", String());
+  serializeJson(doc, response.body);
+  return response;
+}
+
+// 202 for a command the owner has not run yet; Location is where to ask again
+static ApiResponse queuedResponse(uint32_t ticket) {
+  ApiResponse response(202, "application/json", "{\"command\":" + String(ticket) + ",\"status\":\"queued\"}");
+  response.headers.push_back(std::make_pair(String("Location"), "/api/commands?id=" + String(ticket)));
+  return response;
+}
+
+// value/bitLength/protocol of a signalKey()
+static void writeCodeJson(JsonObject code, uint64_t key) {
+  code["value"] = (unsigned long)(key >> 32);
+  code["bitLength"] = (unsigned int)(key >> 8 & 0xFF);
+  code["protocol"] = (unsigned int)(key & 0xFF);
+}
+
+static void writeAnalyticsJson(JsonObject window, const AnalyticsReport& report) {
+  window["start"] = report.start;
+  window["seconds"] = report.length / 1000;
+  window["frames"] = report.frames;
+  window["distinct"] = report.distinct;
+  JsonObject protocols = window.createNestedObject("protocols");
+  for (int protocol = 0; protocol < AnalyticsReport::PROTOCOLS; protocol++) {
+    if (report.protocolFrames[protocol] > 0) {
+      protocols[protocol == 0 ? String("other") : String(protocol)] = report.protocolFrames[protocol];
+    }
+  }
+  // count - error is a lower bound on the code's frames in the window
+  JsonArray top = window.createNestedArray("top");
+  for (size_t i = 0; i < report.topCount; i++) {
+    JsonObject code = top.createNestedObject();
+    writeCodeJson(code, report.top[i].key);
+    code["count"] = report.top[i].count;
+    code["error"] = report.top[i].error;
+  }
+}
+
+static void writeSignalJson(JsonObject signal, const SignalSnapshot& snapshot, size_t id) {
+  const RFSignal& stored = snapshot[id];
+  signal["id"] = id;
+  signal["uid"] = stored.uid;
+  signal["name"] = stored.name;
+  signal["value"] = String(stored.value);
+  signal["bitLength"] = stored.bitLength;
+  signal["protocol"] = stored.protocol;
+  signal["timestamp"] = stored.timestamp;
+  signal["isFavorite"] = stored.isFavorite;
+  
+  std::vector<const String*> tagNames;
+  snapshot.tags.tagsOf(stored.uid, tagNames);
+  if (!tagNames.empty()) {
+    JsonArray tags = signal.createNestedArray("tags");
+    for (const String* name : tagNames) {
+      tags.add(*name);
+    }
+  }
+}
+
+static void addSignalJson(JsonArray& signals, const SignalSnapshot& snapshot, size_t id) {
+  writeSignalJson(signals.createNestedObject(), snapshot, id);
+}
+
+// A JSON object whose last member is a list, written an entry at a time so
+// only one entry's document is ever held. header runs up to the list's
+// "[", footer from its "]".
+class JsonListStream {
+public:
+  typedef std::function<void(JsonObject entry, size_t index)> Writer;
+
+  JsonListStream(const String& header, size_t count, size_t entryBytes, Writer writer, const String& footer = "]}")
+    : doc(entryBytes), writer(writer), count(count), next(0), headerWritten(false), footerWritten(false),
+      header(header), footer(footer), chunkOffset(0) {
+  }
+
+  size_t read(uint8_t* buffer, size_t maxLength) {
+    size_t written = 0;
+    while (written < maxLength) {
+      if (chunkOffset >= chunk.length() && !encodeNext()) {
+        break;
+      }
+      size_t length = std::min(maxLength - written, chunk.length() - chunkOffset);
+      memcpy(buffer + written, chunk.c_str() + chunkOffset, length);
+      chunkOffset += length;
+      written += length;
+    }
+    return written;
+  }
+
+private:
+  bool encodeNext() {
+    chunkOffset = 0;
+    if (!headerWritten) {
+      chunk = header;
+      headerWritten = true;
+    } else if (next < count) {
+      doc.clear();
+      writer(doc.to<JsonObject>(), next);
+      chunk = next > 0 ? "," : "";
+      serializeJson(doc, chunk);
+      next++;
+    } else if (!footerWritten) {
+      chunk = footer;
+      footerWritten = true;
+    } else {
+      chunk = String();
+      return false;
+    }
+    return true;
+  }
+
+  DynamicJsonDocument doc;
+  Writer writer;
+  size_t count;
+  size_t next;
+  bool headerWritten;
+  bool footerWritten;
+  String header;
+  String footer;
+  String chunk;
+  size_t chunkOffset;
+};
+
+static ApiResponse streamedResponse(std::shared_ptr<JsonListStream> list) {
+  ApiResponse response(200, "application/json", String());
+  response.stream = [list](uint8_t* buffer, size_t maxLength) {
+    return list->read(buffer, maxLength);
+  };
+  return response;
+}
+
+// /api/signals a signal at a time, so a full library never has to fit in
+// one JSON document. Lists either every signal or those changed after a
+// revision, plus the uids removed since then.
+static std::shared_ptr<JsonListStream> signalListStream(SignalStore::Snapshot snapshot, uint32_t epoch, int since) {
+  bool full = since < 0;
+  std::shared_ptr<std::vector<uint32_t>> positions = std::make_shared<std::vector<uint32_t>>();
+  for (size_t i = 0; i < snapshot->size(); i++) {
+    if (full || snapshot->columns.revision[i] > (uint32_t)since) {
+      positions->push_back(i);
+    }
+  }
+  
+  char text[96];
+  snprintf(text, sizeof(text), "{\"epoch\":%lu,\"revision\":%lu,\"full\":%s,\"signals\":[",
+           (unsigned long)epoch, (unsigned long)snapshot->revision, full ? "true" : "false");
+  String footer = "]";
+  if (!full) {
+    footer += ",\"removed\":[";
+    bool first = true;
+    for (const RemovedSignal& removed : snapshot->removed) {
+      if (removed.revision > (uint32_t)since) {
+        footer += first ? "" : ",";
+        footer += String(removed.uid);
+        first = false;
+      }
+    }
+    footer += "]";
+  }
+  footer += "}";
+  
+  return std::make_shared<JsonListStream>(text, positions->size(), 1024,
+    [snapshot, positions](JsonObject entry, size_t index) {
+      writeSignalJson(entry, *snapshot, (*positions)[index]);
+    }, footer);
+}
+
+String SnifferApi::ruleEventJson(const RuleEvent& event) {
+  DynamicJsonDocument doc(256);
+  doc["rule"] = event.rule;
+  doc["uid"] = event.signal.uid;
+  doc["name"] = event.signal.name;
+  doc["value"] = String(event.signal.value);
+  doc["bitLength"] = event.signal.bitLength;
+  doc["protocol"] = event.signal.protocol;
+  String body;
+  serializeJson(doc, body);
+  return body;
+}
+
+String SnifferApi::captureEventJson(const CaptureEvent& event) {
+  DynamicJsonDocument doc(256);
+  doc["uid"] = event.signal.uid;
+  doc["name"] = event.signal.name;
+  doc["value"] = String(event.signal.value);
+  doc["bitLength"] = event.signal.bitLength;
+  doc["protocol"] = event.signal.protocol;
+  doc["timestamp"] = event.signal.timestamp;
+  doc["isNew"] = event.isNew;
+  String body;
+  serializeJson(doc, body);
+  return body;
+}
+
+SnifferApi::SnifferApi(SnifferCore& core, const AdmissionLimits& limits)
+  : core(core), admission(limits), importLatency(nullptr),
+    importKey(nullptr), importRejected(nullptr), importRejectedBusy(false), importRetryAfter(0),
+    httpLatency("http_request_duration_seconds", "HTTP handler latency by route"),
+    admissionAccepted("http_admission_total", "API admission decisions",
+      Metric::COUNTER, [this]() { return (double)admission.stats().accepted; }, "result=\"accepted\""),
+    admissionRejectedRate("http_admission_total", "API admission decisions",
+      Metric::COUNTER, [this]() { return (double)admission.stats().rejectedRate; }, "result=\"rejected_rate\""),
+    admissionRejectedBusy("http_admission_total", "API admission decisions",
+      Metric::COUNTER, [this]() { return (double)admission.stats().rejectedBusy; }, "result=\"rejected_busy\"") {
+  registerRoutes();
+  importLatency = httpLatency.add("/api/import", "POST");
+}
+
+void SnifferApi::addRoute(const char* path, HttpMethod method, RouteClass routeClass, Handler handler) {
+  routeTable.push_back(Route{path, method, routeClass, handler, httpLatency.add(path, methodName(method))});
+}
+
+ApiResponse SnifferApi::handle(const Route& route, const ApiRequest& request) {
+  uint32_t started = micros();
+  std::shared_ptr<AdmissionSlot> slot;
+  ApiResponse response(429, "text/plain", String());
+  if (admit(request.client, route.routeClass, slot, response)) {
+    response = route.handler(request);
+    if (response.stream && slot) {
+      // A streamed body keeps its expensive slot until the last chunk
+      ApiStream stream = response.stream;
+      response.stream = [stream, slot](uint8_t* buffer, size_t maxLength) {
+        return stream(buffer, maxLength);
+      };
+    }
+  }
+  httpLatency.observe(route.latency, micros() - started);
+  return response;
+}
+
+ApiResponse SnifferApi::handle(const ApiRequest& request) {
+  for (const Route& route : routeTable) {
+    if (route.method == request.method && request.path == route.path) {
+      return handle(route, request);
+    }
+  }
+  return ApiResponse(404, "text/plain", "Not found");
+}
+
+void SnifferApi::registerRoutes() {
+  // Outcome of a command that answered 202: 202 again while it is queued
+  addRoute("/api/commands", METHOD_GET, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    int ticket;
+    if (!readId(request.param("id"), ticket)) {
+      return ApiResponse(400, "text/plain", "Invalid command ID");
+    }
+    CommandResult result = core.commands().result(ticket);
+    if (result.status == 202) {
+      return queuedResponse(ticket);
+    }
+    return ApiResponse(result.status, "text/plain", result.message);
+  });
+  
+  addRoute("/api/status", METHOD_GET, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    SignalStore::Snapshot signals = core.snapshot();
+    DynamicJsonDocument doc(1024);
+    doc["sniffing"] = core.sniffingEnabled();
+    doc["buzzer"] = core.buzzerEnabled();
+    doc["led"] = core.ledEnabled();
+    doc["repeater"] = core.repeaterEnabled();
+    doc["repeaterCodes"] = core.repeaterCodes()->size();
+    doc["signalCount"] = signals->size();
+    doc["maxSignals"] = core.signalCapacity();
+    doc["storageUsed"] = (float)signals->size() / core.signalCapacity() * 100;
+    doc["lastSignal"] = core.lastSignalTime();
+  
+    // Count favorites
+    int favoriteCount = 0;
+    for (uint8_t favorite : signals->columns.favorite) {
+      favoriteCount += favorite;
+    }
+    doc["favoriteCount"] = favoriteCount;
+  
+    CommandStats stats = core.commands().stats();
+    JsonObject commands = doc.createNestedObject("commands");
+    commands["processed"] = stats.processed;
+    commands["perSecond"] = stats.commandsPerSecond;
+    commands["avgLatencyUs"] = stats.avgLatencyUs;
+    commands["maxLatencyUs"] = stats.maxLatencyUs;
+    commands["rejected"] = stats.rejected;
+  
+    JsonObject indexes = doc.createNestedObject("indexBytes");
+#if RF_INDEX_PROTOCOL
+    indexes["protocol"] = signals->indexes.protocol->memoryUsage();
+#endif
+#if RF_INDEX_TIME
+    indexes["time"] = signals->indexes.time->memoryUsage();
+#endif
+#if RF_INDEX_NAME
+    indexes["name"] = signals->indexes.name->memoryUsage();
+#endif
+    indexes["tags"] = signals->tags.memoryUsage();
+  
+    AdmissionStats admitted = admission.stats();
+    JsonObject admissionJson = doc.createNestedObject("admission");
+    admissionJson["accepted"] = admitted.accepted;
+    admissionJson["rejectedRate"] = admitted.rejectedRate;
+    admissionJson["rejectedBusy"] = admitted.rejectedBusy;
+  
+    if (core.lastImportAdded() >= 0) {
+      JsonObject lastImport = doc.createNestedObject("lastImport");
+      lastImport["added"] = core.lastImportAdded();
+      lastImport["duplicates"] = core.lastImportDuplicates();
+    }
+  
+    return jsonResponse(doc);
+  });
+  
+  // Registered before the /api/repeater toggle, which would otherwise match it
+  addRoute("/api/repeater/codes", METHOD_GET, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    RepeaterCodes codes = core.repeaterCodes();
+    RepeaterStats stats = core.repeaterStats();
+    DynamicJsonDocument doc(256 + codes->size() * 96);
+    doc["enabled"] = core.repeaterEnabled();
+    doc["repeated"] = stats.repeated;
+    doc["echoesSuppressed"] = stats.echoesSuppressed;
+    JsonArray list = doc.createNestedArray("codes");
+    for (uint64_t key : *codes) {
+      writeCodeJson(list.createNestedObject(), key);
+    }
+  
+    return jsonResponse(doc);
+  });
+  
+  // Add or remove a library signal's code; the list outlives the signal
+  static const HttpMethod CODE_METHODS[] = {METHOD_POST, METHOD_DELETE};
+  for (HttpMethod method : CODE_METHODS) {
+    addRoute("/api/repeater/codes", method, ROUTE_CHEAP, [this, method](const ApiRequest& request) {
+      const String* uid = request.find("uid");
+      const String* id = request.find("id");
+      if (!uid && !id) {
+        return ApiResponse(400, "text/plain", "Missing signal ID");
+      }
+      Command command(CMD_REPEATER_CODE);
+      if (!readSignal(uid, id, *core.snapshot(), command.id)) {
+        return ApiResponse(400, "text/plain", "Invalid signal ID");
+      }
+      command.flag = method == METHOD_POST;
+      return commandResponse(command);
+    });
+  }
+  
+  // Settings toggles share their shape
+  struct Toggle {
+    const char* path;
+    CommandType type;
+  };
+  static const Toggle TOGGLES[] = {
+    {"/api/sniffing", CMD_SET_SNIFFING},
+    {"/api/buzzer", CMD_SET_BUZZER},
+    {"/api/led", CMD_SET_LED},
+    {"/api/repeater", CMD_SET_REPEATER}
+  };
+  for (const Toggle& toggle : TOGGLES) {
+    CommandType type = toggle.type;
+    addRoute(toggle.path, METHOD_POST, ROUTE_CHEAP, [this, type](const ApiRequest& request) {
+      const String* enabled = request.param("enabled", true);
+      if (!enabled) {
+        return ApiResponse(400, "text/plain", "Missing enabled parameter");
+      }
+      Command command(type);
+      if (!parseBool(*enabled, command.flag)) {
+        return ApiResponse(400, "text/plain", "Invalid enabled parameter");
+      }
+      return commandResponse(command);
+    });
+  }
+  
+  // Registered before /api/signals, which would otherwise match its sub-paths
+  addRoute("/api/signals/query", METHOD_GET, ROUTE_EXPENSIVE, [this](const ApiRequest& request) {
+    const String* filter = request.param("q");
+    int offset, limit;
+    ApiResponse error(400, "text/plain", String());
+    if (!readPaging(request, offset, limit, error)) {
+      return error;
+    }
+  
+    SignalQuery query;
+    String message;
+    if (!compileSignalQuery(filter ? *filter : String(), query, message)) {
+      return ApiResponse(400, "text/plain", "Invalid query: " + message);
+    }
+  
+    SignalStore::Snapshot snapshot = core.snapshot();
+    std::vector<uint32_t> matches;
+    runSignalQuery(query, *snapshot, core.clock().millis(), matches);
+    return signalPage(*snapshot, matches, offset, limit);
+  });
+  
+  addRoute("/api/signals/tagged", METHOD_GET, ROUTE_EXPENSIVE, [this](const ApiRequest& request) {
+    const String* expr = request.param("expr");
+    if (!expr) {
+      return ApiResponse(400, "text/plain", "Missing expr parameter");
+    }
+    int offset, limit;
+    ApiResponse error(400, "text/plain", String());
+    if (!readPaging(request, offset, limit, error)) {
+      return error;
+    }
+  
+    SignalStore::Snapshot snapshot = core.snapshot();
+    RoaringBitmap selected;
+    String message;
+    if (!snapshot->tags.select(*expr, selected, message)) {
+      return ApiResponse(400, "text/plain", "Invalid expression: " + message);
+    }
+  
+    std::vector<uint32_t> uids;
+    selected.toVector(uids);
+    std::vector<uint32_t> matches;
+    matches.reserve(uids.size());
+    for (uint32_t uid : uids) {
+      int position = snapshot->positionOf(uid);
+      if (position >= 0) {
+        matches.push_back(position);
+      }
+    }
+    std::sort(matches.begin(), matches.end());
+    return signalPage(*snapshot, matches, offset, limit);
+  });
+  
+  // ?epoch=E&since=R lists only what changed after revision R of boot E,
+  // falling back to the whole library when that can't be told
+  addRoute("/api/signals", METHOD_GET, ROUTE_EXPENSIVE, [this](const ApiRequest& request) {
+    const String* sinceText = request.param("since");
+    const String* epochText = request.param("epoch");
+    int since = -1;
+    int epoch = 0;
+    if (sinceText && (!epochText || !parseInt(*sinceText, 0, INT_MAX, since) || !parseInt(*epochText, 0, INT_MAX, epoch))) {
+      return ApiResponse(400, "text/plain", "Invalid since or epoch parameter");
+    }
+  
+    SignalStore::Snapshot snapshot = core.snapshot();
+    if ((uint32_t)epoch != core.libraryEpoch() || since < (int)snapshot->resetRevision ||
+        since > (int)snapshot->revision) {
+      since = -1;
+    }
+    return streamedResponse(signalListStream(snapshot, core.libraryEpoch(), since));
+  });
+  
+  addRoute("/api/transmit", METHOD_POST, ROUTE_TRANSMIT, [this](const ApiRequest& request) {
+    const String* uid = request.find("uid");
+    const String* id = request.find("id");
+    if (!uid && !id) {
+      return ApiResponse(400, "text/plain", "Missing signal ID");
+    }
+    Command command(CMD_TRANSMIT);
+    if (!readSignal(uid, id, *core.snapshot(), command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID");
+    }
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/repeat-transmit", METHOD_POST, ROUTE_TRANSMIT, [this](const ApiRequest& request) {
+    const String* uid = request.find("uid");
+    const String* id = request.find("id");
+    const String* count = request.param("count", true);
+    if ((!uid && !id) || !count) {
+      return ApiResponse(400, "text/plain", "Missing signal ID or count");
+    }
+    Command command(CMD_REPEAT_TRANSMIT);
+    if (!readSignal(uid, id, *core.snapshot(), command.id) || !parseInt(*count, 1, 100, command.count)) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID or count (1-100)");
+    }
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/signals", METHOD_DELETE, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* uid = request.find("uid");
+    const String* id = request.find("id");
+    if (!uid && !id) {
+      return ApiResponse(400, "text/plain", "Missing signal ID");
+    }
+    Command command(CMD_DELETE_SIGNAL);
+    if (!readSignal(uid, id, *core.snapshot(), command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID");
+    }
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/signals/rename", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* uid = request.find("uid");
+    const String* id = request.find("id");
+    const String* name = request.param("name", true);
+    if ((!uid && !id) || !name) {
+      return ApiResponse(400, "text/plain", "Missing parameters");
+    }
+    if (name->length() > MAX_NAME_LENGTH) {
+      return ApiResponse(400, "text/plain", "Name too long (max " + String(MAX_NAME_LENGTH) + " characters)");
+    }
+    Command command(CMD_RENAME_SIGNAL);
+    if (!readSignal(uid, id, *core.snapshot(), command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID");
+    }
+    command.text = *name;
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/signals/favorite", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* uid = request.find("uid");
+    const String* id = request.find("id");
+    const String* favorite = request.param("favorite", true);
+    if ((!uid && !id) || !favorite) {
+      return ApiResponse(400, "text/plain", "Missing parameters");
+    }
+    Command command(CMD_SET_FAVORITE);
+    if (!readSignal(uid, id, *core.snapshot(), command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID");
+    }
+    if (!parseBool(*favorite, command.flag)) {
+      return ApiResponse(400, "text/plain", "Invalid favorite parameter");
+    }
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/clear", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    return commandResponse(Command(CMD_CLEAR_SIGNALS));
+  });
+  
+  // Registered before /api/cleanup, which would otherwise match it
+  addRoute("/api/cleanup/old", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    // Remove signals older than specified days (default 7 days)
+    Command command(CMD_CLEANUP_OLD);
+    command.count = 7;
+    const String* days = request.param("days", true);
+    if (days && !parseInt(*days, 0, 3650, command.count)) {
+      return ApiResponse(400, "text/plain", "Invalid days (0-3650)");
+    }
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/cleanup", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    return commandResponse(Command(CMD_CLEANUP));
+  });
+  
+  addRoute("/api/export", METHOD_GET, ROUTE_EXPENSIVE, [this](const ApiRequest& request) {
+    const String* format = request.param("format");
+    bool binary = format && *format == "binary";
+    std::shared_ptr<SignalExporter> exporter = std::make_shared<SignalExporter>(
+      core.snapshot(), binary ? EXPORT_BINARY : EXPORT_NDJSON);
+  
+    // Streamed from one snapshot, a chunk per callback
+    ApiResponse response(200, binary ? "application/octet-stream" : "application/x-ndjson", String());
+    response.stream = [exporter](uint8_t* buffer, size_t maxLength) {
+      return exporter->read(buffer, maxLength);
+    };
+    response.headers.push_back(std::make_pair(String("Content-Disposition"),
+      String(binary ? "attachment; filename=\"signals.rf43\"" : "attachment; filename=\"signals.ndjson\"")));
+    return response;
+  });
+  
+#if RF_TRACE_ENABLED
+  addRoute("/api/trace", METHOD_GET, ROUTE_EXPENSIVE, [this](const ApiRequest& request) {
+    std::vector<TraceEvent> events;
+    core.trace().snapshot(events);
+    return ApiResponse(200, "application/json", renderChromeTrace(events, core.traceOverhead()));
+  });
+#endif
+  
+  // Recent log entries; pass the returned next as since to poll for new ones
+  addRoute("/api/logs", METHOD_GET, ROUTE_CHEAP, [](const ApiRequest& request) {
+    const String* since = request.param("since");
+    uint32_t first = 0;
+    if (since && !parseUInt32(*since, first)) {
+      return ApiResponse(400, "text/plain", "Invalid since parameter");
+    }
+    std::vector<LogEntry> entries;
+    logRing.recent(entries, first);
+  
+    DynamicJsonDocument doc(256 + entries.size() * (JSON_OBJECT_SIZE(4) + 96));
+    doc["next"] = entries.empty() ? logRing.recorded() : entries.back().sequence + 1;
+    doc["lost"] = logRing.lost();
+    JsonArray list = doc.createNestedArray("entries");
+    char line[96];
+    for (const LogEntry& entry : entries) {
+      LogRing::format(entry, line, sizeof(line));
+      JsonObject item = list.createNestedObject();
+      item["seq"] = entry.sequence;
+      item["timeUs"] = entry.timestampUs;
+      item["level"] = LogRing::levelName(entry.level);
+      item["message"] = line;  // Copied, unlike const char*
+    }
+    return jsonResponse(doc);
+  });
+  
+  // Prometheus scrape target, rendered a metric at a time
+  addRoute("/metrics", METHOD_GET, ROUTE_CHEAP, [](const ApiRequest& request) {
+    std::shared_ptr<MetricsExporter> exporter = std::make_shared<MetricsExporter>();
+    ApiResponse response(200, "text/plain; version=0.0.4", String());
+    response.stream = [exporter](uint8_t* buffer, size_t maxLength) {
+      return exporter->read(buffer, maxLength);
+    };
+    return response;
+  });
+  
+  addRoute("/api/tags", METHOD_GET, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    SignalStore::Snapshot snapshot = core.snapshot();
+    const std::vector<SignalTags::Tag>& tags = snapshot->tags.list();
+    DynamicJsonDocument doc(128 + tags.size() * 64);
+    JsonArray list = doc.createNestedArray("tags");
+    for (const auto& tag : tags) {
+      JsonObject entry = list.createNestedObject();
+      entry["name"] = tag.name;
+      entry["count"] = tag.members->cardinality();
+    }
+  
+    return jsonResponse(doc);
+  });
+  
+  addRoute("/api/tags", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* uid = request.find("uid");
+    const String* id = request.find("id");
+    const String* tag = request.find("tag");
+    if ((!uid && !id) || !tag) {
+      return ApiResponse(400, "text/plain", "Missing parameters");
+    }
+    Command command(CMD_TAG_SIGNAL);
+    if (!readSignal(uid, id, *core.snapshot(), command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID");
+    }
+    command.text = *tag;
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/tags", METHOD_DELETE, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    // With a signal: remove the tag from it, otherwise delete the tag
+    const String* uid = request.find("uid");
+    const String* id = request.find("id");
+    const String* tag = request.find("tag");
+    if (!tag) {
+      return ApiResponse(400, "text/plain", "Missing tag parameter");
+    }
+    Command command(uid || id ? CMD_UNTAG_SIGNAL : CMD_DELETE_TAG);
+    command.id = -1;
+    if ((uid || id) && !readSignal(uid, id, *core.snapshot(), command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID");
+    }
+    command.text = *tag;
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/rules", METHOD_GET, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    int offset, limit;
+    ApiResponse error(400, "text/plain", String());
+    if (!readPaging(request, offset, limit, error)) {
+      return error;
+    }
+  
+    RuleSet rules = core.rules();
+    const std::vector<Rule>& list = rules->rules();
+    size_t first = std::min((size_t)offset, list.size());
+    size_t last = std::min(first + limit, list.size());
+    DynamicJsonDocument doc(256 + (last - first) * 256);
+    doc["total"] = list.size();
+    doc["offset"] = offset;
+    doc["limit"] = limit;
+    doc["fired"] = core.rulesFired();
+    JsonArray page = doc.createNestedArray("rules");
+    for (size_t i = first; i < last; i++) {
+      JsonObject rule = page.createNestedObject();
+      rule["id"] = list[i].id;
+      rule["action"] = ruleActionName(list[i].action);
+      writeCodeJson(rule.createNestedObject("trigger"), list[i].trigger);
+      if (list[i].action == RULE_TRANSMIT) {
+        writeCodeJson(rule.createNestedObject("target"), list[i].target);
+      }
+    }
+  
+    return jsonResponse(doc);
+  });
+  
+  // trigger and target are library signal uids; the rule keeps their codes
+  addRoute("/api/rules", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* trigger = request.param("trigger", true);
+    const String* action = request.param("action", true);
+    const String* target = request.param("target", true);
+    if (!trigger || !action) {
+      return ApiResponse(400, "text/plain", "Missing parameters");
+    }
+    Command command(CMD_ADD_RULE);
+    if (!readId(trigger, command.id) || (target && !readId(target, command.target))) {
+      return ApiResponse(400, "text/plain", "Invalid signal ID");
+    }
+    command.text = *action;
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/rules", METHOD_DELETE, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* id = request.find("id");
+    if (!id) {
+      return ApiResponse(400, "text/plain", "Missing rule ID");
+    }
+    Command command(CMD_DELETE_RULE);
+    if (!readId(id, command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid rule ID");
+    }
+    return commandResponse(command);
+  });
+  
+  // Streamed a translation at a time, like the filters below
+  addRoute("/api/translations", METHOD_GET, ROUTE_EXPENSIVE, [this](const ApiRequest& request) {
+    TranslationSet translations = core.translations();
+    char header[64];
+    snprintf(header, sizeof(header), "{\"total\":%u,\"translated\":%lu,\"translations\":[",
+             (unsigned int)translations->translations().size(), (unsigned long)core.translated());
+    return streamedResponse(std::make_shared<JsonListStream>(header, translations->translations().size(), 448,
+      [translations](JsonObject entry, size_t index) {
+        const Translation& t = translations->translations()[index];
+        entry["id"] = t.id;
+        JsonObject source = entry.createNestedObject("source");
+        source["protocol"] = t.sourceProtocol;
+        source["bitLength"] = t.sourceBits;
+        source["value"] = t.match;
+        source["mask"] = t.mask;
+        JsonObject target = entry.createNestedObject("target");
+        target["protocol"] = t.targetProtocol;
+        target["bitLength"] = t.targetBits;
+        target["value"] = t.base;
+        JsonArray fields = entry.createNestedArray("fields");
+        for (int i = 0; i < t.fieldCount; i++) {
+          JsonObject field = fields.createNestedObject();
+          field["from"] = t.fields[i].from;
+          field["to"] = t.fields[i].to;
+          field["width"] = t.fields[i].width;
+        }
+      }));
+  });
+  
+  // Parsed here so a malformed mapping never reaches the owner task
+  addRoute("/api/translations", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* source = request.param("source", true);
+    const String* target = request.param("target", true);
+    if (!source || !target) {
+      return ApiResponse(400, "text/plain", "Missing parameters");
+    }
+    std::shared_ptr<Translation> translation = std::make_shared<Translation>();
+    String error;
+    if (!parseTranslation(*source, *target, request.param("fields", true), *translation, error)) {
+      return ApiResponse(400, "text/plain", error);
+    }
+    Command command(CMD_ADD_TRANSLATION);
+    command.payload = translation;
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/translations", METHOD_DELETE, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* id = request.find("id");
+    if (!id) {
+      return ApiResponse(400, "text/plain", "Missing translation ID");
+    }
+    Command command(CMD_DELETE_TRANSLATION);
+    if (!readId(id, command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid translation ID");
+    }
+    return commandResponse(command);
+  });
+  
+  // A rule at a time, with protocols and bits in the spelling POST takes
+  addRoute("/api/filters", METHOD_GET, ROUTE_EXPENSIVE, [this](const ApiRequest& request) {
+    FilterSet filters = core.filters();
+    FilterStats stats = core.filterStats();
+    char header[96];
+    snprintf(header, sizeof(header), "{\"total\":%u,\"denied\":%lu,\"notAllowed\":%lu,\"filters\":[",
+             (unsigned int)filters->rules().size(), (unsigned long)stats.denied, (unsigned long)stats.notAllowed);
+    return streamedResponse(std::make_shared<JsonListStream>(header, filters->rules().size(), 384,
+      [filters](JsonObject entry, size_t index) {
+        const FilterRule& rule = filters->rules()[index];
+        entry["id"] = rule.id;
+        entry["list"] = filterListName(rule.list);
+        entry["protocols"] = filterSetText(rule.protocols);
+        entry["bits"] = filterSetText(rule.bitLengths);
+        entry["low"] = rule.low;
+        entry["high"] = rule.high;
+        entry["matches"] = filters->matches(index);
+      }));
+  });
+  
+  // Parsed here so a malformed rule never reaches the owner task
+  addRoute("/api/filters", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* list = request.param("list", true);
+    if (!list) {
+      return ApiResponse(400, "text/plain", "Missing list parameter");
+    }
+    std::shared_ptr<FilterRule> rule = std::make_shared<FilterRule>();
+    String error;
+    if (!parseFilterRule(*list, request.param("protocol", true), request.param("bits", true),
+                         request.param("value", true), *rule, error)) {
+      return ApiResponse(400, "text/plain", error);
+    }
+    Command command(CMD_ADD_FILTER);
+    command.payload = rule;
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/filters", METHOD_DELETE, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* id = request.find("id");
+    if (!id) {
+      return ApiResponse(400, "text/plain", "Missing filter ID");
+    }
+    Command command(CMD_DELETE_FILTER);
+    if (!readId(id, command.id)) {
+      return ApiResponse(400, "text/plain", "Invalid filter ID");
+    }
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/analytics", METHOD_GET, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    AnalyticsReport current, previous;
+    bool hasPrevious;
+    core.analytics().report(core.clock().millis(), current, previous, hasPrevious);
+    DynamicJsonDocument doc(4096);
+    doc["windowSeconds"] = core.analytics().window() / 1000;
+    writeAnalyticsJson(doc.createNestedObject("current"), current);
+    if (hasPrevious) {
+      writeAnalyticsJson(doc.createNestedObject("previous"), previous);
+    }
+  
+    return jsonResponse(doc);
+  });
+  
+  addRoute("/api/analytics", METHOD_POST, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    const String* window = request.param("window", true);
+    if (!window) {
+      return ApiResponse(400, "text/plain", "Missing window parameter");
+    }
+    uint32_t seconds;
+    if (!parseUInt32(*window, seconds)) {
+      return ApiResponse(400, "text/plain", "Invalid window");
+    }
+    Command command(CMD_SET_ANALYTICS_WINDOW);
+    command.value = seconds;
+    return commandResponse(command);
+  });
+  
+  addRoute("/api/analytics", METHOD_DELETE, ROUTE_CHEAP, [this](const ApiRequest& request) {
+    return commandResponse(Command(CMD_RESET_ANALYTICS));
+  });
+}
+
+// A command still queued answers 202 rather than holding the web server task;
+// a retry would run it twice, so clients follow it at /api/commands instead
+ApiResponse SnifferApi::commandResponse(const Command& command) {
+  uint32_t ticket;
+  CommandResult result = core.commands().call(command, COMMAND_WAIT_MS, ticket);
+  if (result.status == 202) {
+    return queuedResponse(ticket);
+  }
+  return ApiResponse(result.status, "text/plain", result.message);
+}
+
+// Reads offset/limit query parameters; fills error when invalid
+bool SnifferApi::readPaging(const ApiRequest& request, int& offset, int& limit, ApiResponse& error) {
+  const String* offsetParam = request.param("offset");
+  const String* limitParam = request.param("limit");
+  offset = 0;
+  limit = 50;
+  if ((offsetParam && !parseInt(*offsetParam, 0, INT_MAX, offset)) ||
+      (limitParam && !parseInt(*limitParam, 1, 100, limit))) {
+    error = ApiResponse(400, "text/plain", "Invalid offset or limit (1-100)");
+    return false;
+  }
+  return true;
+}
+
+ApiResponse SnifferApi::signalPage(const SignalSnapshot& snapshot, const std::vector<uint32_t>& matches,
+                                   int offset, int limit) {
+  size_t first = std::min((size_t)offset, matches.size());
+  size_t last = std::min(first + limit, matches.size());
+  DynamicJsonDocument doc(256 + (last - first) * 320);
+  doc["total"] = matches.size();
+  doc["offset"] = offset;
+  doc["limit"] = limit;
+  JsonArray signals = doc.createNestedArray("signals");
+  for (size_t i = first; i < last; i++) {
+    addSignalJson(signals, snapshot, matches[i]);
+  }
+  
+  return jsonResponse(doc);
+}
+
+void SnifferApi::importData(const void* key, uint32_t client, const uint8_t* data, size_t length, bool first) {
+  if (first) {
+    if (importer) {
+      return;  // One import at a time; finishImport answers 409
+    }
+    uint32_t retryAfter;
+    bool busy;
+    if (!admission.admit(client, ROUTE_EXPENSIVE, core.clock().millis(), retryAfter, busy)) {
+      importRejected = key;
+      importRejectedBusy = busy;
+      importRetryAfter = retryAfter;
+      return;
+    }
+    importSlot = std::make_shared<AdmissionSlot>(admission);
+    importKey = key;
+    importer = std::make_shared<SignalImporter>(core.signalCapacity());
+  }
+  if (importKey == key && importer) {
+    importer->feed(data, length);
+  }
+}
+
+void SnifferApi::importAborted(const void* key) {
+  if (importKey == key) {
+    importKey = nullptr;
+    importer.reset();
+    importSlot.reset();
+  }
+  if (importRejected == key) {
+    importRejected = nullptr;
+  }
+}
+
+ApiResponse SnifferApi::finishImport(const void* key) {
+  uint32_t started = micros();
+  ApiResponse response(202, "text/plain", String());
+  if (importRejected == key) {
+    importRejected = nullptr;
+    response = rejection(importRejectedBusy, importRetryAfter);
+  } else if (importKey != key || !importer) {
+    response = importer ? ApiResponse(409, "text/plain", "Another import is in progress")
+                        : ApiResponse(400, "text/plain", "Missing import data");
+  } else {
+    std::shared_ptr<SignalImporter> finished = importer;
+    importer.reset();
+    importSlot.reset();
+    importKey = nullptr;
+    if (!finished->finish()) {
+      response = ApiResponse(400, "text/plain", "Import failed: " + finished->error());
+    } else {
+      // Applied as one command, so the library is saved once
+      size_t count = finished->records().size();
+      Command command(CMD_IMPORT);
+      command.payload = finished;
+      uint32_t ticket;
+      CommandResult result = core.commands().call(command, 0, ticket);
+      if (result.status != 202) {
+        response = ApiResponse(result.status, "text/plain", result.message);
+      } else {
+        response.body = "Import queued: " + String(count) + " records";
+        response.headers.push_back(std::make_pair(String("Location"), "/api/commands?id=" + String(ticket)));
+      }
+    }
+  }
+  httpLatency.observe(importLatency, micros() - started);
+  return response;
+}
+
+// Applies admission control, filling the 429 on rejection. Expensive
+// routes get a slot that is released when the last holder drops it.
+bool SnifferApi::admit(uint32_t client, RouteClass routeClass, std::shared_ptr<AdmissionSlot>& slot,
+                       ApiResponse& rejected) {
+  uint32_t retryAfter;
+  bool busy;
+  if (!admission.admit(client, routeClass, core.clock().millis(), retryAfter, busy)) {
+    rejected = rejection(busy, retryAfter);
+    return false;
+  }
+  if (routeClass == ROUTE_EXPENSIVE) {
+    slot = std::make_shared<AdmissionSlot>(admission);
+  }
+  return true;
+}
+
+ApiResponse SnifferApi::rejection(bool busy, uint32_t retryAfter) {
+  ApiResponse response(429, "text/plain", busy ? "Server busy, retry later" : "Too many requests");
+  response.headers.push_back(std::make_pair(String("Retry-After"), String(retryAfter)));
+  return response;
+}
+
+const char* SnifferApi::methodName(HttpMethod method) {
+  switch (method) {
+    case METHOD_GET: return "GET";
+    case METHOD_POST: return "POST";
+    case METHOD_DELETE: return "DELETE";
+  }
+  return "OTHER";
+}
@@ -0,0 +1,862 @@
+#include "SnifferCore.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "LogRing.h"
+#include "SignalPersistence.h"
+
+#if RF_TRACE_ENABLED
+#define TRACE(frame, stage, arg) traceStage(frame, stage, arg)
+#else
+#define TRACE(frame, stage, arg) ((void)0)
+#endif
+
+const int SnifferCore::MAX_SIGNALS;
+const int SnifferCore::AUTO_CLEANUP_THRESHOLD;
+const int SnifferCore::MAX_REPEATER_CODES;
+const unsigned long SnifferCore::ECHO_HOLDOFF_MS;
+const unsigned long SnifferCore::REPEATER_WAIT_MS;
+const int SnifferCore::ECHO_SLOTS;
+const unsigned long SnifferCore::DEFAULT_ANALYTICS_WINDOW_S;
+const unsigned long SnifferCore::MAX_ANALYTICS_WINDOW_S;
+
+// The frame a signal key stands for
+static RadioFrame frameOf(uint64_t key) {
+  return RadioFrame{(unsigned long)(key >> 32), (unsigned int)(key >> 8 & 0xFF), (unsigned int)(key & 0xFF)};
+}
+
+SnifferCore::SnifferCore(Radio& radio, KeyValueStore& storage, Clock& clock, Feedback& feedback, int capacity)
+  : radio(radio), storage(storage), time(clock), feedback(feedback),
+    maxSignals(capacity), cleanupThreshold(capacity - capacity / 20),
+    commandQueue(COMMAND_QUEUE_SIZE, CAPTURE_RESERVE), signalsDirty(false), receiveFeedbackPending(false), signalCount(0), epoch(0),
+    sniffing(false), buzzer(true), led(true), lastSignal(0), importAdded(-1), importDuplicates(0),
+    repeater(false), publishedRepeaterCodes(std::make_shared<std::vector<uint64_t>>()),
+    recentTransmits(), nextTransmitSlot(0),
+    ruleSet(std::make_shared<RuleTable>(std::vector<Rule>())), nextRuleId(1),
+    translationSet(std::make_shared<TranslationTable>(std::vector<Translation>())), nextTranslationId(1),
+    filterSet(std::make_shared<FilterTable>(std::vector<FilterRule>())), nextFilterId(1),
+    frameAnalytics(DEFAULT_ANALYTICS_WINDOW_S * 1000),
+    repeatTransmissionActive(false), repeatCount(0), currentRepeatIndex(0),
+#if RF_TRACE_ENABLED
+    nextTraceFrame(1),
+#endif
+    framesReceived("rf_frames_received_total", "RF frames decoded by the receiver"),
+    framesStored("rf_frames_stored_total", "New signals added to the library"),
+    dedupHits("rf_dedup_hits_total", "Frames matching an already stored signal"),
+    framesDroppedQueue("rf_frames_dropped_total", "RF frames that could not be stored", "reason=\"queue_full\""),
+    framesDroppedStorage("rf_frames_dropped_total", "RF frames that could not be stored", "reason=\"storage_full\""),
+    txJobs("rf_tx_jobs_total", "Transmit and repeat-transmit jobs"),
+    transmissions("rf_transmissions_total", "RF frames sent"),
+    repeats("rf_repeats_total", "Frames sent on by the repeater"),
+    echoesSuppressed("rf_echoes_suppressed_total", "Own transmissions received back and ignored"),
+    rulesFiredTotal("rf_rules_fired_total", "Rule actions run for captured frames"),
+    translationsSent("rf_translations_total", "Frames re-encoded and sent by protocol translations"),
+    framesDenied("rf_frames_filtered_total", "RF frames dropped by the capture filters", "reason=\"denied\""),
+    framesNotAllowed("rf_frames_filtered_total", "RF frames dropped by the capture filters", "reason=\"not_allowed\""),
+    saveDuration("rf_save_duration_seconds", "Time to persist the signal library"),
+    commandsProcessed("rf_commands_processed_total", "Commands applied by the owner task",
+      Metric::COUNTER, [this]() { return (double)commandQueue.stats().processed; }),
+    commandsRejected("rf_commands_rejected_total", "Commands refused because the queue was full",
+      Metric::COUNTER, [this]() { return (double)commandQueue.stats().rejected; })
+#if RF_TRACE_ENABLED
+    , traceCycles("rf_trace_overhead_cycles_total", "CPU cycles spent recording trace events")
+#endif
+{
+}
+
+void SnifferCore::begin() {
+  // Load persistent settings
+  buzzer = storage.getBool("buzzerEnabled", true);
+  led = storage.getBool("ledEnabled", true);
+  sniffing = storage.getBool("sniffingEnabled", true);  // Auto-start sniffing by default
+  repeater = storage.getBool("repeaterEnabled", false);
+  epoch = storage.getULong("bootEpoch", 0) + 1;
+  storage.putULong("bootEpoch", epoch);
+  
+  Serial.println("Settings loaded:");
+  Serial.println("  Buzzer: " + String(buzzer ? "ON" : "OFF"));
+  Serial.println("  LED: " + String(led ? "ON" : "OFF"));
+  Serial.println("  Sniffing: " + String(sniffing ? "ON" : "OFF"));
+  
+  // Repeater allowlist: packed signal keys
+  uint64_t codes[MAX_REPEATER_CODES];
+  size_t length = storage.getBytesLength("repeaterCodes");
+  if (length > 0 && length <= sizeof(codes) && length % sizeof(uint64_t) == 0 &&
+      storage.getBytes("repeaterCodes", codes, length) == length) {
+    for (size_t i = 0; i < length / sizeof(uint64_t); i++) {
+      if (codes[i] != 0) {
+        repeaterSet.insert(codes[i]);
+      }
+    }
+  }
+  publishRepeaterCodes(false);
+  Serial.println("  Repeater: " + String(repeater ? "ON" : "OFF") + " (" + String(repeaterSet.size()) + " codes)");
+  
+  std::vector<Rule> rules;
+  loadRules(storage, rules);
+  for (const Rule& rule : rules) {
+    nextRuleId = std::max(nextRuleId, rule.id + 1);
+  }
+  publishRules(rules, false);
+  Serial.println("  Rules: " + String(rules.size()));
+  
+  std::vector<Translation> translations;
+  loadTranslations(storage, translations);
+  for (const Translation& translation : translations) {
+    nextTranslationId = std::max(nextTranslationId, translation.id + 1);
+  }
+  publishTranslations(translations, false);
+  Serial.println("  Translations: " + String(translationSet->translations().size()));
+  
+  std::vector<FilterRule> filters;
+  loadFilters(storage, filters);
+  for (const FilterRule& filter : filters) {
+    nextFilterId = std::max(nextFilterId, filter.id + 1);
+  }
+  publishFilters(filters, false);
+  Serial.println("  Filters: " + String(filters.size()));
+  
+  unsigned long window = std::min(storage.getULong("analyticsWindow", DEFAULT_ANALYTICS_WINDOW_S), MAX_ANALYTICS_WINDOW_S);
+  frameAnalytics.setWindow(window * 1000, time.millis());
+  
+  if (loadSignals(storage, signalStore, signalCount, maxSignals)) {
+    saveStoredSignals();
+  }
+  Serial.println("Loaded " + String(signalStore.size()) + " signals from storage");
+}
+
+void SnifferCore::poll() {
+  // Check for received RF signals
+  RadioFrame frame;
+  if (sniffing && radio.receive(frame)) {
+    handleReceivedFrame(frame);
+  }
+  
+  // Apply queued state changes
+  processCommands();
+  
+  // Handle repeat transmission if active
+  handleRepeatTransmission();
+}
+
+CaptureStats SnifferCore::captureStats() const {
+  return CaptureStats{framesReceived.get(), framesStored.get(), dedupHits.get(),
+                      framesDroppedQueue.get(), framesDroppedStorage.get(), transmissions.get()};
+}
+
+RepeaterStats SnifferCore::repeaterStats() const {
+  return RepeaterStats{repeats.get(), echoesSuppressed.get()};
+}
+
+FilterStats SnifferCore::filterStats() const {
+  return FilterStats{framesDenied.get(), framesNotAllowed.get()};
+}
+
+void SnifferCore::handleReceivedFrame(const RadioFrame& received) {
+  framesReceived.increment();
+#if RF_TRACE_ENABLED
+  uint32_t frame = nextTraceFrame++;
+#else
+  uint32_t frame = 0;
+#endif
+  TRACE(frame, TRACE_DECODE, 0);
+  
+  // Our own transmission heard back: neither a capture nor something to repeat
+  uint64_t key = signalKey(received.value, received.bitLength, received.protocol);
+  if (isEcho(key)) {
+    echoesSuppressed.increment();
+    RF_LOGD(LOG_ECHO_SUPPRESSED);
+    return;
+  }
+  
+  // Counted before filtering and dedup, which hide most of the traffic around
+  frameAnalytics.record(key, received.protocol, time.millis());
+  
+  // Unwanted traffic stops here, before it costs a queue slot, heap or flash
+  int filterRule;
+  if (!filterSet->admit(received, filterRule)) {
+    (filterRule >= 0 ? framesDenied : framesNotAllowed).increment();
+    RF_LOGD(LOG_FILTERED);
+    return;
+  }
+  
+  // Repeat before anything else; storing the capture can wait
+  bool repeated = repeater && repeaterSet.count(key) > 0;
+  if (repeated) {
+    transmitFrame(received);
+    repeats.increment();
+    RF_LOGI(LOG_REPEATED, received.value, received.bitLength, received.protocol);
+  } else {
+    RF_LOGI(LOG_RECEIVED, received.value, received.bitLength, received.protocol);
+  }
+  
+  // Re-encoded for a receiver that speaks another protocol, just as urgent
+  const Translation* translation = translationSet->match(received);
+  if (translation) {
+    RadioFrame translated = translateFrame(*translation, received.value);
+    transmitFrame(translated);
+    translationsSent.increment();
+    RF_LOGI(LOG_TRANSLATED, translation->id, translated.value, translated.bitLength, translated.protocol);
+  }
+  
+  // Hand the frame to the owner pipeline
+  Command capture(CMD_CAPTURE);
+  capture.value = received.value;
+  capture.bitLength = received.bitLength;
+  capture.protocol = received.protocol;
+  capture.trace = frame;
+  if (!commandQueue.post(capture, true)) {
+    framesDroppedQueue.increment();
+    TRACE(frame, TRACE_DEDUP, TRACE_DROPPED);
+    RF_LOGW(LOG_QUEUE_FULL);
+  }
+}
+
+void SnifferCore::processCommands() {
+  std::deque<Command> batch = commandQueue.takeBatch();
+  if (batch.empty()) {
+    commandQueue.batchFinished(0);
+    return;
+  }
+  
+  std::vector<CommandResult> results;
+  results.reserve(batch.size());
+  for (const auto& command : batch) {
+    results.push_back(executeCommand(command));
+  }
+  
+  // One persistence pass and one snapshot for the whole batch
+  if (signalsDirty) {
+    uint32_t saveStarted = time.micros();
+    saveStoredSignals();
+    saveDuration.observe(time.micros() - saveStarted);
+    signalsDirty = false;
+  }
+#if RF_TRACE_ENABLED
+  for (const auto& command : batch) {
+    TRACE(command.trace, TRACE_COMMIT, 0);
+  }
+#endif
+  signalStore.publish();
+  
+  for (size_t i = 0; i < batch.size(); i++) {
+    commandQueue.complete(batch[i], results[i]);
+  }
+  commandQueue.batchFinished(batch.size());
+#if RF_TRACE_ENABLED
+  for (const auto& command : batch) {
+    TRACE(command.trace, TRACE_NOTIFY, 0);
+  }
+#endif
+  
+  // Push notifications go before the buzzer, which can hold the task
+  for (const CaptureEvent& event : pendingCaptures) {
+    captureListener(event);
+  }
+  pendingCaptures.clear();
+  for (const RuleEvent& event : pendingRuleEvents) {
+    ruleListener(event);
+  }
+  pendingRuleEvents.clear();
+  
+  // Provide feedback once replies are out
+  if (receiveFeedbackPending) {
+    receiveFeedbackPending = false;
+    if (buzzer) {
+      feedback.playReceiveSound();
+    }
+    if (led) {
+      feedback.flashLED(100, 3);
+    }
+  }
+}
+
+void SnifferCore::storeCapturedSignal(const Command& command) {
+  // Create new signal
+  RFSignal newSignal;
+  newSignal.value = command.value;
+  newSignal.bitLength = command.bitLength;
+  newSignal.protocol = command.protocol;
+  newSignal.timestamp = time.millis();
+  newSignal.uid = signalCount;
+  newSignal.name = "Signal_" + String(signalCount++);
+  newSignal.isFavorite = false;
+  
+  // Add to storage if not duplicate and under limit
+  if (!isDuplicate(newSignal)) {
+    // Check if we need to do cleanup
+    if (signalStore.size() >= (size_t)cleanupThreshold) {
+      performAutoCleanup();
+    }
+  
+    // Add the signal if there's still space
+    if (signalStore.size() < (size_t)maxSignals) {
+      signalStore.add(newSignal);
+      signalsDirty = true;
+      framesStored.increment();
+      TRACE(command.trace, TRACE_DEDUP, TRACE_NEW);
+      if (captureListener) {
+        pendingCaptures.push_back(CaptureEvent{newSignal, true});
+      }
+  
+      RF_LOGI(LOG_STORED, signalStore.size(), maxSignals);
+    } else {
+      framesDroppedStorage.increment();
+      TRACE(command.trace, TRACE_DEDUP, TRACE_DROPPED);
+      RF_LOGW(LOG_STORAGE_FULL);
+    }
+  } else {
+    TRACE(command.trace, TRACE_DEDUP, TRACE_DUPLICATE);
+    RF_LOGD(LOG_DUPLICATE_IGNORED);
+    if (captureListener) {
+      pendingCaptures.push_back(CaptureEvent{signalStore.at(signalStore.find(signalKey(newSignal))), false});
+    }
+  }
+  
+  runRules(newSignal);
+  
+  // The buzzer holds loop() for half a second, longer than the repeater's budget
+  receiveFeedbackPending = !repeater;
+  lastSignal = time.millis();
+}
+
+// Runs on the owner task only: the capture's rules, in id order
+void SnifferCore::runRules(const RFSignal& captured) {
+  size_t count;
+  const RuleTable::Step* steps = ruleSet->match(signalKey(captured), count);
+  if (count == 0) {
+    return;
+  }
+  
+  int position = signalStore.find(signalKey(captured));
+  for (size_t i = 0; i < count; i++) {
+    const RuleTable::Step& step = steps[i];
+    switch (step.action) {
+      case RULE_TRANSMIT:
+        transmitFrame(frameOf(step.target));
+        break;
+      case RULE_PUSH:
+        if (ruleListener) {
+          pendingRuleEvents.push_back(RuleEvent{step.rule, position >= 0 ? signalStore.at(position) : captured});
+        }
+        break;
+      case RULE_FAVORITE:
+        if (position >= 0 && !signalStore.at(position).isFavorite) {
+          RFSignal updated = signalStore.at(position);
+          updated.isFavorite = true;
+          signalStore.replace(position, updated);
+          signalsDirty = true;
+        }
+        break;
+      default:
+        break;
+    }
+    rulesFiredTotal.increment();
+    RF_LOGI(LOG_RULE_FIRED, step.rule, step.action);
+  }
+}
+
+// Runs on the owner task only
+CommandResult SnifferCore::executeCommand(const Command& command) {
+  // Signals are named by uid: where they sit now, not when the command was queued
+  int index = command.id >= 0 ? signalStore.positionOf(command.id) : -1;
+  bool validId = index >= 0;
+  
+  switch (command.type) {
+    case CMD_CAPTURE:
+      TRACE(command.trace, TRACE_DEQUEUE, 0);
+      storeCapturedSignal(command);
+      return CommandResult{200, "Signal captured"};
+  
+    case CMD_SET_SNIFFING:
+      sniffing = command.flag;
+      storage.putBool("sniffingEnabled", command.flag);  // Save to preferences
+      return CommandResult{200, command.flag ? "Sniffing enabled" : "Sniffing disabled"};
+  
+    case CMD_SET_BUZZER:
+      buzzer = command.flag;
+      storage.putBool("buzzerEnabled", command.flag);  // Save to preferences
+      return CommandResult{200, command.flag ? "Buzzer enabled" : "Buzzer disabled"};
+  
+    case CMD_SET_LED:
+      led = command.flag;
+      storage.putBool("ledEnabled", command.flag);  // Save to preferences
+      return CommandResult{200, command.flag ? "LED enabled" : "LED disabled"};
+  
+    case CMD_TRANSMIT:
+      if (!validId) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      txJobs.increment();
+      transmitSignal(signalStore.at(index), true);
+      return CommandResult{200, "Signal transmitted"};
+  
+    case CMD_REPEAT_TRANSMIT:
+      if (!validId || command.count < 1 || command.count > 100) {
+        return CommandResult{400, "Invalid signal ID or count (1-100)"};
+      }
+      if (repeatTransmissionActive) {
+        return CommandResult{400, "Repeat transmission already in progress"};
+      }
+      txJobs.increment();
+      RF_LOGI(LOG_REPEAT_STARTED, command.count);
+      startRepeatTransmission(signalStore.at(index), command.count);
+      return CommandResult{200, "Repeat transmission started for " + String(command.count) + " times"};
+  
+    case CMD_DELETE_SIGNAL:
+      if (!validId) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      signalStore.erase(index);
+      signalsDirty = true;
+      return CommandResult{200, "Signal deleted"};
+  
+    case CMD_RENAME_SIGNAL: {
+      if (!validId) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      RFSignal updated = signalStore.at(index);
+      updated.name = command.text;
+      signalStore.replace(index, updated);
+      signalsDirty = true;
+      return CommandResult{200, "Signal renamed"};
+    }
+  
+    case CMD_SET_FAVORITE: {
+      if (!validId) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      RFSignal updated = signalStore.at(index);
+      updated.isFavorite = command.flag;
+      signalStore.replace(index, updated);
+      signalsDirty = true;
+      return CommandResult{200, command.flag ? "Signal marked as favorite" : "Signal unmarked as favorite"};
+    }
+  
+    case CMD_CLEAR_SIGNALS:
+      signalStore.clear();
+      // signalCount keeps counting so that a cleared uid never names a new signal
+      signalsDirty = true;
+      return CommandResult{200, "All signals cleared"};
+  
+    case CMD_CLEANUP: {
+      int originalCount = signalStore.size();
+      performAutoCleanup();
+      int removedCount = originalCount - signalStore.size();
+      return CommandResult{200, "Cleanup complete: Removed " + String(removedCount) + " signals"};
+    }
+  
+    case CMD_CLEANUP_OLD: {
+      // Remove signals older than specified days
+      int daysOld = command.count;
+      // Timestamps are millis() since boot: nothing is older than the uptime
+      unsigned long now = time.millis();
+      uint64_t maxAgeMs = (uint64_t)daysOld * 24 * 60 * 60 * 1000;
+      int removedCount = 0;
+      if (daysOld >= 0 && maxAgeMs <= now) {
+        unsigned long cutoffTime = now - maxAgeMs;
+        removedCount = signalStore.removeIf([cutoffTime](const RFSignal& signal) {
+          return !signal.isFavorite && signal.timestamp < cutoffTime;
+        });
+      }
+      signalsDirty |= removedCount > 0;
+      return CommandResult{200, "Removed " + String(removedCount) + " signals older than " + String(daysOld) + " days"};
+    }
+  
+    case CMD_TAG_SIGNAL:
+      if (!validId) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      if (!SignalTags::validName(command.text)) {
+        return CommandResult{400, "Invalid tag name (1-15 letters, digits, _ or -)"};
+      }
+      if (!signalStore.tagSignal(index, command.text)) {
+        return CommandResult{400, "Too many tags (max " + String(SignalTags::MAX_TAGS) + ")"};
+      }
+      signalsDirty = true;
+      return CommandResult{200, "Signal tagged"};
+  
+    case CMD_UNTAG_SIGNAL:
+      if (!validId) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      signalStore.untagSignal(index, command.text);
+      signalsDirty = true;
+      return CommandResult{200, "Tag removed from signal"};
+  
+    case CMD_DELETE_TAG:
+      if (!signalStore.deleteTag(command.text)) {
+        return CommandResult{404, "Unknown tag"};
+      }
+      signalsDirty = true;
+      return CommandResult{200, "Tag deleted"};
+  
+    case CMD_IMPORT:
+      return importSignals(*std::static_pointer_cast<SignalImporter>(command.payload));
+  
+    case CMD_SET_REPEATER:
+      repeater = command.flag;
+      storage.putBool("repeaterEnabled", command.flag);  // Save to preferences
+      return CommandResult{200, command.flag ? "Repeater enabled" : "Repeater disabled"};
+  
+    case CMD_REPEATER_CODE:
+      if (!validId) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      return setRepeaterCode(index, command.flag);
+  
+    case CMD_ADD_RULE: {
+      int target = command.target >= 0 ? signalStore.positionOf(command.target) : -1;
+      if (!validId || (command.target >= 0 && target < 0)) {
+        return CommandResult{400, "Invalid signal ID"};
+      }
+      return addRule(command, index, target);
+    }
+  
+    case CMD_DELETE_RULE:
+      return deleteRule(command.id);
+  
+    case CMD_ADD_TRANSLATION:
+      return addTranslation(*std::static_pointer_cast<Translation>(command.payload));
+  
+    case CMD_DELETE_TRANSLATION:
+      return deleteTranslation(command.id);
+  
+    case CMD_ADD_FILTER:
+      return addFilter(*std::static_pointer_cast<FilterRule>(command.payload));
+  
+    case CMD_DELETE_FILTER:
+      return deleteFilter(command.id);
+  
+    case CMD_SET_ANALYTICS_WINDOW:
+      if (command.value > MAX_ANALYTICS_WINDOW_S) {
+        return CommandResult{400, "Invalid window (0-" + String(MAX_ANALYTICS_WINDOW_S) + " seconds)"};
+      }
+      frameAnalytics.setWindow(command.value * 1000, time.millis());
+      storage.putULong("analyticsWindow", command.value);  // Save to preferences
+      return CommandResult{200, "Analytics window set to " + String(command.value) + " seconds"};
+  
+    case CMD_RESET_ANALYTICS:
+      frameAnalytics.reset(time.millis());
+      return CommandResult{200, "Analytics reset"};
+  }
+  
+  return CommandResult{400, "Unknown command"};
+}
+
+void SnifferCore::transmitSignal(const RFSignal& signal, bool withFeedback) {
+  RF_LOGI(LOG_TRANSMITTING, signal.value, signal.bitLength, signal.protocol);
+  
+  transmitFrame(RadioFrame{signal.value, signal.bitLength, signal.protocol});
+  
+  // Provide feedback only if requested
+  if (withFeedback) {
+    if (buzzer) {
+      feedback.playTransmitSound();
+    }
+    if (led) {
+      feedback.flashLED(200, 2);
+    }
+  }
+}
+
+// Every transmission goes through here so its echo can be recognised
+void SnifferCore::transmitFrame(const RadioFrame& frame) {
+  radio.transmit(frame);
+  transmissions.increment();
+  recentTransmits[nextTransmitSlot] = RecentTransmit{signalKey(frame.value, frame.bitLength, frame.protocol), time.millis()};
+  nextTransmitSlot = (nextTransmitSlot + 1) % ECHO_SLOTS;
+}
+
+bool SnifferCore::isEcho(uint64_t key) {
+  unsigned long now = time.millis();
+  for (const RecentTransmit& sent : recentTransmits) {
+    if (sent.key == key && now - sent.end < ECHO_HOLDOFF_MS) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Runs on the owner task only; trigger (and target, -1 for none) are library positions
+CommandResult SnifferCore::addRule(const Command& command, int trigger, int target) {
+  RuleAction action;
+  if (!parseRuleAction(command.text, action)) {
+    return CommandResult{400, "Invalid action (transmit, push or favorite)"};
+  }
+  if ((action == RULE_TRANSMIT) != (target >= 0)) {
+    return CommandResult{400, "Transmit rules take a target, other actions none"};
+  }
+  if (ruleSet->rules().size() >= RuleTable::MAX_RULES) {
+    return CommandResult{400, "Too many rules (max " + String((unsigned long)RuleTable::MAX_RULES) + ")"};
+  }
+  
+  Rule rule;
+  rule.id = nextRuleId++;
+  rule.trigger = signalKey(signalStore.at(trigger));
+  rule.action = action;
+  rule.target = target >= 0 ? signalKey(signalStore.at(target)) : 0;
+  std::vector<Rule> rules = ruleSet->rules();
+  rules.push_back(rule);
+  publishRules(rules, true);
+  return CommandResult{200, "Rule " + String(rule.id) + " added"};
+}
+
+// Runs on the owner task only
+CommandResult SnifferCore::deleteRule(uint32_t id) {
+  std::vector<Rule> rules = ruleSet->rules();
+  auto rule = std::find_if(rules.begin(), rules.end(), [id](const Rule& r) { return r.id == id; });
+  if (rule == rules.end()) {
+    return CommandResult{404, "Unknown rule"};
+  }
+  rules.erase(rule);
+  publishRules(rules, true);
+  return CommandResult{200, "Rule deleted"};
+}
+
+// Compiles the rules for the owner and the API, and for Preferences when persist is set
+void SnifferCore::publishRules(const std::vector<Rule>& rules, bool persist) {
+  RuleSet compiled = std::make_shared<RuleTable>(rules);
+  if (persist) {
+    saveRules(storage, *compiled);
+  }
+  std::atomic_store(&ruleSet, compiled);
+}
+
+// Runs on the owner task only; the API has parsed and validated it
+CommandResult SnifferCore::addTranslation(const Translation& translation) {
+  String error;
+  if (translationSet->translations().size() >= TranslationTable::MAX_TRANSLATIONS) {
+    return CommandResult{400, "Too many translations (max " + String((unsigned long)TranslationTable::MAX_TRANSLATIONS) + ")"};
+  }
+  if (translationSet->conflicts(translation, error)) {
+    return CommandResult{400, error};
+  }
+  
+  std::vector<Translation> translations = translationSet->translations();
+  translations.push_back(translation);
+  translations.back().id = nextTranslationId++;
+  publishTranslations(translations, true);
+  return CommandResult{200, "Translation " + String(translations.back().id) + " added"};
+}
+
+// Runs on the owner task only
+CommandResult SnifferCore::deleteTranslation(uint32_t id) {
+  std::vector<Translation> translations = translationSet->translations();
+  auto translation = std::find_if(translations.begin(), translations.end(),
+                                  [id](const Translation& t) { return t.id == id; });
+  if (translation == translations.end()) {
+    return CommandResult{404, "Unknown translation"};
+  }
+  translations.erase(translation);
+  publishTranslations(translations, true);
+  return CommandResult{200, "Translation deleted"};
+}
+
+// Compiles the translations for the owner and the API, and for Preferences when persist is set
+void SnifferCore::publishTranslations(const std::vector<Translation>& translations, bool persist) {
+  TranslationSet compiled = std::make_shared<TranslationTable>(translations);
+  if (persist) {
+    saveTranslations(storage, *compiled);
+  }
+  std::atomic_store(&translationSet, compiled);
+}
+
+// Runs on the owner task only; the API has parsed and validated it
+CommandResult SnifferCore::addFilter(const FilterRule& rule) {
+  if (filterSet->rules().size() >= FilterTable::MAX_FILTERS) {
+    return CommandResult{400, "Too many filters (max " + String((unsigned long)FilterTable::MAX_FILTERS) + ")"};
+  }
+  
+  std::vector<FilterRule> rules = filterSet->rules();
+  rules.push_back(rule);
+  rules.back().id = nextFilterId++;
+  publishFilters(rules, true);
+  return CommandResult{200, "Filter " + String(rules.back().id) + " added"};
+}
+
+// Runs on the owner task only
+CommandResult SnifferCore::deleteFilter(uint32_t id) {
+  std::vector<FilterRule> rules = filterSet->rules();
+  auto rule = std::find_if(rules.begin(), rules.end(), [id](const FilterRule& r) { return r.id == id; });
+  if (rule == rules.end()) {
+    return CommandResult{404, "Unknown filter"};
+  }
+  rules.erase(rule);
+  publishFilters(rules, true);
+  return CommandResult{200, "Filter deleted"};
+}
+
+// Compiles the filters for the owner and the API, and for Preferences when persist is set
+void SnifferCore::publishFilters(const std::vector<FilterRule>& rules, bool persist) {
+  std::shared_ptr<FilterTable> compiled = std::make_shared<FilterTable>(rules);
+  compiled->carryMatches(*filterSet);
+  if (persist) {
+    saveFilters(storage, *compiled);
+  }
+  std::atomic_store(&filterSet, FilterSet(compiled));
+}
+
+// Runs on the owner task only
+CommandResult SnifferCore::setRepeaterCode(int index, bool enabled) {
+  uint64_t key = signalKey(signalStore.at(index));
+  if (!enabled) {
+    if (repeaterSet.erase(key) == 0) {
+      return CommandResult{404, "Signal is not repeated"};
+    }
+    publishRepeaterCodes(true);
+    return CommandResult{200, "Signal removed from the repeater"};
+  }
+  if (repeaterSet.count(key) > 0) {
+    return CommandResult{200, "Signal already repeated"};
+  }
+  if (repeaterSet.size() >= (size_t)MAX_REPEATER_CODES) {
+    return CommandResult{400, "Too many repeated signals (max " + String(MAX_REPEATER_CODES) + ")"};
+  }
+  repeaterSet.insert(key);
+  publishRepeaterCodes(true);
+  return CommandResult{200, "Signal added to the repeater"};
+}
+
+// Sorted copy for the API, and for Preferences when persist is set
+void SnifferCore::publishRepeaterCodes(bool persist) {
+  std::shared_ptr<std::vector<uint64_t>> codes = std::make_shared<std::vector<uint64_t>>(
+    repeaterSet.begin(), repeaterSet.end());
+  std::sort(codes->begin(), codes->end());
+  if (persist) {
+    // Preferences won't store zero bytes; key 0 (value 0) never decodes, so it marks an empty list
+    uint64_t none = 0;
+    storage.putBytes("repeaterCodes", codes->empty() ? &none : (const void*)codes->data(),
+                     std::max<size_t>(codes->size(), 1) * sizeof(uint64_t));
+  }
+  std::atomic_store(&publishedRepeaterCodes, RepeaterCodes(codes));
+}
+
+// Adds an uploaded library in one batch; runs on the owner task only
+CommandResult SnifferCore::importSignals(SignalImporter& importer) {
+  // Dedup against the library and within the upload itself
+  std::unordered_set<uint64_t> known;
+  known.reserve(signalStore.size() + importer.records().size());
+  for (size_t i = 0; i < signalStore.size(); i++) {
+    known.insert(signalKey(signalStore.at(i)));
+  }
+  
+  int added = 0;
+  int duplicates = 0;
+  int skipped = 0;
+  for (const auto& imported : importer.records()) {
+    if (!known.insert(signalKey(imported.signal)).second) {
+      duplicates++;
+      continue;
+    }
+    if (signalStore.size() >= (size_t)maxSignals) {
+      skipped++;
+      continue;
+    }
+  
+    RFSignal signal = imported.signal;
+    signal.uid = signalCount++;  // Uids from another device may clash with ours
+    if (signal.name.length() == 0) {
+      signal.name = "Signal_" + String(signal.uid);
+    }
+    signalStore.add(signal);
+    for (const auto& tag : imported.tags) {
+      if (SignalTags::validName(tag)) {
+        signalStore.tagSignal(signalStore.size() - 1, tag);
+      }
+    }
+    added++;
+  }
+  
+  signalsDirty |= added > 0;
+  importAdded = added;
+  importDuplicates = duplicates;
+  String message = "Imported " + String(added) + " signals (" + String(duplicates) +
+                   " duplicates, " + String(skipped) + " over capacity)";
+  RF_LOGI(LOG_IMPORTED, added, duplicates, skipped);
+  return CommandResult{200, message};
+}
+
+// Runs on the owner task only
+bool SnifferCore::isDuplicate(const RFSignal& newSignal) {
+  int position = signalStore.find(signalKey(newSignal));
+  if (position < 0) {
+    return false;
+  }
+  
+  // Update timestamp to show it was received again
+  RFSignal updated = signalStore.at(position);
+  updated.timestamp = newSignal.timestamp;
+  signalStore.replace(position, updated);
+  signalsDirty = true;  // Save the updated timestamp
+  dedupHits.increment();
+  RF_LOGD(LOG_DUPLICATE_UPDATED);
+  return true;
+}
+
+// Runs on the owner task only
+void SnifferCore::performAutoCleanup() {
+  RF_LOGI(LOG_CLEANUP_STARTED);
+  
+  // Remove the oldest 20% of capacity, never favorites
+  int removedCount = signalStore.evictOldest(maxSignals * 0.2);
+  
+  RF_LOGI(LOG_CLEANUP_DONE, removedCount, signalStore.size(), maxSignals);
+  
+  // Save the cleaned up signals
+  signalsDirty = true;
+}
+
+// Runs on the owner task only
+void SnifferCore::saveStoredSignals() {
+  saveSignals(storage, signalStore, signalCount);
+}
+
+// Non-blocking repeat transmission functions
+void SnifferCore::startRepeatTransmission(const RFSignal& signal, int count) {
+  if (!repeatTransmissionActive) {
+    repeatTransmissionActive = true;
+    repeatCount = count;
+    currentRepeatIndex = 0;
+    repeatSignal = signal;
+  
+    // Transmit the first signal immediately without feedback for speed
+    transmitSignal(repeatSignal, false);
+    currentRepeatIndex++;
+    RF_LOGD(LOG_REPEAT_PROGRESS, currentRepeatIndex, repeatCount);
+  }
+}
+
+void SnifferCore::handleRepeatTransmission() {
+  if (repeatTransmissionActive) {
+    // Since there's no delay, transmit all remaining signals immediately without feedback
+    while (currentRepeatIndex < repeatCount) {
+      transmitSignal(repeatSignal, false); // No audio/visual feedback for speed
+      currentRepeatIndex++;
+      RF_LOGD(LOG_REPEAT_PROGRESS, currentRepeatIndex, repeatCount);
+    }
+  
+    // All transmissions complete - provide feedback only at the end
+    RF_LOGI(LOG_REPEAT_DONE, repeatCount);
+    if (buzzer) {
+      feedback.playTransmitSound();
+    }
+    if (led) {
+      feedback.flashLED(200, 1);
+    }
+    repeatTransmissionActive = false;
+  }
+}
+
+#if RF_TRACE_ENABLED
+// Records one pipeline stage; its own cost is exported as a metric
+void SnifferCore::traceStage(uint32_t frame, TraceStage stage, uint8_t arg) {
+  if (frame == 0) {
+    return;
+  }
+  uint32_t started = time.cycles();
+  traceRing.record(frame, stage, arg, time.micros());
+  traceCycles.increment(time.cycles() - started);
+}
+#endif
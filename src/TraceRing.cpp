@@ -0,0 +1,100 @@
+#include "TraceRing.h"
+
+#include <algorithm>
+
+static const char* STAGE_NAMES[] = {"decode", "queued", "dedup", "commit", "notify"};
+static const char* DEDUP_NAMES[] = {"new", "duplicate", "dropped"};
+
+TraceRing::TraceRing() : head(0) {
+  for (auto& slot : slots) {
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.frame.store(0, std::memory_order_relaxed);
+    slot.timestampUs.store(0, std::memory_order_relaxed);
+    slot.stageArg.store(0, std::memory_order_relaxed);
+  }
+}
+
+void TraceRing::record(uint32_t frame, TraceStage stage, uint8_t arg, uint32_t timestampUs) {
+  uint32_t position = head.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots[position % CAPACITY];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.frame.store(frame, std::memory_order_relaxed);
+  slot.timestampUs.store(timestampUs, std::memory_order_relaxed);
+  slot.stageArg.store(((uint32_t)stage << 8) | arg, std::memory_order_relaxed);
+  slot.sequence.store(position + 1, std::memory_order_release);
+}
+
+void TraceRing::snapshot(std::vector<TraceEvent>& events) const {
+  uint32_t end = head.load(std::memory_order_acquire);
+  uint32_t begin = end > CAPACITY ? end - CAPACITY : 0;
+  events.clear();
+  events.reserve(end - begin);
+  for (uint32_t position = begin; position < end; position++) {
+    const Slot& slot = slots[position % CAPACITY];
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+      continue;  // Still being written or already reused
+    }
+    TraceEvent event;
+    event.frame = slot.frame.load(std::memory_order_relaxed);
+    event.timestampUs = slot.timestampUs.load(std::memory_order_relaxed);
+    uint32_t stageArg = slot.stageArg.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != position + 1) {
+      continue;
+    }
+    event.stage = (TraceStage)(stageArg >> 8);
+    event.arg = stageArg & 0xFF;
+    events.push_back(event);
+  }
+}
+
+String renderChromeTrace(std::vector<TraceEvent>& events, uint32_t overheadCycles) {
+  // Group by frame; stable so stages recorded at the same micros() keep order
+  std::stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+    return a.frame < b.frame;
+  });
+  
+  String json;
+  json.reserve(64 + events.size() * 96);
+  json += "{\"traceEvents\":[";
+  bool first = true;
+  for (size_t i = 0; i < events.size(); i++) {
+    const TraceEvent& event = events[i];
+    bool frameStart = i == 0 || events[i - 1].frame != event.frame;
+    if (event.stage >= sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0])) {
+      continue;
+    }
+    
+    if (!first) json += ",";
+    first = false;
+    json += "{\"name\":\"";
+    json += STAGE_NAMES[event.stage];
+    json += "\",\"cat\":\"capture\",\"pid\":1,\"tid\":";
+    json += String(event.frame);
+    if (frameStart) {
+      // First retained stage of a frame is an instant
+      json += ",\"ph\":\"i\",\"s\":\"t\",\"ts\":";
+      json += String(event.timestampUs);
+    } else {
+      // Later stages span from the previous one
+      uint32_t since = events[i - 1].timestampUs;
+      json += ",\"ph\":\"X\",\"ts\":";
+      json += String(since);
+      json += ",\"dur\":";
+      json += String(event.timestampUs - since);
+    }
+    if (event.stage == TRACE_DEDUP && event.arg < sizeof(DEDUP_NAMES) / sizeof(DEDUP_NAMES[0])) {
+      json += ",\"args\":{\"result\":\"";
+      json += DEDUP_NAMES[event.arg];
+      json += "\"}";
+    }
+    json += "}";
+  }
+  json += "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"events\":";
+  json += String((unsigned long)events.size());
+  json += ",\"overheadCycles\":";
+  json += String(overheadCycles);
+  json += "}}";
+  return json;
+}
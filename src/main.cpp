@@ -6,6 +6,14 @@
 #include <RCSwitch.h>
 #include <SPIFFS.h>
 #include <Preferences.h>
+#include <esp_heap_caps.h>
+
+#include "Hal.h"
+#include "LogRing.h"
+#include "Metrics.h"
+#include "Profiler.h"
+#include "SnifferApi.h"
+#include "SnifferCore.h"
 
 // Pin definitions
 #define RF_TRANSMITTER_PIN 2
@@ -20,57 +28,154 @@ RCSwitch receiver = RCSwitch();
 // Web server
 AsyncWebServer server(80);
 
+// Server-sent events: captures reach open dashboards without waiting for a poll
+AsyncEventSource events("/api/events");
+
 // Preferences for storing signals
 Preferences preferences;
 
-// Global variables
-bool sniffingEnabled = false;
-bool buzzerEnabled = true;
-bool ledEnabled = true;
-unsigned long lastSignalTime = 0;
-int signalCount = 0;
+// ESP32 implementations of the core's hardware interfaces
+class RCSwitchRadio : public Radio {
+public:
+  bool receive(RadioFrame& frame) override {
+    if (!receiver.available()) {
+      return false;
+    }
+    frame.value = receiver.getReceivedValue();
+    frame.bitLength = receiver.getReceivedBitlength();
+    frame.protocol = receiver.getReceivedProtocol();
+    receiver.resetAvailable();
+    return frame.value != 0;
+  }
 
-// Signal storage structure
-struct RFSignal {
-  String name;
-  unsigned long value;
-  unsigned int bitLength;
-  unsigned int protocol;
-  unsigned long timestamp;
-  bool isFavorite;
+  void transmit(const RadioFrame& frame) override {
+    mySwitch.setProtocol(frame.protocol);
+    mySwitch.send(frame.value, frame.bitLength);
+  }
 };
 
-// Repeat transmission variables (after struct definition)
-bool repeatTransmissionActive = false;
-int repeatCount = 0;
-int currentRepeatIndex = 0;
-RFSignal repeatSignal;
-unsigned long lastRepeatTime = 0;
-const unsigned long REPEAT_DELAY = 0; // No delay between transmissions
+class PreferencesStore : public KeyValueStore {
+public:
+  int getInt(const char* key, int fallback) override { return preferences.getInt(key, fallback); }
+  void putInt(const char* key, int value) override { preferences.putInt(key, value); }
+  unsigned int getUInt(const char* key, unsigned int fallback) override { return preferences.getUInt(key, fallback); }
+  void putUInt(const char* key, unsigned int value) override { preferences.putUInt(key, value); }
+  unsigned long getULong(const char* key, unsigned long fallback) override { return preferences.getULong(key, fallback); }
+  void putULong(const char* key, unsigned long value) override { preferences.putULong(key, value); }
+  bool getBool(const char* key, bool fallback) override { return preferences.getBool(key, fallback); }
+  void putBool(const char* key, bool value) override { preferences.putBool(key, value); }
+  String getString(const char* key, const String& fallback) override { return preferences.getString(key, fallback); }
+  void putString(const char* key, const String& value) override { preferences.putString(key, value); }
+  size_t getBytesLength(const char* key) override { return preferences.getBytesLength(key); }
+  size_t getBytes(const char* key, void* buffer, size_t maxLength) override { return preferences.getBytes(key, buffer, maxLength); }
+  void putBytes(const char* key, const void* data, size_t length) override { preferences.putBytes(key, data, length); }
+};
 
-// In-memory signal storage (will be persisted to preferences)
-std::vector<RFSignal> storedSignals;
-const int MAX_SIGNALS = 1000;  // Increased to 1000 signals
-const int AUTO_CLEANUP_THRESHOLD = 950;  // Start cleanup when reaching 95% capacity
+class ArduinoClock : public Clock {
+public:
+  unsigned long millis() override { return ::millis(); }
+  unsigned long micros() override { return ::micros(); }
+  uint32_t cycles() override { return ESP.getCycleCount(); }
+};
+
+class BuzzerFeedback : public Feedback {
+public:
+  void playReceiveSound() override {
+    ledcWriteTone(0, 1000);
+    delay(100);
+    ledcWriteTone(0, 0);
+    delay(20);
+    ledcWriteTone(0, 1500);
+    delay(100);
+    ledcWriteTone(0, 0);
+  }
+
+  void playTransmitSound() override {
+    ledcWriteTone(0, 2000);
+    delay(150);
+    ledcWriteTone(0, 0);
+    delay(20);
+    ledcWriteTone(0, 1500);
+    delay(150);
+    ledcWriteTone(0, 0);
+  }
+
+  void playStartupSound() override {
+    for (int i = 0; i < 3; i++) {
+      ledcWriteTone(0, 800 + i * 200);
+      delay(200);
+      ledcWriteTone(0, 0);
+      delay(50);
+    }
+  }
+
+  void flashLED(int duration, int times) override {
+    for (int i = 0; i < times; i++) {
+      digitalWrite(LED_BUILTIN, HIGH);
+      delay(duration);
+      digitalWrite(LED_BUILTIN, LOW);
+      delay(duration);
+    }
+  }
+};
+
+RCSwitchRadio radio;
+PreferencesStore storage;
+ArduinoClock systemClock;
+BuzzerFeedback feedback;
+
+// Signal library and the owner task (loop) pipeline
+SnifferCore core(radio, storage, systemClock, feedback);
+
+// REST API with admission control - keeps HTTP load from crowding out the RF path
+SnifferApi api(core, AdmissionLimits{
+  10.0f,  // requests/s per client
+  20.0f,  // burst
+  5.0f,   // transmits/s per client
+  10.0f,  // transmit burst
+  4.0f,   // tokens per expensive request
+  2       // expensive requests in flight
+});
+
+// CPU and loop profile, sampled once a second by loop()
+Profiler profiler;
+
+// Device health for /metrics
+SampledMetric heapFree("heap_free_bytes", "Free heap",
+  Metric::GAUGE, []() { return (double)ESP.getFreeHeap(); });
+SampledMetric heapLargestBlock("heap_largest_free_block_bytes", "Largest allocatable heap block",
+  Metric::GAUGE, []() { return (double)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); });
+TaskHandle_t loopTask = nullptr;
+SampledMetric loopStackFree("task_stack_free_min_bytes", "Lowest free stack seen per task",
+  Metric::GAUGE, []() { return loopTask ? (double)uxTaskGetStackHighWaterMark(loopTask) : 0.0; },
+  "task=\"loop\"");
+SampledMetric asyncStackFree("task_stack_free_min_bytes", "Lowest free stack seen per task",
+  Metric::GAUGE, []() {
+    TaskHandle_t task = xTaskGetHandle("async_tcp");
+    return task ? (double)uxTaskGetStackHighWaterMark(task) : 0.0;
+  }, "task=\"async_tcp\"");
+TaskHandle_t logTask = nullptr;
+SampledMetric logStackFree("task_stack_free_min_bytes", "Lowest free stack seen per task",
+  Metric::GAUGE, []() { return logTask ? (double)uxTaskGetStackHighWaterMark(logTask) : 0.0; },
+  "task=\"log_drain\"");
+SampledMetric loopRate("loop_iterations_per_second", "loop() passes per second over the last 10 s",
+  Metric::GAUGE, []() { return (double)profiler.snapshot()->loopRate[WINDOW_10S]; });
+SampledMetric loopBusy("loop_busy_percent", "Share of time loop() spends working over the last 10 s",
+  Metric::GAUGE, []() { return (double)profiler.snapshot()->loopBusyPercent[WINDOW_10S]; });
 
 // Function declarations
-void handleReceivedSignal();
-void transmitSignal(const RFSignal& signal);
-void transmitSignal(const RFSignal& signal, bool withFeedback);
-bool isDuplicate(const RFSignal& newSignal);
-void performAutoCleanup();
-void playReceiveSound();
-void playTransmitSound();
-void playStartupSound();
-void flashLED(int duration, int times);
-void loadStoredSignals();
-void saveStoredSignals();
 void setupWebServer();
-void handleRepeatTransmission();
-void startRepeatTransmission(const RFSignal& signal, int count);
+void logDrainTask(void* parameter);
+ApiResponse profileResponse();
+ApiRequest toApiRequest(AsyncWebServerRequest *request, HttpMethod method, const char* path);
+void sendApiResponse(AsyncWebServerRequest *request, const ApiResponse& response);
 
 void setup() {
   Serial.begin(115200);
+  loopTask = xTaskGetCurrentTaskHandle();
+  
+  // Log entries are printed at idle priority, on loop()'s core, whenever it waits
+  xTaskCreatePinnedToCore(logDrainTask, "log_drain", 3072, nullptr, tskIDLE_PRIORITY, &logTask, xPortGetCoreID());
   
   // Initialize pins
   pinMode(LED_BUILTIN, OUTPUT);
@@ -89,16 +194,6 @@ void setup() {
   // Initialize preferences
   preferences.begin("rf433", false);
   
-  // Load persistent settings
-  buzzerEnabled = preferences.getBool("buzzerEnabled", true);
-  ledEnabled = preferences.getBool("ledEnabled", true);
-  sniffingEnabled = preferences.getBool("sniffingEnabled", true);  // Auto-start sniffing by default
-  
-  Serial.println("Settings loaded:");
-  Serial.println("  Buzzer: " + String(buzzerEnabled ? "ON" : "OFF"));
-  Serial.println("  LED: " + String(ledEnabled ? "ON" : "OFF"));
-  Serial.println("  Sniffing: " + String(sniffingEnabled ? "ON" : "OFF"));
-  
   // Setup RF modules
   mySwitch.enableTransmit(RF_TRANSMITTER_PIN);
   receiver.enableReceive(digitalPinToInterrupt(RF_RECEIVER_PIN));
@@ -109,8 +204,18 @@ void setup() {
   Serial.print("AP IP address: ");
   Serial.println(IP);
   
-  // Load stored signals
-  loadStoredSignals();
+  // Load settings and stored signals
+  core.onCapture([](const CaptureEvent& event) {
+    if (events.count() > 0) {
+      events.send(SnifferApi::captureEventJson(event).c_str(), "capture", event.signal.uid);
+    }
+  });
+  core.onRule([](const RuleEvent& event) {
+    if (events.count() > 0) {
+      events.send(SnifferApi::ruleEventJson(event).c_str(), "rule");
+    }
+  });
+  core.begin();
   
   // Setup web server routes
   setupWebServer();
@@ -119,231 +224,34 @@ void setup() {
   server.begin();
   
   Serial.println("RF433 Sniffer ready!");
-  playStartupSound();
+  feedback.playStartupSound();
 }
 
 void loop() {
-  // Check for received RF signals
-  if (receiver.available() && sniffingEnabled) {
-    handleReceivedSignal();
-  }
-  
-  // Handle repeat transmission if active
-  handleRepeatTransmission();
-  
-  // Small delay to prevent watchdog issues
-  delay(10);
-}
-
-void handleReceivedSignal() {
-  unsigned long value = receiver.getReceivedValue();
-  unsigned int bitLength = receiver.getReceivedBitlength();
-  unsigned int protocol = receiver.getReceivedProtocol();
-  
-  if (value != 0) {
-    Serial.print("Received: ");
-    Serial.print(value);
-    Serial.print(" / ");
-    Serial.print(bitLength);
-    Serial.print("bit ");
-    Serial.print("Protocol: ");
-    Serial.println(protocol);
-    
-    // Create new signal
-    RFSignal newSignal;
-    newSignal.value = value;
-    newSignal.bitLength = bitLength;
-    newSignal.protocol = protocol;
-    newSignal.timestamp = millis();
-    newSignal.name = "Signal_" + String(signalCount++);
-    newSignal.isFavorite = false;
-    
-    // Add to storage if not duplicate and under limit
-    if (!isDuplicate(newSignal)) {
-      // Check if we need to do cleanup
-      if (storedSignals.size() >= AUTO_CLEANUP_THRESHOLD) {
-        performAutoCleanup();
-      }
-      
-      // Add the signal if there's still space
-      if (storedSignals.size() < MAX_SIGNALS) {
-        storedSignals.push_back(newSignal);
-        saveStoredSignals();
-        
-        Serial.println("Signal stored (" + String(storedSignals.size()) + "/" + String(MAX_SIGNALS) + ")");
-      } else {
-        Serial.println("Storage full! Signal not saved.");
-      }
-    } else {
-      Serial.println("Duplicate signal ignored.");
-    }
-    
-    // Provide feedback
-    if (buzzerEnabled) {
-      playReceiveSound();
-    }
-    if (ledEnabled) {
-      flashLED(100, 3);
-    }
-    
-    lastSignalTime = millis();
-  }
-  
-  receiver.resetAvailable();
-}
-
-void transmitSignal(const RFSignal& signal) {
-  transmitSignal(signal, true); // Default with feedback
-}
-
-void transmitSignal(const RFSignal& signal, bool withFeedback) {
-  Serial.print("Transmitting: ");
-  Serial.print(signal.value);
-  Serial.print(" / ");
-  Serial.print(signal.bitLength);
-  Serial.print("bit ");
-  Serial.print("Protocol: ");
-  Serial.println(signal.protocol);
+  uint32_t started = micros();
   
-  mySwitch.setProtocol(signal.protocol);
-  mySwitch.send(signal.value, signal.bitLength);
-  
-  // Provide feedback only if requested
-  if (withFeedback) {
-    if (buzzerEnabled) {
-      playTransmitSound();
-    }
-    if (ledEnabled) {
-      flashLED(200, 2);
-    }
-  }
-}
-
-bool isDuplicate(const RFSignal& newSignal) {
-  for (auto& signal : storedSignals) {
-    if (signal.value == newSignal.value && 
-        signal.bitLength == newSignal.bitLength &&
-        signal.protocol == newSignal.protocol) {
-      // Update timestamp to show it was received again
-      signal.timestamp = newSignal.timestamp;
-      saveStoredSignals();  // Save the updated timestamp
-      Serial.println("Duplicate signal detected - timestamp updated");
-      return true;
-    }
-  }
-  return false;
-}
-
-void performAutoCleanup() {
-  Serial.println("Storage nearly full, performing automatic cleanup...");
-  
-  // Sort signals by timestamp (oldest first)
-  std::sort(storedSignals.begin(), storedSignals.end(), 
-    [](const RFSignal& a, const RFSignal& b) {
-      // Keep favorites, sort others by timestamp
-      if (a.isFavorite && !b.isFavorite) return false;
-      if (!a.isFavorite && b.isFavorite) return true;
-      return a.timestamp < b.timestamp;
-    });
-  
-  // Calculate how many signals to remove (remove oldest 20% of non-favorites)
-  int signalsToRemove = MAX_SIGNALS * 0.2;  // Remove 20%
-  int removedCount = 0;
-  
-  // Remove oldest non-favorite signals
-  auto it = storedSignals.begin();
-  while (it != storedSignals.end() && removedCount < signalsToRemove) {
-    if (!it->isFavorite) {
-      it = storedSignals.erase(it);
-      removedCount++;
-    } else {
-      ++it;
-    }
-  }
+  // Received frames, queued state changes and repeat transmissions
+  core.poll();
   
-  Serial.println("Cleanup complete: Removed " + String(removedCount) + " old signals");
-  Serial.println("Storage now: " + String(storedSignals.size()) + "/" + String(MAX_SIGNALS));
+  profiler.loopIteration(micros() - started);
+  profiler.tick(millis());
   
-  // Save the cleaned up signals
-  saveStoredSignals();
-}
-
-void playReceiveSound() {
-  ledcWriteTone(0, 1000);
-  delay(100);
-  ledcWriteTone(0, 0);
-  delay(20);
-  ledcWriteTone(0, 1500);
-  delay(100);
-  ledcWriteTone(0, 0);
-}
-
-void playTransmitSound() {
-  ledcWriteTone(0, 2000);
-  delay(150);
-  ledcWriteTone(0, 0);
-  delay(20);
-  ledcWriteTone(0, 1500);
-  delay(150);
-  ledcWriteTone(0, 0);
-}
-
-void playStartupSound() {
-  for (int i = 0; i < 3; i++) {
-    ledcWriteTone(0, 800 + i * 200);
-    delay(200);
-    ledcWriteTone(0, 0);
-    delay(50);
-  }
+  // Wait for new commands (also yields to prevent watchdog issues); the
+  // repeater checks the receiver every millisecond to stay within budget
+  core.waitForWork(core.repeaterEnabled() ? SnifferCore::REPEATER_WAIT_MS : 10);
 }
 
-void flashLED(int duration, int times) {
-  for (int i = 0; i < times; i++) {
-    digitalWrite(LED_BUILTIN, HIGH);
-    delay(duration);
-    digitalWrite(LED_BUILTIN, LOW);
-    delay(duration);
-  }
-}
-
-void loadStoredSignals() {
-  // Load signals from preferences
-  int count = preferences.getInt("signalCount", 0);
-  signalCount = preferences.getInt("nextId", 0);
-  
-  for (int i = 0; i < count; i++) {
-    RFSignal signal;
-    String prefix = "sig" + String(i) + "_";
-    
-    signal.name = preferences.getString((prefix + "name").c_str(), "");
-    signal.value = preferences.getULong((prefix + "val").c_str(), 0);
-    signal.bitLength = preferences.getUInt((prefix + "bits").c_str(), 0);
-    signal.protocol = preferences.getUInt((prefix + "proto").c_str(), 0);
-    signal.timestamp = preferences.getULong((prefix + "time").c_str(), 0);
-    signal.isFavorite = preferences.getBool((prefix + "fav").c_str(), false);
-    
-    if (signal.value != 0) {
-      storedSignals.push_back(signal);
+void logDrainTask(void* parameter) {
+  char line[96];
+  for (;;) {
+    uint32_t lost = logRing.drain([&line](const LogEntry& entry) {
+      LogRing::format(entry, line, sizeof(line));
+      Serial.println(line);
+    }, 16);
+    if (lost) {
+      Serial.printf("(%u log entries lost)\n", lost);
     }
-  }
-  
-  Serial.println("Loaded " + String(storedSignals.size()) + " signals from storage");
-}
-
-void saveStoredSignals() {
-  preferences.putInt("signalCount", storedSignals.size());
-  preferences.putInt("nextId", signalCount);
-  
-  for (size_t i = 0; i < storedSignals.size(); i++) {
-    String prefix = "sig" + String(i) + "_";
-    const RFSignal& signal = storedSignals[i];
-    
-    preferences.putString((prefix + "name").c_str(), signal.name);
-    preferences.putULong((prefix + "val").c_str(), signal.value);
-    preferences.putUInt((prefix + "bits").c_str(), signal.bitLength);
-    preferences.putUInt((prefix + "proto").c_str(), signal.protocol);
-    preferences.putULong((prefix + "time").c_str(), signal.timestamp);
-    preferences.putBool((prefix + "fav").c_str(), signal.isFavorite);
+    vTaskDelay(pdMS_TO_TICKS(20));
   }
 }
 
@@ -351,233 +259,111 @@ void setupWebServer() {
   // Serve static files
   server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
   
-  // API endpoints
-  server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){
-    DynamicJsonDocument doc(300);
-    doc["sniffing"] = sniffingEnabled;
-    doc["buzzer"] = buzzerEnabled;
-    doc["led"] = ledEnabled;
-    doc["signalCount"] = storedSignals.size();
-    doc["maxSignals"] = MAX_SIGNALS;
-    doc["storageUsed"] = (float)storedSignals.size() / MAX_SIGNALS * 100;
-    doc["lastSignal"] = lastSignalTime;
-    
-    // Count favorites
-    int favoriteCount = 0;
-    for (const auto& signal : storedSignals) {
-      if (signal.isFavorite) favoriteCount++;
-    }
-    doc["favoriteCount"] = favoriteCount;
-    
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
-  });
-  
-  server.on("/api/sniffing", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (request->hasParam("enabled", true)) {
-      sniffingEnabled = request->getParam("enabled", true)->value() == "true";
-      preferences.putBool("sniffingEnabled", sniffingEnabled);  // Save to preferences
-      request->send(200, "text/plain", sniffingEnabled ? "Sniffing enabled" : "Sniffing disabled");
-    } else {
-      request->send(400, "text/plain", "Missing enabled parameter");
-    }
-  });
-  
-  server.on("/api/buzzer", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (request->hasParam("enabled", true)) {
-      buzzerEnabled = request->getParam("enabled", true)->value() == "true";
-      preferences.putBool("buzzerEnabled", buzzerEnabled);  // Save to preferences
-      request->send(200, "text/plain", buzzerEnabled ? "Buzzer enabled" : "Buzzer disabled");
-    } else {
-      request->send(400, "text/plain", "Missing enabled parameter");
-    }
-  });
-  
-  server.on("/api/led", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (request->hasParam("enabled", true)) {
-      ledEnabled = request->getParam("enabled", true)->value() == "true";
-      preferences.putBool("ledEnabled", ledEnabled);  // Save to preferences
-      request->send(200, "text/plain", ledEnabled ? "LED enabled" : "LED disabled");
-    } else {
-      request->send(400, "text/plain", "Missing enabled parameter");
-    }
-  });
-  
-  server.on("/api/signals", HTTP_GET, [](AsyncWebServerRequest *request){
-    DynamicJsonDocument doc(8192);
-    JsonArray signals = doc.createNestedArray("signals");
-    
-    for (size_t i = 0; i < storedSignals.size(); i++) {
-      JsonObject signal = signals.createNestedObject();
-      signal["id"] = i;
-      signal["name"] = storedSignals[i].name;
-      signal["value"] = String(storedSignals[i].value);
-      signal["bitLength"] = storedSignals[i].bitLength;
-      signal["protocol"] = storedSignals[i].protocol;
-      signal["timestamp"] = storedSignals[i].timestamp;
-      signal["isFavorite"] = storedSignals[i].isFavorite;
-    }
-    
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+  // Device-only routes
+  api.addRoute("/api/profile", METHOD_GET, ROUTE_CHEAP, [](const ApiRequest& request) {
+    return profileResponse();
   });
   
-  server.on("/api/transmit", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (request->hasParam("id", true)) {
-      int id = request->getParam("id", true)->value().toInt();
-      if (id >= 0 && id < storedSignals.size()) {
-        transmitSignal(storedSignals[id]);
-        request->send(200, "text/plain", "Signal transmitted");
-      } else {
-        request->send(400, "text/plain", "Invalid signal ID");
-      }
-    } else {
-      request->send(400, "text/plain", "Missing signal ID");
-    }
-  });
+  // API endpoints, in the API's order so sub-paths win over their parents
+  const std::vector<SnifferApi::Route>& routes = api.routes();
+  for (size_t i = 0; i < routes.size(); i++) {
+    static const WebRequestMethod METHODS[] = {HTTP_GET, HTTP_POST, HTTP_DELETE};
+    server.on(routes[i].path, METHODS[routes[i].method], [i](AsyncWebServerRequest *request){
+      const SnifferApi::Route& route = api.routes()[i];
+      sendApiResponse(request, api.handle(route, toApiRequest(request, route.method, route.path)));
+    });
+  }
   
-  server.on("/api/repeat-transmit", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (request->hasParam("id", true) && request->hasParam("count", true)) {
-      int id = request->getParam("id", true)->value().toInt();
-      int count = request->getParam("count", true)->value().toInt();
-      
-      if (id >= 0 && id < storedSignals.size() && count >= 1 && count <= 100) {
-        if (!repeatTransmissionActive) {
-          Serial.println("Starting repeat transmission: " + String(count) + " times");
-          startRepeatTransmission(storedSignals[id], count);
-          request->send(200, "text/plain", "Repeat transmission started for " + String(count) + " times");
-        } else {
-          request->send(400, "text/plain", "Repeat transmission already in progress");
-        }
-      } else {
-        request->send(400, "text/plain", "Invalid signal ID or count (1-100)");
-      }
-    } else {
-      request->send(400, "text/plain", "Missing signal ID or count");
+  server.on("/api/import", HTTP_POST, [](AsyncWebServerRequest *request){
+    sendApiResponse(request, api.finishImport(request));
+  }, [](AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final){
+    // multipart/form-data file upload
+    if (index == 0) {
+      request->onDisconnect([request]() { api.importAborted(request); });
     }
-  });
-  
-  server.on("/api/signals", HTTP_DELETE, [](AsyncWebServerRequest *request){
-    if (request->hasParam("id", true)) {
-      int id = request->getParam("id", true)->value().toInt();
-      if (id >= 0 && id < storedSignals.size()) {
-        storedSignals.erase(storedSignals.begin() + id);
-        saveStoredSignals();
-        request->send(200, "text/plain", "Signal deleted");
-      } else {
-        request->send(400, "text/plain", "Invalid signal ID");
-      }
-    } else {
-      request->send(400, "text/plain", "Missing signal ID");
+    api.importData(request, request->client()->remoteIP(), data, len, index == 0);
+  }, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+    // Raw request body
+    if (index == 0) {
+      request->onDisconnect([request]() { api.importAborted(request); });
     }
+    api.importData(request, request->client()->remoteIP(), data, len, index == 0);
   });
   
-  server.on("/api/signals/rename", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (request->hasParam("id", true) && request->hasParam("name", true)) {
-      int id = request->getParam("id", true)->value().toInt();
-      String name = request->getParam("name", true)->value();
-      if (id >= 0 && id < storedSignals.size()) {
-        storedSignals[id].name = name;
-        saveStoredSignals();
-        request->send(200, "text/plain", "Signal renamed");
-      } else {
-        request->send(400, "text/plain", "Invalid signal ID");
-      }
+  server.addHandler(&events);
+}
+
+ApiResponse profileResponse() {
+  Profiler::Snapshot profile = profiler.snapshot();
+  DynamicJsonDocument doc(512 + profile->tasks.size() * 128);
+  doc["uptimeMs"] = profile->uptimeMs;
+  doc["runTimeStats"] = profile->runTimeStats;
+  
+  JsonArray cores = doc.createNestedArray("coreBusyPercent");
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    if (profile->coreBusyPercent[core] >= 0) {
+      cores.add(profile->coreBusyPercent[core]);
     } else {
-      request->send(400, "text/plain", "Missing parameters");
+      cores.add(nullptr);
     }
-  });
+  }
   
-  server.on("/api/signals/favorite", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (request->hasParam("id", true) && request->hasParam("favorite", true)) {
-      int id = request->getParam("id", true)->value().toInt();
-      bool favorite = request->getParam("favorite", true)->value() == "true";
-      if (id >= 0 && id < storedSignals.size()) {
-        storedSignals[id].isFavorite = favorite;
-        saveStoredSignals();
-        request->send(200, "text/plain", favorite ? "Signal marked as favorite" : "Signal unmarked as favorite");
-      } else {
-        request->send(400, "text/plain", "Invalid signal ID");
-      }
-    } else {
-      request->send(400, "text/plain", "Missing parameters");
+  static const char* WINDOW_NAMES[WINDOW_COUNT] = {"1s", "10s", "60s"};
+  JsonObject loopJson = doc.createNestedObject("loop");
+  JsonObject rate = loopJson.createNestedObject("perSecond");
+  JsonObject busy = loopJson.createNestedObject("busyPercent");
+  for (int window = 0; window < WINDOW_COUNT; window++) {
+    rate[WINDOW_NAMES[window]] = profile->loopRate[window];
+    busy[WINDOW_NAMES[window]] = profile->loopBusyPercent[window];
+  }
+  loopJson["maxUs"] = profile->loopMaxUs;
+  
+  JsonArray tasks = doc.createNestedArray("tasks");
+  for (const TaskProfile& task : profile->tasks) {
+    JsonObject taskJson = tasks.createNestedObject();
+    taskJson["name"] = task.name;
+    taskJson["core"] = task.core;
+    taskJson["priority"] = task.priority;
+    taskJson["stackFreeMin"] = task.stackFreeMin;
+    if (task.cpuPercent >= 0) {
+      taskJson["cpuPercent"] = task.cpuPercent;
     }
-  });
-  
-  server.on("/api/clear", HTTP_POST, [](AsyncWebServerRequest *request){
-    storedSignals.clear();
-    signalCount = 0;
-    saveStoredSignals();
-    request->send(200, "text/plain", "All signals cleared");
-  });
-  
-  server.on("/api/cleanup", HTTP_POST, [](AsyncWebServerRequest *request){
-    int originalCount = storedSignals.size();
-    performAutoCleanup();
-    int removedCount = originalCount - storedSignals.size();
-    request->send(200, "text/plain", "Cleanup complete: Removed " + String(removedCount) + " signals");
-  });
+  }
   
-  server.on("/api/cleanup/old", HTTP_POST, [](AsyncWebServerRequest *request){
-    // Remove signals older than specified days (default 7 days)
-    int daysOld = 7;
-    if (request->hasParam("days", true)) {
-      daysOld = request->getParam("days", true)->value().toInt();
-    }
-    
-    unsigned long cutoffTime = millis() - (daysOld * 24 * 60 * 60 * 1000UL);
-    int originalCount = storedSignals.size();
-    
-    auto it = storedSignals.begin();
-    while (it != storedSignals.end()) {
-      if (!it->isFavorite && it->timestamp < cutoffTime) {
-        it = storedSignals.erase(it);
-      } else {
-        ++it;
-      }
-    }
-    
-    int removedCount = originalCount - storedSignals.size();
-    saveStoredSignals();
-    request->send(200, "text/plain", "Removed " + String(removedCount) + " signals older than " + String(daysOld) + " days");
-  });
+  ApiResponse response(200, "application/json", String());
+  serializeJson(doc, response.body);
+  return response;
 }
 
-// Non-blocking repeat transmission functions
-void startRepeatTransmission(const RFSignal& signal, int count) {
-  if (!repeatTransmissionActive) {
-    repeatTransmissionActive = true;
-    repeatCount = count;
-    currentRepeatIndex = 0;
-    repeatSignal = signal;
-    lastRepeatTime = millis();
-    
-    // Transmit the first signal immediately without feedback for speed
-    transmitSignal(repeatSignal, false);
-    currentRepeatIndex++;
-    Serial.println("Transmitted " + String(currentRepeatIndex) + "/" + String(repeatCount));
+ApiRequest toApiRequest(AsyncWebServerRequest *request, HttpMethod method, const char* path) {
+  ApiRequest converted;
+  converted.method = method;
+  converted.path = path;
+  converted.client = request->client()->remoteIP();
+  int count = request->params();
+  converted.params.reserve(count);
+  for (int i = 0; i < count; i++) {
+    AsyncWebParameter* param = request->getParam(i);
+    if (!param->isFile()) {
+      converted.params.push_back(ApiParam{param->name(), param->value(), param->isPost()});
+    }
   }
+  return converted;
 }
 
-void handleRepeatTransmission() {
-  if (repeatTransmissionActive) {
-    // Since there's no delay, transmit all remaining signals immediately without feedback
-    while (currentRepeatIndex < repeatCount) {
-      transmitSignal(repeatSignal, false); // No audio/visual feedback for speed
-      currentRepeatIndex++;
-      Serial.println("Transmitted " + String(currentRepeatIndex) + "/" + String(repeatCount));
-    }
-    
-    // All transmissions complete - provide feedback only at the end
-    Serial.println("Repeat transmission completed: " + String(repeatCount) + " times");
-    if (buzzerEnabled) {
-      playTransmitSound();
-    }
-    if (ledEnabled) {
-      flashLED(200, 1);
-    }
-    repeatTransmissionActive = false;
+void sendApiResponse(AsyncWebServerRequest *request, const ApiResponse& response) {
+  AsyncWebServerResponse *sent;
+  if (response.stream) {
+    ApiStream stream = response.stream;
+    sent = request->beginChunkedResponse(response.contentType,
+      [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return stream(buffer, maxLen);
+      });
+  } else {
+    sent = request->beginResponse(response.status, response.contentType, response.body);
   }
-}
\ No newline at end of file
+  for (const auto& header : response.headers) {
+    sent->addHeader(header.first, header.second);
+  }
+  request->send(sent);
+}
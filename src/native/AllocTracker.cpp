@@ -0,0 +1,109 @@
+#include "AllocTracker.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+static std::atomic<unsigned long> allocations(0);
+static std::atomic<unsigned long> frees(0);
+static std::atomic<unsigned long long> bytesAllocated(0);
+static std::atomic<long> liveBlocks(0);
+static std::atomic<long> liveBytes(0);
+static std::atomic<long> peakBytes(0);
+
+static void* allocate(size_t size) {
+  void* block = malloc(size ? size : 1);
+  if (!block) {
+    return nullptr;
+  }
+  // Usable size, so frees can subtract the same amount without a header
+  long usable = malloc_usable_size(block);
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytesAllocated.fetch_add(usable, std::memory_order_relaxed);
+  liveBlocks.fetch_add(1, std::memory_order_relaxed);
+  long live = liveBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+  long peak = peakBytes.load(std::memory_order_relaxed);
+  while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+  return block;
+}
+
+static void release(void* block) {
+  if (!block) {
+    return;
+  }
+  frees.fetch_add(1, std::memory_order_relaxed);
+  liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+  liveBytes.fetch_sub(malloc_usable_size(block), std::memory_order_relaxed);
+  free(block);
+}
+
+AllocStats allocStats() {
+  AllocStats stats;
+  stats.allocations = allocations.load(std::memory_order_relaxed);
+  stats.frees = frees.load(std::memory_order_relaxed);
+  stats.bytesAllocated = bytesAllocated.load(std::memory_order_relaxed);
+  stats.liveBlocks = liveBlocks.load(std::memory_order_relaxed);
+  stats.liveBytes = liveBytes.load(std::memory_order_relaxed);
+  stats.peakBytes = peakBytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void resetAllocPeak() {
+  peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+size_t heapFootprint() {
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#if __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 info = mallinfo2();
+  return info.arena + info.hblkhd;
+#endif
+#endif
+  return 0;
+}
+
+void* operator new(size_t size) {
+  void* block = allocate(size);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void operator delete(void* block) noexcept {
+  release(block);
+}
+
+void operator delete[](void* block) noexcept {
+  release(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+  release(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+  release(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+  release(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+  release(block);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+
+// Counting replacement for the global operator new and delete of the native
+// program. Every container and String allocation goes through it, so the
+// soak subcommand can watch for leaks and churn. The counters are relaxed
+// atomics: exact while one thread allocates, close enough otherwise.
+struct AllocStats {
+  unsigned long allocations;
+  unsigned long frees;
+  unsigned long long bytesAllocated;  // Total handed out, including since-freed
+  long liveBlocks;
+  long liveBytes;
+  long peakBytes;  // Highest liveBytes since the last resetAllocPeak()
+};
+
+AllocStats allocStats();
+void resetAllocPeak();
+
+// Bytes malloc holds from the system, in use or free; 0 when the allocator
+// can't say (sanitizer builds replace it)
+size_t heapFootprint();
@@ -0,0 +1,177 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "NativeCommands.h"
+#include "NativeHost.h"
+
+// Accuracy of the /api/analytics sketches against exact counts. Skewed
+// synthetic traffic (a few chatty transmitters, a long tail of rare ones)
+// goes through the receive path of a host with a deny filter, so filtered
+// and deduplicated frames are part of it; then a sweep feeds uniform
+// traffic of known cardinality straight into the sketches.
+
+static const unsigned long FRAME_INTERVAL_MS = 5;
+static const unsigned int DENIED_PROTOCOL = 6;
+
+// Distinct counts further off than this fail: three standard errors
+static const double DISTINCT_TOLERANCE = 3 * 1.04 / sqrt((double)HyperLogLog::REGISTERS);
+
+static RadioFrame codeFrame(uint32_t code) {
+  return RadioFrame{0x100000 + code * 13, 24, 1 + code % DENIED_PROTOCOL};
+}
+
+static ApiRequest makeRequest(HttpMethod method, const char* path) {
+  ApiRequest request;
+  request.method = method;
+  request.path = path;
+  request.client = 0x0100007f;
+  return request;
+}
+
+// Zipf-like ranks: code i is picked with weight 1 / (i + 1)^skew
+static std::vector<double> zipfCdf(uint32_t codes, double skew) {
+  std::vector<double> cdf(codes);
+  double total = 0;
+  for (uint32_t i = 0; i < codes; i++) {
+    total += 1.0 / pow(i + 1, skew);
+    cdf[i] = total;
+  }
+  for (double& p : cdf) {
+    p /= total;
+  }
+  return cdf;
+}
+
+static bool checkDistinct(const char* label, size_t exact, uint32_t estimate) {
+  double error = exact ? ((double)estimate - exact) / exact : 0;
+  bool ok = fabs(error) <= DISTINCT_TOLERANCE;
+  printf("%-24s exact %7zu  estimate %7u  error %+6.2f%%  %s\n", label, exact, estimate, error * 100,
+         ok ? "ok" : "FAIL");
+  return ok;
+}
+
+// analytics [--frames N] [--codes N] [--skew S] [--seed S]
+int runAnalytics(const Options& options, int argc, char** argv) {
+  unsigned long frames = 20000;
+  uint32_t codes = 5000;
+  double skew = 1.1;
+  uint32_t seed = 75;
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+      frames = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--codes") == 0 && hasValue) {
+      codes = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--skew") == 0 && hasValue) {
+      skew = strtod(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "analytics: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (frames == 0 || codes == 0) {
+    fprintf(stderr, "analytics: --frames and --codes must be at least 1\n");
+    return 2;
+  }
+  
+  ManualClock clock;
+  NativeHost host(clock);
+  host.begin();
+  // One window for the whole run, and one protocol denied
+  ApiRequest window = makeRequest(METHOD_POST, "/api/analytics");
+  window.params.push_back(ApiParam{"window", "0", true});
+  ApiRequest deny = makeRequest(METHOD_POST, "/api/filters");
+  deny.params.push_back(ApiParam{"list", "deny", true});
+  deny.params.push_back(ApiParam{"protocol", String(DENIED_PROTOCOL), true});
+  if (host.request(window).status != 200 || host.request(deny).status != 200) {
+    fprintf(stderr, "analytics: cannot set up the host\n");
+    return 1;
+  }
+  
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::vector<double> cdf = zipfCdf(codes, skew);
+  std::unordered_map<uint64_t, uint32_t> exact;
+  uint32_t exactProtocols[AnalyticsReport::PROTOCOLS] = {};
+  for (unsigned long i = 0; i < frames; i++) {
+    uint32_t code = std::lower_bound(cdf.begin(), cdf.end(), uniform(random)) - cdf.begin();
+    RadioFrame frame = codeFrame(std::min(code, codes - 1));
+    exact[signalKey(frame.value, frame.bitLength, frame.protocol)]++;
+    exactProtocols[frame.protocol]++;
+    clock.advanceMillis(FRAME_INTERVAL_MS);
+    host.radio.inject(frame);
+    host.settle();
+    if (options.verbose && (i + 1) % 5000 == 0) {
+      fprintf(stderr, "analytics: %lu/%lu frames\n", i + 1, frames);
+    }
+  }
+  host.pump();
+  
+  AnalyticsReport current, previous;
+  bool hasPrevious;
+  host.core.analytics().report(clock.millis(), current, previous, hasPrevious);
+  CaptureStats capture = host.core.captureStats();
+  FilterStats filtered = host.core.filterStats();
+  printf("%lu frames from %u codes (skew %.2f): %u stored, %u deduplicated, %u filtered\n", frames, codes, skew,
+         capture.stored, capture.duplicates, filtered.denied + filtered.notAllowed);
+  
+  int failures = 0;
+  if (current.frames != frames) {
+    printf("frames: counted %u of %lu  FAIL\n", current.frames, frames);
+    failures++;
+  }
+  for (int protocol = 0; protocol < AnalyticsReport::PROTOCOLS; protocol++) {
+    if (current.protocolFrames[protocol] != exactProtocols[protocol]) {
+      printf("protocol %d: counted %u, sent %u  FAIL\n", protocol, current.protocolFrames[protocol],
+             exactProtocols[protocol]);
+      failures++;
+    }
+  }
+  failures += !checkDistinct("distinct (skewed)", exact.size(), current.distinct);
+  
+  // Heavy hitters: every reported count must bound the true one, and the
+  // true top codes should be the reported ones
+  std::vector<std::pair<uint32_t, uint64_t>> ranked;
+  for (const auto& code : exact) {
+    ranked.push_back(std::make_pair(code.second, code.first));
+  }
+  std::sort(ranked.rbegin(), ranked.rend());
+  size_t found = 0;
+  printf("%-4s %-10s %8s %8s %6s %5s\n", "rank", "code", "exact", "count", "error", "rank");
+  for (size_t i = 0; i < current.topCount; i++) {
+    const SpaceSaving::Entry& entry = current.top[i];
+    uint32_t truth = exact.count(entry.key) ? exact[entry.key] : 0;
+    size_t rank = 0;
+    while (rank < ranked.size() && ranked[rank].second != entry.key) {
+      rank++;
+    }
+    found += rank < (size_t)AnalyticsReport::TOP;
+    bool bounded = entry.count - entry.error <= truth && truth <= entry.count;
+    printf("%-4zu 0x%08lx %8u %8u %6u %5zu%s\n", i + 1, (unsigned long)(entry.key >> 32), truth, entry.count,
+           entry.error, rank + 1, bounded ? "" : "  FAIL (count does not bound the true count)");
+    failures += !bounded;
+  }
+  printf("top %d: %zu of the true top %d reported\n", AnalyticsReport::TOP, found, AnalyticsReport::TOP);
+  
+  // HyperLogLog over uniform traffic of known cardinality, each code three times
+  for (uint32_t distinct = 100; distinct <= 1000000; distinct *= 10) {
+    FrameAnalytics sketch(0);
+    for (uint32_t i = 0; i < distinct * 3; i++) {
+      sketch.record(signalKey(0x10000000 + i % distinct, 32, 1), 1, 0);
+    }
+    sketch.report(0, current, previous, hasPrevious);
+    char label[32];
+    snprintf(label, sizeof(label), "distinct (%u codes)", distinct);
+    failures += !checkDistinct(label, distinct, current.distinct);
+  }
+  
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include "Bench.h"
+
+#include <time.h>
+#include <thread>
+
+BenchRunner::BenchRunner(double minSeconds, const char* filter)
+  : minSeconds(minSeconds), filter(filter ? filter : "") {
+}
+
+bool BenchRunner::run(const std::string& name, size_t items, Body body) {
+  if (!filter.empty() && name.find(filter) == std::string::npos) {
+    return false;
+  }
+  
+  BenchTimer timer;
+  unsigned long iterations = 0;
+  std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  do {
+    body(timer);
+    iterations++;
+    // Untimed setup can dominate; stop after 10x the budget in wall time
+  } while (timer.seconds() < minSeconds &&
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() < minSeconds * 10);
+  
+  done.push_back(BenchResult{name, iterations, timer.seconds() / iterations, items, {}});
+  const BenchResult& result = done.back();
+  fprintf(stderr, "%-40s %10lu %14.1f ns/op\n", name.c_str(), iterations,
+          result.secondsPerIteration * 1e9 / (items ? items : 1));
+  return true;
+}
+
+void BenchRunner::addCounter(const std::string& name, double value) {
+  if (!done.empty()) {
+    done.back().counters.push_back(std::make_pair(name, value));
+  }
+}
+
+void BenchRunner::printTable(FILE* out) const {
+  fprintf(out, "%-40s %10s %14s %14s\n", "Benchmark", "Iterations", "ns/op", "ops/s");
+  for (const BenchResult& result : done) {
+    double perItem = result.secondsPerIteration / (result.itemsPerIteration ? result.itemsPerIteration : 1);
+    fprintf(out, "%-40s %10lu %14.1f %14.0f", result.name.c_str(), result.iterations,
+            perItem * 1e9, perItem > 0 ? 1 / perItem : 0.0);
+    for (const auto& counter : result.counters) {
+      fprintf(out, "  %s=%.6g", counter.first.c_str(), counter.second);
+    }
+    fprintf(out, "\n");
+  }
+}
+
+void BenchRunner::writeJson(FILE* out) const {
+  char date[32];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  
+  fprintf(out, "{\n  \"context\": {\n");
+  fprintf(out, "    \"date\": \"%s\",\n", date);
+  fprintf(out, "    \"executable\": \"rf433 native bench\",\n");
+  fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+  fprintf(out, "    \"library_build_type\": \"release\"\n");
+#else
+  fprintf(out, "    \"library_build_type\": \"debug\"\n");
+#endif
+  fprintf(out, "  },\n  \"benchmarks\": [");
+  for (size_t i = 0; i < done.size(); i++) {
+    const BenchResult& result = done[i];
+    double perItem = result.secondsPerIteration / (result.itemsPerIteration ? result.itemsPerIteration : 1);
+    fprintf(out, "%s\n    {\n", i ? "," : "");
+    fprintf(out, "      \"name\": \"%s\",\n", result.name.c_str());
+    fprintf(out, "      \"run_name\": \"%s\",\n", result.name.c_str());
+    fprintf(out, "      \"run_type\": \"iteration\",\n");
+    fprintf(out, "      \"iterations\": %lu,\n", result.iterations);
+    fprintf(out, "      \"real_time\": %.3f,\n", perItem * 1e9);
+    fprintf(out, "      \"cpu_time\": %.3f,\n", perItem * 1e9);
+    fprintf(out, "      \"time_unit\": \"ns\",\n");
+    fprintf(out, "      \"items_per_second\": %.3f", perItem > 0 ? 1 / perItem : 0.0);
+    // Counters go beside the standard fields, as Google Benchmark does
+    for (const auto& counter : result.counters) {
+      fprintf(out, ",\n      \"%s\": %.6g", counter.first.c_str(), counter.second);
+    }
+    fprintf(out, "\n");
+    fprintf(out, "    }");
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
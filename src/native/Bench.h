@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdio.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal benchmark harness. Results are written in the Google Benchmark
+// JSON layout so its compare.py and existing dashboards can read them.
+
+// Times only the part of an iteration between start() and stop()
+class BenchTimer {
+public:
+  BenchTimer() : elapsed(0) {}
+
+  void start() { started = std::chrono::steady_clock::now(); }
+  void stop() { elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count(); }
+  double seconds() const { return elapsed; }
+
+private:
+  std::chrono::steady_clock::time_point started;
+  double elapsed;
+};
+
+struct BenchResult {
+  std::string name;
+  unsigned long iterations;
+  double secondsPerIteration;
+  size_t itemsPerIteration;
+  // User counters, e.g. flash operations per iteration
+  std::vector<std::pair<std::string, double>> counters;
+};
+
+class BenchRunner {
+public:
+  // One iteration; items is how many operations it performs
+  typedef std::function<void(BenchTimer& timer)> Body;
+
+  BenchRunner(double minSeconds, const char* filter);
+
+  // Repeats body until it has been timed for minSeconds; false when the
+  // filter skipped it
+  bool run(const std::string& name, size_t items, Body body);
+  // Attach a counter to the result of the last run()
+  void addCounter(const std::string& name, double value);
+
+  const std::vector<BenchResult>& results() const { return done; }
+  void printTable(FILE* out) const;
+  void writeJson(FILE* out) const;
+
+private:
+  double minSeconds;
+  std::string filter;
+  std::vector<BenchResult> done;
+};
+
+// Suites beyond the store benchmarks in StoreBench.cpp
+void benchParsers(BenchRunner& runner);
+void benchFlash(BenchRunner& runner);
+void benchRules(BenchRunner& runner);
+void benchTranslations(BenchRunner& runner);
+void benchFilters(BenchRunner& runner);
+void benchAnalytics(BenchRunner& runner);
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "NativeCommands.h"
+#include "NvsEmulator.h"
+#include "SignalPersistence.h"
+#include "SignalStore.h"
+#include "SnifferCore.h"
+
+// Persistence measured in flash work: every logical mutation goes through
+// saveSignals() into the NVS emulator, and the benchmarks report the
+// erases, programs and bytes it caused and how long the device would spend
+// on them. The powerloss subcommand cuts power at each of those programs.
+
+static const char* NAMESPACE = "rf433";
+
+// What one record costs in NVS entries: "Signal N" needs two, six scalars one each
+static const size_t ENTRIES_PER_SIGNAL = 8;
+
+struct Mutation {
+  const char* name;
+  const char* help;
+  void (*apply)(SignalStore& store, std::mt19937& random, int& nextId);
+};
+
+static RFSignal makeSignal(uint32_t uid) {
+  RFSignal signal;
+  signal.uid = uid;
+  signal.name = "Signal " + String((unsigned long)uid);
+  signal.value = ((uid + 1) * 0x9E3779B1u) & 0xFFFFFF;
+  signal.bitLength = 24;
+  signal.protocol = 1;
+  signal.timestamp = 1000UL * uid;
+  signal.isFavorite = uid % 20 == 0;
+  return signal;
+}
+
+static void fillLibrary(SignalStore& store, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    store.add(makeSignal(i));
+  }
+  store.publish();
+}
+
+static void refreshTimestamp(SignalStore& store, std::mt19937& random, int& nextId) {
+  size_t index = random() % store.size();
+  RFSignal signal = store.at(index);
+  signal.timestamp += 1000;
+  store.replace(index, signal);
+}
+
+static void rename(SignalStore& store, std::mt19937& random, int& nextId) {
+  size_t index = random() % store.size();
+  RFSignal signal = store.at(index);
+  signal.name = "Renamed " + String((unsigned long)(random() % 10000));
+  store.replace(index, signal);
+}
+
+static void toggleFavorite(SignalStore& store, std::mt19937& random, int& nextId) {
+  size_t index = random() % store.size();
+  RFSignal signal = store.at(index);
+  signal.isFavorite = !signal.isFavorite;
+  store.replace(index, signal);
+}
+
+static void tag(SignalStore& store, std::mt19937& random, int& nextId) {
+  store.tagSignal(random() % store.size(), "bench");
+}
+
+// A new code in a full library: the oldest goes, as auto-cleanup does
+static void capture(SignalStore& store, std::mt19937& random, int& nextId) {
+  store.erase(0);
+  store.add(makeSignal(nextId++));
+}
+
+static const Mutation MUTATIONS[] = {
+  {"duplicate", "a repeat capture refreshes one timestamp", refreshTimestamp},
+  {"rename", "one signal renamed", rename},
+  {"favorite", "one favorite flag toggled", toggleFavorite},
+  {"tag", "one signal tagged", tag},
+  {"capture", "new signal added, oldest evicted", capture},
+};
+
+// The default 20 KB partition while the library fits in it, else one sized
+// for the library with a quarter spare for garbage collection
+static size_t partitionFor(size_t signals) {
+  size_t entries = signals * ENTRIES_PER_SIGNAL + 16;
+  if (entries * 5 / 4 <= 4 * 126) {
+    return NvsStore::DEFAULT_PARTITION_SIZE;
+  }
+  return (entries * 5 / 4 / 126 + 2) * EmulatedFlash::SECTOR_SIZE;
+}
+
+static void reportFlash(BenchRunner& runner, const FlashStats& before, const FlashStats& after) {
+  double iterations = runner.results().back().iterations;
+  runner.addCounter("erases", (after.erases - before.erases) / iterations);
+  runner.addCounter("writes", (after.writes - before.writes) / iterations);
+  runner.addCounter("bytes", (after.bytesWritten - before.bytesWritten) / iterations);
+  runner.addCounter("flash_ms", (after.simulatedUs - before.simulatedUs) / 1000 / iterations);
+}
+
+// nvs/<mutation>/<signals>: one mutation and the save that follows it. Each
+// runs against the flash the previous one left, so garbage collection shows
+// up at its steady-state rate.
+void benchFlash(BenchRunner& runner) {
+  static const size_t SIZES[] = {50, (size_t)SnifferCore::MAX_SIGNALS};
+  for (size_t size : SIZES) {
+    for (const Mutation& mutation : MUTATIONS) {
+      EmulatedFlash flash(partitionFor(size));
+      NvsStore nvs(flash, NAMESPACE);
+      SignalStore store;
+      fillLibrary(store, size);
+      int nextId = size;
+      saveSignals(nvs, store, nextId);
+  
+      std::mt19937 random(433);
+      FlashStats before = flash.stats();
+      std::string name = std::string("nvs/") + mutation.name + "/" + std::to_string(size);
+      bool ran = runner.run(name, 1, [&](BenchTimer& timer) {
+        mutation.apply(store, random, nextId);
+        timer.start();
+        saveSignals(nvs, store, nextId);
+        timer.stop();
+      });
+      if (!ran) {
+        continue;
+      }
+      reportFlash(runner, before, flash.stats());
+      if (nvs.failures() > 0) {
+        fprintf(stderr, "%s: %lu NVS writes failed (%s)\n", name.c_str(), nvs.failures(), nvs.lastError());
+      }
+    }
+  }
+}
+
+static bool sameLibrary(const SignalStore& a, const SignalStore& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    const RFSignal& x = a.at(i);
+    const RFSignal& y = b.at(i);
+    if (x.uid != y.uid || x.name != y.name || x.value != y.value || x.bitLength != y.bitLength ||
+        x.protocol != y.protocol || x.timestamp != y.timestamp || x.isFavorite != y.isFavorite) {
+      return false;
+    }
+  }
+  
+  const std::vector<SignalTags::Tag>& tagsA = a.currentTags().list();
+  const std::vector<SignalTags::Tag>& tagsB = b.currentTags().list();
+  if (tagsA.size() != tagsB.size()) {
+    return false;
+  }
+  std::vector<uint8_t> membersA;
+  std::vector<uint8_t> membersB;
+  for (size_t i = 0; i < tagsA.size(); i++) {
+    tagsA[i].members->serialize(membersA);
+    tagsB[i].members->serialize(membersB);
+    if (tagsA[i].name != tagsB[i].name || membersA != membersB) {
+      return false;
+    }
+    membersA.clear();
+    membersB.clear();
+  }
+  return true;
+}
+
+// powerloss [--signals N] [--mutation NAME]
+int runPowerLoss(const Options& options, int argc, char** argv) {
+  size_t signals = 40;
+  const char* only = nullptr;
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--signals") == 0 && hasValue) {
+      signals = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--mutation") == 0 && hasValue) {
+      only = argv[++i];
+    } else {
+      fprintf(stderr, "powerloss: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (signals == 0) {
+    fprintf(stderr, "powerloss: --signals must be at least 1\n");
+    return 2;
+  }
+  
+  // Each cut point: restore the flash from before the save, cut power at the
+  // nth program or erase, remount as after a reset and load the library.
+  // It must come back as the old library, the new one, or a mix of both;
+  // a mount that fails or keeps repairing counts as broken.
+  printf("%-10s %6s %6s %6s %6s %7s\n", "mutation", "cuts", "old", "new", "mixed", "broken");
+  int broken = 0;
+  for (const Mutation& mutation : MUTATIONS) {
+    if (only && strcmp(only, mutation.name) != 0) {
+      continue;
+    }
+    SignalStore before;
+    fillLibrary(before, signals);
+    SignalStore after;
+    fillLibrary(after, signals);
+    int nextId = signals;
+    std::mt19937 random(433);
+    mutation.apply(after, random, nextId);
+    after.publish();
+  
+    EmulatedFlash flash(partitionFor(signals));
+    {
+      NvsStore nvs(flash, NAMESPACE);
+      saveSignals(nvs, before, signals);
+    }
+    std::vector<uint8_t> baseline = flash.image();
+    unsigned long operations;
+    {
+      NvsStore nvs(flash, NAMESPACE);
+      operations = flash.generation();
+      saveSignals(nvs, after, nextId);
+      operations = flash.generation() - operations;
+    }
+  
+    unsigned long counts[4] = {0, 0, 0, 0};  // old, new, mixed, broken
+    for (unsigned long cut = 1; cut <= operations; cut++) {
+      flash.setImage(baseline);
+      {
+        NvsStore nvs(flash, NAMESPACE);
+        flash.powerLossAfter(cut);
+        saveSignals(nvs, after, nextId);
+      }
+      flash.restorePower();
+  
+      NvsStore remounted(flash, NAMESPACE);
+      unsigned long repaired = flash.generation();
+      SignalStore loaded;
+      int loadedNextId = 0;
+      loadSignals(remounted, loaded, loadedNextId, signals + 1);
+      bool stable = remounted.mount() && flash.generation() == repaired;
+      int outcome = !stable ? 3 : sameLibrary(loaded, before) ? 0 : sameLibrary(loaded, after) ? 1 : 2;
+      counts[outcome]++;
+      if (options.verbose && outcome >= 2) {
+        fprintf(stderr, "%s: cut %lu of %lu: %s, %zu signals loaded\n", mutation.name, cut, operations,
+                outcome == 2 ? "mixed" : remounted.lastError(), loaded.size());
+      }
+    }
+    printf("%-10s %6lu %6lu %6lu %6lu %7lu\n", mutation.name, operations, counts[0], counts[1],
+           counts[2], counts[3]);
+    broken += counts[3];
+  }
+  return broken == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "NativeCommands.h"
+#include "NativeHost.h"
+
+// Captures must not lose their queue slot to API traffic. Client threads
+// post cheap settings and favorite commands as fast as the API answers,
+// without admission limits, while frames arrive one per owner pass; any
+// capture refused by the command queue fails the run.
+
+static const uint32_t FRAME_BASE = 0x500000;
+
+static ApiRequest makeRequest(HttpMethod method, const char* path, uint32_t client) {
+  ApiRequest request;
+  request.method = method;
+  request.path = path;
+  request.client = client;
+  return request;
+}
+
+// One of the commands a busy dashboard sends
+static ApiRequest floodRequest(unsigned long n, uint32_t client) {
+  ApiRequest request;
+  if (n % 2 == 0) {
+    request = makeRequest(METHOD_POST, "/api/led", client);
+    request.params.push_back(ApiParam{"enabled", n % 4 == 0 ? "true" : "false", true});
+  } else {
+    request = makeRequest(METHOD_POST, "/api/signals/favorite", client);
+    request.params.push_back(ApiParam{"id", "0", true});
+    request.params.push_back(ApiParam{"favorite", n % 3 == 0 ? "true" : "false", true});
+  }
+  return request;
+}
+
+// flood [--frames N] [--clients N]
+int runFlood(const Options& options, int argc, char** argv) {
+  unsigned long frames = 500;
+  unsigned long clients = 64;
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+      frames = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--clients") == 0 && hasValue) {
+      clients = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "flood: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (frames == 0) {
+    fprintf(stderr, "flood: --frames must be at least 1\n");
+    return 2;
+  }
+  
+  SystemClock clock;
+  NativeHost host(clock);
+  host.begin();
+  host.radio.inject(RadioFrame{FRAME_BASE - 1, 24, 1});  // Signal 0, for the favorite commands
+  host.settle();
+  
+  std::atomic<bool> running(true);
+  std::atomic<unsigned long> answered(0), queued(0), refused(0);
+  std::vector<std::thread> threads;
+  for (unsigned long c = 0; c < clients; c++) {
+    threads.push_back(std::thread([&, c]() {
+      for (unsigned long n = c; running.load(); n++) {
+        ApiResponse response = host.api.handle(floodRequest(n, 0x0a000000 + c));
+        answered++;
+        queued += response.status == 202;
+        if (response.status == 503) {
+          refused++;
+          delay(1);  // A real client would back off too
+        }
+      }
+    }));
+  }
+  
+  // The owner: a frame per pass, as loop() reads the receiver's latch
+  for (unsigned long i = 0; i < frames; i++) {
+    host.radio.inject(RadioFrame{FRAME_BASE + i, 24, 1});
+    host.pump(1);
+    if (options.verbose && (i + 1) % 500 == 0) {
+      fprintf(stderr, "flood: %lu/%lu frames\n", i + 1, frames);
+    }
+  }
+  running.store(false);
+  for (std::thread& thread : threads) {
+    thread.join();  // A client waiting on its command gives up after COMMAND_WAIT_MS
+  }
+  host.pump();
+  
+  CaptureStats capture = host.core.captureStats();
+  CommandStats commands = host.core.commands().stats();
+  printf("%lu frames, %lu clients: %lu requests (%lu queued, %lu refused), %lu commands rejected\n", frames,
+         clients, answered.load(), queued.load(), refused.load(), commands.rejected);
+  printf("captures: %u received, %u stored, %u dropped (queue full)\n", capture.received, capture.stored,
+         capture.droppedQueue);
+  if (capture.droppedQueue != 0 || capture.received != frames + 1) {
+    printf("FAIL: captures lost to API traffic\n");
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
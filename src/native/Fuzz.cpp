@@ -0,0 +1,241 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FuzzTargets.h"
+#include "NativeCommands.h"
+
+// Mutation fuzzing without libFuzzer, so the targets also run in a plain
+// gcc build under ASan/UBSan. Coverage-guided runs use env:fuzz instead.
+
+static const char* CRASH_PATH = "fuzz-crash.bin";
+static const std::string* currentInput = nullptr;
+
+// Save the input that killed us; only async-signal-safe calls here
+static void saveCurrentInput() {
+  if (!currentInput) {
+    return;
+  }
+  int fd = open(CRASH_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    ssize_t written = write(fd, currentInput->data(), currentInput->size());
+    (void)written;
+    close(fd);
+  }
+  currentInput = nullptr;
+}
+
+static void onFatalSignal(int signal) {
+  saveCurrentInput();
+  ::signal(signal, SIG_DFL);
+  raise(signal);
+}
+
+// Sanitizer reports exit without a signal; the runtime offers a hook
+extern "C" void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+static bool readFile(const std::string& path, std::string& contents) {
+  FILE* in = fopen(path.c_str(), "rb");
+  if (!in) {
+    return false;
+  }
+  char buffer[4096];
+  size_t length;
+  contents.clear();
+  while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+    contents.append(buffer, length);
+  }
+  fclose(in);
+  return true;
+}
+
+// A file, or every regular file in a directory
+static bool loadInputs(const char* path, std::vector<std::string>& inputs) {
+  struct stat info;
+  if (stat(path, &info) != 0) {
+    return false;
+  }
+  if (!S_ISDIR(info.st_mode)) {
+    inputs.push_back(std::string());
+    return readFile(path, inputs.back());
+  }
+  DIR* dir = opendir(path);
+  if (!dir) {
+    return false;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    std::string file = std::string(path) + "/" + entry->d_name;
+    if (stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+      inputs.push_back(std::string());
+      readFile(file, inputs.back());
+    }
+  }
+  closedir(dir);
+  return true;
+}
+
+static void mutate(std::string& input, const std::vector<std::string>& corpus, std::mt19937& random,
+                   size_t maxLength) {
+  static const char* TOKENS[] = {"0", "-1", "4294967295", "2147483648", "true", "&", "=", "{", "}",
+                                 "..", "\"", "\n", "tag:", " AND ", " OR ", "NOT ", "(", ")", "\xff\xff"};
+  int mutations = 1 + random() % 4;
+  for (int m = 0; m < mutations; m++) {
+    size_t position = input.empty() ? 0 : random() % (input.size() + 1);
+    switch (random() % 7) {
+      case 0:  // Flip a bit
+        if (!input.empty()) {
+          input[position % input.size()] ^= 1 << (random() % 8);
+        }
+        break;
+      case 1:  // Random byte
+        if (!input.empty()) {
+          input[position % input.size()] = random();
+        }
+        break;
+      case 2:  // Insert bytes
+        input.insert(position, 1 + random() % 4, (char)random());
+        break;
+      case 3:  // Erase a range
+        if (!input.empty()) {
+          position %= input.size();
+          input.erase(position, 1 + random() % std::min<size_t>(16, input.size() - position));
+        }
+        break;
+      case 4:  // Insert a token
+        input.insert(position, TOKENS[random() % (sizeof(TOKENS) / sizeof(TOKENS[0]))]);
+        break;
+      case 5:  // Duplicate a range
+        if (!input.empty()) {
+          position %= input.size();
+          input.insert(random() % (input.size() + 1), input.substr(position, 1 + random() % 32));
+        }
+        break;
+      case 6: {  // Splice with another input
+        const std::string& other = corpus[random() % corpus.size()];
+        if (!other.empty()) {
+          input = input.substr(0, position) + other.substr(random() % other.size());
+        }
+        break;
+      }
+    }
+  }
+  if (input.size() > maxLength) {
+    input.resize(maxLength);
+  }
+}
+
+static bool writeCorpus(const char* dir, const std::vector<std::string>& corpus) {
+  mkdir(dir, 0755);
+  for (size_t i = 0; i < corpus.size(); i++) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/seed-%03zu", dir, i);
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+      return false;
+    }
+    fwrite(corpus[i].data(), 1, corpus[i].size(), out);
+    fclose(out);
+  }
+  return true;
+}
+
+static void listTargets() {
+  fprintf(stderr, "targets:\n");
+  for (size_t i = 0; i < FUZZ_TARGET_COUNT; i++) {
+    fprintf(stderr, "  %-8s %s\n", FUZZ_TARGETS[i].name, FUZZ_TARGETS[i].help);
+  }
+}
+
+int runFuzz(const Options& options, int argc, char** argv) {
+  if (argc < 1) {
+    fprintf(stderr, "usage: fuzz <target|all> [--runs N] [--seed S] [--max-len N] [--write-corpus DIR] [input..]\n");
+    listTargets();
+    return 2;
+  }
+  unsigned long runs = 100000;
+  uint32_t seed = 1;
+  size_t maxLength = 4096;
+  const char* corpusDir = nullptr;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--runs") == 0 && hasValue) {
+      runs = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--max-len") == 0 && hasValue) {
+      maxLength = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--write-corpus") == 0 && hasValue) {
+      corpusDir = argv[++i];
+    } else if (!loadInputs(argv[i], inputs)) {
+      fprintf(stderr, "fuzz: cannot read %s\n", argv[i]);
+      return 1;
+    }
+  }
+  
+  std::vector<const FuzzTarget*> targets;
+  for (size_t i = 0; i < FUZZ_TARGET_COUNT; i++) {
+    if (strcmp(argv[0], "all") == 0 || strcmp(argv[0], FUZZ_TARGETS[i].name) == 0) {
+      targets.push_back(&FUZZ_TARGETS[i]);
+    }
+  }
+  if (targets.empty()) {
+    fprintf(stderr, "fuzz: unknown target '%s'\n", argv[0]);
+    listTargets();
+    return 2;
+  }
+  
+  signal(SIGSEGV, onFatalSignal);
+  signal(SIGABRT, onFatalSignal);
+  signal(SIGBUS, onFatalSignal);
+  if (__sanitizer_set_death_callback) {
+    __sanitizer_set_death_callback(saveCurrentInput);
+  }
+  
+  printf("%-8s %8s %10s %12s\n", "target", "inputs", "runs", "execs/s");
+  for (const FuzzTarget* target : targets) {
+    std::vector<std::string> corpus = inputs;
+    if (corpus.empty()) {
+      target->seeds(corpus);
+    }
+    if (corpusDir) {
+      std::string dir = targets.size() > 1 ? std::string(corpusDir) + "-" + target->name : corpusDir;
+      if (!writeCorpus(dir.c_str(), corpus)) {
+        fprintf(stderr, "fuzz: cannot write %s\n", dir.c_str());
+        return 1;
+      }
+    }
+  
+    // Replay everything given, then mutate it
+    std::mt19937 random(seed);
+    std::string input;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    for (const std::string& given : corpus) {
+      currentInput = &given;
+      target->run((const uint8_t*)given.data(), given.size());
+    }
+    for (unsigned long run = 0; run < runs; run++) {
+      input = corpus[random() % corpus.size()];
+      mutate(input, corpus, random, maxLength);
+      currentInput = &input;
+      target->run((const uint8_t*)input.data(), input.size());
+      if (options.verbose && (run + 1) % 10000 == 0) {
+        fprintf(stderr, "%s: %lu runs\n", target->name, run + 1);
+      }
+    }
+    currentInput = nullptr;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    unsigned long total = runs + corpus.size();
+    printf("%-8s %8zu %10lu %12.0f\n", target->name, corpus.size(), total, seconds > 0 ? total / seconds : 0.0);
+  }
+  return 0;
+}
@@ -0,0 +1,433 @@
+#include "FuzzTargets.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+#include "CaptureFilter.h"
+#include "NativeHost.h"
+#include "ParamParse.h"
+#include "SignalCodec.h"
+#include "SignalPersistence.h"
+#include "SignalQuery.h"
+#include "SignalStore.h"
+
+#define FUZZ_CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "fuzz check failed: %s (%s:%d)\n", #condition, __FILE__, __LINE__); \
+      abort(); \
+    } \
+  } while (0)
+
+static String toString(const uint8_t* data, size_t size) {
+  return String((const char*)data, size);
+}
+
+// A few signals and tags for the query, tag and persistence targets
+static void fillLibrary(SignalStore& store) {
+  static const char* NAMES[] = {"Gate", "Garage door", "", "Doorbell", "Gate 2"};
+  for (uint32_t i = 0; i < 5; i++) {
+    RFSignal signal;
+    signal.uid = i;
+    signal.name = NAMES[i];
+    signal.value = 5393 + i * 1000;
+    signal.bitLength = 12 + i * 4;
+    signal.protocol = 1 + i % 3;
+    signal.timestamp = i * 60000;
+    signal.isFavorite = i % 2;
+    store.add(signal);
+  }
+  store.tagSignal(0, "garage");
+  store.tagSignal(1, "garage");
+  store.tagSignal(3, "house");
+  store.publish();
+}
+
+// params: the strict number and flag parsers against a slow reference.
+// The first byte picks the accepted range, the rest is the text.
+static const long PARAM_RANGES[][2] = {
+  {INT_MIN, INT_MAX}, {0, INT_MAX}, {1, 100}, {0, 3650}, {LONG_MIN, LONG_MAX}, {-10, -6}
+};
+
+static bool referenceLong(const std::string& text, long min, long max, long& value) {
+  size_t start = !text.empty() && (text[0] == '-' || text[0] == '+') ? 1 : 0;
+  bool negative = start == 1 && text[0] == '-';
+  if (start == text.size()) {
+    return false;
+  }
+  for (size_t i = start; i < text.size(); i++) {
+    if (text[i] < '0' || text[i] > '9') {
+      return false;
+    }
+  }
+  while (start + 1 < text.size() && text[start] == '0') {
+    start++;
+  }
+  if (text.size() - start > 19) {
+    return false;
+  }
+  unsigned long long magnitude = strtoull(text.c_str() + start, nullptr, 10);
+  if (magnitude == 0) {
+    value = 0;
+  } else if (negative) {
+    if (min >= 0 || magnitude - 1 > (unsigned long long)(-(min + 1))) {
+      return false;
+    }
+    value = -(long)(magnitude - 1) - 1;
+  } else {
+    if (max <= 0 || magnitude > (unsigned long long)max) {
+      return false;
+    }
+    value = (long)magnitude;
+  }
+  return value >= min && value <= max;
+}
+
+static void fuzzParams(const uint8_t* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  const long* range = PARAM_RANGES[data[0] % (sizeof(PARAM_RANGES) / sizeof(PARAM_RANGES[0]))];
+  std::string text((const char*)data + 1, size - 1);
+  
+  long parsed = 0, expected = 0;
+  bool ok = parseLong(text.data(), text.size(), range[0], range[1], parsed);
+  FUZZ_CHECK(ok == referenceLong(text, range[0], range[1], expected));
+  FUZZ_CHECK(!ok || parsed == expected);
+  
+  String value = toString(data + 1, size - 1);
+  uint32_t unsignedValue;
+  if (parseUInt32(value, unsignedValue)) {
+    FUZZ_CHECK(referenceLong(text, 0, 4294967295L, expected) && (uint32_t)expected == unsignedValue);
+  }
+  bool flag;
+  if (parseBool(value, flag)) {
+    FUZZ_CHECK(text == (flag ? "true" : "false") || text == (flag ? "1" : "0"));
+  }
+  
+  // GET /api/filters lists sets in the spelling POST parses
+  FilterRule rule, reparsed;
+  String error;
+  if (parseFilterRule("deny", &value, &value, nullptr, rule, error)) {
+    String protocols = filterSetText(rule.protocols);
+    String bits = filterSetText(rule.bitLengths);
+    FUZZ_CHECK(parseFilterRule("deny", &protocols, &bits, nullptr, reparsed, error));
+    FUZZ_CHECK(reparsed.protocols == rule.protocols && reparsed.bitLengths == rule.bitLengths);
+  }
+}
+
+static void seedParams(std::vector<std::string>& corpus) {
+  const char* texts[] = {"0", "42", "-7", "+3", "2147483647", "-2147483648", "9223372036854775807",
+                         "true", "false", "1", "007", "1,3-5", "12-24,32"};
+  for (size_t range = 0; range < sizeof(PARAM_RANGES) / sizeof(PARAM_RANGES[0]); range++) {
+    for (const char* text : texts) {
+      corpus.push_back(std::string(1, (char)range) + text);
+    }
+  }
+}
+
+// api: one request to a route picked by the first byte, with the rest as
+// "name=value&..." pairs sent both in the query and in the body. The index
+// past the last route uploads the rest as an import.
+static NativeHost& fuzzHost() {
+  static SystemClock clock;
+  static NativeHost* host = nullptr;
+  if (!host) {
+    Serial.setOutput(nullptr);
+    host = new NativeHost(clock);
+    host->begin();
+  }
+  if (host->core.snapshot()->size() == 0) {
+    // Keep a few signals around so ids point somewhere
+    for (unsigned long value = 1; value <= 3; value++) {
+      host->radio.inject(RadioFrame{value * 1111, 24, 1});
+      host->settle();
+    }
+    host->pump();
+  }
+  return *host;
+}
+
+static void fuzzApi(const uint8_t* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  NativeHost& host = fuzzHost();
+  const std::vector<SnifferApi::Route>& routes = host.api.routes();
+  size_t index = data[0] % (routes.size() + 1);
+  
+  ApiResponse response(0, "", String());
+  if (index == routes.size()) {
+    response = host.importBody(data + 1, size - 1);
+  } else {
+    ApiRequest request;
+    request.method = routes[index].method;
+    request.path = routes[index].path;
+    request.client = 0x0100007f;
+    size_t start = 1;
+    while (start <= size) {
+      size_t end = start;
+      while (end < size && data[end] != '&') {
+        end++;
+      }
+      size_t equals = start;
+      while (equals < end && data[equals] != '=') {
+        equals++;
+      }
+      ApiParam param;
+      param.name = toString(data + start, equals - start);
+      param.value = equals < end ? toString(data + equals + 1, end - equals - 1) : String();
+      param.body = false;
+      request.params.push_back(param);
+      param.body = true;
+      request.params.push_back(param);
+      start = end + 1;
+    }
+    response = host.request(request);
+  }
+  FUZZ_CHECK(response.status >= 200 && response.status < 600);
+  FUZZ_CHECK(host.core.snapshot()->size() <= (size_t)SnifferCore::MAX_SIGNALS);
+}
+
+static void seedApi(std::vector<std::string>& corpus) {
+  const char* params[] = {
+    "id=0&count=3&enabled=true&favorite=true&days=7&name=Gate&tag=garage",
+    "q=protocol in {1,2} and bits >= 12&offset=0&limit=10",
+    "expr=tag:garage AND NOT favorite&limit=5",
+    "since=0&format=binary",
+    "id=-1&count=101&enabled=maybe&limit=0&offset=-1",
+    "uid=1&trigger=0&target=1&action=transmit&tag=garage",
+  };
+  size_t routes = fuzzHost().api.routes().size();
+  for (size_t index = 0; index < routes; index++) {
+    for (const char* text : params) {
+      corpus.push_back(std::string(1, (char)index) + text);
+    }
+  }
+  corpus.push_back(std::string(1, (char)routes) +
+    "{\"uid\":1,\"name\":\"Gate\",\"value\":5393,\"bitLength\":24,\"protocol\":1,\"tags\":[\"garage\"]}\n");
+}
+
+// query: /api/signals/query filter expressions
+static void fuzzQuery(const uint8_t* data, size_t size) {
+  static SignalStore* library = nullptr;
+  if (!library) {
+    library = new SignalStore();
+    fillLibrary(*library);
+  }
+  SignalQuery query;
+  String error;
+  if (!compileSignalQuery(toString(data, size), query, error)) {
+    FUZZ_CHECK(error.length() > 0);
+    return;
+  }
+  SignalStore::Snapshot snapshot = library->snapshot();
+  std::vector<uint32_t> matches;
+  runSignalQuery(query, *snapshot, 3600000, matches);
+  for (size_t i = 0; i < matches.size(); i++) {
+    FUZZ_CHECK(matches[i] < snapshot->size());
+    FUZZ_CHECK(i == 0 || matches[i - 1] < matches[i]);
+  }
+}
+
+static void seedQuery(std::vector<std::string>& corpus) {
+  corpus.push_back("protocol in {1,2} and bits in 12..32");
+  corpus.push_back("protocol = 1 and bits >= 12 and bits <= 24");
+  corpus.push_back("seen < 3600 and name ^= \"Gar\" and !favorite");
+  corpus.push_back("favorite and name ^= Gate");
+}
+
+// tags: /api/signals/tagged selection expressions
+static void fuzzTags(const uint8_t* data, size_t size) {
+  static SignalStore* library = nullptr;
+  if (!library) {
+    library = new SignalStore();
+    fillLibrary(*library);
+  }
+  SignalStore::Snapshot snapshot = library->snapshot();
+  RoaringBitmap selected;
+  String error;
+  if (snapshot->tags.select(toString(data, size), selected, error)) {
+    std::vector<uint32_t> uids;
+    selected.toVector(uids);
+    for (uint32_t uid : uids) {
+      FUZZ_CHECK(snapshot->positionOf(uid) >= 0);
+    }
+  }
+}
+
+static void seedTags(std::vector<std::string>& corpus) {
+  corpus.push_back("tag:garage AND NOT favorite");
+  corpus.push_back("(tag:garage OR tag:house) AND all");
+  corpus.push_back("favorite");
+}
+
+// import: upload bodies in either backup format, fed in chunks whose size
+// is the first byte
+static void fuzzImport(const uint8_t* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  size_t chunk = data[0] + 1;
+  SignalImporter importer(16);
+  bool ok = true;
+  for (size_t offset = 1; ok && offset < size; offset += chunk) {
+    ok = importer.feed(data + offset, std::min(chunk, size - offset));
+  }
+  if (ok && importer.finish()) {
+    FUZZ_CHECK(importer.records().size() <= 16);
+    for (const ImportedSignal& imported : importer.records()) {
+      FUZZ_CHECK(imported.signal.bitLength >= 1 && imported.signal.bitLength <= 64);
+      FUZZ_CHECK(imported.signal.protocol >= 1 && imported.signal.protocol <= 255);
+      FUZZ_CHECK(imported.signal.name.length() <= MAX_NAME_LENGTH);
+    }
+  } else {
+    FUZZ_CHECK(importer.error().length() > 0);
+  }
+}
+
+static void seedImport(std::vector<std::string>& corpus) {
+  SignalStore library;
+  fillLibrary(library);
+  // A name past the limit with a two-byte character across the cut
+  RFSignal longName = library.at(0);
+  longName.uid = 5;
+  longName.value = 1;
+  longName.name = (std::string(MAX_NAME_LENGTH - 1, 'a') + "\xc3\xa9" + std::string(100, 'b')).c_str();
+  library.add(longName);
+  library.publish();
+  for (ExportFormat format : {EXPORT_BINARY, EXPORT_NDJSON}) {
+    SignalExporter exporter(library.snapshot(), format);
+    std::string body(1, (char)63);
+    uint8_t buffer[256];
+    size_t length;
+    while ((length = exporter.read(buffer, sizeof(buffer))) > 0) {
+      body.append((const char*)buffer, length);
+    }
+    corpus.push_back(body);
+  }
+}
+
+// store: a Preferences image as loadSignals() finds it after a reboot.
+// Whatever loads must survive a save and load unchanged.
+static void fuzzStore(const uint8_t* data, size_t size) {
+  static const int CAPACITY = 64;
+  MemoryStore preferences;
+  preferences.load(data, size);
+  SignalStore store;
+  int nextId;
+  loadSignals(preferences, store, nextId, CAPACITY);
+  
+  FUZZ_CHECK(store.size() <= (size_t)CAPACITY);
+  FUZZ_CHECK(nextId >= 0);
+  std::set<uint32_t> uids;
+  for (size_t i = 0; i < store.size(); i++) {
+    const RFSignal& signal = store.at(i);
+    FUZZ_CHECK(uids.insert(signal.uid).second);
+    FUZZ_CHECK(signal.uid < (uint32_t)nextId);
+    FUZZ_CHECK(signal.bitLength >= 1 && signal.bitLength <= 64);
+  }
+  
+  MemoryStore saved;
+  saveSignals(saved, store, nextId);
+  SignalStore reloaded;
+  int reloadedNextId;
+  FUZZ_CHECK(!loadSignals(saved, reloaded, reloadedNextId, CAPACITY));
+  FUZZ_CHECK(reloaded.size() == store.size() && reloadedNextId == nextId);
+  FUZZ_CHECK(reloaded.currentTags().list().size() == store.currentTags().list().size());
+}
+
+static void seedStore(std::vector<std::string>& corpus) {
+  SignalStore library;
+  fillLibrary(library);
+  MemoryStore preferences;
+  saveSignals(preferences, library, library.size());
+  std::vector<uint8_t> image;
+  preferences.encode(image);
+  corpus.push_back(std::string(image.begin(), image.end()));
+}
+
+// bitmap: tag membership as stored in flash
+static void fuzzBitmap(const uint8_t* data, size_t size) {
+  RoaringBitmap bitmap;
+  if (!bitmap.deserialize(data, size)) {
+    return;
+  }
+  std::vector<uint8_t> encoded;
+  bitmap.serialize(encoded);
+  RoaringBitmap decoded;
+  FUZZ_CHECK(decoded.deserialize(encoded.data(), encoded.size()));
+  FUZZ_CHECK(decoded.cardinality() == bitmap.cardinality());
+  std::vector<uint8_t> again;
+  decoded.serialize(again);
+  FUZZ_CHECK(again == encoded);
+  
+  // Set operations against a dense and a sparse chunk, as tag expressions mix them
+  static RoaringBitmap other;
+  if (other.empty()) {
+    for (uint32_t id = 1; id < 10000; id += 2) {
+      other.add(id);
+    }
+    for (uint32_t id = 65536; id < 65600; id += 5) {
+      other.add(id);
+    }
+  }
+  std::vector<uint32_t> ids, otherIds;
+  bitmap.toVector(ids);
+  other.toVector(otherIds);
+  const RoaringBitmap results[] = {RoaringBitmap::intersect(bitmap, other), RoaringBitmap::unite(bitmap, other),
+                                   RoaringBitmap::subtract(bitmap, other), RoaringBitmap::subtract(other, bitmap)};
+  std::vector<uint32_t> expected[4];
+  std::set_intersection(ids.begin(), ids.end(), otherIds.begin(), otherIds.end(), std::back_inserter(expected[0]));
+  std::set_union(ids.begin(), ids.end(), otherIds.begin(), otherIds.end(), std::back_inserter(expected[1]));
+  std::set_difference(ids.begin(), ids.end(), otherIds.begin(), otherIds.end(), std::back_inserter(expected[2]));
+  std::set_difference(otherIds.begin(), otherIds.end(), ids.begin(), ids.end(), std::back_inserter(expected[3]));
+  for (int i = 0; i < 4; i++) {
+    std::vector<uint32_t> actual;
+    results[i].toVector(actual);
+    FUZZ_CHECK(actual == expected[i] && results[i].cardinality() == expected[i].size());
+  }
+}
+
+static void seedBitmap(std::vector<std::string>& corpus) {
+  RoaringBitmap sparse, dense;
+  for (uint32_t id = 0; id < 40; id += 3) {
+    sparse.add(id);
+  }
+  sparse.add(70000);
+  for (uint32_t id = 0; id < 6000; id++) {
+    dense.add(id);
+    dense.add(65536 + id);
+  }
+  for (const RoaringBitmap* bitmap : {&sparse, &dense}) {
+    std::vector<uint8_t> encoded;
+    bitmap->serialize(encoded);
+    corpus.push_back(std::string(encoded.begin(), encoded.end()));
+  }
+}
+
+const FuzzTarget FUZZ_TARGETS[] = {
+  {"params", "Number and flag parameter parsers", fuzzParams, seedParams},
+  {"api", "Every API route's parameters, and import uploads", fuzzApi, seedApi},
+  {"query", "Signal query filter expressions", fuzzQuery, seedQuery},
+  {"tags", "Tag selection expressions", fuzzTags, seedTags},
+  {"import", "NDJSON and binary backup parser", fuzzImport, seedImport},
+  {"store", "Library loader over a Preferences image", fuzzStore, seedStore},
+  {"bitmap", "Stored tag bitmaps", fuzzBitmap, seedBitmap},
+};
+
+const size_t FUZZ_TARGET_COUNT = sizeof(FUZZ_TARGETS) / sizeof(FUZZ_TARGETS[0]);
+
+const FuzzTarget* findFuzzTarget(const char* name) {
+  for (size_t i = 0; i < FUZZ_TARGET_COUNT; i++) {
+    if (strcmp(FUZZ_TARGETS[i].name, name) == 0) {
+      return &FUZZ_TARGETS[i];
+    }
+  }
+  return nullptr;
+}
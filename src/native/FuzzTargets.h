@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Fuzz targets over everything that parses untrusted bytes: API parameters,
+// filter and tag expressions, import uploads and what loadSignals() reads
+// back from flash. They are shared by the libFuzzer build (env:fuzz) and
+// the native program's fuzz subcommand. A target must accept any input;
+// broken invariants abort() so the fuzzer records the input.
+struct FuzzTarget {
+  const char* name;
+  const char* help;
+  void (*run)(const uint8_t* data, size_t size);
+  // Valid inputs to start mutating from
+  void (*seeds)(std::vector<std::string>& corpus);
+};
+
+extern const FuzzTarget FUZZ_TARGETS[];
+extern const size_t FUZZ_TARGET_COUNT;
+
+const FuzzTarget* findFuzzTarget(const char* name);
@@ -0,0 +1,369 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NativeCommands.h"
+#include "NativeHost.h"
+
+// Button press to dashboard: timestamped frames go into the receive path
+// while a push client (the /api/events stream) and a polling dashboard
+// watch for them, and background clients load the API. Per frame it
+// records when the library was published with it and when each client
+// had it, all measured from the receiver interrupt.
+
+// Measured frames are the only codes in this range; prefill sits below it
+static const uint32_t FRAME_BASE = 0x400000;
+static const uint32_t PREFILL_BASE = 0x200000;
+
+enum LatencyStage { STAGE_STORED, STAGE_PUSH, STAGE_POLL, STAGE_COUNT };
+
+static const char* STAGE_NAMES[] = {"stored", "push", "poll"};
+
+static uint64_t nowUs() {
+  static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+// 0 = never reached; each field has a single writer
+struct FrameTimes {
+  uint64_t injectedUs;
+  uint64_t stageUs[STAGE_COUNT];
+};
+
+// Stand-in for AsyncEventSource and one connected browser: the owner task
+// queues the same text the device sends, a client thread reads it
+class EventStream {
+public:
+  EventStream() : closed(false) {}
+
+  void send(uint32_t uid, size_t frame, const String& data) {
+    char header[64];
+    snprintf(header, sizeof(header), "event: capture\nid: %u\ndata: ", uid);
+    std::lock_guard<std::mutex> lock(streamMutex);
+    frames[uid] = frame;
+    messages.push_back(std::string(header) + data.c_str() + "\n\n");
+    ready.notify_one();
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(streamMutex);
+    closed = true;
+    ready.notify_one();
+  }
+
+  // Blocks for the next event; false once closed and drained
+  bool receive(size_t& frame) {
+    std::unique_lock<std::mutex> lock(streamMutex);
+    ready.wait(lock, [this]() { return closed || !messages.empty(); });
+    if (messages.empty()) {
+      return false;
+    }
+    std::string message = messages.front();
+    messages.pop_front();
+    const char* id = strstr(message.c_str(), "\nid: ");
+    std::map<uint32_t, size_t>::iterator match = frames.end();
+    if (id) {
+      match = frames.find(strtoul(id + 5, nullptr, 10));
+    }
+    if (match == frames.end()) {
+      frame = SIZE_MAX;
+      return true;
+    }
+    frame = match->second;
+    frames.erase(match);
+    return true;
+  }
+
+private:
+  std::mutex streamMutex;
+  std::condition_variable ready;
+  std::deque<std::string> messages;
+  std::map<uint32_t, size_t> frames;  // uid -> measured frame
+  bool closed;
+};
+
+static ApiRequest makeRequest(HttpMethod method, const char* path) {
+  ApiRequest request;
+  request.method = method;
+  request.path = path;
+  request.client = 0x0200007f;
+  return request;
+}
+
+static void drainBody(ApiResponse& response) {
+  if (response.stream) {
+    uint8_t buffer[1024];
+    while (response.stream(buffer, sizeof(buffer)) > 0) {
+    }
+  }
+}
+
+// Other browsers and scripts: listings, status, metrics and a transmit now and then
+static void backgroundRequest(NativeHost& host, unsigned long n, std::mt19937& random) {
+  ApiRequest request;
+  switch (n % 8) {
+    case 0:
+    case 4:
+      request = makeRequest(METHOD_GET, "/api/signals");
+      break;
+    case 1:
+    case 5:
+      request = makeRequest(METHOD_GET, "/api/status");
+      break;
+    case 2:
+      request = makeRequest(METHOD_GET, "/metrics");
+      break;
+    case 3:
+    case 6:
+      request = makeRequest(METHOD_GET, "/api/signals/query");
+      request.params.push_back(ApiParam{"limit", "20", false});
+      break;
+    default:
+      request = makeRequest(METHOD_POST, "/api/transmit");
+      request.params.push_back(ApiParam{"id", String((unsigned long)(random() % 100)), true});
+      break;
+  }
+  ApiResponse response = host.api.handle(request);
+  drainBody(response);
+}
+
+// The dashboard's refresh: the full library, marking each measured frame
+// the first time it shows up. The binary export stands in for /api/signals
+// so the stand-in needs no JSON parser; both list every signal.
+static void pollLibrary(NativeHost& host, std::vector<FrameTimes>& times) {
+  ApiRequest request = makeRequest(METHOD_GET, "/api/export");
+  request.client = 0x0300007f;
+  request.params.push_back(ApiParam{"format", "binary", false});
+  ApiResponse response = host.api.handle(request);
+  SignalImporter importer(SnifferCore::MAX_SIGNALS);
+  if (response.stream) {
+    uint8_t buffer[1024];
+    size_t length;
+    while ((length = response.stream(buffer, sizeof(buffer))) > 0) {
+      importer.feed(buffer, length);
+    }
+  } else {
+    importer.feed((const uint8_t*)response.body.c_str(), response.body.length());
+  }
+  if (!importer.finish()) {
+    return;
+  }
+  uint64_t now = nowUs();
+  for (const ImportedSignal& record : importer.records()) {
+    uint32_t frame = record.signal.value - FRAME_BASE;
+    if (record.signal.value >= FRAME_BASE && frame < times.size() && times[frame].stageUs[STAGE_POLL] == 0) {
+      times[frame].stageUs[STAGE_POLL] = now;
+    }
+  }
+}
+
+struct LoadResult {
+  double requestRate;  // Background requests/s actually served
+  unsigned long overwritten;
+  std::vector<FrameTimes> times;
+};
+
+struct LatencyConfig {
+  size_t frames;
+  double frameRate;
+  size_t prefill;
+  unsigned long pollMs;
+  unsigned long loopWaitMs;
+  uint32_t seed;
+};
+
+static LoadResult measure(const LatencyConfig& config, double loadRate) {
+  SystemClock clock;
+  NativeHost host(clock);
+  host.radio.setCapacity(1);  // RCSwitch latches a single frame
+  LoadResult result;
+  result.times.assign(config.frames, FrameTimes());
+  std::vector<FrameTimes>& times = result.times;
+  
+  EventStream events;
+  host.core.onCapture([&](const CaptureEvent& event) {
+    uint32_t frame = event.signal.value - FRAME_BASE;
+    if (event.signal.value < FRAME_BASE || frame >= times.size()) {
+      return;
+    }
+    times[frame].stageUs[STAGE_STORED] = nowUs();
+    events.send(event.signal.uid, frame, SnifferApi::captureEventJson(event));
+  });
+  host.begin();
+  for (size_t i = 0; i < config.prefill; i++) {
+    host.radio.inject(RadioFrame{PREFILL_BASE + (uint32_t)i, 24, 1});
+    host.settle();
+  }
+  
+  std::atomic<bool> running(true);
+  std::thread pushClient([&]() {
+    size_t frame;
+    while (events.receive(frame)) {
+      if (frame < times.size()) {
+        times[frame].stageUs[STAGE_PUSH] = nowUs();
+      }
+    }
+  });
+  std::thread pollClient([&]() {
+    while (running) {
+      uint64_t next = nowUs() + config.pollMs * 1000;
+      pollLibrary(host, times);
+      while (running && nowUs() < next) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  });
+  std::atomic<unsigned long> served(0);
+  std::thread background([&]() {
+    if (loadRate <= 0) {
+      return;
+    }
+    std::mt19937 random(config.seed + 1);
+    uint64_t next = nowUs();
+    while (running) {
+      backgroundRequest(host, served, random);
+      served++;
+      next += 1000000 / loadRate;
+      while (running && nowUs() < next) {
+        std::this_thread::sleep_for(std::chrono::microseconds(std::min<uint64_t>(next - nowUs(), 1000)));
+      }
+    }
+  });
+  
+  // Presses arrive at random, config.frameRate per second on average
+  std::atomic<bool> injected(false);
+  uint64_t started = nowUs();
+  std::thread receiver([&]() {
+    std::mt19937 random(config.seed);
+    std::exponential_distribution<double> gap(config.frameRate);
+    std::chrono::steady_clock::time_point at = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < config.frames; i++) {
+      at += std::chrono::microseconds((uint64_t)(gap(random) * 1e6));
+      std::this_thread::sleep_until(at);
+      times[i].injectedUs = nowUs();
+      host.radio.inject(RadioFrame{FRAME_BASE + (uint32_t)i, 24, 1});
+    }
+    injected = true;
+  });
+  
+  // This thread is loop(); after the last frame it keeps going for two
+  // polls so the dashboard gets to see it
+  while (!injected || host.radio.pending() > 0) {
+    host.pump(config.loopWaitMs);
+  }
+  uint64_t lastInjected = nowUs();
+  while (nowUs() < lastInjected + config.pollMs * 2000 + 100000) {
+    host.pump(config.loopWaitMs);
+  }
+  double seconds = (nowUs() - started) / 1e6;
+  running = false;
+  events.close();
+  receiver.join();
+  pushClient.join();
+  pollClient.join();
+  background.join();
+  
+  result.requestRate = served / seconds;
+  result.overwritten = host.radio.overwritten();
+  return result;
+}
+
+static double percentile(const std::vector<double>& sorted, double q) {
+  return sorted[(size_t)(q * (sorted.size() - 1) + 0.5)];
+}
+
+static bool parseList(const char* text, std::vector<double>& values) {
+  values.clear();
+  while (*text) {
+    char* end;
+    values.push_back(strtod(text, &end));
+    if (end == text || values.back() < 0 || (*end != ',' && *end != '\0')) {
+      return false;
+    }
+    text = *end ? end + 1 : end;
+  }
+  return !values.empty();
+}
+
+// latency [--frames N] [--rate HZ] [--loads R,..] [--prefill N] [--poll-ms MS] [--loop-wait MS] [--seed S]
+int runLatency(const Options& options, int argc, char** argv) {
+  LatencyConfig config = {200, 20, 500, 5000, 10, 433};
+  std::vector<double> loads = {0, 20, 100};
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+      config.frames = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--rate") == 0 && hasValue) {
+      config.frameRate = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--loads") == 0 && hasValue) {
+      if (!parseList(argv[++i], loads)) {
+        fprintf(stderr, "latency: --loads takes requests/s like 0,20,100\n");
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--prefill") == 0 && hasValue) {
+      config.prefill = std::min(strtoul(argv[++i], nullptr, 10), (unsigned long)SnifferCore::AUTO_CLEANUP_THRESHOLD);
+    } else if (strcmp(argv[i], "--poll-ms") == 0 && hasValue) {
+      config.pollMs = std::max(strtoul(argv[++i], nullptr, 10), 1UL);
+    } else if (strcmp(argv[i], "--loop-wait") == 0 && hasValue) {
+      config.loopWaitMs = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+      config.seed = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "latency: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (config.frames == 0 || config.frameRate <= 0) {
+    fprintf(stderr, "latency: --frames and --rate must be positive\n");
+    return 2;
+  }
+  
+  printf("%zu frames at %.1f/s per load, %zu signals stored first, dashboard polls every %lu ms\n",
+         config.frames, config.frameRate, config.prefill, config.pollMs);
+  printf("%-8s %9s %-7s %7s %9s %9s %9s %7s\n", "load/s", "served/s", "stage", "frames",
+         "p50 ms", "p99 ms", "max ms", "missed");
+  for (double load : loads) {
+    LoadResult result = measure(config, load);
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+      std::vector<double> latencies;
+      for (const FrameTimes& frame : result.times) {
+        if (frame.stageUs[stage] != 0) {
+          // A poll can land between publish and the listener; never below 0
+          latencies.push_back((std::max(frame.stageUs[stage], frame.injectedUs) - frame.injectedUs) / 1000.0);
+        }
+      }
+      std::sort(latencies.begin(), latencies.end());
+      char loadText[16] = "";
+      char servedText[16] = "";
+      if (stage == 0) {
+        snprintf(loadText, sizeof(loadText), "%.0f", load);
+        snprintf(servedText, sizeof(servedText), "%.1f", result.requestRate);
+      }
+      if (latencies.empty()) {
+        printf("%-8s %9s %-7s %7d %9s %9s %9s %7zu\n", loadText, servedText, STAGE_NAMES[stage], 0,
+               "-", "-", "-", config.frames);
+        continue;
+      }
+      printf("%-8s %9s %-7s %7zu %9.2f %9.2f %9.2f %7zu\n", loadText, servedText, STAGE_NAMES[stage],
+             latencies.size(), percentile(latencies, 0.5), percentile(latencies, 0.99), latencies.back(),
+             config.frames - latencies.size());
+    }
+    if (options.verbose && result.overwritten > 0) {
+      fprintf(stderr, "latency: %lu frames overwritten in the receiver before loop() read them\n",
+              result.overwritten);
+    }
+  }
+  return 0;
+}
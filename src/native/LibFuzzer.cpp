@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FuzzTargets.h"
+
+// libFuzzer entry points for env:fuzz, which replaces main.cpp. The target
+// comes from RF_FUZZ_TARGET; everything else is libFuzzer's own options:
+//   RF_FUZZ_TARGET=api .pio/build/fuzz/program -max_total_time=600 corpus/api
+
+static const FuzzTarget* target = nullptr;
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+  const char* name = getenv("RF_FUZZ_TARGET");
+  target = name ? findFuzzTarget(name) : nullptr;
+  if (!target) {
+    fprintf(stderr, "Set RF_FUZZ_TARGET to one of:\n");
+    for (size_t i = 0; i < FUZZ_TARGET_COUNT; i++) {
+      fprintf(stderr, "  %-8s %s\n", FUZZ_TARGETS[i].name, FUZZ_TARGETS[i].help);
+    }
+    exit(2);
+  }
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  target->run(data, size);
+  return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Subcommands of the native program (see main.cpp)
+
+struct Options {
+  const char* storePath;
+  bool verbose;
+};
+
+// Each returns the process exit code; argv holds the subcommand's own arguments
+int runScript(const Options& options, int argc, char** argv);
+int runBench(const Options& options, int argc, char** argv);
+int runGenerate(const Options& options, int argc, char** argv);
+int runReplay(const Options& options, int argc, char** argv);
+int runFuzz(const Options& options, int argc, char** argv);
+int runPowerLoss(const Options& options, int argc, char** argv);
+int runSoak(const Options& options, int argc, char** argv);
+int runLatency(const Options& options, int argc, char** argv);
+int runAnalytics(const Options& options, int argc, char** argv);
+int runFlood(const Options& options, int argc, char** argv);
+int runStress(const Options& options, int argc, char** argv);
@@ -0,0 +1,211 @@
+#include "NativeHal.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+uint32_t SystemClock::cycles() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool QueueRadio::receive(RadioFrame& frame) {
+  std::lock_guard<std::mutex> lock(radioMutex);
+  if (received.empty()) {
+    return false;
+  }
+  frame = received.front();
+  received.pop_front();
+  return frame.value != 0;
+}
+
+void QueueRadio::transmit(const RadioFrame& frame) {
+  {
+    std::lock_guard<std::mutex> lock(radioMutex);
+    sent.push_back(frame);
+  }
+  if (transmitListener) {
+    transmitListener(frame);
+  }
+}
+
+void QueueRadio::inject(const RadioFrame& frame) {
+  std::lock_guard<std::mutex> lock(radioMutex);
+  if (capacity > 0 && received.size() >= capacity) {
+    received.pop_front();
+    overwrittenFrames++;
+  }
+  received.push_back(frame);
+}
+
+size_t QueueRadio::pending() {
+  std::lock_guard<std::mutex> lock(radioMutex);
+  return received.size();
+}
+
+std::vector<RadioFrame> QueueRadio::transmitted() {
+  std::lock_guard<std::mutex> lock(radioMutex);
+  return sent;
+}
+
+void QueueRadio::clearTransmitted() {
+  std::lock_guard<std::mutex> lock(radioMutex);
+  sent.clear();
+}
+
+// File layout: per entry a key length byte, key, 32-bit value length, value
+bool MemoryStore::open(const char* file) {
+  path = file;
+  values.clear();
+  dirty = false;
+  
+  FILE* in = fopen(file, "rb");
+  if (!in) {
+    return false;
+  }
+  std::vector<uint8_t> image;
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    image.insert(image.end(), chunk, chunk + read);
+  }
+  fclose(in);
+  load(image.data(), image.size());
+  return true;
+}
+
+bool MemoryStore::load(const uint8_t* data, size_t length) {
+  values.clear();
+  size_t offset = 0;
+  while (offset < length) {
+    // Entry: u8 key length, key, u32 value length, value
+    size_t keyLength = data[offset++];
+    uint32_t valueLength;
+    if (length - offset < keyLength + sizeof(valueLength)) {
+      return false;
+    }
+    std::string key((const char*)data + offset, keyLength);
+    offset += keyLength;
+    memcpy(&valueLength, data + offset, sizeof(valueLength));
+    offset += sizeof(valueLength);
+    if (length - offset < valueLength) {
+      return false;
+    }
+    values[key].assign(data + offset, data + offset + valueLength);
+    offset += valueLength;
+  }
+  return true;
+}
+
+bool MemoryStore::save() {
+  if (path.empty() || !dirty) {
+    return true;
+  }
+  FILE* out = fopen(path.c_str(), "wb");
+  if (!out) {
+    return false;
+  }
+  std::vector<uint8_t> image;
+  encode(image);
+  fwrite(image.data(), 1, image.size(), out);
+  dirty = false;
+  return fclose(out) == 0;
+}
+
+void MemoryStore::encode(std::vector<uint8_t>& image) const {
+  image.clear();
+  for (const auto& entry : values) {
+    uint8_t keyLength = entry.first.size();
+    uint32_t length = entry.second.size();
+    image.push_back(keyLength);
+    image.insert(image.end(), entry.first.begin(), entry.first.begin() + keyLength);
+    const uint8_t* lengthBytes = (const uint8_t*)&length;
+    image.insert(image.end(), lengthBytes, lengthBytes + sizeof(length));
+    image.insert(image.end(), entry.second.begin(), entry.second.end());
+  }
+}
+
+bool MemoryStore::read(const char* key, void* value, size_t length) {
+  auto found = values.find(key);
+  if (found == values.end() || found->second.size() != length) {
+    return false;
+  }
+  memcpy(value, found->second.data(), length);
+  return true;
+}
+
+void MemoryStore::write(const char* key, const void* value, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)value;
+  values[key].assign(bytes, bytes + length);
+  dirty = true;
+}
+
+int MemoryStore::getInt(const char* key, int fallback) {
+  int32_t value;
+  return read(key, &value, sizeof(value)) ? value : fallback;
+}
+
+void MemoryStore::putInt(const char* key, int value) {
+  int32_t stored = value;
+  write(key, &stored, sizeof(stored));
+}
+
+unsigned int MemoryStore::getUInt(const char* key, unsigned int fallback) {
+  uint32_t value;
+  return read(key, &value, sizeof(value)) ? value : fallback;
+}
+
+void MemoryStore::putUInt(const char* key, unsigned int value) {
+  uint32_t stored = value;
+  write(key, &stored, sizeof(stored));
+}
+
+unsigned long MemoryStore::getULong(const char* key, unsigned long fallback) {
+  uint32_t value;
+  return read(key, &value, sizeof(value)) ? value : fallback;
+}
+
+void MemoryStore::putULong(const char* key, unsigned long value) {
+  uint32_t stored = value;
+  write(key, &stored, sizeof(stored));
+}
+
+bool MemoryStore::getBool(const char* key, bool fallback) {
+  uint8_t value;
+  return read(key, &value, sizeof(value)) ? value != 0 : fallback;
+}
+
+void MemoryStore::putBool(const char* key, bool value) {
+  uint8_t stored = value ? 1 : 0;
+  write(key, &stored, sizeof(stored));
+}
+
+String MemoryStore::getString(const char* key, const String& fallback) {
+  auto found = values.find(key);
+  if (found == values.end()) {
+    return fallback;
+  }
+  return String((const char*)found->second.data(), found->second.size());
+}
+
+void MemoryStore::putString(const char* key, const String& value) {
+  write(key, value.c_str(), value.length());
+}
+
+size_t MemoryStore::getBytesLength(const char* key) {
+  auto found = values.find(key);
+  return found == values.end() ? 0 : found->second.size();
+}
+
+size_t MemoryStore::getBytes(const char* key, void* buffer, size_t maxLength) {
+  auto found = values.find(key);
+  if (found == values.end() || found->second.size() > maxLength) {
+    return 0;
+  }
+  memcpy(buffer, found->second.data(), found->second.size());
+  return found->second.size();
+}
+
+void MemoryStore::putBytes(const char* key, const void* data, size_t length) {
+  write(key, data, length);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Hal.h"
+
+// Host stand-ins for the hardware interfaces in Hal.h
+
+// Wall clock since process start
+class SystemClock : public Clock {
+public:
+  unsigned long millis() override { return ::millis(); }
+  unsigned long micros() override { return ::micros(); }
+  uint32_t cycles() override;  // Nanoseconds, truncated
+};
+
+// Time only moves when told to, for accelerated and repeatable runs
+class ManualClock : public Clock {
+public:
+  ManualClock() : nowUs(0) {}
+
+  unsigned long millis() override { return nowUs / 1000; }
+  unsigned long micros() override { return nowUs; }
+  uint32_t cycles() override { return nowUs; }
+
+  void advanceMicros(unsigned long us) { nowUs += us; }
+  void advanceMillis(unsigned long ms) { nowUs += ms * 1000UL; }
+
+private:
+  std::atomic<unsigned long> nowUs;
+};
+
+// Frames are injected by the host; transmissions are recorded.
+// With capacity 1 it behaves like RCSwitch: a frame nobody has read yet
+// is overwritten by the next decode.
+class QueueRadio : public Radio {
+public:
+  explicit QueueRadio(size_t capacity = 0) : capacity(capacity), overwrittenFrames(0) {}
+
+  bool receive(RadioFrame& frame) override;
+  void transmit(const RadioFrame& frame) override;
+
+  // Any thread
+  void inject(const RadioFrame& frame);
+  size_t pending();
+  std::vector<RadioFrame> transmitted();
+  void clearTransmitted();  // Long runs would otherwise record without bound
+  unsigned long overwritten() const { return overwrittenFrames; }
+  void setCapacity(size_t frames) { capacity = frames; }  // 0 = unbounded
+  // Called on the transmitting thread after each transmission, outside the
+  // lock so it may inject the echo the receiver would pick up; set it first
+  void onTransmit(std::function<void(const RadioFrame&)> listener) { transmitListener = listener; }
+
+private:
+  std::mutex radioMutex;
+  std::deque<RadioFrame> received;
+  std::vector<RadioFrame> sent;
+  std::function<void(const RadioFrame&)> transmitListener;
+  size_t capacity;
+  std::atomic<unsigned long> overwrittenFrames;
+};
+
+// Preferences namespace held in memory, optionally mirrored to a file.
+// Values keep their NVS widths, so ULong stays 32-bit like on the device.
+class MemoryStore : public KeyValueStore {
+public:
+  MemoryStore() : dirty(false) {}
+
+  // Load path if it exists; save() writes changes back to it
+  bool open(const char* path);
+  bool save();
+  // The file format: per entry u8 key length, key, u32 value length, value
+  void encode(std::vector<uint8_t>& image) const;
+  // Replace the contents with an encoded image; false if it is truncated
+  bool load(const uint8_t* data, size_t length);
+  size_t entries() const { return values.size(); }
+
+  int getInt(const char* key, int fallback) override;
+  void putInt(const char* key, int value) override;
+  unsigned int getUInt(const char* key, unsigned int fallback) override;
+  void putUInt(const char* key, unsigned int value) override;
+  unsigned long getULong(const char* key, unsigned long fallback) override;
+  void putULong(const char* key, unsigned long value) override;
+  bool getBool(const char* key, bool fallback) override;
+  void putBool(const char* key, bool value) override;
+  String getString(const char* key, const String& fallback) override;
+  void putString(const char* key, const String& value) override;
+  size_t getBytesLength(const char* key) override;
+  size_t getBytes(const char* key, void* buffer, size_t maxLength) override;
+  void putBytes(const char* key, const void* data, size_t length) override;
+
+private:
+  bool read(const char* key, void* value, size_t length);
+  void write(const char* key, const void* value, size_t length);
+
+  std::map<std::string, std::vector<uint8_t>> values;
+  std::string path;
+  bool dirty;
+};
+
+// Counts what the buzzer and LED would have done
+class CountingFeedback : public Feedback {
+public:
+  CountingFeedback() : receiveSounds(0), transmitSounds(0), startupSounds(0), ledFlashes(0) {}
+
+  void playReceiveSound() override { receiveSounds++; }
+  void playTransmitSound() override { transmitSounds++; }
+  void playStartupSound() override { startupSounds++; }
+  void flashLED(int duration, int times) override { ledFlashes += times; }
+
+  std::atomic<unsigned long> receiveSounds;
+  std::atomic<unsigned long> transmitSounds;
+  std::atomic<unsigned long> startupSounds;
+  std::atomic<unsigned long> ledFlashes;
+};
@@ -0,0 +1,62 @@
+#include "NativeHost.h"
+
+#include <future>
+
+const AdmissionLimits NativeHost::UNLIMITED = {1e9f, 1e9f, 1e9f, 1e9f, 0.0f, 1000};
+
+NativeHost::NativeHost(Clock& clock, const AdmissionLimits& limits, int capacity)
+  : core(radio, storage, clock, feedback, capacity), api(core, limits) {
+}
+
+void NativeHost::pump(unsigned long waitMs) {
+  core.poll();
+  if (waitMs > 0) {
+    core.waitForWork(waitMs);
+  }
+}
+
+void NativeHost::settle() {
+  do {
+    core.poll();
+  } while (radio.pending() > 0);
+}
+
+ApiResponse NativeHost::request(const ApiRequest& request) {
+  std::future<ApiResponse> pending = std::async(std::launch::async, [this, &request]() {
+    return api.handle(request);
+  });
+  while (pending.wait_for(std::chrono::microseconds(50)) != std::future_status::ready) {
+    core.poll();
+  }
+  
+  ApiResponse response = pending.get();
+  if (response.stream) {
+    uint8_t buffer[1024];
+    size_t length;
+    while ((length = response.stream(buffer, sizeof(buffer))) > 0) {
+      response.body.concat((const char*)buffer, length);
+    }
+    response.stream = nullptr;
+  }
+  return response;
+}
+
+ApiResponse NativeHost::request(HttpMethod method, const char* path) {
+  ApiRequest converted;
+  converted.method = method;
+  converted.path = path;
+  converted.client = 0x0100007f;  // 127.0.0.1
+  return request(converted);
+}
+
+ApiResponse NativeHost::importBody(const uint8_t* data, size_t length) {
+  static const int KEY = 0;
+  std::future<ApiResponse> pending = std::async(std::launch::async, [this, data, length]() {
+    api.importData(&KEY, 0x0100007f, data, length, true);
+    return api.finishImport(&KEY);
+  });
+  while (pending.wait_for(std::chrono::microseconds(50)) != std::future_status::ready) {
+    core.poll();
+  }
+  return pending.get();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "NativeHal.h"
+#include "SnifferApi.h"
+#include "SnifferCore.h"
+
+// A whole device on the host: core, API and stand-in hardware. The thread
+// that calls pump(), settle() and request() is the owner task.
+class NativeHost {
+public:
+  // No rate limits by default; the host is its own only client
+  static const AdmissionLimits UNLIMITED;
+
+  // capacity as for SnifferCore; benchmarks raise it to hold their library
+  NativeHost(Clock& clock, const AdmissionLimits& limits = UNLIMITED, int capacity = SnifferCore::MAX_SIGNALS);
+
+  void begin() { core.begin(); }
+
+  // One owner pass, waiting up to waitMs for commands when idle
+  void pump(unsigned long waitMs = 0);
+  // Poll until every injected frame has been stored or dropped
+  void settle();
+  // Runs the request on a web-server thread while this thread keeps the
+  // owner going, then collects a streamed body into response.body
+  ApiResponse request(const ApiRequest& request);
+  ApiResponse request(HttpMethod method, const char* path);
+  // Upload an import body in one chunk
+  ApiResponse importBody(const uint8_t* data, size_t length);
+
+  QueueRadio radio;
+  MemoryStore storage;
+  CountingFeedback feedback;
+  SnifferCore core;
+  SnifferApi api;
+};
@@ -0,0 +1,757 @@
+#include "NvsEmulator.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// ESP-IDF item types
+static const uint8_t TYPE_U8 = 0x01;
+static const uint8_t TYPE_U32 = 0x04;
+static const uint8_t TYPE_I32 = 0x14;
+static const uint8_t TYPE_SZ = 0x21;
+static const uint8_t TYPE_BLOB = 0x41;
+
+static const uint8_t PAGE_VERSION = 0xFE;
+
+// First 32 bytes of every page; the CRC leaves out the state so it can change
+struct PageHeader {
+  uint32_t state;
+  uint32_t sequence;
+  uint8_t version;
+  uint8_t reserved[19];
+  uint32_t crc32;
+};
+
+static_assert(sizeof(PageHeader) == 32, "NVS page headers are 32 bytes");
+
+static uint32_t crc32(const void* data, size_t length, uint32_t crc = 0) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t headerCrc(const PageHeader& header) {
+  return crc32((const uint8_t*)&header + 4, 24);
+}
+
+// Covers nsIndex..chunkIndex, key and data: everything but the CRC itself
+static uint32_t itemCrc(const void* item) {
+  const uint8_t* bytes = (const uint8_t*)item;
+  return crc32(bytes + 8, 24, crc32(bytes, 4));
+}
+
+static bool isVariable(uint8_t datatype) {
+  return datatype == TYPE_SZ || datatype == TYPE_BLOB;
+}
+
+static bool isKnownType(uint8_t datatype) {
+  return datatype == TYPE_U8 || datatype == TYPE_U32 || datatype == TYPE_I32 || isVariable(datatype);
+}
+
+static bool allErased(const uint8_t* bytes, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (bytes[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ----- EmulatedFlash -----
+
+EmulatedFlash::EmulatedFlash(size_t size)
+  : bytes((size + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE, 0xFF),
+    changes(0), powerLossCountdown(0), lost(false), latencyScale(0) {
+}
+
+bool EmulatedFlash::read(size_t offset, void* data, size_t length) {
+  if (lost || offset > bytes.size() || length > bytes.size() - offset) {
+    return false;
+  }
+  memcpy(data, bytes.data() + offset, length);
+  counters.reads++;
+  counters.bytesRead += length;
+  spend(READ_BASE_US + length * READ_NS_PER_BYTE / 1000.0);
+  return true;
+}
+
+bool EmulatedFlash::write(size_t offset, const void* data, size_t length) {
+  if (lost || offset > bytes.size() || length > bytes.size() - offset) {
+    return false;
+  }
+  bool cut = interrupted();
+  size_t programmed = cut ? length / 2 : length;
+  const uint8_t* source = (const uint8_t*)data;
+  for (size_t i = 0; i < programmed; i++) {
+    bytes[offset + i] &= source[i];  // NOR flash can only clear bits
+  }
+  changes++;
+  counters.writes++;
+  counters.bytesWritten += programmed;
+  spend(WRITE_BASE_US + programmed * WRITE_NS_PER_BYTE / 1000.0);
+  return !cut;
+}
+
+bool EmulatedFlash::erase(size_t sector) {
+  if (lost || sector >= sectors()) {
+    return false;
+  }
+  bool cut = interrupted();
+  size_t offset = sector * SECTOR_SIZE;
+  memset(bytes.data() + offset, 0xFF, cut ? SECTOR_SIZE / 2 : SECTOR_SIZE);
+  changes++;
+  counters.erases++;
+  spend(ERASE_US);
+  return !cut;
+}
+
+bool EmulatedFlash::setImage(const std::vector<uint8_t>& contents) {
+  if (contents.size() != bytes.size()) {
+    return false;
+  }
+  bytes = contents;
+  return true;
+}
+
+bool EmulatedFlash::interrupted() {
+  if (powerLossCountdown > 0 && --powerLossCountdown == 0) {
+    lost = true;
+    return true;
+  }
+  return false;
+}
+
+void EmulatedFlash::spend(double us) {
+  counters.simulatedUs += us;
+  if (latencyScale > 0) {
+    std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(us * latencyScale));
+  }
+}
+
+// ----- NvsStore -----
+
+NvsStore::NvsStore(EmulatedFlash& flash, const char* space)
+  : flash(flash), spaceName(space), space(0), active(0), nextSequence(0),
+    savedGeneration(0), failed(0), error("") {
+  static_assert(sizeof(Item) == ENTRY_SIZE, "NVS entries are 32 bytes");
+  mount();
+}
+
+bool NvsStore::mount() {
+  Page blank;
+  blank.state = PAGE_EMPTY;
+  blank.sequence = 0;
+  memset(blank.entries, ENTRY_EMPTY, sizeof(blank.entries));
+  blank.nextFree = 0;
+  blank.erased = 0;
+  pages.assign(flash.sectors(), blank);
+  items.clear();
+  active = pages.size();
+  nextSequence = 0;
+  space = 0;
+  
+  // Headers first: pages are loaded oldest first so newer duplicates win
+  std::vector<std::pair<uint32_t, size_t>> order;
+  std::vector<uint8_t> sector(EmulatedFlash::SECTOR_SIZE);
+  for (size_t p = 0; p < pages.size(); p++) {
+    PageHeader header;
+    if (!flash.read(p * EmulatedFlash::SECTOR_SIZE, &header, sizeof(header))) {
+      return flashFailed();
+    }
+    bool inUse = header.state == PAGE_ACTIVE || header.state == PAGE_FULL || header.state == PAGE_FREEING;
+    if (inUse && header.crc32 == headerCrc(header)) {
+      pages[p].state = header.state;
+      pages[p].sequence = header.sequence;
+      order.push_back(std::make_pair(header.sequence, p));
+      nextSequence = std::max(nextSequence, header.sequence + 1);
+      continue;
+    }
+    if (header.state == PAGE_EMPTY) {
+      if (!flash.read(p * EmulatedFlash::SECTOR_SIZE, sector.data(), sector.size())) {
+        return flashFailed();
+      }
+      if (allErased(sector.data(), sector.size())) {
+        continue;
+      }
+    }
+    // Torn header, interrupted erase or corrupt page
+    if (!flash.erase(p)) {
+      return flashFailed();
+    }
+  }
+  
+  std::sort(order.begin(), order.end());
+  for (const auto& page : order) {
+    if (!loadPage(page.second)) {
+      return false;
+    }
+  }
+  
+  // Finish a garbage collection that a reset cut short
+  for (size_t p = 0; p < pages.size(); p++) {
+    if (pages[p].state != PAGE_FREEING) {
+      continue;
+    }
+    if (active == pages.size()) {
+      auto empty = std::find_if(pages.begin(), pages.end(), [](const Page& page) { return page.state == PAGE_EMPTY; });
+      if (empty == pages.end() || !activate(empty - pages.begin())) {
+        return fail("no page to finish garbage collection");
+      }
+    }
+    if (!finishFreeing(p)) {
+      return false;
+    }
+  }
+  return openNamespace();
+}
+
+bool NvsStore::loadPage(size_t p) {
+  Page& page = pages[p];
+  uint8_t bitmap[ENTRY_SIZE];
+  if (!flash.read(p * EmulatedFlash::SECTOR_SIZE + BITMAP_OFFSET, bitmap, sizeof(bitmap))) {
+    return flashFailed();
+  }
+  for (size_t i = 0; i < ENTRIES_PER_PAGE; i++) {
+    page.entries[i] = (bitmap[i / 4] >> (2 * (i % 4))) & 3;
+  }
+  
+  for (size_t i = 0; i < ENTRIES_PER_PAGE;) {
+    if (page.entries[i] == ENTRY_EMPTY || page.entries[i] == ENTRY_ERASED) {
+      i++;
+      continue;
+    }
+    Item item;
+    Location location = {p, i, 1, 0};
+    if (!readItem(location, item)) {
+      return flashFailed();
+    }
+    // Bad CRC, truncated span or the illegal state 1: discard the entry
+    if (page.entries[i] != ENTRY_WRITTEN || !validItem(p, i, item)) {
+      if (!setEntryStates(p, i, 1, ENTRY_ERASED)) {
+        return false;
+      }
+      i++;
+      continue;
+    }
+    location.span = item.span;
+    location.datatype = item.datatype;
+    if (!indexItem(item, location)) {
+      return false;
+    }
+    i += item.span;
+  }
+  
+  // Entries marked empty that hold data were torn before their state was set
+  uint8_t entry[ENTRY_SIZE];
+  for (size_t i = 0; i < ENTRIES_PER_PAGE; i++) {
+    if (page.entries[i] != ENTRY_EMPTY) {
+      continue;
+    }
+    if (!flash.read(entryOffset(p, i), entry, sizeof(entry))) {
+      return flashFailed();
+    }
+    if (!allErased(entry, sizeof(entry)) && !setEntryStates(p, i, 1, ENTRY_ERASED)) {
+      return false;
+    }
+  }
+  page.nextFree = 0;
+  for (size_t i = 0; i < ENTRIES_PER_PAGE; i++) {
+    if (page.entries[i] != ENTRY_EMPTY) {
+      page.nextFree = i + 1;
+    }
+  }
+  // Writes only go to the end of the page; retire any gap below it
+  for (size_t i = 0; i < page.nextFree; i++) {
+    if (page.entries[i] == ENTRY_EMPTY && !setEntryStates(p, i, 1, ENTRY_ERASED)) {
+      return false;
+    }
+  }
+  page.erased = std::count(page.entries, page.entries + ENTRIES_PER_PAGE, (uint8_t)ENTRY_ERASED);
+  
+  if (page.state == PAGE_ACTIVE) {
+    // Only the newest page can be active
+    if (active < pages.size() && !writePageState(active, PAGE_FULL)) {
+      return false;
+    }
+    active = p;
+  }
+  return true;
+}
+
+bool NvsStore::validItem(size_t p, size_t entry, const Item& item) {
+  if (item.crc32 != itemCrc(&item) || !isKnownType(item.datatype) || item.span == 0 ||
+      entry + item.span > ENTRIES_PER_PAGE || (item.nsIndex == 0 && item.datatype != TYPE_U8)) {
+    return false;
+  }
+  if (!isVariable(item.datatype)) {
+    return item.span == 1;
+  }
+  
+  uint16_t size;
+  uint32_t dataCrc;
+  memcpy(&size, item.data, sizeof(size));
+  memcpy(&dataCrc, item.data + 4, sizeof(dataCrc));
+  if (size > MAX_VARIABLE_LENGTH || item.span != 1 + (size + ENTRY_SIZE - 1) / ENTRY_SIZE) {
+    return false;
+  }
+  for (size_t i = entry + 1; i < entry + item.span; i++) {
+    if (pages[p].entries[i] != ENTRY_WRITTEN) {
+      return false;
+    }
+  }
+  std::vector<uint8_t> data(size);
+  if (size > 0 && !flash.read(entryOffset(p, entry + 1), data.data(), size)) {
+    return false;
+  }
+  return crc32(data.data(), size) == dataCrc;
+}
+
+bool NvsStore::indexItem(const Item& item, const Location& location) {
+  ItemKey key(item.nsIndex, std::string(item.key, strnlen(item.key, sizeof(item.key))));
+  auto existing = items.find(key);
+  // Pages load oldest first, so the copy already indexed is the stale one
+  if (existing != items.end() && !eraseItem(existing->second)) {
+    return false;
+  }
+  items[key] = location;
+  return true;
+}
+
+bool NvsStore::openNamespace() {
+  Item item;
+  auto found = items.find(ItemKey(0, spaceName));
+  if (found != items.end()) {
+    if (!readItem(found->second, item)) {
+      return flashFailed();
+    }
+    space = item.data[0];
+    return true;
+  }
+  
+  // Like nvs_open() in read/write mode, create it with the lowest free index
+  bool used[256] = {false};
+  for (const auto& entry : items) {
+    if (entry.first.first == 0) {
+      if (!readItem(entry.second, item)) {
+        return flashFailed();
+      }
+      used[item.data[0]] = true;
+    }
+  }
+  for (uint8_t index = 1; index <= MAX_NAMESPACES; index++) {
+    if (!used[index]) {
+      if (!set(0, spaceName.c_str(), TYPE_U8, &index, sizeof(index))) {
+        return false;
+      }
+      space = index;
+      return true;
+    }
+  }
+  return fail("too many namespaces");
+}
+
+bool NvsStore::put(const char* key, uint8_t datatype, const void* data, size_t length) {
+  // Namespace 0 holds the namespace table; never write user keys into it
+  return (space != 0 || openNamespace()) && set(space, key, datatype, data, length);
+}
+
+bool NvsStore::set(uint8_t nsIndex, const char* key, uint8_t datatype, const void* data, size_t length) {
+  if (flash.powerLost()) {
+    return fail("power lost");
+  }
+  size_t keyLength = strlen(key);
+  if (keyLength == 0 || keyLength > MAX_KEY_LENGTH) {
+    return fail("key too long");
+  }
+  bool variable = isVariable(datatype);
+  if (variable ? length > MAX_VARIABLE_LENGTH : length > sizeof(Item::data)) {
+    return fail("value too large");
+  }
+  
+  Item item;
+  memset(&item, 0xFF, sizeof(item));
+  item.nsIndex = nsIndex;
+  item.datatype = datatype;
+  memset(item.key, 0, sizeof(item.key));
+  memcpy(item.key, key, keyLength);
+  if (variable) {
+    item.span = 1 + (length + ENTRY_SIZE - 1) / ENTRY_SIZE;
+    uint16_t size = length;
+    uint32_t dataCrc = crc32(data, length);
+    memcpy(item.data, &size, sizeof(size));
+    memcpy(item.data + 4, &dataCrc, sizeof(dataCrc));
+  } else {
+    item.span = 1;
+    memcpy(item.data, data, length);
+  }
+  item.crc32 = itemCrc(&item);
+  
+  ItemKey itemKey(nsIndex, std::string(key, keyLength));
+  auto existing = items.find(itemKey);
+  if (existing != items.end() && existing->second.datatype == datatype &&
+      sameValue(existing->second, item, data, length)) {
+    return true;
+  }
+  
+  // New copy first, then retire the old one: a reset in between leaves a
+  // duplicate that mount() resolves, never a missing value
+  Location written;
+  if (!writeItem(item, data, length, written)) {
+    return false;
+  }
+  existing = items.find(itemKey);  // Garbage collection may have moved it
+  if (existing != items.end() && !eraseItem(existing->second)) {
+    return false;
+  }
+  items[itemKey] = written;
+  return true;
+}
+
+bool NvsStore::sameValue(const Location& location, const Item& item, const void* data, size_t length) {
+  Item stored;
+  if (!readItem(location, stored) || memcmp(stored.data, item.data, sizeof(item.data)) != 0) {
+    return false;
+  }
+  if (!isVariable(item.datatype) || length == 0) {
+    return true;
+  }
+  // Same size and CRC; compare the bytes to be sure
+  std::vector<uint8_t> current(length);
+  return flash.read(entryOffset(location.page, location.entry + 1), current.data(), length) &&
+         memcmp(current.data(), data, length) == 0;
+}
+
+bool NvsStore::writeItem(const Item& item, const void* data, size_t length, Location& location) {
+  if (!ensureRoom(item.span)) {
+    return false;
+  }
+  Page& page = pages[active];
+  location = Location{active, page.nextFree, item.span, item.datatype};
+  // Claimed up front: a torn write must never be written over
+  page.nextFree += item.span;
+  
+  if (!flash.write(entryOffset(location.page, location.entry), &item, ENTRY_SIZE)) {
+    return flashFailed();
+  }
+  if (item.span > 1) {
+    std::vector<uint8_t> padded((item.span - 1) * ENTRY_SIZE, 0xFF);
+    memcpy(padded.data(), data, length);
+    if (!flash.write(entryOffset(location.page, location.entry + 1), padded.data(), padded.size())) {
+      return flashFailed();
+    }
+  }
+  return setEntryStates(location.page, location.entry, item.span, ENTRY_WRITTEN);
+}
+
+bool NvsStore::eraseItem(const Location& location) {
+  return setEntryStates(location.page, location.entry, location.span, ENTRY_ERASED);
+}
+
+bool NvsStore::ensureRoom(size_t span) {
+  for (size_t attempt = 0; attempt <= pages.size(); attempt++) {
+    if (active < pages.size() && pages[active].nextFree + span <= ENTRIES_PER_PAGE) {
+      return true;
+    }
+    if (active < pages.size()) {
+      if (!writePageState(active, PAGE_FULL)) {
+        return false;
+      }
+      active = pages.size();
+    }
+    if (!requestPage()) {
+      return false;
+    }
+  }
+  return fail("not enough space");
+}
+
+bool NvsStore::requestPage() {
+  size_t empty = 0;
+  size_t first = pages.size();
+  for (size_t p = 0; p < pages.size(); p++) {
+    if (pages[p].state == PAGE_EMPTY) {
+      empty++;
+      first = std::min(first, p);
+    }
+  }
+  // The last empty page is kept for garbage collection
+  return empty > 1 ? activate(first) : collectGarbage();
+}
+
+bool NvsStore::activate(size_t p) {
+  PageHeader header;
+  memset(&header, 0xFF, sizeof(header));
+  header.state = PAGE_ACTIVE;
+  header.sequence = nextSequence++;
+  header.version = PAGE_VERSION;
+  header.crc32 = headerCrc(header);
+  if (!flash.write(p * EmulatedFlash::SECTOR_SIZE, &header, sizeof(header))) {
+    return flashFailed();
+  }
+  pages[p].state = PAGE_ACTIVE;
+  pages[p].sequence = header.sequence;
+  active = p;
+  return true;
+}
+
+bool NvsStore::collectGarbage() {
+  // Reclaim the full page with the most erased entries into the spare page
+  size_t victim = pages.size();
+  size_t spare = pages.size();
+  for (size_t p = 0; p < pages.size(); p++) {
+    if (pages[p].state == PAGE_FULL && pages[p].erased > 0 &&
+        (victim == pages.size() || pages[p].erased > pages[victim].erased)) {
+      victim = p;
+    } else if (pages[p].state == PAGE_EMPTY) {
+      spare = p;
+    }
+  }
+  if (victim == pages.size() || spare == pages.size()) {
+    return fail("not enough space");
+  }
+  return writePageState(victim, PAGE_FREEING) && activate(spare) && finishFreeing(victim);
+}
+
+bool NvsStore::finishFreeing(size_t p) {
+  // Live items in page order, so the copies keep their relative order
+  std::vector<std::pair<size_t, ItemKey>> live;
+  for (const auto& item : items) {
+    if (item.second.page == p) {
+      live.push_back(std::make_pair(item.second.entry, item.first));
+    }
+  }
+  std::sort(live.begin(), live.end());
+  for (const auto& item : live) {
+    Location moved;
+    if (!copyItem(items[item.second], moved)) {
+      return false;
+    }
+    items[item.second] = moved;
+  }
+  
+  if (!flash.erase(p)) {
+    return flashFailed();
+  }
+  pages[p].state = PAGE_EMPTY;
+  pages[p].sequence = 0;
+  memset(pages[p].entries, ENTRY_EMPTY, sizeof(pages[p].entries));
+  pages[p].nextFree = 0;
+  pages[p].erased = 0;
+  return true;
+}
+
+bool NvsStore::copyItem(const Location& from, Location& moved) {
+  Page& page = pages[active];
+  if (page.nextFree + from.span > ENTRIES_PER_PAGE) {
+    return fail("not enough space");
+  }
+  moved = Location{active, page.nextFree, from.span, from.datatype};
+  page.nextFree += from.span;
+  
+  std::vector<uint8_t> raw(from.span * ENTRY_SIZE);
+  if (!flash.read(entryOffset(from.page, from.entry), raw.data(), raw.size()) ||
+      !flash.write(entryOffset(moved.page, moved.entry), raw.data(), raw.size())) {
+    return flashFailed();
+  }
+  return setEntryStates(moved.page, moved.entry, moved.span, ENTRY_WRITTEN);
+}
+
+bool NvsStore::setEntryStates(size_t p, size_t first, size_t count, EntryState state) {
+  Page& page = pages[p];
+  for (size_t i = first; i < first + count; i++) {
+    if (state == ENTRY_ERASED && page.entries[i] != ENTRY_ERASED) {
+      page.erased++;
+    }
+    page.entries[i] = state;
+  }
+  
+  // The bitmap is programmed a 32-bit word (16 entries) at a time
+  for (size_t word = first / 16; count > 0 && word <= (first + count - 1) / 16; word++) {
+    uint8_t bits[4];
+    for (size_t b = 0; b < 4; b++) {
+      bits[b] = 0;
+      for (size_t k = 0; k < 4; k++) {
+        size_t entry = word * 16 + b * 4 + k;
+        bits[b] |= (entry < ENTRIES_PER_PAGE ? page.entries[entry] : (uint8_t)ENTRY_EMPTY) << (2 * k);
+      }
+    }
+    if (!flash.write(p * EmulatedFlash::SECTOR_SIZE + BITMAP_OFFSET + word * 4, bits, sizeof(bits))) {
+      return flashFailed();
+    }
+  }
+  return true;
+}
+
+bool NvsStore::writePageState(size_t p, uint32_t state) {
+  if (!flash.write(p * EmulatedFlash::SECTOR_SIZE, &state, sizeof(state))) {
+    return flashFailed();
+  }
+  pages[p].state = state;
+  return true;
+}
+
+bool NvsStore::readItem(const Location& location, Item& item) {
+  return flash.read(entryOffset(location.page, location.entry), &item, sizeof(item));
+}
+
+bool NvsStore::fail(const char* message) {
+  error = message;
+  failed++;
+  return false;
+}
+
+bool NvsStore::flashFailed() {
+  return fail(flash.powerLost() ? "power lost" : "flash error");
+}
+
+size_t NvsStore::usedEntries() const {
+  size_t used = 0;
+  for (const Page& page : pages) {
+    used += page.nextFree - page.erased;
+  }
+  return used;
+}
+
+size_t NvsStore::freeEntries() const {
+  // One page always stays empty for garbage collection
+  size_t usable = pages.size() > 1 ? (pages.size() - 1) * ENTRIES_PER_PAGE : 0;
+  return usable - std::min(usable, usedEntries());
+}
+
+bool NvsStore::open(const char* file) {
+  path.clear();
+  FILE* in = fopen(file, "rb");
+  if (!in) {
+    path = file;
+    return false;
+  }
+  std::vector<uint8_t> image;
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    image.insert(image.end(), chunk, chunk + read);
+  }
+  fclose(in);
+  if (!flash.setImage(image)) {
+    return fail("partition image has the wrong size");
+  }
+  path = file;
+  savedGeneration = flash.generation();
+  return mount();
+}
+
+bool NvsStore::save() {
+  if (path.empty() || flash.generation() == savedGeneration) {
+    return true;
+  }
+  FILE* out = fopen(path.c_str(), "wb");
+  if (!out) {
+    return false;
+  }
+  fwrite(flash.image().data(), 1, flash.size(), out);
+  savedGeneration = flash.generation();
+  return fclose(out) == 0;
+}
+
+bool NvsStore::get(const char* key, uint8_t datatype, void* data, size_t length) {
+  auto found = items.find(ItemKey(space, key));
+  Item item;
+  if (found == items.end() || found->second.datatype != datatype || !readItem(found->second, item)) {
+    return false;
+  }
+  memcpy(data, item.data, length);
+  return true;
+}
+
+bool NvsStore::getVariable(const char* key, uint8_t datatype, std::vector<uint8_t>& data) {
+  auto found = items.find(ItemKey(space, key));
+  Item item;
+  if (found == items.end() || found->second.datatype != datatype || !readItem(found->second, item)) {
+    return false;
+  }
+  uint16_t size;
+  memcpy(&size, item.data, sizeof(size));
+  data.resize(size);
+  return size == 0 || flash.read(entryOffset(found->second.page, found->second.entry + 1), data.data(), size);
+}
+
+// Preferences maps these onto the NVS types below; ULong is 32-bit there
+
+int NvsStore::getInt(const char* key, int fallback) {
+  int32_t value;
+  return get(key, TYPE_I32, &value, sizeof(value)) ? value : fallback;
+}
+
+void NvsStore::putInt(const char* key, int value) {
+  int32_t stored = value;
+  put(key, TYPE_I32, &stored, sizeof(stored));
+}
+
+unsigned int NvsStore::getUInt(const char* key, unsigned int fallback) {
+  uint32_t value;
+  return get(key, TYPE_U32, &value, sizeof(value)) ? value : fallback;
+}
+
+void NvsStore::putUInt(const char* key, unsigned int value) {
+  uint32_t stored = value;
+  put(key, TYPE_U32, &stored, sizeof(stored));
+}
+
+unsigned long NvsStore::getULong(const char* key, unsigned long fallback) {
+  uint32_t value;
+  return get(key, TYPE_U32, &value, sizeof(value)) ? value : fallback;
+}
+
+void NvsStore::putULong(const char* key, unsigned long value) {
+  uint32_t stored = value;
+  put(key, TYPE_U32, &stored, sizeof(stored));
+}
+
+bool NvsStore::getBool(const char* key, bool fallback) {
+  uint8_t value;
+  return get(key, TYPE_U8, &value, sizeof(value)) ? value != 0 : fallback;
+}
+
+void NvsStore::putBool(const char* key, bool value) {
+  uint8_t stored = value ? 1 : 0;
+  put(key, TYPE_U8, &stored, sizeof(stored));
+}
+
+String NvsStore::getString(const char* key, const String& fallback) {
+  std::vector<uint8_t> data;
+  if (!getVariable(key, TYPE_SZ, data)) {
+    return fallback;
+  }
+  return String((const char*)data.data(), strnlen((const char*)data.data(), data.size()));
+}
+
+void NvsStore::putString(const char* key, const String& value) {
+  // Stored with its terminator, like nvs_set_str()
+  put(key, TYPE_SZ, value.c_str(), value.length() + 1);
+}
+
+size_t NvsStore::getBytesLength(const char* key) {
+  std::vector<uint8_t> data;
+  return getVariable(key, TYPE_BLOB, data) ? data.size() : 0;
+}
+
+size_t NvsStore::getBytes(const char* key, void* buffer, size_t maxLength) {
+  std::vector<uint8_t> data;
+  if (!getVariable(key, TYPE_BLOB, data) || data.size() > maxLength) {
+    return 0;
+  }
+  memcpy(buffer, data.data(), data.size());
+  return data.size();
+}
+
+void NvsStore::putBytes(const char* key, const void* data, size_t length) {
+  put(key, TYPE_BLOB, data, length);
+}
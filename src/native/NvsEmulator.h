@@ -0,0 +1,210 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Hal.h"
+
+// Host model of the ESP32's NVS partition, so storage changes can be
+// judged by the flash work they cause rather than by CPU time alone.
+
+// Flash operation counts and the time they would take on the device
+struct FlashStats {
+  FlashStats() : erases(0), writes(0), bytesWritten(0), reads(0), bytesRead(0), simulatedUs(0) {}
+
+  unsigned long erases;
+  unsigned long writes;
+  unsigned long bytesWritten;
+  unsigned long reads;
+  unsigned long bytesRead;
+  double simulatedUs;
+};
+
+// SPI NOR flash: writes can only clear bits, erases set a 4 KB sector back
+// to 0xFF. Power can be cut at any program or erase, which then completes
+// only half way; every later one fails until power is restored.
+class EmulatedFlash {
+public:
+  static const size_t SECTOR_SIZE = 4096;
+
+  // Typical datasheet figures for the ESP32's SPI flash
+  static const unsigned int ERASE_US = 45000;
+  static const unsigned int WRITE_BASE_US = 15;
+  static const unsigned int WRITE_NS_PER_BYTE = 2500;
+  static const unsigned int READ_BASE_US = 1;
+  static const unsigned int READ_NS_PER_BYTE = 50;
+
+  explicit EmulatedFlash(size_t size);
+
+  size_t size() const { return bytes.size(); }
+  size_t sectors() const { return bytes.size() / SECTOR_SIZE; }
+
+  bool read(size_t offset, void* data, size_t length);
+  bool write(size_t offset, const void* data, size_t length);
+  bool erase(size_t sector);
+
+  // Cut power during the nth program or erase from now (1 = the next one)
+  void powerLossAfter(unsigned long operations) { powerLossCountdown = operations; }
+  bool powerLost() const { return lost; }
+  void restorePower() { lost = false; powerLossCountdown = 0; }
+
+  // Sleep for the simulated time times scale (0 = only count it)
+  void setLatencyScale(double scale) { latencyScale = scale; }
+
+  const FlashStats& stats() const { return counters; }
+  void resetStats() { counters = FlashStats(); }
+  // Program and erase operations since the flash was created
+  unsigned long generation() const { return changes; }
+
+  const std::vector<uint8_t>& image() const { return bytes; }
+  // Replace the contents, e.g. with a partition dump; the size must match
+  bool setImage(const std::vector<uint8_t>& contents);
+
+private:
+  bool interrupted();
+  void spend(double us);
+
+  std::vector<uint8_t> bytes;
+  FlashStats counters;
+  unsigned long changes;
+  unsigned long powerLossCountdown;
+  bool lost;
+  double latencyScale;
+};
+
+// The NVS layout on top of EmulatedFlash, close to ESP-IDF's: 4 KB pages
+// of 126 32-byte entries behind a header and a 2-bit entry state bitmap,
+// values written to the active page and the old copy marked erased, one
+// page kept free for garbage collection, 15-character keys and up to 254
+// namespaces. Strings and blobs are single items of at most 4000 bytes
+// (IDF chunks larger blobs). Like nvs_set_*, writing an unchanged value
+// does not touch the flash.
+//
+// mount() rebuilds the state from the flash alone, discarding torn entries
+// and duplicates left by a power loss, as the device does after a reset.
+class NvsStore : public KeyValueStore {
+public:
+  // The Arduino core's default partition table gives NVS 20 KB
+  static const size_t DEFAULT_PARTITION_SIZE = 0x5000;
+  static const size_t MAX_KEY_LENGTH = 15;
+  static const size_t MAX_VARIABLE_LENGTH = 4000;
+
+  NvsStore(EmulatedFlash& flash, const char* space);
+
+  bool mount();
+
+  // Load a partition image from path if it exists; save() writes it back
+  // when the flash changed
+  bool open(const char* path);
+  bool save();
+
+  // Mounts and put* calls that failed: no space, key too long, value too
+  // large or power lost
+  unsigned long failures() const { return failed; }
+  const char* lastError() const { return error; }
+  size_t usedEntries() const;
+  size_t freeEntries() const;
+
+  int getInt(const char* key, int fallback) override;
+  void putInt(const char* key, int value) override;
+  unsigned int getUInt(const char* key, unsigned int fallback) override;
+  void putUInt(const char* key, unsigned int value) override;
+  unsigned long getULong(const char* key, unsigned long fallback) override;
+  void putULong(const char* key, unsigned long value) override;
+  bool getBool(const char* key, bool fallback) override;
+  void putBool(const char* key, bool value) override;
+  String getString(const char* key, const String& fallback) override;
+  void putString(const char* key, const String& value) override;
+  size_t getBytesLength(const char* key) override;
+  size_t getBytes(const char* key, void* buffer, size_t maxLength) override;
+  void putBytes(const char* key, const void* data, size_t length) override;
+
+private:
+  static const size_t ENTRY_SIZE = 32;
+  static const size_t ENTRIES_PER_PAGE = 126;
+  static const size_t BITMAP_OFFSET = 32;
+  static const size_t FIRST_ENTRY_OFFSET = 64;
+  static const uint8_t MAX_NAMESPACES = 254;
+
+  enum EntryState : uint8_t { ENTRY_ERASED = 0, ENTRY_WRITTEN = 2, ENTRY_EMPTY = 3 };
+
+  enum PageState : uint32_t {
+    PAGE_EMPTY = 0xFFFFFFFF,
+    PAGE_ACTIVE = 0xFFFFFFFE,
+    PAGE_FULL = 0xFFFFFFFC,
+    PAGE_FREEING = 0xFFFFFFF8,
+    PAGE_CORRUPT = 0xFFFFFFF0
+  };
+
+  // On-flash entry; variable-length items keep {u16 size, u16, u32 crc} in data
+  struct Item {
+    uint8_t nsIndex;
+    uint8_t datatype;
+    uint8_t span;
+    uint8_t chunkIndex;
+    uint32_t crc32;
+    char key[16];
+    uint8_t data[8];
+  };
+
+  struct Page {
+    uint32_t state;
+    uint32_t sequence;
+    uint8_t entries[ENTRIES_PER_PAGE];  // EntryState
+    size_t nextFree;
+    size_t erased;
+  };
+
+  struct Location {
+    size_t page;
+    size_t entry;
+    uint8_t span;
+    uint8_t datatype;
+  };
+
+  typedef std::pair<uint8_t, std::string> ItemKey;
+
+  bool put(const char* key, uint8_t datatype, const void* data, size_t length);
+  bool set(uint8_t nsIndex, const char* key, uint8_t datatype, const void* data, size_t length);
+  bool get(const char* key, uint8_t datatype, void* data, size_t length);
+  bool getVariable(const char* key, uint8_t datatype, std::vector<uint8_t>& data);
+  bool sameValue(const Location& location, const Item& item, const void* data, size_t length);
+  bool openNamespace();
+
+  bool loadPage(size_t page);
+  bool validItem(size_t page, size_t entry, const Item& item);
+  bool indexItem(const Item& item, const Location& location);
+  bool writeItem(const Item& item, const void* data, size_t length, Location& location);
+  bool eraseItem(const Location& location);
+  bool ensureRoom(size_t span);
+  bool requestPage();
+  bool activate(size_t page);
+  bool collectGarbage();
+  bool finishFreeing(size_t page);
+  bool copyItem(const Location& from, Location& moved);
+  bool setEntryStates(size_t page, size_t first, size_t count, EntryState state);
+  bool writePageState(size_t page, uint32_t state);
+  bool readItem(const Location& location, Item& item);
+  bool fail(const char* message);
+  bool flashFailed();
+
+  size_t entryOffset(size_t page, size_t entry) const {
+    return page * EmulatedFlash::SECTOR_SIZE + FIRST_ENTRY_OFFSET + entry * ENTRY_SIZE;
+  }
+
+  EmulatedFlash& flash;
+  std::string spaceName;
+  uint8_t space;
+  std::vector<Page> pages;
+  size_t active;  // Page being filled, or pages.size() when none
+  uint32_t nextSequence;
+  std::map<ItemKey, Location> items;
+  std::string path;
+  unsigned long savedGeneration;
+  unsigned long failed;
+  const char* error;
+};
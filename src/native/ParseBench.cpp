@@ -0,0 +1,149 @@
+#include <limits.h>
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "ParamParse.h"
+#include "RoaringBitmap.h"
+#include "SignalCodec.h"
+#include "SignalQuery.h"
+#include "SignalStore.h"
+
+// Throughput of everything that parses request or upload bytes. The
+// String::toInt() rows are the lenient parsing the handlers used before.
+
+static const size_t PARAMS = 1000;
+static const size_t RECORDS = 1000;
+
+static void benchParams(BenchRunner& runner) {
+  std::mt19937 rng(65);
+  std::vector<String> ids;
+  std::vector<String> flags;
+  for (size_t i = 0; i < PARAMS; i++) {
+    ids.push_back(String((unsigned long)(rng() % 100000)));
+    flags.push_back(rng() % 2 ? "true" : "false");
+  }
+  
+  volatile long sink = 0;
+  runner.run("parse/int/strict", PARAMS, [&](BenchTimer& timer) {
+    timer.start();
+    for (const String& id : ids) {
+      int value;
+      sink += parseInt(id, 0, INT_MAX, value) ? value : -1;
+    }
+    timer.stop();
+  });
+  runner.run("parse/int/toInt", PARAMS, [&](BenchTimer& timer) {
+    timer.start();
+    for (const String& id : ids) {
+      sink += id.toInt();
+    }
+    timer.stop();
+  });
+  runner.run("parse/bool/strict", PARAMS, [&](BenchTimer& timer) {
+    timer.start();
+    for (const String& flag : flags) {
+      bool value;
+      sink += parseBool(flag, value) && value;
+    }
+    timer.stop();
+  });
+  runner.run("parse/bool/compare", PARAMS, [&](BenchTimer& timer) {
+    timer.start();
+    for (const String& flag : flags) {
+      sink += flag == "true";
+    }
+    timer.stop();
+  });
+}
+
+static void benchExpressions(BenchRunner& runner) {
+  const String filter = "protocol in {1,2} and bits >= 12 and seen < 3600 and name ^= \"Gar\"";
+  runner.run("parse/query", 1, [&](BenchTimer& timer) {
+    SignalQuery query;
+    String error;
+    timer.start();
+    compileSignalQuery(filter, query, error);
+    timer.stop();
+  });
+  
+  SignalStore store;
+  RFSignal signal = RFSignal();
+  for (uint32_t i = 0; i < 64; i++) {
+    signal.uid = i;
+    signal.value = 1000 + i;
+    signal.bitLength = 24;
+    signal.protocol = 1;
+    store.add(signal);
+    store.tagSignal(i, i % 2 ? "garage" : "house");
+  }
+  store.publish();
+  SignalStore::Snapshot snapshot = store.snapshot();
+  const String expression = "(tag:garage OR tag:house) AND NOT favorite";
+  runner.run("parse/tags", 1, [&](BenchTimer& timer) {
+    RoaringBitmap selected;
+    String error;
+    timer.start();
+    snapshot->tags.select(expression, selected, error);
+    timer.stop();
+  });
+}
+
+static void benchUploads(BenchRunner& runner) {
+  SignalStore store;
+  for (uint32_t i = 0; i < RECORDS; i++) {
+    RFSignal signal;
+    signal.uid = i;
+    signal.name = "Signal " + String((unsigned long)i);
+    signal.value = 5393 + i;
+    signal.bitLength = 24;
+    signal.protocol = 1;
+    signal.timestamp = i * 1000;
+    signal.isFavorite = false;
+    store.add(signal);
+  }
+  store.publish();
+  
+  static const char* FORMAT_NAMES[] = {"ndjson", "binary"};
+  for (ExportFormat format : {EXPORT_NDJSON, EXPORT_BINARY}) {
+    std::vector<uint8_t> body;
+    SignalExporter exporter(store.snapshot(), format);
+    uint8_t buffer[1024];
+    size_t length;
+    while ((length = exporter.read(buffer, sizeof(buffer))) > 0) {
+      body.insert(body.end(), buffer, buffer + length);
+    }
+    // Uploads arrive in TCP-sized chunks
+    runner.run(std::string("parse/import/") + FORMAT_NAMES[format], RECORDS, [&](BenchTimer& timer) {
+      SignalImporter importer(RECORDS);
+      timer.start();
+      for (size_t offset = 0; offset < body.size(); offset += 1436) {
+        importer.feed(body.data() + offset, std::min<size_t>(1436, body.size() - offset));
+      }
+      importer.finish();
+      timer.stop();
+    });
+  }
+  
+  RoaringBitmap members;
+  for (uint32_t uid = 0; uid < RECORDS; uid += 3) {
+    members.add(uid);
+  }
+  std::vector<uint8_t> encoded;
+  members.serialize(encoded);
+  runner.run("parse/bitmap", 1, [&](BenchTimer& timer) {
+    RoaringBitmap decoded;
+    timer.start();
+    decoded.deserialize(encoded.data(), encoded.size());
+    timer.stop();
+  });
+}
+
+void benchParsers(BenchRunner& runner) {
+  benchParams(runner);
+  benchExpressions(runner);
+  benchUploads(runner);
+}
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NativeCommands.h"
+#include "NativeHost.h"
+#include "RfTraffic.h"
+
+// generate: scenario -> pulse trace and decoded frames
+// replay: frames (from a trace or a scenario) -> the receive path of a host
+
+// Decode to retransmission, the repeater's target
+static const double REPEAT_BUDGET_MS = 50;
+
+static std::set<uint64_t> frameCodes(const std::vector<Frame>& frames) {
+  std::set<uint64_t> codes;
+  for (const Frame& frame : frames) {
+    codes.insert(signalKey(frame.value, frame.bitLength, frame.protocol));
+  }
+  return codes;
+}
+
+static bool writeFile(const char* path, const PulseTrace* pulses, const std::vector<Frame>* frames) {
+  FILE* out = fopen(path, "w");
+  if (!out) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return false;
+  }
+  bool ok = pulses ? writePulses(out, *pulses) : writeFrames(out, *frames);
+  return fclose(out) == 0 && ok;
+}
+
+// generate <scenario> [--pulses FILE] [--frames FILE]
+int runGenerate(const Options& options, int argc, char** argv) {
+  const char* scenarioPath = nullptr;
+  const char* pulsesPath = nullptr;
+  const char* framesPath = nullptr;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "--pulses") == 0 && i + 1 < argc) {
+      pulsesPath = argv[++i];
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      framesPath = argv[++i];
+    } else if (!scenarioPath && argv[i][0] != '-') {
+      scenarioPath = argv[i];
+    } else {
+      fprintf(stderr, "generate: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (!scenarioPath) {
+    fprintf(stderr, "generate: missing scenario\n");
+    return 2;
+  }
+  
+  Scenario scenario;
+  std::string error;
+  if (!scenario.load(scenarioPath, error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  PulseTrace pulses;
+  TrafficTruth truth;
+  generateTraffic(scenario, pulses, truth);
+  std::vector<Frame> frames;
+  decodeTrace(pulses, frames);
+  
+  printf("scenario        %s (seed %u, %.0f s)\n", scenario.name.c_str(), scenario.seed, scenario.durationSeconds);
+  std::set<uint64_t> decoded = frameCodes(frames);
+  size_t corrupted = 0;
+  for (uint64_t code : decoded) {
+    corrupted += truth.codes.count(code) == 0;
+  }
+  printf("presses         %lu (%zu distinct codes)\n", truth.presses, truth.codes.size());
+  printf("frames sent     %lu\n", truth.framesSent);
+  printf("noise pulses    %lu\n", truth.noisePulses);
+  printf("edges           %zu\n", pulses.durations.size());
+  printf("frames decoded  %zu (%zu distinct codes, %zu never sent)\n", frames.size(), decoded.size(), corrupted);
+  
+  if (pulsesPath && !writeFile(pulsesPath, &pulses, nullptr)) {
+    return 1;
+  }
+  if (framesPath && !writeFile(framesPath, nullptr, &frames)) {
+    return 1;
+  }
+  return 0;
+}
+
+struct ReplayResult {
+  size_t framesIn;
+  CaptureStats capture;
+  unsigned long overwritten;  // Latched frame replaced before loop() read it
+  double seconds;
+  RepeaterStats repeater;
+  std::vector<double> repeatMs;  // Decode to retransmission, per repeated frame
+};
+
+// Puts the traffic's first codes in the library and on the repeater's
+// allowlist, the way a user would through the API, then turns it on
+static void setUpRepeater(NativeHost& host, const std::vector<Frame>& frames) {
+  std::set<uint64_t> seen;
+  for (const Frame& frame : frames) {
+    if (seen.size() >= (size_t)SnifferCore::MAX_REPEATER_CODES) {
+      break;
+    }
+    if (seen.insert(signalKey(frame.value, frame.bitLength, frame.protocol)).second) {
+      host.radio.inject(RadioFrame{frame.value, frame.bitLength, frame.protocol});
+      host.settle();
+    }
+  }
+  for (size_t id = 0; id < host.core.snapshot()->size(); id++) {
+    ApiRequest request;
+    request.method = METHOD_POST;
+    request.path = "/api/repeater/codes";
+    request.params.push_back(ApiParam{"id", String((unsigned long)id), true});
+    host.request(request);
+  }
+  ApiRequest enable;
+  enable.method = METHOD_POST;
+  enable.path = "/api/repeater";
+  enable.params.push_back(ApiParam{"enabled", "true", true});
+  host.request(enable);
+}
+
+// The injector thread plays the receiver interrupt; this thread is loop().
+// With the repeater on, every transmission is heard back as an echo.
+static ReplayResult replayFrames(const std::vector<Frame>& frames, double speed, size_t radioSlots,
+                                 unsigned long loopWaitMs, bool repeater) {
+  SystemClock clock;
+  NativeHost host(clock);
+  host.radio.setCapacity(radioSlots);
+  host.begin();
+  ReplayResult result;
+  
+  std::mutex decodedMutex;
+  std::map<uint64_t, std::chrono::steady_clock::time_point> decodedAt;  // Latest decode per code
+  if (repeater) {
+    setUpRepeater(host, frames);
+    host.radio.onTransmit([&](const RadioFrame& sent) {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        auto decoded = decodedAt.find(signalKey(sent.value, sent.bitLength, sent.protocol));
+        if (decoded != decodedAt.end()) {
+          result.repeatMs.push_back(std::chrono::duration<double, std::milli>(now - decoded->second).count());
+          decodedAt.erase(decoded);
+        }
+      }
+      host.radio.inject(sent);
+    });
+  }
+  CaptureStats before = host.core.captureStats();
+  
+  std::atomic<bool> injected(false);
+  std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  std::thread receiver([&]() {
+    for (const Frame& frame : frames) {
+      if (speed > 0) {
+        std::this_thread::sleep_until(started + std::chrono::microseconds((uint64_t)(frame.timeUs / speed)));
+      }
+      if (repeater) {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decodedAt[signalKey(frame.value, frame.bitLength, frame.protocol)] = std::chrono::steady_clock::now();
+      }
+      host.radio.inject(RadioFrame{frame.value, frame.bitLength, frame.protocol});
+    }
+    injected = true;
+  });
+  
+  // loop()'s idle wait shrinks with the replay speed, down to just yielding
+  unsigned long waitMs = speed > 0 ? loopWaitMs / speed : loopWaitMs;
+  while (!injected || host.radio.pending() > 0) {
+    host.pump(waitMs);
+    if (waitMs == 0) {
+      std::this_thread::yield();
+    }
+  }
+  receiver.join();
+  host.pump();
+  
+  // Counts from the replay alone, without the repeater's set-up
+  CaptureStats after = host.core.captureStats();
+  result.framesIn = frames.size();
+  result.capture = CaptureStats{after.received - before.received, after.stored - before.stored,
+                                after.duplicates - before.duplicates, after.droppedQueue - before.droppedQueue,
+                                after.droppedStorage - before.droppedStorage,
+                                after.transmissions - before.transmissions};
+  result.overwritten = host.radio.overwritten();
+  result.repeater = host.core.repeaterStats();
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  return result;
+}
+
+static double percentile(const std::vector<double>& sorted, double q) {
+  return sorted[(size_t)(q * (sorted.size() - 1) + 0.5)];
+}
+
+// replay [--speed X] [--radio-slots N] [--loop-wait MS] [--repeater] <trace or scenario>...
+// Speed 0 injects as fast as possible. --repeater repeats the traffic's
+// first codes and reports decode-to-retransmission latency; time it at speed 1.
+int runReplay(const Options& options, int argc, char** argv) {
+  double speed = 1;
+  size_t radioSlots = 1;  // RCSwitch latches a single frame
+  unsigned long loopWaitMs = 10;  // loop() waits this long for commands
+  bool loopWaitSet = false;
+  bool repeater = false;
+  std::vector<const char*> inputs;
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--speed") == 0 && hasValue) {
+      speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--radio-slots") == 0 && hasValue) {
+      radioSlots = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--loop-wait") == 0 && hasValue) {
+      loopWaitMs = strtoul(argv[++i], nullptr, 10);
+      loopWaitSet = true;
+    } else if (strcmp(argv[i], "--repeater") == 0) {
+      repeater = true;
+    } else if (argv[i][0] != '-') {
+      inputs.push_back(argv[i]);
+    } else {
+      fprintf(stderr, "replay: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (inputs.empty()) {
+    fprintf(stderr, "replay: missing trace or scenario\n");
+    return 2;
+  }
+  if (repeater && !loopWaitSet) {
+    loopWaitMs = SnifferCore::REPEATER_WAIT_MS;  // As loop() does with the repeater on
+  }
+  if (repeater && speed != 1) {
+    fprintf(stderr, "replay: repeat latencies are wall-clock; only --speed 1 gives device-like numbers\n");
+  }
+  
+  std::vector<std::vector<Frame>> traffic(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    PulseTrace pulses;
+    bool isPulses = false;
+    std::string error;
+    if (!readTrace(inputs[i], pulses, traffic[i], isPulses, error)) {
+      // Not a trace: generate the scenario's traffic
+      Scenario scenario;
+      if (!scenario.load(inputs[i], error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+      }
+      TrafficTruth truth;
+      generateTraffic(scenario, pulses, truth);
+      isPulses = true;
+    }
+    if (isPulses) {
+      decodeTrace(pulses, traffic[i]);
+    }
+  }
+  
+  if (repeater) {
+    printf("%-24s %8s %8s %8s %8s %8s %8s %8s\n", "input", "in", "repeated", "echoes",
+           "p50 ms", "p99 ms", "max ms", "over");
+  } else {
+    printf("%-24s %8s %8s %8s %8s %8s %8s %8s %8s\n", "input", "in", "received", "stored",
+           "dup", "dropped", "overwr", "queue", "full");
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    ReplayResult result = replayFrames(traffic[i], speed, radioSlots, loopWaitMs, repeater);
+    const char* name = strrchr(inputs[i], '/') ? strrchr(inputs[i], '/') + 1 : inputs[i];
+    if (repeater) {
+      // Over: repeats later than the budget after the decode
+      std::vector<double>& latencies = result.repeatMs;
+      std::sort(latencies.begin(), latencies.end());
+      size_t over = latencies.end() - std::upper_bound(latencies.begin(), latencies.end(), REPEAT_BUDGET_MS);
+      if (latencies.empty()) {
+        printf("%-24s %8zu %8u %8u %8s %8s %8s %8s\n", name, result.framesIn, result.repeater.repeated,
+               result.repeater.echoesSuppressed, "-", "-", "-", "-");
+        continue;
+      }
+      printf("%-24s %8zu %8u %8u %8.2f %8.2f %8.2f %8zu\n", name, result.framesIn, result.repeater.repeated,
+             result.repeater.echoesSuppressed, percentile(latencies, 0.5), percentile(latencies, 0.99),
+             latencies.back(), over);
+      continue;
+    }
+    unsigned long dropped = result.overwritten + result.capture.droppedQueue + result.capture.droppedStorage;
+    printf("%-24s %8zu %8u %8u %8u %8lu %8lu %8u %8u\n", name, result.framesIn,
+           result.capture.received, result.capture.stored, result.capture.duplicates, dropped,
+           result.overwritten, result.capture.droppedQueue, result.capture.droppedStorage);
+  }
+  return 0;
+}
@@ -0,0 +1,357 @@
+#include "RfTraffic.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+// Protocols 1-7 as defined by rc-switch 2.6
+const RcProtocol RC_PROTOCOLS[RC_PROTOCOL_COUNT] = {
+  {350, 1, 31, 1, 3, 3, 1, false},
+  {650, 1, 10, 1, 2, 2, 1, false},
+  {100, 30, 71, 4, 11, 9, 6, false},
+  {380, 1, 6, 1, 3, 3, 1, false},
+  {500, 6, 14, 1, 2, 2, 1, false},
+  {450, 23, 1, 1, 2, 2, 1, true},   // HT6P20B
+  {150, 2, 62, 1, 6, 6, 1, false},  // HS2303-PT
+};
+
+Scenario::Scenario()
+  : seed(1), durationSeconds(60), noisePerSecond(0), noiseMinUs(50), noiseMaxUs(500),
+    jitterPercent(0), edgeJitterUs(0) {
+}
+
+static bool parseRange(const std::string& text, int& low, int& high) {
+  size_t dash = text.find('-');
+  low = atoi(text.c_str());
+  high = dash == std::string::npos ? low : atoi(text.c_str() + dash + 1);
+  return low > 0 && high >= low;
+}
+
+bool Scenario::load(const char* path, std::string& error) {
+  std::ifstream in(path);
+  if (!in) {
+    error = std::string("cannot read ") + path;
+    return false;
+  }
+  name = path;
+  size_t slash = name.find_last_of('/');
+  if (slash != std::string::npos) {
+    name = name.substr(slash + 1);
+  }
+  
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(in, line)) {
+    lineNumber++;
+    std::istringstream words(line);
+    std::string key;
+    if (!(words >> key) || key[0] == '#') {
+      continue;
+    }
+  
+    bool ok = true;
+    if (key == "seed") {
+      ok = (bool)(words >> seed);
+    } else if (key == "duration") {
+      ok = (bool)(words >> durationSeconds) && durationSeconds > 0;
+    } else if (key == "jitter") {
+      ok = (bool)(words >> jitterPercent) && jitterPercent >= 0 && jitterPercent < 50;
+    } else if (key == "edgejitter") {
+      ok = (bool)(words >> edgeJitterUs);
+    } else if (key == "remotes" || key == "noise") {
+      RemoteGroup group = {1, 1, 24, 1, 1.0, 4, 4};
+      if (key == "remotes") {
+        ok = (bool)(words >> group.count) && group.count > 0;
+      }
+      std::string setting;
+      while (ok && words >> setting) {
+        size_t equals = setting.find('=');
+        std::string name = setting.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : setting.substr(equals + 1);
+        if (key == "noise" && name == "rate") {
+          noisePerSecond = atof(value.c_str());
+        } else if (key == "noise" && name == "min") {
+          noiseMinUs = atoi(value.c_str());
+        } else if (key == "noise" && name == "max") {
+          noiseMaxUs = atoi(value.c_str());
+        } else if (key == "remotes" && name == "protocol") {
+          group.protocol = atoi(value.c_str());
+          ok = group.protocol >= 1 && group.protocol <= RC_PROTOCOL_COUNT;
+        } else if (key == "remotes" && name == "bits") {
+          group.bitLength = atoi(value.c_str());
+          ok = group.bitLength >= 4 && group.bitLength <= 32;
+        } else if (key == "remotes" && name == "buttons") {
+          group.buttons = atoi(value.c_str());
+          ok = group.buttons >= 1 && group.buttons <= 16;
+        } else if (key == "remotes" && name == "rate") {
+          group.pressesPerMinute = atof(value.c_str());
+          ok = group.pressesPerMinute > 0;
+        } else if (key == "remotes" && name == "repeats") {
+          ok = parseRange(value, group.minRepeats, group.maxRepeats);
+        } else {
+          ok = false;
+        }
+      }
+      if (key == "remotes") {
+        remotes.push_back(group);
+      } else {
+        ok = ok && noiseMinUs > 0 && noiseMaxUs >= noiseMinUs;
+      }
+    } else {
+      ok = false;
+    }
+  
+    if (!ok) {
+      error = std::string(path) + ":" + std::to_string(lineNumber) + ": invalid '" + line + "'";
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t PulseTrace::totalUs() const {
+  uint64_t total = 0;
+  for (uint32_t duration : durations) {
+    total += duration;
+  }
+  return total;
+}
+
+typedef std::pair<uint64_t, uint64_t> Interval;  // Carrier on, [start, end) in µs
+
+// Appends one RCSwitch::send() of code: the data bits, then the sync
+static uint64_t transmitFrame(const RcProtocol& protocol, unsigned long code, int bitLength,
+                              uint64_t start, double pulseLength, int edgeJitter,
+                              std::mt19937& rng, std::vector<Interval>& on) {
+  std::uniform_int_distribution<int> spread(-edgeJitter, edgeJitter);
+  uint64_t now = start;
+  for (int bit = bitLength; bit >= 0; bit--) {
+    // bit 0, after the data, is the sync symbol
+    uint8_t highPulses, lowPulses;
+    if (bit == 0) {
+      highPulses = protocol.syncHigh;
+      lowPulses = protocol.syncLow;
+    } else if (code & (1UL << (bit - 1))) {
+      highPulses = protocol.oneHigh;
+      lowPulses = protocol.oneLow;
+    } else {
+      highPulses = protocol.zeroHigh;
+      lowPulses = protocol.zeroLow;
+    }
+    uint64_t high = std::max(1LL, llround(highPulses * pulseLength) + spread(rng));
+    uint64_t low = std::max(1LL, llround(lowPulses * pulseLength) + spread(rng));
+    if (protocol.inverted) {
+      on.push_back(Interval(now + high, now + high + low));
+    } else {
+      on.push_back(Interval(now, now + high));
+    }
+    now += high + low;
+  }
+  return now;
+}
+
+void generateTraffic(const Scenario& scenario, PulseTrace& pulses, TrafficTruth& truth) {
+  std::mt19937 rng(scenario.seed);
+  uint64_t durationUs = scenario.durationSeconds * 1e6;
+  double jitter = scenario.jitterPercent / 100;
+  std::uniform_real_distribution<double> clockError(-jitter, jitter);
+  truth = TrafficTruth();
+  
+  std::vector<Interval> on;
+  for (const RemoteGroup& group : scenario.remotes) {
+    const RcProtocol& protocol = RC_PROTOCOLS[group.protocol - 1];
+    int buttonBits = 0;
+    while ((1 << buttonBits) < group.buttons) {
+      buttonBits++;
+    }
+    unsigned long mask = group.bitLength >= 32 ? 0xFFFFFFFFUL : (1UL << group.bitLength) - 1;
+    std::exponential_distribution<double> gap(group.pressesPerMinute / 60.0);
+    std::uniform_int_distribution<int> repeats(group.minRepeats, group.maxRepeats);
+  
+    for (int remote = 0; remote < group.count; remote++) {
+      unsigned long address = ((unsigned long)rng() << buttonBits) & mask;
+      for (double t = gap(rng); t * 1e6 < durationUs; t += gap(rng)) {
+        unsigned long code = address | (rng() % group.buttons);
+        if (code == 0) {
+          code = 1;  // RCSwitch never reports 0
+        }
+        int count = repeats(rng);
+        uint64_t now = t * 1e6;
+        double pulseLength = protocol.pulseLength * (1 + clockError(rng));
+        for (int copy = 0; copy < count; copy++) {
+          now = transmitFrame(protocol, code, group.bitLength, now, pulseLength,
+                              scenario.edgeJitterUs, rng, on);
+        }
+        truth.codes.insert(signalKey(code, group.bitLength, group.protocol));
+        truth.presses++;
+        truth.framesSent += count;
+      }
+    }
+  }
+  
+  if (scenario.noisePerSecond > 0) {
+    std::exponential_distribution<double> gap(scenario.noisePerSecond);
+    std::uniform_int_distribution<unsigned int> width(scenario.noiseMinUs, scenario.noiseMaxUs);
+    for (double t = gap(rng); t * 1e6 < durationUs; t += gap(rng)) {
+      uint64_t start = t * 1e6;
+      on.push_back(Interval(start, start + width(rng)));
+      truth.noisePulses++;
+    }
+  }
+  
+  // One receiver, one carrier: overlapping transmissions merge
+  std::sort(on.begin(), on.end());
+  pulses.durations.clear();
+  uint64_t lastEdge = 0;
+  for (size_t i = 0; i < on.size();) {
+    uint64_t start = on[i].first;
+    uint64_t end = on[i].second;
+    for (i++; i < on.size() && on[i].first <= end; i++) {
+      end = std::max(end, on[i].second);
+    }
+    if (!pulses.durations.empty() || start > 0) {
+      pulses.durations.push_back(start - lastEdge);
+    }
+    pulses.durations.push_back(end - start);
+    lastEdge = end;
+  }
+}
+
+PulseDecoder::PulseDecoder() : changeCount(0), repeatCount(0) {
+  memset(timings, 0, sizeof(timings));
+}
+
+static inline unsigned int diff(int a, int b) {
+  return abs(a - b);
+}
+
+// Mirrors RCSwitch::handleInterrupt()
+bool PulseDecoder::edge(uint32_t duration, uint64_t nowUs, Frame& frame) {
+  bool decoded = false;
+  if (duration > SEPARATION_LIMIT_US) {
+    // A long gap: the sync after a frame, or silence
+    if (repeatCount == 0 || diff(duration, timings[0]) < 200) {
+      repeatCount++;
+      if (repeatCount == 2) {
+        for (int protocol = 1; protocol <= RC_PROTOCOL_COUNT; protocol++) {
+          if (receiveProtocol(protocol, changeCount, nowUs, frame)) {
+            decoded = frame.value != 0;
+            break;
+          }
+        }
+        repeatCount = 0;
+      }
+    }
+    changeCount = 0;
+  }
+  
+  if (changeCount >= MAX_CHANGES) {
+    changeCount = 0;
+    repeatCount = 0;
+  }
+  timings[changeCount++] = duration;
+  return decoded;
+}
+
+// Mirrors RCSwitch::receiveProtocol()
+bool PulseDecoder::receiveProtocol(int number, unsigned int count, uint64_t nowUs, Frame& frame) {
+  const RcProtocol& protocol = RC_PROTOCOLS[number - 1];
+  unsigned long code = 0;
+  unsigned int syncPulses = std::max(protocol.syncHigh, protocol.syncLow);
+  unsigned int delay = timings[0] / syncPulses;
+  unsigned int tolerance = delay * TOLERANCE_PERCENT / 100;
+  unsigned int firstDataTiming = protocol.inverted ? 2 : 1;
+  
+  for (unsigned int i = firstDataTiming; i + 1 < count; i += 2) {
+    code <<= 1;
+    if (diff(timings[i], delay * protocol.zeroHigh) < tolerance &&
+        diff(timings[i + 1], delay * protocol.zeroLow) < tolerance) {
+      // zero
+    } else if (diff(timings[i], delay * protocol.oneHigh) < tolerance &&
+               diff(timings[i + 1], delay * protocol.oneLow) < tolerance) {
+      code |= 1;
+    } else {
+      return false;
+    }
+  }
+  
+  frame.value = 0;
+  if (count > 7) {
+    frame.timeUs = nowUs;
+    frame.value = code;
+    frame.bitLength = (count - 1) / 2;
+    frame.protocol = number;
+  }
+  return true;
+}
+
+void decodeTrace(const PulseTrace& pulses, std::vector<Frame>& frames) {
+  PulseDecoder decoder;
+  uint64_t now = 0;
+  Frame frame;
+  for (uint32_t duration : pulses.durations) {
+    now += duration;
+    if (decoder.edge(duration, now, frame)) {
+      frames.push_back(frame);
+    }
+  }
+}
+
+bool writePulses(FILE* out, const PulseTrace& pulses) {
+  fprintf(out, "# rf433 pulses\n");
+  for (uint32_t duration : pulses.durations) {
+    fprintf(out, "%u\n", duration);
+  }
+  return !ferror(out);
+}
+
+bool writeFrames(FILE* out, const std::vector<Frame>& frames) {
+  fprintf(out, "# rf433 frames\n");
+  for (const Frame& frame : frames) {
+    fprintf(out, "%llu %lu %u %u\n", (unsigned long long)frame.timeUs, frame.value,
+            frame.bitLength, frame.protocol);
+  }
+  return !ferror(out);
+}
+
+bool readTrace(const char* path, PulseTrace& pulses, std::vector<Frame>& frames, bool& isPulses,
+               std::string& error) {
+  FILE* in = fopen(path, "r");
+  if (!in) {
+    error = std::string("cannot read ") + path;
+    return false;
+  }
+  
+  char header[64] = "";
+  if (!fgets(header, sizeof(header), in)) {
+    header[0] = '\0';
+  }
+  bool ok = true;
+  if (strncmp(header, "# rf433 pulses", 14) == 0) {
+    isPulses = true;
+    unsigned int duration;
+    while (fscanf(in, "%u", &duration) == 1) {
+      pulses.durations.push_back(duration);
+    }
+  } else if (strncmp(header, "# rf433 frames", 14) == 0) {
+    isPulses = false;
+    unsigned long long time;
+    Frame frame;
+    while (fscanf(in, "%llu %lu %u %u", &time, &frame.value, &frame.bitLength, &frame.protocol) == 4) {
+      frame.timeUs = time;
+      frames.push_back(frame);
+    }
+  } else {
+    ok = false;
+  }
+  ok = ok && feof(in);
+  fclose(in);
+  if (!ok) {
+    error = std::string(path) + ": not an rf433 pulse or frame trace";
+  }
+  return ok;
+}
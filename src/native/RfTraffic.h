@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "RFSignal.h"
+
+// Synthetic 433 MHz traffic for the native build: scenarios describe
+// remotes and noise, the generator turns them into the pulse train the
+// receiver pin would see, and PulseDecoder turns pulses back into frames
+// the same way RCSwitch's interrupt handler does.
+
+// RCSwitch protocol timings, in multiples of pulseLength
+struct RcProtocol {
+  uint16_t pulseLength;  // µs
+  uint8_t syncHigh, syncLow;
+  uint8_t zeroHigh, zeroLow;
+  uint8_t oneHigh, oneLow;
+  bool inverted;
+};
+
+static const int RC_PROTOCOL_COUNT = 7;
+extern const RcProtocol RC_PROTOCOLS[RC_PROTOCOL_COUNT];  // Protocol n is [n - 1]
+
+// A group of identical remotes in a scenario
+struct RemoteGroup {
+  int count;
+  int protocol;
+  int bitLength;
+  int buttons;              // Codes per remote, differing in the low bits
+  double pressesPerMinute;  // Per remote, Poisson arrivals
+  int minRepeats, maxRepeats;  // Frames sent per press
+};
+
+// Scenario file, one setting per line:
+//   seed <n>
+//   duration <seconds>
+//   remotes <count> protocol=<p> bits=<n> buttons=<n> rate=<presses/min> repeats=<min>-<max>
+//   noise rate=<pulses/s> min=<µs> max=<µs>
+//   jitter <percent>   clock error of each press, constant for its frames
+//   edgejitter <µs>    random offset of every edge
+//   # comment
+struct Scenario {
+  std::string name;
+  uint32_t seed;
+  double durationSeconds;
+  std::vector<RemoteGroup> remotes;
+  double noisePerSecond;
+  unsigned int noiseMinUs, noiseMaxUs;
+  double jitterPercent;
+  unsigned int edgeJitterUs;
+
+  Scenario();
+  bool load(const char* path, std::string& error);
+};
+
+struct Frame {
+  uint64_t timeUs;  // Decode time (end of the second copy for RCSwitch)
+  unsigned long value;
+  unsigned int bitLength;
+  unsigned int protocol;
+};
+
+// What the generator put on air
+struct TrafficTruth {
+  TrafficTruth() : presses(0), framesSent(0), noisePulses(0) {}
+
+  unsigned long presses;
+  unsigned long framesSent;   // presses x repeats
+  unsigned long noisePulses;
+  std::set<uint64_t> codes;   // signalKey() of every code pressed
+};
+
+// Durations between successive edges, starting at a rising edge
+struct PulseTrace {
+  std::vector<uint32_t> durations;
+  uint64_t totalUs() const;
+};
+
+void generateTraffic(const Scenario& scenario, PulseTrace& pulses, TrafficTruth& truth);
+
+// RCSwitch's receive state machine over edge-to-edge durations
+class PulseDecoder {
+public:
+  PulseDecoder();
+
+  // Feed the duration since the previous edge; true when a frame decoded
+  bool edge(uint32_t durationUs, uint64_t nowUs, Frame& frame);
+
+private:
+  bool receiveProtocol(int protocol, unsigned int changeCount, uint64_t nowUs, Frame& frame);
+
+  static const unsigned int MAX_CHANGES = 67;
+  static const unsigned int SEPARATION_LIMIT_US = 4300;
+  static const unsigned int TOLERANCE_PERCENT = 60;
+
+  uint32_t timings[MAX_CHANGES];
+  unsigned int changeCount;
+  unsigned int repeatCount;
+};
+
+void decodeTrace(const PulseTrace& pulses, std::vector<Frame>& frames);
+
+// Trace files are text: a header line naming the kind, then one record per
+// line - an edge duration for pulses, "<time µs> <value> <bits> <protocol>"
+// for frames.
+bool writePulses(FILE* out, const PulseTrace& pulses);
+bool writeFrames(FILE* out, const std::vector<Frame>& frames);
+// Reads either kind; isPulses says which it was
+bool readTrace(const char* path, PulseTrace& pulses, std::vector<Frame>& frames, bool& isPulses,
+               std::string& error);
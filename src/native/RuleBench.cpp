@@ -0,0 +1,222 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "CaptureFilter.h"
+#include "FrameAnalytics.h"
+#include "RFSignal.h"
+#include "SignalRules.h"
+#include "SignalTranslation.h"
+
+// Cost of evaluating capture filters, on-capture rules, protocol
+// translations and the analytics sketches per frame, for the compiled tables and for a scan over the
+// list. Half the rules' codes have two rules.
+
+static const size_t RULES = RuleTable::MAX_RULES;
+static const size_t FRAMES = 1000;
+
+static uint64_t code(uint32_t i) {
+  return signalKey(0x100000 + i * 7, 24, 1 + i % 3);
+}
+
+void benchRules(BenchRunner& runner) {
+  std::mt19937 rng(72);
+  std::vector<Rule> rules;
+  for (uint32_t id = 1; rules.size() < RULES; id++) {
+    uint32_t trigger = rules.size() * 2 / 3;
+    rules.push_back(Rule{code(trigger), code(100000 + id), id, (RuleAction)(id % RULE_ACTION_COUNT)});
+  }
+  uint32_t triggers = RULES * 2 / 3;
+  std::vector<uint64_t> hits;
+  std::vector<uint64_t> misses;
+  for (size_t i = 0; i < FRAMES; i++) {
+    hits.push_back(code(rng() % triggers));
+    misses.push_back(code(triggers + rng() % 50000));
+  }
+  
+  std::string suffix = std::to_string(RULES);
+  RuleTable table(rules);
+  if (runner.run("rules_compile/table/" + suffix, RULES, [&](BenchTimer& timer) {
+    timer.start();
+    RuleTable compiled(rules);
+    timer.stop();
+  })) {
+    runner.addCounter("bytes", table.memoryUsage());
+  }
+  
+  volatile uint64_t sink = 0;
+  const char* names[] = {"rules_hit", "rules_miss"};
+  const std::vector<uint64_t>* frames[] = {&hits, &misses};
+  for (int kind = 0; kind < 2; kind++) {
+    const std::vector<uint64_t>& keys = *frames[kind];
+    runner.run(std::string(names[kind]) + "/table/" + suffix, keys.size(), [&](BenchTimer& timer) {
+      timer.start();
+      for (uint64_t key : keys) {
+        size_t count;
+        const RuleTable::Step* steps = table.match(key, count);
+        for (size_t i = 0; i < count; i++) {
+          sink += steps[i].target + steps[i].action;
+        }
+      }
+      timer.stop();
+    });
+    runner.run(std::string(names[kind]) + "/scan/" + suffix, keys.size(), [&](BenchTimer& timer) {
+      timer.start();
+      for (uint64_t key : keys) {
+        for (const Rule& rule : rules) {
+          if (rule.trigger == key) {
+            sink += rule.target + rule.action;
+          }
+        }
+      }
+      timer.stop();
+    });
+  }
+}
+
+// A full translation set: four source formats with four masks each
+void benchTranslations(BenchRunner& runner) {
+  static const uint32_t MASKS[] = {0xFFFFFF, 0xFFFFF0, 0xFFFF00, 0xFF0000};
+  std::mt19937 rng(73);
+  std::vector<Translation> translations;
+  for (uint32_t id = 1; translations.size() < TranslationTable::MAX_TRANSLATIONS; id++) {
+    Translation t = {};
+    t.id = id;
+    t.sourceProtocol = 1 + id % 4;
+    t.sourceBits = 24;
+    t.mask = MASKS[id / 4 % 4];
+    t.match = (0x100000 + id * 0x1111) & t.mask;
+    t.targetProtocol = 2;
+    t.targetBits = 32;
+    t.base = 0xA0000000 + id;
+    t.fieldCount = 1;
+    t.fields[0] = BitField{0, 8, 4};
+    translations.push_back(t);
+  }
+  TranslationTable table(translations);
+  
+  std::vector<RadioFrame> hits;
+  std::vector<RadioFrame> misses;
+  for (size_t i = 0; i < FRAMES; i++) {
+    const Translation& t = table.translations()[rng() % table.translations().size()];
+    hits.push_back(RadioFrame{t.match | (rng() & ~t.mask & 0xFFFFFF), 24, t.sourceProtocol});
+    misses.push_back(RadioFrame{0x800000 + rng() % 0x7FFFFF, 24, (unsigned int)(1 + rng() % 4)});
+  }
+  
+  std::string suffix = std::to_string(table.translations().size());
+  volatile uint64_t sink = 0;
+  const char* names[] = {"translate_hit", "translate_miss"};
+  const std::vector<RadioFrame>* frames[] = {&hits, &misses};
+  for (int kind = 0; kind < 2; kind++) {
+    const std::vector<RadioFrame>& received = *frames[kind];
+    runner.run(std::string(names[kind]) + "/table/" + suffix, received.size(), [&](BenchTimer& timer) {
+      timer.start();
+      for (const RadioFrame& frame : received) {
+        const Translation* t = table.match(frame);
+        if (t) {
+          sink += translateFrame(*t, frame.value).value;
+        }
+      }
+      timer.stop();
+    });
+    // First match in id order, which is not the most specific one
+    runner.run(std::string(names[kind]) + "/scan/" + suffix, received.size(), [&](BenchTimer& timer) {
+      timer.start();
+      for (const RadioFrame& frame : received) {
+        for (const Translation& t : table.translations()) {
+          if (t.sourceProtocol == frame.protocol && t.sourceBits == frame.bitLength &&
+              (frame.value & t.mask) == t.match) {
+            sink += translateFrame(t, frame.value).value;
+            break;
+          }
+        }
+      }
+      timer.stop();
+    });
+  }
+}
+
+// A full filter set: half exact codes, a quarter formats, a quarter ranges
+void benchFilters(BenchRunner& runner) {
+  std::mt19937 rng(74);
+  std::vector<FilterRule> rules;
+  for (uint32_t id = 1; rules.size() < FilterTable::MAX_FILTERS; id++) {
+    FilterRule rule = {};
+    rule.id = id;
+    rule.list = id % 5 == 0 ? FILTER_ALLOW : FILTER_DENY;
+    rule.protocols = 1u << (1 + id % 4);
+    rule.bitLengths = 1ULL << 24;
+    if (id % 4 < 2) {
+      rule.low = rule.high = 0x100000 + id * 7;
+    } else if (id % 4 == 2) {
+      rule.protocols = 1u << (5 + id % 8);
+      rule.bitLengths = 1ULL << (8 + id % 24);
+      rule.high = UINT32_MAX;
+    } else {
+      rule.low = 0x200000 + id * 0x1000;
+      rule.high = rule.low + 0x3000;
+    }
+    rules.push_back(rule);
+  }
+  std::vector<RadioFrame> frames;
+  for (size_t i = 0; i < FRAMES; i++) {
+    frames.push_back(RadioFrame{0x100000 + rng() % 0x180000, (unsigned int)(12 + rng() % 3 * 6), (unsigned int)(1 + rng() % 12)});
+  }
+  
+  std::string suffix = std::to_string(rules.size());
+  FilterTable table(rules);
+  volatile int sink = 0;
+  runner.run("filter_admit/table/" + suffix, frames.size(), [&](BenchTimer& timer) {
+    timer.start();
+    for (const RadioFrame& frame : frames) {
+      int rule;
+      sink += table.admit(frame, rule);
+    }
+    timer.stop();
+  });
+  runner.run("filter_admit/scan/" + suffix, frames.size(), [&](BenchTimer& timer) {
+    timer.start();
+    for (const RadioFrame& frame : frames) {
+      bool allowed = false;
+      bool denied = false;
+      for (const FilterRule& rule : rules) {
+        if ((rule.protocols >> frame.protocol & 1) && (rule.bitLengths >> frame.bitLength & 1) &&
+            frame.value >= rule.low && frame.value <= rule.high) {
+          (rule.list == FILTER_ALLOW ? allowed : denied) = true;
+        }
+      }
+      sink += !denied && allowed;
+    }
+    timer.stop();
+  });
+}
+
+// Sketch updates per frame: a few busy codes, and a new code every frame,
+// which evicts from the heavy-hitter summary each time
+void benchAnalytics(BenchRunner& runner) {
+  std::mt19937 rng(75);
+  std::vector<uint64_t> skewed;
+  std::vector<uint64_t> unique;
+  for (size_t i = 0; i < FRAMES; i++) {
+    skewed.push_back(code(rng() % 16 == 0 ? rng() % 5000 : rng() % 16));
+    unique.push_back(code(i));
+  }
+  
+  FrameAnalytics analytics(0);
+  const char* names[] = {"analytics_record/skewed", "analytics_record/unique"};
+  const std::vector<uint64_t>* frames[] = {&skewed, &unique};
+  for (int kind = 0; kind < 2; kind++) {
+    const std::vector<uint64_t>& keys = *frames[kind];
+    if (runner.run(names[kind], keys.size(), [&](BenchTimer& timer) {
+      analytics.reset(0);
+      timer.start();
+      for (uint64_t key : keys) {
+        analytics.record(key, key & 0xFF, 0);
+      }
+      timer.stop();
+    })) {
+      runner.addCounter("bytes", sizeof(FrameAnalytics));
+    }
+  }
+}
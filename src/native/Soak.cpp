@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AllocTracker.h"
+#include "NativeCommands.h"
+#include "NativeHost.h"
+
+// Days of device uptime in minutes: captures, dashboard polling,
+// transmissions and edits against a host on an accelerated clock, with the
+// counting allocator sampled along the way. A leak or fragmentation shows
+// up as a floor that keeps rising once the library has reached its steady
+// size; churn shows up as allocations per operation.
+
+enum SoakOperation { SOAK_CAPTURE, SOAK_POLL, SOAK_TRANSMIT, SOAK_EDIT, SOAK_OPERATION_COUNT };
+
+static const char* OPERATION_NAMES[] = {"capture", "poll", "transmit", "edit"};
+
+// Out of 100: what a busy site with an open dashboard looks like
+static const int OPERATION_WEIGHTS[] = {60, 25, 5, 10};
+
+// Remotes pressed over and over; one capture in 50 is a code never seen before
+static const size_t REMOTES = 200;
+static const int NEW_CODE_PERCENT = 2;
+
+struct SoakSample {
+  unsigned long iteration;
+  double uptimeHours;
+  size_t signals;
+  AllocStats alloc;
+  size_t heapBytes;
+};
+
+struct OperationCost {
+  unsigned long count;
+  unsigned long allocations;
+  unsigned long long bytes;
+};
+
+static ApiRequest makeRequest(HttpMethod method, const char* path) {
+  ApiRequest request;
+  request.method = method;
+  request.path = path;
+  request.client = 0x0100007f;
+  return request;
+}
+
+static void addParam(ApiRequest& request, const char* name, const String& value) {
+  request.params.push_back(ApiParam{name, value, request.method != METHOD_GET});
+}
+
+// The dashboard's requests, the full list now and then
+static void poll(NativeHost& host, unsigned long iteration) {
+  ApiRequest request;
+  switch (iteration % 10) {
+    case 0:
+      request = makeRequest(METHOD_GET, "/api/signals");
+      break;
+    case 1:
+      request = makeRequest(METHOD_GET, "/metrics");
+      break;
+    case 2:
+    case 3:
+      request = makeRequest(METHOD_GET, "/api/signals/query");
+      addParam(request, "limit", "20");
+      break;
+    case 4:
+      request = makeRequest(METHOD_GET, "/api/logs");
+      addParam(request, "since", String(iteration));
+      break;
+    default:
+      request = makeRequest(METHOD_GET, "/api/status");
+      break;
+  }
+  host.request(request);
+}
+
+static void edit(NativeHost& host, std::mt19937& random, size_t signals) {
+  ApiRequest request;
+  String id((unsigned long)(random() % signals));
+  switch (random() % 5) {
+    case 0:
+      request = makeRequest(METHOD_POST, "/api/signals/rename");
+      addParam(request, "name", "Soak " + String((unsigned long)(random() % 1000)));
+      break;
+    case 1:
+      request = makeRequest(METHOD_POST, "/api/signals/favorite");
+      addParam(request, "favorite", random() % 2 ? "true" : "false");
+      break;
+    case 2:
+      request = makeRequest(METHOD_POST, "/api/tags");
+      addParam(request, "tag", "soak");
+      break;
+    case 3:
+      request = makeRequest(METHOD_DELETE, "/api/tags");
+      addParam(request, "tag", "soak");
+      break;
+    default:
+      request = makeRequest(METHOD_DELETE, "/api/signals");
+      break;
+  }
+  addParam(request, "id", id);
+  host.request(request);
+}
+
+// Lowest value of field in each quarter after warm-up; a leak lifts every one
+static bool risingFloor(const std::vector<SoakSample>& samples, size_t first,
+                        long (*field)(const SoakSample&), long tolerance, long& growth) {
+  size_t quarter = (samples.size() - first) / 4;
+  growth = 0;
+  if (quarter == 0) {
+    return false;
+  }
+  long floors[4];
+  for (int q = 0; q < 4; q++) {
+    floors[q] = field(samples[first + q * quarter]);
+    for (size_t i = first + q * quarter; i < first + (q + 1) * quarter; i++) {
+      floors[q] = std::min(floors[q], field(samples[i]));
+    }
+  }
+  growth = floors[3] - floors[0];
+  return floors[0] < floors[1] && floors[1] < floors[2] && floors[2] < floors[3] && growth > tolerance;
+}
+
+static long liveBytesOf(const SoakSample& sample) { return sample.alloc.liveBytes; }
+static long liveBlocksOf(const SoakSample& sample) { return sample.alloc.liveBlocks; }
+static long heapBytesOf(const SoakSample& sample) { return sample.heapBytes; }
+static long signalsOf(const SoakSample& sample) { return sample.signals; }
+
+static void writeSample(FILE* out, const SoakSample& sample) {
+  double fragmentation = sample.heapBytes > 0 ? 1.0 - (double)sample.alloc.liveBytes / sample.heapBytes : 0.0;
+  fprintf(out, "%lu,%.2f,%zu,%lu,%lu,%ld,%ld,%ld,%zu,%.4f\n", sample.iteration, sample.uptimeHours,
+          sample.signals, sample.alloc.allocations, sample.alloc.frees, sample.alloc.liveBlocks,
+          sample.alloc.liveBytes, sample.alloc.peakBytes, sample.heapBytes, fragmentation);
+}
+
+// soak [--iterations N] [--samples N] [--step-ms MS] [--warmup PERCENT] [--tolerance BYTES] [--seed S] [--csv FILE]
+int runSoak(const Options& options, int argc, char** argv) {
+  unsigned long iterations = 1000000;
+  unsigned long sampleCount = 200;
+  unsigned long stepMs = 100;
+  unsigned long warmupPercent = 25;
+  long tolerance = 16384;
+  uint32_t seed = 433;
+  const char* csvPath = nullptr;
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--iterations") == 0 && hasValue) {
+      iterations = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--samples") == 0 && hasValue) {
+      sampleCount = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--step-ms") == 0 && hasValue) {
+      stepMs = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--warmup") == 0 && hasValue) {
+      warmupPercent = std::min(strtoul(argv[++i], nullptr, 10), 90UL);
+    } else if (strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+      tolerance = strtol(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--csv") == 0 && hasValue) {
+      csvPath = argv[++i];
+    } else {
+      fprintf(stderr, "soak: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (iterations == 0 || sampleCount == 0) {
+    fprintf(stderr, "soak: --iterations and --samples must be at least 1\n");
+    return 2;
+  }
+  unsigned long sampleEvery = std::max(iterations / sampleCount, 1UL);
+  
+  FILE* csv = nullptr;
+  if (csvPath) {
+    csv = fopen(csvPath, "w");
+    if (!csv) {
+      fprintf(stderr, "soak: cannot write %s\n", csvPath);
+      return 1;
+    }
+    fprintf(csv, "iteration,uptime_h,signals,allocs,frees,live_blocks,live_bytes,peak_bytes,heap_bytes,fragmentation\n");
+  }
+  
+  ManualClock clock;
+  NativeHost host(clock);
+  host.begin();
+  std::mt19937 random(seed);
+  uint32_t nextCode = 0;
+  OperationCost costs[SOAK_OPERATION_COUNT] = {};
+  std::vector<SoakSample> samples;
+  samples.reserve(iterations / sampleEvery + 1);
+  
+  for (unsigned long iteration = 1; iteration <= iterations; iteration++) {
+    clock.advanceMillis(stepMs);
+    int roll = random() % 100;
+    int operation = 0;
+    while (roll >= OPERATION_WEIGHTS[operation]) {
+      roll -= OPERATION_WEIGHTS[operation++];
+    }
+    size_t signals = host.core.snapshot()->size();
+    if (signals == 0 && (operation == SOAK_TRANSMIT || operation == SOAK_EDIT)) {
+      operation = SOAK_CAPTURE;
+    }
+  
+    AllocStats before = allocStats();
+    switch (operation) {
+      case SOAK_CAPTURE: {
+        // Four buttons per remote; new codes sit above the remotes' range
+        uint32_t code = (int)(random() % 100) < NEW_CODE_PERCENT ? 0x800000 + nextCode++ : 0x100000 + random() % (REMOTES * 4);
+        host.radio.inject(RadioFrame{code, 24, 1});
+        host.settle();
+        break;
+      }
+      case SOAK_POLL:
+        poll(host, iteration);
+        break;
+      case SOAK_TRANSMIT: {
+        ApiRequest request = makeRequest(METHOD_POST, "/api/transmit");
+        addParam(request, "id", String((unsigned long)(random() % signals)));
+        host.request(request);
+        host.radio.clearTransmitted();
+        break;
+      }
+      case SOAK_EDIT:
+        edit(host, random, signals);
+        break;
+    }
+    host.pump();
+    AllocStats after = allocStats();
+    costs[operation].count++;
+    costs[operation].allocations += after.allocations - before.allocations;
+    costs[operation].bytes += after.bytesAllocated - before.bytesAllocated;
+  
+    if (iteration % sampleEvery == 0 || iteration == iterations) {
+      SoakSample sample = {iteration, clock.millis() / 3600000.0, host.core.snapshot()->size(), allocStats(), heapFootprint()};
+      samples.push_back(sample);
+      resetAllocPeak();
+      if (csv) {
+        writeSample(csv, sample);
+      }
+      if (options.verbose) {
+        fprintf(stderr, "soak: %lu/%lu, %zu signals, %ld live bytes\n", iteration, iterations,
+                sample.signals, sample.alloc.liveBytes);
+      }
+    }
+  }
+  if (csv) {
+    fclose(csv);
+  }
+  
+  const SoakSample& last = samples.back();
+  printf("%lu iterations, %.1f h simulated, %zu signals at the end\n", iterations, last.uptimeHours, last.signals);
+  printf("%-10s %10s %12s %12s\n", "operation", "count", "allocs/op", "bytes/op");
+  for (int op = 0; op < SOAK_OPERATION_COUNT; op++) {
+    double count = costs[op].count ? costs[op].count : 1;
+    printf("%-10s %10lu %12.1f %12.0f\n", OPERATION_NAMES[op], costs[op].count,
+           costs[op].allocations / count, costs[op].bytes / count);
+  }
+  
+  // Growth checks over the samples after warm-up, once the library and
+  // every cache have had time to reach their working size
+  struct Check {
+    const char* name;
+    long (*field)(const SoakSample&);
+    long tolerance;
+  } checks[] = {
+    {"live bytes", liveBytesOf, tolerance},
+    {"live blocks", liveBlocksOf, tolerance / 64},
+    {"heap footprint", heapBytesOf, tolerance},
+  };
+  size_t first = samples.size() * warmupPercent / 100;
+  long libraryGrowth;
+  if (risingFloor(samples, first, signalsOf, 10, libraryGrowth)) {
+    printf("library still filling (%+ld signals after warm-up); run longer for a verdict\n", libraryGrowth);
+    return 0;
+  }
+  int failures = 0;
+  for (const Check& check : checks) {
+    long growth;
+    bool rising = risingFloor(samples, first, check.field, check.tolerance, growth);
+    if (check.field == heapBytesOf && last.heapBytes == 0) {
+      printf("%-15s n/a (allocator does not report it)\n", check.name);
+      continue;
+    }
+    printf("%-15s floor %+ld after warm-up: %s\n", check.name, growth, rising ? "GROWING" : "ok");
+    failures += rising;
+  }
+  return failures == 0 ? 0 : 1;
+}
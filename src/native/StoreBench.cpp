@@ -0,0 +1,533 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AllocTracker.h"
+#include "Bench.h"
+#include "NativeCommands.h"
+#include "NativeHost.h"
+#include "SignalCodec.h"
+#include "SignalPersistence.h"
+#include "SignalQuery.h"
+#include "SignalStore.h"
+
+// Store benchmarks at growing library sizes. Every operation runs against
+// the real SignalStore/persistence/API code and, where it existed, against
+// the original std::vector<RFSignal> implementation as a baseline.
+
+enum Distribution {
+  DIST_UNIQUE,   // Every capture is a new code: dedup lookups miss
+  DIST_REMOTES   // A few remotes pressed over and over: lookups hit
+};
+
+static const char* DISTRIBUTION_NAMES[] = {"unique", "remotes"};
+static const size_t PROBES = 1000;
+
+struct Workload {
+  std::vector<RFSignal> library;
+  std::vector<RFSignal> captures;  // Dedup probes
+};
+
+// Distinct 24-bit codes: multiplying by an odd constant is a bijection mod 2^24
+static unsigned long scramble(uint32_t i) {
+  return ((i + 1) * 0x9E3779B1u) & 0xFFFFFF;
+}
+
+static Workload makeWorkload(Distribution distribution, size_t size, uint32_t seed) {
+  std::mt19937 rng(seed);
+  Workload workload;
+  workload.library.reserve(size);
+  
+  unsigned long timestamp = 0;
+  for (size_t i = 0; i < size; i++) {
+    RFSignal signal;
+    signal.uid = i;
+    signal.name = "Signal " + String((unsigned long)i);
+    if (distribution == DIST_UNIQUE) {
+      signal.value = scramble(i);
+      signal.protocol = 1;
+    } else {
+      // Four buttons per remote, remotes spread over protocols 1-3
+      uint32_t remote = i / 4;
+      signal.value = (scramble(remote) & 0xFFFFF) << 4 | (i % 4);
+      signal.protocol = 1 + remote % 3;
+    }
+    signal.bitLength = 24;
+    timestamp += 500 + rng() % 1000;
+    signal.timestamp = timestamp;
+    signal.isFavorite = rng() % 20 == 0;
+    workload.library.push_back(signal);
+  }
+  // Timestamps arrive roughly, not strictly, in order
+  std::shuffle(workload.library.begin(), workload.library.end(), rng);
+  
+  std::vector<size_t> active;
+  if (distribution == DIST_REMOTES) {
+    for (int remote = 0; remote < 16 && size > 0; remote++) {
+      active.push_back(rng() % size);
+    }
+  }
+  for (size_t i = 0; i < PROBES; i++) {
+    RFSignal capture;
+    if (distribution == DIST_UNIQUE) {
+      capture.value = 1 + rng() % 0xFFFFFF;
+      capture.bitLength = 32;  // Never in the library
+      capture.protocol = 1;
+    } else {
+      // Each press repeats the frame a few times
+      capture = workload.library[active[(i / 4) % active.size()]];
+    }
+    capture.uid = 0;
+    capture.isFavorite = false;
+    capture.timestamp = timestamp + i;
+    workload.captures.push_back(capture);
+  }
+  return workload;
+}
+
+// The pre-SignalStore implementation, kept as the baseline
+class VectorBaseline {
+public:
+  std::vector<RFSignal> storedSignals;
+
+  bool isDuplicate(const RFSignal& newSignal) {
+    for (auto& signal : storedSignals) {
+      if (signal.value == newSignal.value &&
+          signal.bitLength == newSignal.bitLength &&
+          signal.protocol == newSignal.protocol) {
+        signal.timestamp = newSignal.timestamp;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void performAutoCleanup(size_t signalsToRemove) {
+    std::sort(storedSignals.begin(), storedSignals.end(),
+      [](const RFSignal& a, const RFSignal& b) {
+        if (a.isFavorite && !b.isFavorite) return false;
+        if (!a.isFavorite && b.isFavorite) return true;
+        return a.timestamp < b.timestamp;
+      });
+  
+    size_t removedCount = 0;
+    auto it = storedSignals.begin();
+    while (it != storedSignals.end() && removedCount < signalsToRemove) {
+      if (!it->isFavorite) {
+        it = storedSignals.erase(it);
+        removedCount++;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void cleanupOld(unsigned long cutoffTime) {
+    storedSignals.erase(std::remove_if(storedSignals.begin(), storedSignals.end(),
+      [cutoffTime](const RFSignal& signal) {
+        return !signal.isFavorite && signal.timestamp < cutoffTime;
+      }), storedSignals.end());
+  }
+
+  void save(KeyValueStore& preferences, int signalCount) {
+    preferences.putInt("signalCount", storedSignals.size());
+    preferences.putInt("nextId", signalCount);
+  
+    for (size_t i = 0; i < storedSignals.size(); i++) {
+      String prefix = "sig" + String((unsigned long)i) + "_";
+      const RFSignal& signal = storedSignals[i];
+  
+      preferences.putString((prefix + "name").c_str(), signal.name);
+      preferences.putULong((prefix + "val").c_str(), signal.value);
+      preferences.putUInt((prefix + "bits").c_str(), signal.bitLength);
+      preferences.putUInt((prefix + "proto").c_str(), signal.protocol);
+      preferences.putULong((prefix + "time").c_str(), signal.timestamp);
+      preferences.putBool((prefix + "fav").c_str(), signal.isFavorite);
+    }
+  }
+
+  void load(KeyValueStore& preferences) {
+    int count = preferences.getInt("signalCount", 0);
+    for (int i = 0; i < count; i++) {
+      RFSignal signal;
+      String prefix = "sig" + String(i) + "_";
+  
+      signal.name = preferences.getString((prefix + "name").c_str(), "");
+      signal.value = preferences.getULong((prefix + "val").c_str(), 0);
+      signal.bitLength = preferences.getUInt((prefix + "bits").c_str(), 0);
+      signal.protocol = preferences.getUInt((prefix + "proto").c_str(), 0);
+      signal.timestamp = preferences.getULong((prefix + "time").c_str(), 0);
+      signal.isFavorite = preferences.getBool((prefix + "fav").c_str(), false);
+  
+      if (signal.value != 0) {
+        storedSignals.push_back(signal);
+      }
+    }
+  }
+};
+
+static void fillStore(SignalStore& store, const std::vector<RFSignal>& signals) {
+  for (const RFSignal& signal : signals) {
+    store.add(signal);
+  }
+  store.publish();
+}
+
+static unsigned long medianTimestamp(const std::vector<RFSignal>& signals) {
+  std::vector<unsigned long> timestamps;
+  for (const RFSignal& signal : signals) {
+    timestamps.push_back(signal.timestamp);
+  }
+  std::nth_element(timestamps.begin(), timestamps.begin() + timestamps.size() / 2, timestamps.end());
+  return timestamps.empty() ? 0 : timestamps[timestamps.size() / 2];
+}
+
+static void benchStore(BenchRunner& runner, const Workload& workload, const std::string& suffix) {
+  const std::vector<RFSignal>& library = workload.library;
+  size_t size = library.size();
+  
+  runner.run("insert/store/" + suffix, size, [&](BenchTimer& timer) {
+    SignalStore store;
+    timer.start();
+    fillStore(store, library);
+    timer.stop();
+  });
+  
+  SignalStore filled;
+  fillStore(filled, library);
+  
+  // What the capture path does per frame: find, then refresh the timestamp
+  runner.run("dedup/store/" + suffix, workload.captures.size(), [&](BenchTimer& timer) {
+    timer.start();
+    for (const RFSignal& capture : workload.captures) {
+      int position = filled.find(signalKey(capture));
+      if (position >= 0) {
+        RFSignal updated = filled.at(position);
+        updated.timestamp = capture.timestamp;
+        filled.replace(position, updated);
+      }
+    }
+    timer.stop();
+  });
+  
+  // One capture batch: a single change, then a new snapshot for readers
+  runner.run("publish/store/" + suffix, 1, [&](BenchTimer& timer) {
+    RFSignal updated = filled.at(0);
+    updated.timestamp++;
+    timer.start();
+    filled.replace(0, updated);
+    filled.publish();
+    timer.stop();
+  });
+  
+  runner.run("evict/store/" + suffix, size / 5, [&](BenchTimer& timer) {
+    SignalStore store;
+    fillStore(store, library);
+    timer.start();
+    store.evictOldest(size / 5);
+    store.publish();
+    timer.stop();
+  });
+  
+  unsigned long cutoff = medianTimestamp(library);
+  runner.run("cleanup_age/store/" + suffix, size, [&](BenchTimer& timer) {
+    SignalStore store;
+    fillStore(store, library);
+    timer.start();
+    store.removeIf([cutoff](const RFSignal& signal) {
+      return !signal.isFavorite && signal.timestamp < cutoff;
+    });
+    store.publish();
+    timer.stop();
+  });
+  
+  runner.run("save/store/" + suffix, size, [&](BenchTimer& timer) {
+    MemoryStore preferences;
+    timer.start();
+    saveSignals(preferences, filled, size);
+    timer.stop();
+  });
+  
+  MemoryStore saved;
+  saveSignals(saved, filled, size);
+  runner.run("load/store/" + suffix, size, [&](BenchTimer& timer) {
+    SignalStore store;
+    int nextId;
+    timer.start();
+    loadSignals(saved, store, nextId, size);
+    timer.stop();
+  });
+}
+
+static void benchBaseline(BenchRunner& runner, const Workload& workload, const std::string& suffix) {
+  const std::vector<RFSignal>& library = workload.library;
+  size_t size = library.size();
+  
+  runner.run("insert/vector/" + suffix, size, [&](BenchTimer& timer) {
+    VectorBaseline baseline;
+    timer.start();
+    for (const RFSignal& signal : library) {
+      baseline.storedSignals.push_back(signal);
+    }
+    timer.stop();
+  });
+  
+  VectorBaseline filled;
+  filled.storedSignals = library;
+  runner.run("dedup/vector/" + suffix, workload.captures.size(), [&](BenchTimer& timer) {
+    timer.start();
+    for (const RFSignal& capture : workload.captures) {
+      filled.isDuplicate(capture);
+    }
+    timer.stop();
+  });
+  
+  runner.run("evict/vector/" + suffix, size / 5, [&](BenchTimer& timer) {
+    VectorBaseline baseline;
+    baseline.storedSignals = library;
+    timer.start();
+    baseline.performAutoCleanup(size / 5);
+    timer.stop();
+  });
+  
+  unsigned long cutoff = medianTimestamp(library);
+  runner.run("cleanup_age/vector/" + suffix, size, [&](BenchTimer& timer) {
+    VectorBaseline baseline;
+    baseline.storedSignals = library;
+    timer.start();
+    baseline.cleanupOld(cutoff);
+    timer.stop();
+  });
+  
+  runner.run("save/vector/" + suffix, size, [&](BenchTimer& timer) {
+    MemoryStore preferences;
+    timer.start();
+    filled.save(preferences, size);
+    timer.stop();
+  });
+  
+  MemoryStore saved;
+  filled.save(saved, size);
+  runner.run("load/vector/" + suffix, size, [&](BenchTimer& timer) {
+    VectorBaseline baseline;
+    timer.start();
+    baseline.load(saved);
+    timer.stop();
+  });
+}
+
+// Filter expressions as /api/signals/query and /api/signals/tagged run
+// them; the row name carries the index that narrowed the scan
+static void benchQueries(BenchRunner& runner, const Workload& workload, const std::string& suffix) {
+  const std::vector<RFSignal>& library = workload.library;
+  size_t size = library.size();
+  SignalStore store;
+  unsigned long now = 0;
+  for (const RFSignal& signal : library) {
+    store.add(signal);
+    now = std::max(now, signal.timestamp);
+  }
+  for (size_t i = 0; i < size; i += 10) {
+    store.tagSignal(i, "garage");
+  }
+  store.publish();
+  SignalStore::Snapshot snapshot = store.snapshot();
+  
+  // Protocol 2 is absent from the unique library and a third of the remotes;
+  // the last tenth of the timeline; "Signal 12", "Signal 120"...
+  const char* names[] = {"query_protocol", "query_seen", "query_prefix"};
+  String expressions[] = {"protocol = 2", "seen < " + String((unsigned long)(size / 10)), "name ^= \"Signal 12\""};
+  for (size_t q = 0; q < 3; q++) {
+    SignalQuery query;
+    String error;
+    if (!compileSignalQuery(expressions[q], query, error)) {
+      fprintf(stderr, "bench: %s: %s\n", expressions[q].c_str(), error.c_str());
+      continue;
+    }
+    std::vector<uint32_t> matches;
+    QueryIndex index = runSignalQuery(query, *snapshot, now, matches);
+    if (runner.run(std::string(names[q]) + "/" + queryIndexName(index) + "/" + suffix, 1, [&](BenchTimer& timer) {
+      matches.clear();
+      timer.start();
+      runSignalQuery(query, *snapshot, now, matches);
+      timer.stop();
+    })) {
+      runner.addCounter("matches", matches.size());
+    }
+  }
+  
+  std::vector<uint32_t> matches;
+  if (runner.run("query_tag/tags/" + suffix, 1, [&](BenchTimer& timer) {
+    timer.start();
+    RoaringBitmap selected;
+    String error;
+    snapshot->tags.select("tag:garage", selected, error);
+    std::vector<uint32_t> uids;
+    selected.toVector(uids);
+    matches.clear();
+    for (uint32_t uid : uids) {
+      int position = snapshot->positionOf(uid);
+      if (position >= 0) {
+        matches.push_back(position);
+      }
+    }
+    std::sort(matches.begin(), matches.end());
+    timer.stop();
+  })) {
+    runner.addCounter("matches", matches.size());
+  }
+}
+
+// Listing goes through the real API handlers on a loaded host
+static void benchListing(BenchRunner& runner, const Workload& workload, const std::string& suffix) {
+  // Room for the whole library, or begin() would load only MAX_SIGNALS of it
+  SystemClock clock;
+  NativeHost host(clock, NativeHost::UNLIMITED, workload.library.size());
+  SignalStore library;
+  fillStore(library, workload.library);
+  saveSignals(host.storage, library, workload.library.size());
+  host.begin();
+  
+  ApiRequest page;
+  page.method = METHOD_GET;
+  page.path = "/api/signals/query";
+  page.params.push_back(ApiParam{"limit", "100", false});
+  runner.run("list_page/store/" + suffix, 1, [&](BenchTimer& timer) {
+    timer.start();
+    host.request(page);
+    timer.stop();
+  });
+  
+  size_t bytes = 0;
+  if (runner.run("list_all/store/" + suffix, 1, [&](BenchTimer& timer) {
+    timer.start();
+    bytes = host.request(METHOD_GET, "/api/signals").body.length();
+    timer.stop();
+  })) {
+    runner.addCounter("bytes", bytes);
+  }
+  
+  // A cached dashboard's poll after a remote was pressed again, and after nothing happened
+  ApiRequest changes;
+  changes.method = METHOD_GET;
+  changes.path = "/api/signals";
+  changes.params.push_back(ApiParam{"epoch", String((unsigned long)host.core.libraryEpoch()), false});
+  changes.params.push_back(ApiParam{"since", String(), false});
+  size_t pressed = 0;
+  if (runner.run("list_delta/store/" + suffix, 1, [&](BenchTimer& timer) {
+    SignalStore::Snapshot before = host.core.snapshot();
+    const RFSignal& signal = (*before)[pressed++ % before->size()];
+    host.radio.inject(RadioFrame{signal.value, signal.bitLength, signal.protocol});
+    host.settle();
+    changes.params.back().value = String((unsigned long)before->revision);
+    timer.start();
+    bytes = host.request(changes).body.length();
+    timer.stop();
+  })) {
+    runner.addCounter("bytes", bytes);
+  }
+  
+  changes.params.back().value = String((unsigned long)host.core.snapshot()->revision);
+  if (runner.run("list_unchanged/store/" + suffix, 1, [&](BenchTimer& timer) {
+    timer.start();
+    bytes = host.request(changes).body.length();
+    timer.stop();
+  })) {
+    runner.addCounter("bytes", bytes);
+  }
+  
+  runner.run("export/store/" + suffix, workload.library.size(), [&](BenchTimer& timer) {
+    timer.start();
+    host.request(METHOD_GET, "/api/export");
+    timer.stop();
+  });
+  
+  // Restoring that export: what /api/import parses and stages before the
+  // owner applies it. peak_bytes is the heap it needs on top of the library.
+  size_t size = workload.library.size();
+  static const char* FORMATS[] = {"ndjson", "binary"};
+  for (const char* format : FORMATS) {
+    ApiRequest exportRequest;
+    exportRequest.method = METHOD_GET;
+    exportRequest.path = "/api/export";
+    exportRequest.params.push_back(ApiParam{"format", format, false});
+    String body = host.request(exportRequest).body;
+    const uint8_t* data = (const uint8_t*)body.c_str();
+    long peak = 0;
+    if (runner.run(std::string("import/") + format + "/" + suffix, size, [&](BenchTimer& timer) {
+      long before = allocStats().liveBytes;
+      resetAllocPeak();
+      timer.start();
+      SignalImporter importer(size);
+      for (size_t offset = 0; offset < body.length(); offset += 1436) {
+        importer.feed(data + offset, std::min<size_t>(1436, body.length() - offset));
+      }
+      importer.finish();
+      timer.stop();
+      peak = std::max(peak, allocStats().peakBytes - before);
+    })) {
+      runner.addCounter("peak_bytes", peak);
+    }
+  }
+}
+
+// bench [--sizes 1000,10000,100000] [--min-time SECONDS] [--filter TEXT] [--json FILE]
+int runBench(const Options& options, int argc, char** argv) {
+  std::vector<size_t> sizes = {1000, 10000, 100000};
+  double minSeconds = 0.2;
+  const char* filter = nullptr;
+  const char* jsonPath = nullptr;
+  
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--sizes") == 0 && hasValue) {
+      sizes.clear();
+      for (char* size = strtok(argv[++i], ","); size; size = strtok(nullptr, ",")) {
+        sizes.push_back(strtoul(size, nullptr, 10));
+      }
+    } else if (strcmp(argv[i], "--min-time") == 0 && hasValue) {
+      minSeconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--json") == 0 && hasValue) {
+      jsonPath = argv[++i];
+    } else {
+      fprintf(stderr, "bench: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  
+  BenchRunner runner(minSeconds, filter);
+  for (int distribution = DIST_UNIQUE; distribution <= DIST_REMOTES; distribution++) {
+    for (size_t size : sizes) {
+      Workload workload = makeWorkload((Distribution)distribution, size, 433);
+      std::string suffix = std::string(DISTRIBUTION_NAMES[distribution]) + "/" + std::to_string(size);
+      benchStore(runner, workload, suffix);
+      benchBaseline(runner, workload, suffix);
+      benchQueries(runner, workload, suffix);
+      benchListing(runner, workload, suffix);
+    }
+  }
+  benchParsers(runner);
+  benchFlash(runner);
+  benchRules(runner);
+  benchTranslations(runner);
+  benchFilters(runner);
+  benchAnalytics(runner);
+  
+  runner.printTable(stdout);
+  if (jsonPath) {
+    FILE* out = fopen(jsonPath, "w");
+    if (!out) {
+      fprintf(stderr, "bench: cannot write %s\n", jsonPath);
+      return 1;
+    }
+    runner.writeJson(out);
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "NativeCommands.h"
+#include "SignalQuery.h"
+#include "SignalStore.h"
+
+// The snapshot contract under contention: one writer adds, replaces,
+// erases, tags, evicts and publishes while reader threads walk whatever
+// snapshot is current, run queries and tag selections over it and check
+// that it is consistent with itself. Meant for the tsan environment, where
+// any unsynchronised sharing between the writer and a snapshot is reported.
+
+static const char* TAGS[] = {"garage", "house", "car"};
+
+struct ReaderTotals {
+  unsigned long snapshots;
+  unsigned long signals;
+  unsigned long failures;
+};
+
+// Everything a snapshot holds must describe the same records
+static bool checkSnapshot(const SignalSnapshot& snapshot, const SignalQuery& query, unsigned long& signals) {
+  size_t size = snapshot.size();
+  const SignalColumns& columns = snapshot.columns;
+  if (columns.uid.size() != size || columns.revision.size() != size || snapshot.uidOrder.size() != size) {
+    return false;
+  }
+  for (size_t i = 0; i < size; i++) {
+    const RFSignal& signal = snapshot[i];
+    if (columns.uid[i] != signal.uid || columns.value[i] != signal.value ||
+        columns.timestamp[i] != signal.timestamp || columns.protocol[i] != signal.protocol ||
+        columns.favorite[i] != signal.isFavorite || columns.revision[i] > snapshot.revision) {
+      return false;
+    }
+  }
+  for (size_t i = 1; i < size; i++) {
+    if (columns.uid[snapshot.uidOrder[i - 1]] >= columns.uid[snapshot.uidOrder[i]]) {
+      return false;
+    }
+  }
+  signals += size;
+  
+#if RF_INDEX_PROTOCOL
+  size_t posted = 0;
+  for (unsigned int protocol = 0; protocol <= ProtocolIndex::MAX_PROTOCOL; protocol++) {
+    for (uint32_t uid : snapshot.indexes.protocol->postings(protocol)) {
+      int position = snapshot.positionOf(uid);
+      if (position < 0 || snapshot[position].protocol != protocol) {
+        return false;
+      }
+      posted++;
+    }
+  }
+  if (posted != size) {
+    return false;
+  }
+#endif
+#if RF_INDEX_TIME
+  size_t timed = 0;
+  for (const TimeIndex::Entry* entry = snapshot.indexes.time->begin(0); entry != snapshot.indexes.time->end();
+       entry++) {
+    int position = snapshot.positionOf(entry->uid);
+    if (position < 0 || snapshot[position].timestamp != entry->timestamp) {
+      return false;
+    }
+    timed++;
+  }
+  if (timed != size) {
+    return false;
+  }
+#endif
+  
+  RoaringBitmap all;
+  String error;
+  if (!snapshot.tags.select("all", all, error) || all.cardinality() != size) {
+    return false;
+  }
+  RoaringBitmap tagged;
+  if (!snapshot.tags.select("tag:garage OR (tag:house AND NOT favorite)", tagged, error)) {
+    return false;
+  }
+  std::vector<uint32_t> uids;
+  tagged.toVector(uids);
+  for (uint32_t uid : uids) {
+    if (snapshot.positionOf(uid) < 0) {
+      return false;
+    }
+  }
+  
+  std::vector<uint32_t> matches;
+  runSignalQuery(query, snapshot, 0, matches);
+  for (uint32_t position : matches) {
+    if (position >= size || snapshot[position].protocol != 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// stress [--ops N] [--readers N] [--size N] [--seed S]
+int runStress(const Options& options, int argc, char** argv) {
+  unsigned long ops = 50000;
+  unsigned long readers = 4;
+  unsigned long size = 1000;
+  uint32_t seed = 51;
+  for (int i = 0; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--ops") == 0 && hasValue) {
+      ops = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--readers") == 0 && hasValue) {
+      readers = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+      size = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "stress: unknown argument '%s'\n", argv[i]);
+      return 2;
+    }
+  }
+  if (readers == 0 || size < 10) {
+    fprintf(stderr, "stress: need at least 1 reader and --size 10\n");
+    return 2;
+  }
+  
+  SignalQuery query;
+  String error;
+  if (!compileSignalQuery("protocol = 2 and name ^= \"s\"", query, error)) {
+    fprintf(stderr, "stress: %s\n", error.c_str());
+    return 1;
+  }
+  
+  SignalStore store;
+  std::atomic<bool> running(true);
+  std::vector<ReaderTotals> totals(readers, ReaderTotals());
+  std::vector<std::thread> threads;
+  for (unsigned long r = 0; r < readers; r++) {
+    threads.push_back(std::thread([&, r]() {
+      ReaderTotals& mine = totals[r];
+      while (running.load()) {
+        SignalStore::Snapshot snapshot = store.snapshot();
+        mine.snapshots++;
+        if (!checkSnapshot(*snapshot, query, mine.signals)) {
+          mine.failures++;
+        }
+      }
+    }));
+  }
+  
+  // The owner: a handful of changes per publish, as a batch of commands
+  std::mt19937 random(seed);
+  uint32_t nextUid = 0;
+  unsigned long publishes = 0;
+  for (unsigned long op = 0; op < ops; op++) {
+    size_t count = store.size();
+    unsigned int pick = random() % 16;
+    if (count < size / 2 || pick < 6) {
+      RFSignal signal;
+      signal.uid = nextUid++;
+      signal.name = "s" + String(signal.uid % 97);
+      signal.value = random();
+      signal.bitLength = 24;
+      signal.protocol = 1 + random() % 4;
+      signal.timestamp = op;
+      signal.isFavorite = random() % 8 == 0;
+      store.add(signal);
+    } else if (pick < 9) {
+      RFSignal updated = store.at(random() % count);
+      updated.timestamp = op;
+      updated.isFavorite = !updated.isFavorite;
+      updated.name = "t" + String(op % 13);
+      store.replace(store.positionOf(updated.uid), updated);
+    } else if (pick < 11) {
+      store.erase(random() % count);
+    } else if (pick < 13) {
+      store.tagSignal(random() % count, TAGS[random() % 3]);
+    } else if (pick < 14) {
+      store.untagSignal(random() % count, TAGS[random() % 3]);
+    } else if (count > size) {
+      store.evictOldest(count / 5);
+    }
+    if (random() % 4 == 0) {
+      store.publish();
+      publishes++;
+    }
+    if (options.verbose && (op + 1) % 50000 == 0) {
+      fprintf(stderr, "stress: %lu/%lu changes\n", op + 1, ops);
+    }
+  }
+  store.publish();
+  running.store(false);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  
+  unsigned long snapshots = 0, signals = 0, failures = 0;
+  for (const ReaderTotals& reader : totals) {
+    snapshots += reader.snapshots;
+    signals += reader.signals;
+    failures += reader.failures;
+  }
+  printf("%lu changes in %lu publishes, %lu readers: %lu snapshots checked (%lu signals), %lu inconsistent\n", ops,
+         publishes, readers, snapshots, signals, failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LogRing.h"
+#include "NativeCommands.h"
+#include "NativeHost.h"
+
+// Host entry point for env:native. Each subcommand drives a NativeHost the
+// way the ESP32's loop() and web server would.
+
+typedef int (*CommandMain)(const Options& options, int argc, char** argv);
+
+struct Subcommand {
+  const char* name;
+  const char* args;
+  const char* help;
+  CommandMain run;
+};
+
+static const Subcommand SUBCOMMANDS[] = {
+  {"run", "", "Execute a script from stdin (frame, GET/POST/DELETE, import, sleep, sent)", runScript},
+  {"bench", "[--sizes N,..] [--json FILE]", "Store, persistence and listing benchmarks", runBench},
+  {"generate", "<scenario> [--pulses F] [--frames F]", "Synthesize RF traffic from a scenario", runGenerate},
+  {"replay", "[--speed X] <trace|scenario>..", "Feed traffic through the receive path", runReplay},
+  {"fuzz", "<target|all> [--runs N] [input..]", "Mutation-fuzz the parsers and loaders", runFuzz},
+  {"powerloss", "[--signals N] [--mutation NAME]", "Cut power at every flash write of a save", runPowerLoss},
+  {"soak", "[--iterations N] [--csv FILE]", "Accelerated uptime run tracking heap growth", runSoak},
+  {"latency", "[--rate HZ] [--loads R,..] [--poll-ms MS]", "RF frame to stored, pushed and polled latency", runLatency},
+  {"analytics", "[--frames N] [--codes N] [--skew S]", "Sketch accuracy against exact counts", runAnalytics},
+  {"flood", "[--frames N] [--clients N]", "Captures against an API command flood", runFlood},
+  {"stress", "[--ops N] [--readers N] [--size N]", "One store writer against snapshot readers", runStress},
+};
+
+static void usage() {
+  fprintf(stderr, "usage: program [--store FILE] [--verbose] <command> [args]\n\n");
+  for (const Subcommand& command : SUBCOMMANDS) {
+    fprintf(stderr, "  %-9s %-38s %s\n", command.name, command.args, command.help);
+  }
+}
+
+static bool parseMethod(const std::string& word, HttpMethod& method) {
+  if (word == "GET") {
+    method = METHOD_GET;
+  } else if (word == "POST") {
+    method = METHOD_POST;
+  } else if (word == "DELETE") {
+    method = METHOD_DELETE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void printResponse(const ApiResponse& response) {
+  printf("%d %s\n", response.status, response.body.c_str());
+}
+
+// One directive per line:
+//   frame <value> <bits> <protocol>     decoded frame from the receiver
+//   GET|POST|DELETE <path> [k=v ...]    API request; POST params are form body
+//   import <file>                       /api/import upload
+//   sleep <ms>                          keep the owner task running
+//   sent                                print the frames transmitted since the last one
+//   # comment
+int runScript(const Options& options, int argc, char** argv) {
+  SystemClock clock;
+  NativeHost host(clock);
+  if (options.storePath) {
+    host.storage.open(options.storePath);
+  }
+  host.begin();
+  
+  std::string line;
+  int lineNumber = 0;
+  int errors = 0;
+  while (std::getline(std::cin, line)) {
+    lineNumber++;
+    std::istringstream words(line);
+    std::string directive;
+    if (!(words >> directive) || directive[0] == '#') {
+      continue;
+    }
+  
+    HttpMethod method;
+    if (directive == "frame") {
+      RadioFrame frame = {0, 0, 0};
+      if (!(words >> frame.value >> frame.bitLength >> frame.protocol)) {
+        fprintf(stderr, "line %d: frame <value> <bits> <protocol>\n", lineNumber);
+        errors++;
+        continue;
+      }
+      host.radio.inject(frame);
+      host.settle();
+    } else if (parseMethod(directive, method)) {
+      ApiRequest request;
+      request.method = method;
+      request.client = 0x0100007f;
+      std::string path;
+      words >> path;
+      request.path = path.c_str();
+      std::string param;
+      while (words >> param) {
+        size_t equals = param.find('=');
+        String name = param.substr(0, equals).c_str();
+        String value = equals == std::string::npos ? "" : param.substr(equals + 1).c_str();
+        request.params.push_back(ApiParam{name, value, method == METHOD_POST});
+      }
+      printResponse(host.request(request));
+    } else if (directive == "import") {
+      std::string file;
+      words >> file;
+      std::ifstream in(file.c_str(), std::ios::binary);
+      if (!in) {
+        fprintf(stderr, "line %d: cannot read %s\n", lineNumber, file.c_str());
+        errors++;
+        continue;
+      }
+      std::vector<uint8_t> body((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      printResponse(host.importBody(body.data(), body.size()));
+    } else if (directive == "sent") {
+      for (const RadioFrame& sent : host.radio.transmitted()) {
+        printf("sent %lu %u %u\n", sent.value, sent.bitLength, sent.protocol);
+      }
+      host.radio.clearTransmitted();
+    } else if (directive == "sleep") {
+      unsigned long ms = 0;
+      words >> ms;
+      unsigned long until = clock.millis() + ms;
+      while (clock.millis() < until) {
+        host.pump(1);
+      }
+    } else {
+      fprintf(stderr, "line %d: unknown directive '%s'\n", lineNumber, directive.c_str());
+      errors++;
+    }
+  }
+  
+  // Let repeat transmissions and queued commands finish before saving
+  host.pump();
+  if (!host.storage.save()) {
+    fprintf(stderr, "cannot write %s\n", options.storePath);
+    errors++;
+  }
+  return errors == 0 ? 0 : 1;
+}
+
+// Stands in for the device's log_drain task
+static void drainLogs() {
+  char line[96];
+  uint32_t lost = logRing.drain([&line](const LogEntry& entry) {
+    LogRing::format(entry, line, sizeof(line));
+    Serial.println(line);
+  }, LogRing::CAPACITY);
+  if (lost) {
+    Serial.printf("(%u log entries lost)\n", lost);
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options = {nullptr, false};
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; arg++) {
+    if (strcmp(argv[arg], "--store") == 0 && arg + 1 < argc) {
+      options.storePath = argv[++arg];
+    } else if (strcmp(argv[arg], "--verbose") == 0) {
+      options.verbose = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (arg >= argc) {
+    usage();
+    return 2;
+  }
+  
+  // The core logs to Serial like on the device; keep it off stdout unless asked
+  Serial.setOutput(options.verbose ? stderr : nullptr);
+  
+  for (const Subcommand& command : SUBCOMMANDS) {
+    if (strcmp(argv[arg], command.name) == 0) {
+      std::atomic<bool> running(true);
+      std::thread logDrain;
+      if (options.verbose) {
+        logDrain = std::thread([&running]() {
+          while (running.load()) {
+            drainLogs();
+            delay(20);
+          }
+        });
+      }
+      int status = command.run(options, argc - arg - 1, argv + arg + 1);
+      running.store(false);
+      if (logDrain.joinable()) {
+        logDrain.join();
+        drainLogs();
+      }
+      return status;
+    }
+  }
+  usage();
+  return 2;
+}